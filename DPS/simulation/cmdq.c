@@ -0,0 +1,238 @@
+// cmdq.c
+
+#include "cmdq.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+static uint32_t ring_capacity(int slots) {
+    uint64_t want = (uint64_t)CMD_QUEUE_SIZE * (uint64_t)slots;
+    uint32_t cap = 1;
+    while (cap < want) cap <<= 1;
+    return cap;
+}
+
+int cmdq_init(CommandQueue* q, int slots, CmdQueueMode mode) {
+    memset(q, 0, sizeof(*q));
+    q->wake_fd = -1;
+    if (slots <= 0) return -1;
+    q->mode = mode;
+    q->slots = slots;
+
+    uint32_t cap = ring_capacity(slots);
+    q->mask = cap - 1;
+    q->ring = calloc(cap, sizeof(*q->ring));
+    q->sent_id = calloc((size_t)slots, sizeof(*q->sent_id));
+    if (!q->ring || !q->sent_id) goto fail;
+    if (mode == CMDQ_LATEST_WINS) {
+        void* boxes = NULL;
+        if (posix_memalign(&boxes, CMDQ_CACHELINE, sizeof(CmdMailbox) * (size_t)slots) != 0) goto fail;
+        q->mailbox = boxes;
+        memset(q->mailbox, 0, sizeof(CmdMailbox) * (size_t)slots);
+        q->dirty = calloc(((size_t)slots + 63) / 64, sizeof(*q->dirty));
+        q->taken = calloc((size_t)slots, sizeof(*q->taken));
+        if (!q->dirty || !q->taken) goto fail;
+    }
+    q->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (q->wake_fd < 0) goto fail;
+    return 0;
+
+fail:
+    cmdq_destroy(q);
+    return -1;
+}
+
+void cmdq_destroy(CommandQueue* q) {
+    if (q->wake_fd >= 0) close(q->wake_fd);
+    free(q->ring);
+    free(q->sent_id);
+    free(q->mailbox);
+    free(q->dirty);
+    free(q->taken);
+    memset(q, 0, sizeof(*q));
+    q->wake_fd = -1;
+}
+
+/* Producer: wake the consumer if it announced itself idle */
+static void cmdq_wake(CommandQueue* q) {
+    /* Publish before checking for a parked consumer (pairs with the fence in cmdq_pop) */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&q->consumer_idle, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&q->consumer_idle, 0, __ATOMIC_ACQ_REL)) {
+        uint64_t one = 1;
+        ssize_t w = write(q->wake_fd, &one, sizeof(one));
+        (void)w; // EAGAIN only if the counter is saturated, i.e. already signaled
+        __atomic_fetch_add(&q->stats.wakeups, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static int ring_push(CommandQueue* q, int slot, const LeaderCommand* cmd) {
+    uint64_t tail = q->tail;
+    if (tail - q->head_cache > q->mask) {
+        /* Looks full: refresh the consumer's index */
+        q->head_cache = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+        if (tail - q->head_cache > q->mask) return -1;
+    }
+    CmdQueueCell* cell = &q->ring[tail & q->mask];
+    cell->cmd = *cmd;
+    cell->slot = slot;
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static void mailbox_put(CommandQueue* q, int slot, const LeaderCommand* cmd) {
+    CmdMailbox* m = &q->mailbox[slot];
+    uint32_t seq = m->seq;
+    __atomic_store_n(&m->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    m->cmd = *cmd;
+    __atomic_store_n(&m->seq, seq + 2, __ATOMIC_RELEASE);
+
+    uint64_t bit = (uint64_t)1 << (slot & 63);
+    if (__atomic_fetch_or(&q->dirty[slot >> 6], bit, __ATOMIC_RELEASE) & bit) {
+        __atomic_fetch_add(&q->stats.replaced, 1, __ATOMIC_RELAXED);
+    }
+}
+
+//FUNC: Queue a command (producer only; never blocks)
+int cmdq_push(CommandQueue* q, int slot, const LeaderCommand* cmd) {
+    if (slot < 0 || slot >= q->slots) return -1;
+    if (q->mode == CMDQ_LATEST_WINS && !cmd->is_turning_event && !cmd->is_heartbeat) {
+        mailbox_put(q, slot, cmd);
+    } else if (ring_push(q, slot, cmd) < 0) {
+        __atomic_fetch_add(&q->stats.dropped, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+    __atomic_fetch_add(&q->stats.pushed, 1, __ATOMIC_RELAXED);
+    cmdq_wake(q);
+    return 0;
+}
+
+/* Consumer: consistent copy of a mailbox (retries while the producer writes it) */
+static void mailbox_take(CmdMailbox* m, LeaderCommand* out) {
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&m->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue;
+        *out = m->cmd;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&m->seq, __ATOMIC_RELAXED) == seq) return;
+    }
+}
+
+static int cmd_order(const void* a, const void* b) {
+    const LeaderCommand* x = a;
+    const LeaderCommand* y = b;
+    if (x->platoon_id != y->platoon_id) return x->platoon_id < y->platoon_id ? -1 : 1;
+    if (x->command_id != y->command_id) return x->command_id < y->command_id ? -1 : 1;
+    /* A heartbeat names the command it follows */
+    return x->is_heartbeat - y->is_heartbeat;
+}
+
+/* Newest command handed out for slot */
+static void note_sent(CommandQueue* q, int slot, uint64_t id) {
+    if (id > q->sent_id[slot]) q->sent_id[slot] = id;
+}
+
+static int cmdq_drain(CommandQueue* q, LeaderCommand* out, int max) {
+    int n = 0;
+    int boxed = 0;
+
+    /* Mailboxes before the ring: a turn pushed before a mailbox state we see
+     * is then already visible in the ring */
+    if (q->mode == CMDQ_LATEST_WINS) {
+        int words = (q->slots + 63) / 64;
+        for (int w = 0; w < words && n < max; w++) {
+            if (!__atomic_load_n(&q->dirty[w], __ATOMIC_RELAXED)) continue;
+            uint64_t bits = __atomic_exchange_n(&q->dirty[w], 0, __ATOMIC_ACQUIRE);
+            while (bits) {
+                if (n == max) {
+                    /* No room: leave the rest pending */
+                    __atomic_fetch_or(&q->dirty[w], bits, __ATOMIC_RELAXED);
+                    break;
+                }
+                int slot = w * 64 + __builtin_ctzll(bits);
+                bits &= bits - 1;
+                mailbox_take(&q->mailbox[slot], &out[n]);
+                /* Already handed out (re-flagged by a later write we read early) */
+                if (out[n].command_id <= q->sent_id[slot]) continue;
+                q->taken[n++] = slot;
+            }
+        }
+        boxed = n;
+        for (int i = 0; i < boxed; i++) note_sent(q, q->taken[i], out[i].command_id);
+    }
+
+    uint64_t head = q->head;
+    while (n < max) {
+        if (head == q->tail_cache) {
+            q->tail_cache = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+            if (head == q->tail_cache) break;
+        }
+        CmdQueueCell* cell = &q->ring[head & q->mask];
+        out[n++] = cell->cmd;
+        if (!cell->cmd.is_heartbeat) note_sent(q, cell->slot, cell->cmd.command_id);
+        head++;
+    }
+    __atomic_store_n(&q->head, head, __ATOMIC_RELEASE);
+
+    /* Mailbox states and ring turns interleave by command_id per platoon */
+    if (boxed > 0 && n > 1) qsort(out, (size_t)n, sizeof(*out), cmd_order);
+    return n;
+}
+
+//FUNC: Take queued commands without blocking (consumer only)
+int cmdq_try_pop(CommandQueue* q, LeaderCommand* out, int max) {
+    if (max <= 0) return 0;
+    return cmdq_drain(q, out, max);
+}
+
+//FUNC: Take queued commands, sleeping while there are none (consumer only)
+int cmdq_pop(CommandQueue* q, LeaderCommand* out, int max) {
+    if (max <= 0) return 0;
+    while (!__atomic_load_n(&q->closed, __ATOMIC_ACQUIRE)) {
+        int n = cmdq_drain(q, out, max);
+        if (n > 0) return n;
+
+        /* Announce the park, then re-check so a concurrent push is not lost */
+        __atomic_store_n(&q->consumer_idle, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        n = cmdq_drain(q, out, max);
+        if (n > 0 || __atomic_load_n(&q->closed, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&q->consumer_idle, 0, __ATOMIC_RELAXED);
+            return n;
+        }
+
+        q->parks++;
+        struct pollfd pfd = {.fd = q->wake_fd, .events = POLLIN};
+        while (poll(&pfd, 1, -1) < 0 && errno == EINTR) {
+        }
+        uint64_t count;
+        ssize_t r = read(q->wake_fd, &count, sizeof(count));
+        (void)r;
+    }
+    return 0;
+}
+
+int cmdq_batch_max(const CommandQueue* q) {
+    return (int)(q->mask + 1) + (q->mode == CMDQ_LATEST_WINS ? q->slots : 0);
+}
+
+void cmdq_close(CommandQueue* q) {
+    __atomic_store_n(&q->closed, 1, __ATOMIC_RELEASE);
+    if (q->wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t w = write(q->wake_fd, &one, sizeof(one));
+        (void)w;
+    }
+}
+
+void cmdq_get_stats(const CommandQueue* q, CmdQueueStats* out) {
+    out->pushed = __atomic_load_n(&q->stats.pushed, __ATOMIC_RELAXED);
+    out->dropped = __atomic_load_n(&q->stats.dropped, __ATOMIC_RELAXED);
+    out->replaced = __atomic_load_n(&q->stats.replaced, __ATOMIC_RELAXED);
+    out->wakeups = __atomic_load_n(&q->stats.wakeups, __ATOMIC_RELAXED);
+}
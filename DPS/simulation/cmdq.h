@@ -0,0 +1,101 @@
+#ifndef CMDQ_H
+#define CMDQ_H
+
+#include <stdint.h>
+
+#include "truckplatoon.h"
+
+/* Cruise command queue from a leader shard's FSM (the only producer) to its
+ * sender thread (the only consumer).
+ *
+ * CMDQ_FIFO: a wait-free single-producer/single-consumer ring. Every command
+ * goes out in order; a push onto a full ring drops the new command.
+ * CMDQ_LATEST_WINS: each platoon has a one-command mailbox that a push simply
+ * overwrites, so a sender that falls behind always transmits the newest
+ * leader state and never works through a backlog. Turning commands still go
+ * through the ring, because the turn point is not repeated by later commands,
+ * and so do heartbeats, which must not overwrite the command they name.
+ * A pop of cmdq_batch_max() hands out each platoon's commands in command_id
+ * order and never one older than a command an earlier pop handed out.
+ *
+ * Producer, consumer and wakeup state sit on separate cache lines, and each
+ * side caches the other's index so the shared lines are only read when the
+ * ring looks full or empty. The consumer parks on an eventfd only after
+ * announcing itself idle; a push makes the write() only in that case.
+ */
+#define CMDQ_CACHELINE 64
+
+typedef enum {
+    CMDQ_FIFO = 0,
+    CMDQ_LATEST_WINS
+} CmdQueueMode;
+
+typedef struct {
+    LeaderCommand cmd;
+    int32_t slot;                   // platoon index within the shard
+} CmdQueueCell;
+
+/* Latest-wins mailbox: seq is odd while the producer writes cmd (seqlock) */
+typedef struct {
+    uint32_t seq;
+    LeaderCommand cmd;
+} __attribute__((aligned(CMDQ_CACHELINE))) CmdMailbox;
+
+typedef struct {
+    uint64_t pushed;
+    uint64_t dropped;               // ring full
+    uint64_t replaced;              // latest-wins: overwritten before the sender took it
+    uint64_t wakeups;               // eventfd writes
+} CmdQueueStats;
+
+typedef struct {
+    /* Producer line */
+    uint64_t tail __attribute__((aligned(CMDQ_CACHELINE)));
+    uint64_t head_cache;
+    CmdQueueStats stats;            // written by the producer, read atomically
+
+    /* Consumer line */
+    uint64_t head __attribute__((aligned(CMDQ_CACHELINE)));
+    uint64_t tail_cache;
+    uint64_t parks;
+
+    /* Wakeup line */
+    int consumer_idle __attribute__((aligned(CMDQ_CACHELINE)));
+    int closed;
+    int wake_fd;
+
+    /* Set up by cmdq_init */
+    CmdQueueMode mode;
+    uint32_t mask;                  // ring capacity - 1
+    int slots;
+    CmdQueueCell* ring;
+    CmdMailbox* mailbox;            // CMDQ_LATEST_WINS only, one per slot
+    uint64_t* dirty;                // bit per slot with a mailbox command pending
+    uint64_t* sent_id;              // consumer: newest command_id handed out per slot
+    int* taken;                     // consumer scratch: slot of each mailbox command in a pop
+} CommandQueue;
+
+/* Queue for slots platoons: a ring of at least CMD_QUEUE_SIZE commands per
+ * platoon (rounded up to a power of two). 0 or -1 */
+int cmdq_init(CommandQueue* q, int slots, CmdQueueMode mode);
+void cmdq_destroy(CommandQueue* q);
+
+/* Producer: queue cmd for platoon slot. 0, or -1 if it was dropped. Never blocks. */
+int cmdq_push(CommandQueue* q, int slot, const LeaderCommand* cmd);
+
+/* Consumer: take up to max commands, blocking until there is at least one.
+ * Returns 0 once the queue is closed. */
+int cmdq_pop(CommandQueue* q, LeaderCommand* out, int max);
+
+/* Consumer, non-blocking: 0 if nothing is queued */
+int cmdq_try_pop(CommandQueue* q, LeaderCommand* out, int max);
+
+/* Largest batch one pop can return */
+int cmdq_batch_max(const CommandQueue* q);
+
+/* Wake the consumer for good: cmdq_pop returns 0 from now on */
+void cmdq_close(CommandQueue* q);
+
+void cmdq_get_stats(const CommandQueue* q, CmdQueueStats* out);
+
+#endif
@@ -6,11 +6,11 @@
 #include <stdio.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
-#include <sys/timerfd.h>
 
 #include "truckplatoon.h"
 #include "event.h"
 #include "follower.h"
+#include "tpnet.h"
 
 
 
@@ -26,29 +26,14 @@ void propagate_emergency(void){
     if (!local_has_rear)
         return;
 
-    struct sockaddr_in dst;
-    memset(&dst, 0, sizeof(dst));
-
-    dst.sin_family = AF_INET;
-    dst.sin_port   = htons(local_rear.udp_port);
-
-    if (inet_pton(AF_INET,
-                  local_rear.ip,
-                  &dst.sin_addr) != 1) {
-        perror("inet_pton failed in propagate_emergency");
-        return;
-    }
-
     FT_MESSAGE emergency_warning = {.type=MSG_FT_EMERGENCY_BRAKE, 
                                     .payload.warning.emergency_Flag = 1, .payload.warning.resendFlag =0 }; 
     
+    unsigned char wire[TPWIRE_MAX];
+    size_t len = tpwire_encode_ft(&emergency_warning, wire, sizeof(wire));
+
     pthread_mutex_lock(&mutex_sockets);
-    int32_t status = sendto(udp_sock,
-                          &emergency_warning,
-                          sizeof(emergency_warning),
-                          0,
-                          (struct sockaddr*)&dst,
-                          sizeof(dst));
+    int32_t status = sendToTruck(udp_sock, &local_rear, wire, len);
     pthread_mutex_unlock(&mutex_sockets);
 
     if (status < 0) {
@@ -64,42 +49,15 @@ void propagate_emergency(void){
 
 
 
-// Emergency Timer thread 
-void* emergency_timer_thread(void* arg) {
-    uint32_t duration_ms = *(uint32_t*)arg;
-    free(arg);
-
-    int tfd = timerfd_create(CLOCK_MONOTONIC, 0);
-    if (tfd < 0) {
-        perror("timerfd_create");
-        return NULL;
-    }
-
-    struct itimerspec its = {0};
-    its.it_value.tv_sec  = duration_ms / 1000;
-    its.it_value.tv_nsec = (duration_ms % 1000) * 1000000;
+//Start emergency Timer: EVT_EMERGENCY_TIMER after duration_ms
 
-    timerfd_settime(tfd, 0, &its, NULL);
-
-    uint64_t expirations;
-    read(tfd, &expirations, sizeof(expirations));
-
-    Event e = {.type = EVT_EMERGENCY_TIMER};
-    push_event(&truck_EventQ, &e);
-
-    close(tfd);
-    return NULL;
-}
-
-//Start energency Timer 
+static TimerId emergency_timer = TIMER_INVALID;
 
 void start_emergency_timer(uint32_t duration_ms) {
-    pthread_t tid;
-    uint32_t* arg = malloc(sizeof(uint32_t));
-    *arg = duration_ms;
-
-    pthread_create(&tid, NULL, emergency_timer_thread, arg);
-    pthread_detach(tid);
+    /* Re-entering emergency restarts the hold time */
+    timer_cancel(&follower_timers, emergency_timer);
+    Event e = {.type = EVT_EMERGENCY_TIMER};
+    emergency_timer = timer_arm_event(&follower_timers, duration_ms, 0, &truck_EventQ, &e);
 }
 
 // FUNC: Entry Actions for emergency Brake 
@@ -3,66 +3,628 @@
 #define _POSIX_C_SOURCE 200809L
 
 #include <string.h>
+#include <stdlib.h>
+#include <time.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
 #include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 #include "truckplatoon.h"
 #include "event.h"
 
 
+#define RING_MASK (MAX_EVENTS - 1)
+#define POOL_MASK (EVENT_POOL_SIZE - 1)
+
+/* Payload bytes each type carries (0 = none). Types up to EVENT_INLINE_BYTES stay
+ * in the ring cell; larger ones go to the payload pool. */
+static const uint8_t payload_size[NUM_PRIORITIES] = {
+    [EVT_INTRUDER]       = sizeof(IntruderInfo),
+    [EVT_DISTANCE]       = sizeof(FT_POSITION),
+    [EVT_CRUISE_CMD]     = sizeof(LeaderCommand),
+    [EVT_INTRUDER_CLEAR] = sizeof(IntruderInfo),
+    [EVT_TICK_UPDATE]    = sizeof(TickData),
+    [EVT_USER_INPUT]     = sizeof(UserInputData),
+    [EVT_FOLLOWER_MSG]   = sizeof(FollowerMsgData),
+    [EVT_PLATOON_FORMED] = sizeof(PlatoonData),
+};
+
 
 
 /*Queue And Scheduling Related Functions */
 
-//FUNC: For initializing event queue 
+//FUNC: For initializing event queue
 void event_queue_init(EventQueue* queue) {
+    event_queue_init_ex(queue, 0);
+}
+
+//FUNC: Initialize with signaling mode (EVENT_QUEUE_EVENTFD makes the queue pollable)
+int event_queue_init_ex(EventQueue* queue, int flags) {
     memset(queue, 0, sizeof(*queue));
-    pthread_mutexattr_init(&queue->attr_eventQueue);
-    pthread_mutexattr_setprotocol(&queue->attr_eventQueue, PTHREAD_PRIO_INHERIT);
-    pthread_mutex_init(&queue->mutex_eventQueue, &queue->attr_eventQueue);
-    pthread_cond_init(&queue->cond_eventQueue, NULL);   
+    for (int p = 0; p < NUM_PRIORITIES; p++) {
+        EventRing* evnt_ring = &queue->eventRings[p];
+        for (size_t i = 0; i < MAX_EVENTS; i++) {
+            evnt_ring->queue[i].seq = i;
+        }
+    }
+    /* Every payload slot starts free */
+    for (size_t i = 0; i < EVENT_POOL_SIZE; i++) {
+        queue->payload_free.cells[i].seq = i + 1;
+        queue->payload_free.cells[i].idx = (uint32_t)i;
+    }
+    queue->payload_free.tail = EVENT_POOL_SIZE;
+
+    for (int p = 0; p < NUM_PRIORITIES; p++) {
+        pthread_mutex_init(&queue->arena[p].lock, NULL);
+    }
+    /* Never shed safety- or lifecycle-critical events */
+    queue->policy[EVT_EMERGENCY] = EVQ_OVERFLOW_ARENA;
+    queue->policy[EVT_LEADER_TIMEOUT] = EVQ_OVERFLOW_ARENA;
+    queue->policy[EVT_PLATOON_FORMED] = EVQ_OVERFLOW_ARENA;
+    queue->policy[EVT_SHUTDOWN] = EVQ_OVERFLOW_ARENA;
+
+    queue->wake_fd = -1;
+    if (flags & EVENT_QUEUE_EVENTFD) {
+        queue->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (queue->wake_fd < 0) {
+            perror("eventfd");
+            return -1;
+        }
+    } else {
+        sem_init(&queue->sem_eventQueue, 0, 0);
+    }
+    return 0;
+}
+
+//FUNC: Pollable fd of an EVENT_QUEUE_EVENTFD queue (-1 otherwise)
+int event_queue_fd(const EventQueue* queue) {
+    return queue->wake_fd;
+}
+
+
+/* Wake a parked consumer */
+static void queue_wake(EventQueue* queue) {
+    if (queue->wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t w = write(queue->wake_fd, &one, sizeof(one));
+        (void)w; // EAGAIN only if the counter is saturated, i.e. already signaled
+    } else {
+        sem_post(&queue->sem_eventQueue);
+    }
+}
+
+/* Block until queue_wake */
+static void queue_park(EventQueue* queue) {
+    if (queue->wake_fd >= 0) {
+        struct pollfd pfd = {.fd = queue->wake_fd, .events = POLLIN};
+        while (poll(&pfd, 1, -1) < 0 && errno == EINTR) {
+        }
+        uint64_t count;
+        ssize_t r = read(queue->wake_fd, &count, sizeof(count));
+        (void)r;
+    } else {
+        while (sem_wait(&queue->sem_eventQueue) != 0 && errno == EINTR) {
+        }
+    }
+}
+
+
+/* Claim a slot and publish the header. Returns 0 if the ring is full. */
+static int ring_push(EventRing* evnt_ring, const EventHeader* hdr) {
+    size_t pos = __atomic_load_n(&evnt_ring->tail, __ATOMIC_RELAXED);
+    EventCell* cell;
+
+    for (;;) {
+        cell = &evnt_ring->queue[pos & RING_MASK];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&evnt_ring->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (dif < 0) {
+            return 0; // consumer has not released this slot yet
+        } else {
+            pos = __atomic_load_n(&evnt_ring->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->hdr = *hdr;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+
+/* Take the oldest published event. Normally only the consumer calls this, but
+ * DROP_OLDEST producers also use it to evict, hence the CAS on head. */
+static int ring_pop(EventRing* evnt_ring, EventHeader* out) {
+    size_t pos = __atomic_load_n(&evnt_ring->head, __ATOMIC_RELAXED);
+    EventCell* cell;
+
+    for (;;) {
+        cell = &evnt_ring->queue[pos & RING_MASK];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&evnt_ring->head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (dif < 0) {
+            return 0; // empty, or the producer at head has not published yet
+        } else {
+            pos = __atomic_load_n(&evnt_ring->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    *out = cell->hdr;
+    __atomic_store_n(&cell->seq, pos + MAX_EVENTS, __ATOMIC_RELEASE);
+    return 1;
+}
+
+
+/* Payload pool free list (MPMC, same scheme as the event rings) */
+static int pool_alloc(EventQueue* queue, uint16_t* idx) {
+    EventIndexRing* fr = &queue->payload_free;
+    size_t pos = __atomic_load_n(&fr->head, __ATOMIC_RELAXED);
+    EventIndexCell* cell;
+
+    for (;;) {
+        cell = &fr->cells[pos & POOL_MASK];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&fr->head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (dif < 0) {
+            return 0; // pool exhausted
+        } else {
+            pos = __atomic_load_n(&fr->head, __ATOMIC_RELAXED);
+        }
+    }
+
+    *idx = (uint16_t)cell->idx;
+    __atomic_store_n(&cell->seq, pos + EVENT_POOL_SIZE, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static void pool_release(EventQueue* queue, uint16_t idx) {
+    if (idx == EVENT_NO_PAYLOAD) return;
+
+    EventIndexRing* fr = &queue->payload_free;
+    size_t pos = __atomic_load_n(&fr->tail, __ATOMIC_RELAXED);
+    EventIndexCell* cell;
+
+    for (;;) {
+        cell = &fr->cells[pos & POOL_MASK];
+        size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&fr->tail, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else {
+            /* Cannot be full: there are only EVENT_POOL_SIZE indices */
+            pos = __atomic_load_n(&fr->tail, __ATOMIC_RELAXED);
+        }
+    }
+
+    cell->idx = idx;
+    __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+
+/* Event -> header, copying only the payload bytes the type uses.
+ * Returns 0 if a pooled payload is needed and the pool is empty. */
+static int event_pack(EventQueue* queue, const Event* event, EventHeader* hdr) {
+    size_t len = payload_size[event->type];
+
+    hdr->enqueue_ns = event->enqueue_ns;
+    hdr->type = (uint8_t)event->type;
+    hdr->inline_len = 0;
+    hdr->pool_idx = EVENT_NO_PAYLOAD;
+
+    if (len == 0) {
+        return 1;
+    }
+    if (len <= EVENT_INLINE_BYTES) {
+        memcpy(hdr->inline_data, &event->event_data, len);
+        hdr->inline_len = (uint8_t)len;
+        return 1;
+    }
+    if (!pool_alloc(queue, &hdr->pool_idx)) {
+        return 0;
+    }
+    memcpy(&queue->payload_pool[hdr->pool_idx], &event->event_data, len);
+    return 1;
+}
+
+/* Header -> Event, returning the pool slot */
+static void event_unpack(EventQueue* queue, const EventHeader* hdr, Event* out) {
+    out->type = (EventType)hdr->type;
+    out->enqueue_ns = hdr->enqueue_ns;
+    if (hdr->inline_len) {
+        memcpy(&out->event_data, hdr->inline_data, hdr->inline_len);
+    } else if (hdr->pool_idx != EVENT_NO_PAYLOAD) {
+        memcpy(&out->event_data, &queue->payload_pool[hdr->pool_idx], payload_size[hdr->type]);
+        pool_release(queue, hdr->pool_idx);
+    }
+}
+
+/* Pack + ring push; undoes the pool allocation if the ring is full */
+static int ring_push_event(EventQueue* queue, const Event* event) {
+    EventHeader hdr;
+    if (!event_pack(queue, event, &hdr)) {
+        return 0;
+    }
+    if (ring_push(&queue->eventRings[event->type], &hdr)) {
+        return 1;
+    }
+    pool_release(queue, hdr.pool_idx);
+    return 0;
+}
+
+
+/* Append to the overflow arena, doubling its buffer when full */
+static int arena_push(EventArena* arena, const Event* event) {
+    pthread_mutex_lock(&arena->lock);
+    if (arena->count == arena->cap) {
+        size_t new_cap = arena->cap ? arena->cap * 2 : MAX_EVENTS;
+        Event* nb = malloc(new_cap * sizeof(Event));
+        if (!nb) {
+            pthread_mutex_unlock(&arena->lock);
+            return 0;
+        }
+        for (size_t i = 0; i < arena->count; i++) {
+            nb[i] = arena->buf[(arena->head + i) % arena->cap];
+        }
+        free(arena->buf);
+        arena->buf = nb;
+        arena->cap = new_cap;
+        arena->head = 0;
+    }
+    arena->buf[(arena->head + arena->count) % arena->cap] = *event;
+    __atomic_store_n(&arena->count, arena->count + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&arena->lock);
+    return 1;
+}
+
+static int arena_pop(EventArena* arena, Event* out) {
+    if (__atomic_load_n(&arena->count, __ATOMIC_ACQUIRE) == 0) {
+        return 0;
+    }
+    pthread_mutex_lock(&arena->lock);
+    int had = arena->count > 0;
+    if (had) {
+        *out = arena->buf[arena->head];
+        arena->head = (arena->head + 1) % arena->cap;
+        __atomic_store_n(&arena->count, arena->count - 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&arena->lock);
+    return had;
+}
+
+
+static void slot_lock(EventSlot* slot) {
+    while (__atomic_exchange_n(&slot->lock, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&slot->lock, __ATOMIC_RELAXED)) {
+            sched_yield();
+        }
+    }
+}
+
+static void slot_unlock(EventSlot* slot) {
+    __atomic_store_n(&slot->lock, 0, __ATOMIC_RELEASE);
+}
+
+/* Overwrite the pending event (if any) with the newer one. Returns 1 if one was replaced. */
+static int slot_put(EventSlot* slot, const Event* event) {
+    slot_lock(slot);
+    int replaced = slot->pending;
+    slot->event = *event;
+    __atomic_store_n(&slot->pending, 1, __ATOMIC_RELEASE);
+    slot_unlock(slot);
+    return replaced;
+}
+
+static int slot_take(EventSlot* slot, Event* out) {
+    if (!__atomic_load_n(&slot->pending, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    slot_lock(slot);
+    int had = slot->pending;
+    if (had) {
+        *out = slot->event;
+        __atomic_store_n(&slot->pending, 0, __ATOMIC_RELAXED);
+    }
+    slot_unlock(slot);
+    return had;
+}
+
+/* One event of priority p: ring first, then its overflow (newer than anything
+ * left in the ring), then the coalescing slot */
+static int queue_take(EventQueue* queue, int p, Event* out) {
+    EventHeader hdr;
+    if (ring_pop(&queue->eventRings[p], &hdr)) {
+        event_unpack(queue, &hdr, out);
+        return 1;
+    }
+    if (arena_pop(&queue->arena[p], out)) {
+        return 1;
+    }
+    if (queue->coalesce_mask & ((uint64_t)1 << p)) {
+        return slot_take(&queue->latest[p], out);
+    }
+    return 0;
+}
+
+
+/* Highest priority first: the lowest set bit of ready_mask is the highest-priority
+ * ring that may hold events. Takes up to max events. */
+static int queue_drain(EventQueue* queue, Event* out, int max) {
+    int n = 0;
+    while (n < max) {
+        uint64_t mask = __atomic_load_n(&queue->ready_mask, __ATOMIC_ACQUIRE);
+        if (mask == 0) {
+            break;
+        }
+
+        int p = __builtin_ctzll(mask);
+        uint64_t bit = (uint64_t)1 << p;
+
+        if (queue_take(queue, p, &out[n])) {
+            n++;
+            continue;
+        }
+
+        /* Ring looked empty: clear its bit, then re-check so a push that
+         * published before the clear is not stranded without a bit. */
+        __atomic_fetch_and(&queue->ready_mask, ~bit, __ATOMIC_ACQ_REL);
+        if (queue_take(queue, p, &out[n])) {
+            n++;
+            __atomic_fetch_or(&queue->ready_mask, bit, __ATOMIC_RELEASE);
+        }
+    }
+
+    if (queue->latency && n > 0) {
+        uint64_t now = lat_now_ns();
+        for (int i = 0; i < n; i++) {
+            uint64_t t = out[i].enqueue_ns;
+            lat_hist_record(&queue->latency->wait[out[i].type], now > t ? now - t : 0);
+        }
+    }
+    return n;
+}
+
+
+//FUNC: Enable/disable latest-value-wins for one event type
+void event_queue_set_coalesce(EventQueue* queue, EventType type, int enable) {
+    if ((unsigned)type >= NUM_PRIORITIES) return;
+    if (enable) queue->coalesce_mask |= (uint64_t)1 << type;
+    else queue->coalesce_mask &= ~((uint64_t)1 << type);
+}
+
+
+static uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+/* Ring for `type` is full: apply its policy. Returns 1 if the event was queued. */
+static int push_overflow(EventQueue* queue, const Event* event) {
+    EventType type = event->type;
+    EventRing* evnt_ring = &queue->eventRings[type];
+    EventQueueStats* st = &queue->stats[type];
+
+    switch (queue->policy[type]) {
+    case EVQ_OVERFLOW_DROP_OLDEST: {
+        EventHeader victim;
+        for (int attempt = 0; attempt < MAX_EVENTS; attempt++) {
+            if (ring_pop(evnt_ring, &victim)) {
+                pool_release(queue, victim.pool_idx);
+                __atomic_fetch_add(&st->dropped_oldest, 1, __ATOMIC_RELAXED);
+            }
+            if (ring_push_event(queue, event)) return 1;
+        }
+        break;
+    }
+
+    case EVQ_OVERFLOW_BLOCK: {
+        uint64_t deadline = monotonic_us() + (uint64_t)queue->block_timeout_ms[type] * 1000ULL;
+        struct timespec backoff = {.tv_sec = 0, .tv_nsec = EVENT_BLOCK_BACKOFF_US * 1000L};
+        do {
+            nanosleep(&backoff, NULL);
+            if (ring_push_event(queue, event)) return 1;
+        } while (monotonic_us() < deadline);
+        __atomic_fetch_add(&st->block_timeouts, 1, __ATOMIC_RELAXED);
+        break;
+    }
+
+    case EVQ_OVERFLOW_ARENA:
+        if (arena_push(&queue->arena[type], event)) {
+            __atomic_fetch_add(&st->spilled, 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+        break;
+
+    case EVQ_OVERFLOW_DROP_NEWEST:
+    default:
+        break;
+    }
+
+    __atomic_fetch_add(&st->dropped_newest, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+
+//FUNC: Configure overflow handling for one event type
+void event_queue_set_overflow(EventQueue* queue, EventType type,
+                              EventOverflowPolicy policy, uint32_t timeout_ms) {
+    if ((unsigned)type >= NUM_PRIORITIES) return;
+    queue->policy[type] = policy;
+    queue->block_timeout_ms[type] = timeout_ms;
 }
 
 
 //FUNC: PUSH events
 
 void push_event(EventQueue* queue, Event* event) {
-    pthread_mutex_lock(&queue->mutex_eventQueue);
+    if ((unsigned)event->type >= NUM_PRIORITIES) {
+        fprintf(stderr, "Invalid event type %d\n", event->type);
+        return;
+    }
 
-    EventRing* evnt_ring = &queue->eventRings[event->type];
-    int next_tail = (evnt_ring->tail + 1) % MAX_EVENTS;
+    event->enqueue_ns = lat_now_ns();
 
-    if (next_tail == evnt_ring->head) {
-        // queue full
-        fprintf(stderr, "Event queue full for type %d\n", event->type);
-        pthread_mutex_unlock(&queue->mutex_eventQueue);
-        return;
+    if (queue->coalesce_mask & ((uint64_t)1 << event->type)) {
+        if (slot_put(&queue->latest[event->type], event)) {
+            __atomic_fetch_add(&queue->stats[event->type].coalesced, 1, __ATOMIC_RELAXED);
+        }
+    } else if (__atomic_load_n(&queue->arena[event->type].count, __ATOMIC_ACQUIRE) > 0) {
+        /* Keep FIFO order: while spilled events are pending, new ones queue behind them */
+        if (!push_overflow(queue, event)) return;
+    } else if (!ring_push_event(queue, event)) {
+        if (!push_overflow(queue, event)) return;
     }
 
-    evnt_ring->queue[evnt_ring->tail] = *event;
-    evnt_ring->tail = next_tail;
+    __atomic_fetch_or(&queue->ready_mask, (uint64_t)1 << event->type, __ATOMIC_RELEASE);
 
-    pthread_cond_signal(&queue->cond_eventQueue);
-    pthread_mutex_unlock(&queue->mutex_eventQueue);
+    /* Publish before checking for a parked consumer (pairs with the fence in pop_events) */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&queue->consumer_waiting, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&queue->consumer_waiting, 0, __ATOMIC_ACQ_REL)) {
+        queue_wake(queue);
+    }
 }
 
 
-//FUNC: Pull Events
-Event pop_event(EventQueue* queue) {
-    pthread_mutex_lock(&queue->mutex_eventQueue);
+//FUNC: Pull a batch of events (blocks until at least one is available)
+int pop_events(EventQueue* queue, Event* out, int max) {
+    if (max <= 0) return 0;
 
     while (1) {
-        for (int p = 0; p < NUM_PRIORITIES; p++) {
-            EventRing* evnt_ring = &queue->eventRings[p];
-            if (evnt_ring->head != evnt_ring->tail) {
-                Event evnt = evnt_ring->queue[evnt_ring->head];
-                evnt_ring->head = (evnt_ring->head + 1) % MAX_EVENTS;
-                pthread_mutex_unlock(&queue->mutex_eventQueue);
-                return evnt;
-            }
+        int n = queue_drain(queue, out, max);
+        if (n > 0) {
+            return n;
+        }
+
+        /* Announce intent to sleep, then re-check so a concurrent push is not lost */
+        __atomic_store_n(&queue->consumer_waiting, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        n = queue_drain(queue, out, max);
+        if (n > 0) {
+            __atomic_store_n(&queue->consumer_waiting, 0, __ATOMIC_RELAXED);
+            return n;
         }
 
         // sleep if no events
-        pthread_cond_wait(&queue->cond_eventQueue, &queue->mutex_eventQueue);
+        queue_park(queue);
+    }
+}
+
+
+//FUNC: Non-blocking drain for callers that wait on event_queue_fd themselves
+int try_pop_events(EventQueue* queue, Event* out, int max) {
+    if (max <= 0) return 0;
+    return queue_drain(queue, out, max);
+}
+
+//FUNC: Mark the consumer as about to block outside the queue (e.g. in epoll_wait).
+// Returns 1 if it may block, 0 if events are already pending.
+int event_queue_prepare_wait(EventQueue* queue) {
+    __atomic_store_n(&queue->consumer_waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&queue->ready_mask, __ATOMIC_ACQUIRE) != 0) {
+        __atomic_store_n(&queue->consumer_waiting, 0, __ATOMIC_RELAXED);
+        return 0;
+    }
+    return 1;
+}
+
+//FUNC: Consumer woke up; fd_readable says whether event_queue_fd was reported ready
+void event_queue_finish_wait(EventQueue* queue, int fd_readable) {
+    __atomic_store_n(&queue->consumer_waiting, 0, __ATOMIC_RELAXED);
+    if (fd_readable && queue->wake_fd >= 0) {
+        uint64_t count;
+        ssize_t r = read(queue->wake_fd, &count, sizeof(count));
+        (void)r;
+    }
+}
+
+
+//FUNC: Pull Events
+Event pop_event(EventQueue* queue) {
+    Event evnt;
+    pop_events(queue, &evnt, 1);
+    return evnt;
+}
+
+
+//FUNC: Snapshot drop/spill counters for one type
+void event_queue_get_stats(EventQueue* queue, EventType type, EventQueueStats* out) {
+    memset(out, 0, sizeof(*out));
+    if ((unsigned)type >= NUM_PRIORITIES) return;
+    EventQueueStats* st = &queue->stats[type];
+    out->dropped_newest = __atomic_load_n(&st->dropped_newest, __ATOMIC_RELAXED);
+    out->dropped_oldest = __atomic_load_n(&st->dropped_oldest, __ATOMIC_RELAXED);
+    out->block_timeouts = __atomic_load_n(&st->block_timeouts, __ATOMIC_RELAXED);
+    out->spilled = __atomic_load_n(&st->spilled, __ATOMIC_RELAXED);
+    out->coalesced = __atomic_load_n(&st->coalesced, __ATOMIC_RELAXED);
+}
+
+//FUNC: Print non-zero counters
+void event_queue_dump_stats(EventQueue* queue, FILE* out, const char* label) {
+    for (int p = 0; p < NUM_PRIORITIES; p++) {
+        EventQueueStats st;
+        event_queue_get_stats(queue, (EventType)p, &st);
+        if (!(st.dropped_newest | st.dropped_oldest | st.spilled | st.coalesced)) continue;
+        fprintf(out, "[%s] event type %d: dropped_newest=%llu dropped_oldest=%llu "
+                     "block_timeouts=%llu spilled=%llu coalesced=%llu\n",
+                label ? label : "EVQ", p,
+                (unsigned long long)st.dropped_newest, (unsigned long long)st.dropped_oldest,
+                (unsigned long long)st.block_timeouts, (unsigned long long)st.spilled,
+                (unsigned long long)st.coalesced);
+    }
+}
+
+
+//FUNC: Attach latency histograms (queue-wait is recorded on dequeue)
+void event_queue_attach_latency(EventQueue* queue, EventLatency* latency) {
+    queue->latency = latency;
+}
+
+//FUNC: Record handler service time for one event
+void event_latency_record_service(EventLatency* latency, EventType type, uint64_t ns) {
+    if (!latency || (unsigned)type >= NUM_PRIORITIES) return;
+    lat_hist_record(&latency->service[type], ns);
+}
+
+//FUNC: Print wait/service histograms for every type that saw traffic
+void event_latency_dump(EventLatency* latency, FILE* out, const char* label) {
+    if (!latency) return;
+    fprintf(out, "[%s] event latency (queue-wait / service):\n", label ? label : "EVQ");
+    for (int p = 0; p < NUM_PRIORITIES; p++) {
+        char name[32];
+        snprintf(name, sizeof(name), "  type %2d wait", p);
+        lat_hist_print(&latency->wait[p], out, name);
+        snprintf(name, sizeof(name), "  type %2d service", p);
+        lat_hist_print(&latency->service[p], out, name);
     }
 }
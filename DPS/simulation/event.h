@@ -2,7 +2,9 @@
 #define EVENT_H
 
 #include "truckplatoon.h"
+#include "latency_hist.h"
 #include <pthread.h>
+#include <semaphore.h>
 #include <string.h>
 #include <sched.h>
 #include <errno.h>
@@ -10,8 +12,21 @@
 #include <stdlib.h>
 #include <unistd.h>
 
-#define MAX_EVENTS 32
-#define NUM_PRIORITIES 12 // includes EVT_SHUTDOWN + EVT_LEADER_TIMEOUT
+#define MAX_EVENTS 32 // per ring, must be a power of two
+#define EVENT_POOL_SIZE 64 // out-of-line payload slots per queue, power of two
+#define EVENT_INLINE_BYTES 12 // payloads up to this size travel inside the ring cell
+#define EVENT_CACHELINE 64
+#define EVENT_BATCH_MAX 8 // events an FSM drains per wakeup
+
+#define EVENT_BLOCK_BACKOFF_US 100 // EVQ_OVERFLOW_BLOCK retry interval
+
+/* event_queue_init_ex flags */
+#define EVENT_QUEUE_EVENTFD 0x1 // signal through a pollable eventfd instead of a semaphore
+#define NUM_PRIORITIES 14 // includes EVT_SHUTDOWN + EVT_LEADER_TIMEOUT
+
+#if NUM_PRIORITIES > 64
+#error "EventQueue.ready_mask holds one bit per priority (max 64)"
+#endif
 
 typedef enum {
     EVT_EMERGENCY        = 0,  // highest priority
@@ -25,7 +40,9 @@ typedef enum {
     EVT_USER_INPUT       = 8,  // leader keyboard commands
     EVT_FOLLOWER_MSG     = 9,  // leader: incoming follower net messages
     EVT_PLATOON_FORMED   = 10, // leader has minimum followers; finalize topology
-    EVT_SHUTDOWN         = 11  // graceful termination request
+    EVT_SHUTDOWN         = 11, // graceful termination request
+    EVT_LEADER_PREDICT   = 12, // follower: extrapolate the leader between commands
+    EVT_LEADER_RECONNECT = 13  // follower: try the leader again after the link dropped
 } EventType;
 
 /* Data for user input events */
@@ -33,42 +50,181 @@ typedef struct {
     char key; // 'w','a','s','d', etc.
 } UserInputData;
 
+/* Data for leader physics ticks: seq lets a coalesced tick account for the
+ * ticks it replaced */
+typedef struct {
+    uint64_t seq;
+} TickData;
+
 /* Data wrapper for follower-originated messages */
 typedef struct {
     int follower_id;      // sender index (0..N)
+    int platoon_id;       // platoon the sender belongs to
     FT_MESSAGE msg;       // the original FT_MESSAGE
 } FollowerMsgData;
 
+/* Data for leader platoon-wide events (EVT_PLATOON_FORMED) */
+typedef struct {
+    int32_t platoon_id;
+} PlatoonData;
+
+typedef union {
+    LeaderCommand leader_cmd;
+    FT_POSITION ft_pos; 
+    IntruderInfo intruder;
+    UserInputData input;        /* EVT_USER_INPUT */
+    FollowerMsgData follower_msg; /* EVT_FOLLOWER_MSG */
+    TickData tick;              /* EVT_TICK_UPDATE */
+    PlatoonData platoon;        /* EVT_PLATOON_FORMED */
+} EventData;
+
+/* Event as producers build it and the FSM consumes it. Inside the queue only
+ * the bytes its type actually uses are stored (see EventHeader). */
 typedef struct {
     EventType type;
-    union {
-        LeaderCommand leader_cmd;
-        FT_POSITION ft_pos; 
-        IntruderInfo intruder;
-        UserInputData input;        /* EVT_USER_INPUT */
-        FollowerMsgData follower_msg; /* EVT_FOLLOWER_MSG */
-    } event_data;
+    uint64_t enqueue_ns;            // CLOCK_MONOTONIC, stamped by push_event
+    EventData event_data;
 } Event;
 
+/* Compact in-queue form: payloads of at most EVENT_INLINE_BYTES live in the
+ * header, larger ones (LeaderCommand, FollowerMsgData) in the queue's payload
+ * pool, referenced by pool_idx. */
+#define EVENT_NO_PAYLOAD 0xFFFFu
+typedef struct {
+    uint64_t enqueue_ns;
+    uint8_t type;
+    uint8_t inline_len;
+    uint16_t pool_idx;              // EVENT_NO_PAYLOAD unless pooled
+    unsigned char inline_data[EVENT_INLINE_BYTES];
+} EventHeader;
+
+
+/* What push_event does when a type's ring is full */
+typedef enum {
+    EVQ_OVERFLOW_DROP_NEWEST = 0, // discard the event being pushed (default)
+    EVQ_OVERFLOW_DROP_OLDEST,     // evict the oldest queued event of that type
+    EVQ_OVERFLOW_BLOCK,           // retry until space or timeout, then drop newest
+    EVQ_OVERFLOW_ARENA            // spill into a growable per-type arena; never drops
+} EventOverflowPolicy;
+
+/* Per-type counters, updated atomically by producers */
+typedef struct {
+    uint64_t dropped_newest;  // rejected at push (full ring, DROP_NEWEST or BLOCK timeout)
+    uint64_t dropped_oldest;  // evicted by DROP_OLDEST
+    uint64_t block_timeouts;  // BLOCK pushes that gave up (also counted in dropped_newest)
+    uint64_t spilled;         // pushes that went to the overflow arena
+    uint64_t coalesced;       // pending events overwritten in coalescing mode
+} EventQueueStats;
 
-// Event Ring
+/* Per-type latency: time spent queued, and time the FSM spent handling it */
 typedef struct {
-    Event queue[MAX_EVENTS];
-    int head;
-    int tail;
+    LatencyHist wait[NUM_PRIORITIES];
+    LatencyHist service[NUM_PRIORITIES];
+} EventLatency;
+
+// Overflow arena: FIFO spill area for one type, grown on demand.
+// Only touched once the ring has overflowed, so a mutex is fine here.
+typedef struct {
+    pthread_mutex_t lock;
+    Event* buf;
+    size_t cap;
+    size_t head;
+    size_t count;            // also read without the lock as a hint
+} EventArena;
+
+// Event Ring: bounded lock-free ring (per-slot sequence numbers).
+// Producers claim slots with a CAS on tail. head is advanced with a CAS too, so a
+// DROP_OLDEST producer can evict from the front while the consumer is popping.
+typedef struct {
+    size_t seq;                     // slot turn, accessed atomically
+    EventHeader hdr;
+} EventCell;
+
+typedef struct {
+    size_t tail __attribute__((aligned(EVENT_CACHELINE)));  // producers
+    size_t head __attribute__((aligned(EVENT_CACHELINE)));  // consumer (+ evicting producers)
+    EventCell queue[MAX_EVENTS] __attribute__((aligned(EVENT_CACHELINE)));
 } EventRing;
 
-// Event Queue 
+// Free list of payload pool indices: same sequence-numbered ring, MPMC
+// (producers allocate, the consumer and evicting producers release).
+typedef struct {
+    size_t seq;
+    uint32_t idx;
+} EventIndexCell;
+
+typedef struct {
+    size_t tail __attribute__((aligned(EVENT_CACHELINE)));
+    size_t head __attribute__((aligned(EVENT_CACHELINE)));
+    EventIndexCell cells[EVENT_POOL_SIZE];
+} EventIndexRing;
+
+// Coalescing slot: latest-value-wins storage for types where only the newest
+// sample matters. lock is a short spin flag held for one Event copy.
+typedef struct {
+    int lock;
+    int pending;
+    Event event;
+} EventSlot;
+
+// Event Queue: one ring per EventType (index == priority, 0 is highest).
+// ready_mask has bit p set while ring p may hold events: push_event sets it,
+// the consumer clears it when it finds the ring empty.
+// Types in coalesce_mask bypass their ring and overwrite latest[type] instead.
+// A full ring is handled per type by policy[type]; stats[type] records what was shed.
+// Producers never block; the consumer parks (sem_eventQueue, or wake_fd in
+// EVENT_QUEUE_EVENTFD mode) only after it has announced itself in
+// consumer_waiting and re-checked every ring.
 typedef struct {
     EventRing eventRings[NUM_PRIORITIES];
-    pthread_mutex_t mutex_eventQueue;
-    pthread_cond_t cond_eventQueue;
-    pthread_mutexattr_t attr_eventQueue;
+    EventData payload_pool[EVENT_POOL_SIZE];
+    EventIndexRing payload_free;
+    EventSlot latest[NUM_PRIORITIES];
+    uint64_t coalesce_mask;
+    EventOverflowPolicy policy[NUM_PRIORITIES];
+    uint32_t block_timeout_ms[NUM_PRIORITIES];
+    EventArena arena[NUM_PRIORITIES];
+    EventQueueStats stats[NUM_PRIORITIES];
+    EventLatency* latency;          // optional, queue-wait recorded on dequeue
+    uint64_t ready_mask __attribute__((aligned(EVENT_CACHELINE)));
+    int consumer_waiting __attribute__((aligned(EVENT_CACHELINE)));
+    sem_t sem_eventQueue;
+    int wake_fd;                    // eventfd, -1 in semaphore mode
 } EventQueue;
 
 /* Event queue API (generic) */
 void event_queue_init(EventQueue* queue);
+int event_queue_init_ex(EventQueue* queue, int flags);
 void push_event(EventQueue* queue, Event* event);
 Event pop_event(EventQueue* queue);
+/* Latest-value-wins mode for one type: a push overwrites a pending event of
+ * the same type. Configure before producers start. */
+void event_queue_set_coalesce(EventQueue* queue, EventType type, int enable);
+/* Overflow handling for one type; timeout_ms only applies to EVQ_OVERFLOW_BLOCK.
+ * Defaults: ARENA for EVT_EMERGENCY, EVT_LEADER_TIMEOUT, EVT_PLATOON_FORMED and
+ * EVT_SHUTDOWN, DROP_NEWEST for the rest. */
+void event_queue_set_overflow(EventQueue* queue, EventType type,
+                              EventOverflowPolicy policy, uint32_t timeout_ms);
+/* Snapshot of the counters for one type */
+void event_queue_get_stats(EventQueue* queue, EventType type, EventQueueStats* out);
+/* Print non-zero counters for every type (e.g. on shutdown) */
+void event_queue_dump_stats(EventQueue* queue, FILE* out, const char* label);
+/* Latency histograms: attach before producers start. The queue records
+ * queue-wait per type on dequeue; the FSM records service time itself. */
+void event_queue_attach_latency(EventQueue* queue, EventLatency* latency);
+void event_latency_record_service(EventLatency* latency, EventType type, uint64_t ns);
+void event_latency_dump(EventLatency* latency, FILE* out, const char* label);
+/* Drain up to max events in priority order with one wakeup; returns count (>= 1) */
+int pop_events(EventQueue* queue, Event* out, int max);
+
+/* Multiplexing with other fds (EVENT_QUEUE_EVENTFD mode):
+ *   if (event_queue_prepare_wait(q)) block in epoll/poll on event_queue_fd(q) + others;
+ *   event_queue_finish_wait(q, queue_fd_was_ready);
+ *   n = try_pop_events(q, batch, max);
+ */
+int event_queue_fd(const EventQueue* queue);
+int try_pop_events(EventQueue* queue, Event* out, int max);
+int event_queue_prepare_wait(EventQueue* queue);
+void event_queue_finish_wait(EventQueue* queue, int fd_readable);
 
 #endif
\ No newline at end of file
@@ -19,6 +19,8 @@
 #include "event.h"
 #include "follower.h"
 #include "tpnet.h"
+#include "tpio.h"
+#include "tpshm.h"
 #include "intruder.h"
 #include "cruise_control.h"
 #include "matrix_clock.h"
@@ -33,33 +35,46 @@ int8_t simulation_running = 1;
 
 //THREAD RELATED 
 pthread_t tid;
-pthread_t udp_tid, tcp_tid, sm_tid;
+pthread_t sm_tid;
 pthread_t intruder_tid; //meghana
-pthread_t watchdog_tid;
 EventQueue truck_EventQ;
+TimerWheel follower_timers;
+static EventLatency follower_latency;
 TurnQueue follower_turns; // bw
 
 //MUTEX
 pthread_mutex_t mutex_follower;
 pthread_mutex_t mutex_topology;
 pthread_mutex_t mutex_sockets;
-pthread_mutex_t mutex_leader_rx;
 
 static uint64_t monotonic_ms(void);
 static void follower_update_leader_rx_time(void);
-static void* leader_rx_watchdog(void* arg);
+static void leader_watchdog_arm(uint32_t delay_ms);
+static int leader_watchdog_expired(void);
 
+/* Only touched by the state machine thread (TCP reads happen there) */
 static uint64_t last_leader_rx_ms = 0;
 static int leader_timeout_emitted = 0;
 
+/* Last full cruise command: between commands from a send-on-change leader the
+ * follower extrapolates the leader from it (state machine thread) */
+static LeaderCommand leader_ref;
+static uint64_t leader_ref_rx_ms = 0;
+static int have_leader_ref = 0;
+#define LEADER_PREDICT_AFTER_MS ((uint64_t)(LEADER_TICK_DT * 1500.0f)) // commands are late
+
 // SOCKET RELATED
 int udp_sock = -1;
 int32_t tcp2Leader = -1;
+static uint16_t self_udp_port = 0;   /* what a resume presents again */
+static int32_t self_platoon = 0;
 
 static volatile sig_atomic_t follower_shutdown_requested = 0;
 static volatile sig_atomic_t follower_sig_received = 0;
+static volatile sig_atomic_t follower_dump_requested = 0; /* SIGUSR1: print queue stats */
 
 static void follower_on_signal(int signo);
+static void follower_dump_event_stats(void);
 
 // Control Vars //bw
 int follower_idx = 0;
@@ -85,6 +100,7 @@ void send_position_to_rear(void);
 void move_truck(Truck *t, float dt, TurnQueue *q);
 static void handle_cruise_cmd(Event *evnt);
 static void handle_distance_update(Event *evnt);
+static void handle_leader_predict(void);
 
 MatrixClock follower_clock;  // mc
 
@@ -109,7 +125,8 @@ void follower_request_shutdown(const char* reason) {
     pthread_mutex_lock(&mutex_sockets);
     if (tcp2Leader >= 0) {
         shutdown(tcp2Leader, SHUT_RDWR);
-        close(tcp2Leader);
+        /* A shared-memory link stays mapped until exit: the state machine may be reading it */
+        if (!tpshm_is_link(tcp2Leader)) close(tcp2Leader);
         tcp2Leader = -1;
     }
     if (udp_sock >= 0) {
@@ -121,19 +138,41 @@ void follower_request_shutdown(const char* reason) {
 }
 
 static void follower_on_signal(int signo) {
-    (void)signo;
+    if (signo == SIGUSR1) {
+        follower_dump_requested = 1;
+        return;
+    }
     follower_sig_received = 1;
 }
 
+/* Multicast cruise commands (when the leader runs with --mcast); FSM thread only */
+static TpIo follower_io;
+static int mcast_fd = -1;
+static uint32_t mcast_next_seq = 0;
+static uint64_t mcast_received = 0, mcast_lost = 0, mcast_stale = 0;
+
+static void follower_dump_event_stats(void) {
+    event_queue_dump_stats(&truck_EventQ, stderr, "FOLLOWER");
+    event_latency_dump(&follower_latency, stderr, "FOLLOWER");
+    if (mcast_fd >= 0) {
+        fprintf(stderr, "[FOLLOWER] multicast commands received=%llu lost=%llu stale=%llu\n",
+                (unsigned long long)mcast_received, (unsigned long long)mcast_lost,
+                (unsigned long long)mcast_stale);
+    }
+}
+
 int main(int argc, char* argv[]) {
 
-    if (argc != 2) {
-        printf("Usage: %s  <MY_UDP_PORT>\n", argv[0]);
+    if (argc != 2 && argc != 3) {
+        printf("Usage: %s  <MY_UDP_PORT> [PLATOON_ID]\n", argv[0]);
         return 1;
     }
 
     const char* my_ip = LEADER_IP;
     uint16_t my_port = atoi(argv[1]);
+    int32_t my_platoon = (argc == 3) ? atoi(argv[2]) : 0;
+    self_udp_port = my_port;
+    self_platoon = my_platoon;
 
     struct sigaction sa = {0};
     sa.sa_handler = follower_on_signal;
@@ -141,6 +180,7 @@ int main(int argc, char* argv[]) {
     sa.sa_flags = 0;
     sigaction(SIGINT, &sa, NULL);
     sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGUSR1, &sa, NULL);
     
     mc_init(&follower_clock); //matrix clock initialization
 
@@ -150,8 +190,17 @@ int main(int argc, char* argv[]) {
     // Initial position (placeholder, will be snapped by TCP listener)
     follower = (Truck) {.x = 0.0f, .y = -10.0f, .speed = 0, .dir = NORTH, .state = PLATOONING};
 
-    //EVENT Queue
-    event_queue_init(&truck_EventQ); 
+    //EVENT Queue (eventfd mode: the FSM epolls it together with the sockets)
+    event_queue_init_ex(&truck_EventQ, EVENT_QUEUE_EVENTFD); 
+    /* Cruise control only needs the freshest front/leader sample */
+    event_queue_set_coalesce(&truck_EventQ, EVT_DISTANCE, 1);
+    event_queue_set_coalesce(&truck_EventQ, EVT_CRUISE_CMD, 1);
+    /* State-changing events must not be shed when the FSM falls behind */
+    event_queue_set_overflow(&truck_EventQ, EVT_INTRUDER, EVQ_OVERFLOW_ARENA, 0);
+    event_queue_set_overflow(&truck_EventQ, EVT_INTRUDER_CLEAR, EVQ_OVERFLOW_ARENA, 0);
+    event_queue_set_overflow(&truck_EventQ, EVT_EMERGENCY_TIMER, EVQ_OVERFLOW_ARENA, 0);
+    event_queue_set_overflow(&truck_EventQ, EVT_LEADER_RECONNECT, EVQ_OVERFLOW_ARENA, 0);
+    event_queue_attach_latency(&truck_EventQ, &follower_latency);
     turn_queue_init(&follower_turns); // bw
 
     //1. Create TCP + UDP Sockets and Connect
@@ -160,36 +209,38 @@ int main(int argc, char* argv[]) {
     udp_sock = createUDPServer(my_port); 
 
     // 2. Send Registration
-    join_platoon(tcp2Leader, my_ip, my_port);
-    printf("[INIT] Registration sent to leader (udp_port=%d)\n", my_port);
+    join_platoon(tcp2Leader, my_ip, my_port, my_platoon);
+    printf("[INIT] Registration sent to leader (udp_port=%d platoon=%d)\n", my_port, my_platoon);
 
     //Mutex Init
     pthread_mutex_init(&mutex_follower, NULL);
     pthread_mutex_init(&mutex_topology, NULL);
     pthread_mutex_init(&mutex_sockets, NULL);
-    pthread_mutex_init(&mutex_leader_rx, NULL);
 
-    pthread_mutex_lock(&mutex_leader_rx);
+    if (timer_wheel_start(&follower_timers) < 0) {
+        return 1;
+    }
     last_leader_rx_ms = monotonic_ms();
     leader_timeout_emitted = 0;
-    pthread_mutex_unlock(&mutex_leader_rx);
+    leader_watchdog_arm(LEADER_RX_TIMEOUT_MS);
+    {
+        /* Dead reckoning at the physics rate; a no-op while full commands keep coming */
+        Event predict = {.type = EVT_LEADER_PREDICT};
+        uint32_t period_ms = (uint32_t)(FOLLOWER_PHYS_DT * 1000.0f);
+        timer_arm_event(&follower_timers, period_ms, period_ms, &truck_EventQ, &predict);
+    }
 
     // 3. Thread Creations 
     
-    pthread_create(&udp_tid, NULL, udp_listener, NULL);
-    pthread_create(&tcp_tid, NULL, tcp_listener, NULL);
     pthread_create(&sm_tid, NULL, truck_state_machine, NULL);
     pthread_create(&intruder_tid, NULL, keyboard_listener, NULL);//meghana
-    pthread_create(&watchdog_tid, NULL, leader_rx_watchdog, NULL);
-    printf("[INIT] Threads started: udp_listener, tcp_listener, state_machine, keyboard_listener\n");
+    printf("[INIT] Threads started: state_machine (udp+tcp+events), keyboard_listener, timers\n");
    
 
 
     //Scheduling policy and prioroty 
             /*
-            set_realtime_priority(sm_tid,  SCHED_FIFO, 80); // state machine
-            set_realtime_priority(udp_tid, SCHED_FIFO, 70); // emergency RX
-            set_realtime_priority(tcp_tid, SCHED_FIFO, 60); // cruise RX
+            set_realtime_priority(sm_tid,  SCHED_FIFO, 80); // state machine + UDP/TCP RX
             */
 
 
@@ -205,6 +256,10 @@ int main(int argc, char* argv[]) {
             follower_request_shutdown("signal");
             break;
         }
+        if (follower_dump_requested) {
+            follower_dump_requested = 0;
+            follower_dump_event_stats();
+        }
         phys_tick_count++;
         next_tick.tv_nsec += (long)(FOLLOWER_PHYS_DT * 1e9);
         if (next_tick.tv_nsec >= 1e9) {
@@ -266,10 +321,10 @@ int main(int argc, char* argv[]) {
     follower_request_shutdown("main exit");
 
     pthread_join(intruder_tid, NULL);
-    pthread_join(udp_tid, NULL);
-    pthread_join(tcp_tid, NULL);
     pthread_join(sm_tid, NULL);
-    pthread_join(watchdog_tid, NULL);
+    timer_wheel_stop(&follower_timers);
+
+    follower_dump_event_stats();
     return 0;
 }
 
@@ -280,393 +335,650 @@ static uint64_t monotonic_ms(void) {
 }
 
 static void follower_update_leader_rx_time(void) {
-    pthread_mutex_lock(&mutex_leader_rx);
     last_leader_rx_ms = monotonic_ms();
-    leader_timeout_emitted = 0;
-    pthread_mutex_unlock(&mutex_leader_rx);
+    if (leader_timeout_emitted) {
+        /* The watchdog stops after reporting a timeout; restart it */
+        leader_timeout_emitted = 0;
+        leader_watchdog_arm(LEADER_RX_TIMEOUT_MS);
+    }
 }
 
-static void* leader_rx_watchdog(void* arg) {
-    (void)arg;
+/* Watchdog: a one-shot EVT_LEADER_TIMEOUT timer. It is not re-armed on every
+ * leader message; when it fires the FSM checks the real quiet time and re-arms
+ * for the remainder if the leader spoke meanwhile. */
+static void leader_watchdog_arm(uint32_t delay_ms) {
+    Event ev = {.type = EVT_LEADER_TIMEOUT};
+    timer_arm_event(&follower_timers, delay_ms, 0, &truck_EventQ, &ev);
+}
 
-    while (!follower_shutdown_requested) {
-        struct timespec ts = {.tv_sec = 0, .tv_nsec = (long)LEADER_WATCHDOG_PERIOD_MS * 1000L * 1000L};
-        nanosleep(&ts, NULL);
+static int leader_watchdog_expired(void) {
+    pthread_mutex_lock(&mutex_follower);
+    TRUCK_CONTROL_STATE st = follower.state;
+    pthread_mutex_unlock(&mutex_follower);
 
-        if (follower_shutdown_requested) break;
+    /* Ignore timeouts while platooning/formation is not complete (leader may legitimately be quiet). */
+    if (st == PLATOONING) {
+        leader_watchdog_arm(LEADER_WATCHDOG_PERIOD_MS);
+        return 0;
+    }
 
-        pthread_mutex_lock(&mutex_follower);
-        TRUCK_CONTROL_STATE st = follower.state;
-        pthread_mutex_unlock(&mutex_follower);
+    uint64_t quiet = monotonic_ms() - last_leader_rx_ms;
+    if (quiet <= (uint64_t)LEADER_RX_TIMEOUT_MS) {
+        leader_watchdog_arm((uint32_t)(LEADER_RX_TIMEOUT_MS - quiet) + 1);
+        return 0;
+    }
+    leader_timeout_emitted = 1;
+    return 1;
+}
 
-        /* Ignore timeouts while platooning/formation is not complete (leader may legitimately be quiet). */
-        if (st == PLATOONING) {
-            continue;
-        }
 
-        uint64_t last_ms;
-        int already_emitted;
-        pthread_mutex_lock(&mutex_leader_rx);
-        last_ms = last_leader_rx_ms;
-        already_emitted = leader_timeout_emitted;
-        pthread_mutex_unlock(&mutex_leader_rx);
-
-        uint64_t now = monotonic_ms();
-        if (!already_emitted && now > last_ms && (now - last_ms) > (uint64_t)LEADER_RX_TIMEOUT_MS) {
-            pthread_mutex_lock(&mutex_leader_rx);
-            leader_timeout_emitted = 1;
-            pthread_mutex_unlock(&mutex_leader_rx);
-
-            Event ev = {.type = EVT_LEADER_TIMEOUT};
-            push_event(&truck_EventQ, &ev);
+
+//FUNC: UDP datagram received from the front truck: turn it into an event
+void udp_listener_handle(const TpIoEvent* ev) {
+    FT_MESSAGE msg;
+
+    if (ev->res < 0) {
+        if (ev->res == -EINTR || ev->res == -EAGAIN || follower_shutdown_requested) return;
+        errno = -ev->res;
+        perror("recvfrom");
+        follower_request_shutdown("udp recvfrom error");
+        return;
+    }
+    if (tpwire_decode_ft(ev->data, (size_t)ev->res, &msg) < 0) return; /* stray or foreign datagram */
+
+    switch (msg.type) {
+        case MSG_FT_EMERGENCY_BRAKE:{
+            Event emergency_evt = {.type = EVT_EMERGENCY};
+            push_event(&truck_EventQ, &emergency_evt);
+            break;}
+
+        case MSG_FT_POSITION:{
+            Event distance_evt = {.type = EVT_DISTANCE};
+            distance_evt.event_data.ft_pos = msg.payload.position;
+            push_event(&truck_EventQ, &distance_evt);
+            break;}
+            
+        case MSG_FT_INTRUDER_REPORT:
+            // Potential future use
+            break;
+            
+        default:
+            break;
+    }
+}
+
+
+//FUNC: TP_NET=shm: front trucks connecting to our inbox; their links carry the datagrams
+static void truck_links_accept(int inbox) {
+    int fd;
+    while ((fd = tpshm_accept(inbox)) >= 0) {
+        uint64_t token = ((uint64_t)FOLLOWER_TOKEN_TRUCK << 32) | (uint32_t)fd;
+        if (tpio_watch(&follower_io, fd, TPIO_RECV, token) < 0) {
+            perror("tpio_watch truck link");
+            tpshm_close(fd);
         }
     }
+}
 
-    return NULL;
+static void truck_link_handle(const TpIoEvent* ev) {
+    if (ev->res == 0 || (ev->res < 0 && ev->res != -EAGAIN && ev->res != -EINTR)) {
+        /* That truck left or is no longer in front of us */
+        tpio_unwatch(&follower_io, ev->fd);
+        tpshm_close(ev->fd);
+        return;
+    }
+    udp_listener_handle(ev);
 }
 
 
+//FUNC: Leader moved cruise commands to multicast: join the group and watch it
+static void follower_mcast_join(const McastInfoMsg* info) {
+    if (mcast_fd >= 0) return;
+    int fd = createMulticastListener(&info->group, LEADER_IP);
+    if (fd < 0) return;
+    if (tpio_watch(&follower_io, fd, TPIO_RECV, (uint64_t)fd) < 0) {
+        perror("tpio_watch mcast");
+        close(fd);
+        return;
+    }
+    mcast_fd = fd;
+    mcast_next_seq = info->next_seq;
+    printf("\n[MCAST] Cruise commands on %s:%d (from seq %u)\n",
+           info->group.ip, info->group.udp_port, info->next_seq);
+}
 
-// Dedicated thread for listening to UDP emergency messages from other trucks
-void* udp_listener(void* arg) {
-    (void)arg;
-    FT_MESSAGE msg;
-    
-    while (!follower_shutdown_requested) {
-        int local_udp;
-        pthread_mutex_lock(&mutex_sockets);
-        local_udp = udp_sock;
-        pthread_mutex_unlock(&mutex_sockets);
+static void handle_leader_message(const LD_MESSAGE* msg);
+
+//FUNC: Leader state extrapolated from the last full command to now_ms
+static LeaderCommand leader_predict(uint64_t now_ms) {
+    LeaderCommand c = leader_ref;
+    float dt = (float)(now_ms - leader_ref_rx_ms) / 1000.0f;
+    c.is_turning_event = 0; /* already queued when the command arrived */
+    switch (c.leader.dir) {
+        case NORTH: c.leader.y += c.leader.speed * dt; break;
+        case SOUTH: c.leader.y -= c.leader.speed * dt; break;
+        case EAST:  c.leader.x += c.leader.speed * dt; break;
+        case WEST:  c.leader.x -= c.leader.speed * dt; break;
+    }
+    return c;
+}
+
+static uint32_t topo_epoch = 0;     /* newest topology epoch applied */
+static int topo_epoch_known = 0;
+
+/* Leader link (state machine thread). The session token from MSG_LDR_ASSIGN_ID
+ * lets a new connection resume this truck's slot after the link drops. */
+static uint64_t session_token = 0;
+static int leader_link = -1;            /* fd watched for leader frames; -1 while down */
+static int leader_link_confirmed = 0;   /* a frame arrived on it: the join or resume took */
+static uint64_t leader_lost_ms = 0;     /* when the outage began */
+static uint32_t reconnect_delay_ms = 0;
+
+//FUNC: Topology messages from an epoch older than the newest one applied are stale
+static int topology_stale(const LD_MESSAGE* msg) {
+    if (msg->type != MSG_LDR_ASSIGN_ID && msg->type != MSG_LDR_UPDATE_REAR && msg->type != MSG_LDR_SPAWN) {
+        return 0;
+    }
+    if (topo_epoch_known && (int32_t)(msg->topo_epoch - topo_epoch) < 0) {
+        printf("\n[TOPOLOGY] Dropping stale update (epoch %u, at %u)\n", msg->topo_epoch, topo_epoch);
+        return 1;
+    }
+    topo_epoch = msg->topo_epoch;
+    topo_epoch_known = 1;
+    return 0;
+}
+
+//FUNC: Multicast datagram received: apply a sequenced cruise command, counting gaps
+static void mcast_listener_handle(const TpIoEvent* ev) {
+    LD_MESSAGE msg;
+    uint32_t seq;
+
+    if (ev->res <= 0 || follower_shutdown_requested) return;
+    if (tpwire_decode_ld_seq(ev->data, (size_t)ev->res, &seq, &msg) < 0 ||
+        (msg.type != MSG_LDR_CMD && msg.type != MSG_LDR_HEARTBEAT)) {
+        return;
+    }
+    int lost = tpwire_seq_check(&mcast_next_seq, seq);
+    if (lost < 0) {
+        /* Older than one already applied: commands are latest-wins */
+        mcast_stale++;
+        return;
+    }
+    if (lost > 0) {
+        mcast_lost += (uint64_t)lost;
+        printf("\n[MCAST] Gap: %d command(s) lost before seq %u\n", lost, seq);
+    }
+    mcast_received++;
+    handle_leader_message(&msg);
+}
 
-        if (local_udp < 0) break;
+//FUNC: Handle one decoded leader message
+static void handle_leader_message(const LD_MESSAGE* msg) {
 
-        ssize_t recv_len = recvfrom(local_udp, &msg, sizeof(msg), 0, NULL, NULL);
-        if (recv_len < 0) {
-            if (errno == EINTR) continue;
-            if (follower_shutdown_requested) break;
-            perror("recvfrom");
-            follower_request_shutdown("udp recvfrom error");
+    /* Any message from leader implies liveness */
+    follower_update_leader_rx_time();
+    if (topology_stale(msg)) return;
+
+    switch (msg->type){
+        case MSG_LDR_CMD:
+            if (msg->payload.cmd.is_turning_event) {
+            turn_queue_push(&follower_turns, msg->payload.cmd.turn_point_x, msg->payload.cmd.turn_point_y, msg->payload.cmd.turn_dir);
+            }
+            leader_base_speed = msg->payload.cmd.leader.speed;
+            leader_ref = msg->payload.cmd;
+            leader_ref_rx_ms = monotonic_ms();
+            have_leader_ref = 1;
+            Event cmd_evt = {.type = EVT_CRUISE_CMD, .event_data.leader_cmd = msg->payload.cmd};
+            push_event(&truck_EventQ, &cmd_evt);
+            break;
+        case MSG_LDR_HEARTBEAT:
+            /* The leader is still on the course of the command it names: act on
+             * where that puts it now (a real leader message, so it also ends a
+             * watchdog stop). A newer name means that command is still in flight. */
+            if (have_leader_ref && msg->payload.cmd.command_id == leader_ref.command_id) {
+                Event beat_evt = {.type = EVT_CRUISE_CMD, .event_data.leader_cmd = leader_predict(monotonic_ms())};
+                push_event(&truck_EventQ, &beat_evt);
+            }
+            break;
+        case MSG_LDR_UPDATE_REAR: 
+            pthread_mutex_lock(&mutex_topology);
+            has_rearTruck = msg->payload.rearInfo.has_rearTruck;
+            if (has_rearTruck){ rearTruck_Address = msg->payload.rearInfo.rearTruck_Address;}
+            pthread_mutex_unlock(&mutex_topology);
+            printf("\n[TOPOLOGY] Rear updated: has_rear=%d rear_port=%d\n", has_rearTruck, rearTruck_Address.udp_port);
+            break; 
+
+        case MSG_LDR_EMERGENCY_BRAKE: {
+            Event emergency_evt = {.type = EVT_EMERGENCY};
+            push_event(&truck_EventQ, &emergency_evt);
+            break;}
+
+        case MSG_LDR_SPAWN:
+            /* Leader-supplied spawn pose for realistic join near current platoon */
+            pthread_mutex_lock(&mutex_follower);
+            if (needs_spawn_snap) {
+                follower.x = msg->payload.spawn.spawn_x;
+                follower.y = msg->payload.spawn.spawn_y;
+                follower.dir = msg->payload.spawn.spawn_dir;
+                needs_spawn_snap = 0;
+                have_front_position = 0;
+                printf("\n[SPAWN] Leader spawn: (%.1f,%.1f) dir=%d pos=%d\n",
+                       follower.x, follower.y, follower.dir, msg->payload.spawn.assigned_id);
+            }
+            pthread_mutex_unlock(&mutex_follower);
+            break;
+            
+        case MSG_LDR_ASSIGN_ID:
+            /*
+             * Leader may resend MSG_LDR_ASSIGN_ID during topology reformation.
+             * We must NOT reset/snap our physical position on reassign, otherwise
+             * trucks "jump" back to their initial start slots.
+             */
+            if (msg->session_token) session_token = msg->session_token;
+            if (follower_idx == 0) {
+                follower_idx = msg->payload.assigned_id;
+                platoon_position = msg->payload.assigned_id;
+                   /* Defer physical spawn/snap until first cruise command arrives (we need leader position). */
+                   needs_spawn_snap = 1;
+                   have_front_position = 0;
+                   printf("\n[ID] Initial ID: %d (Platoon pos: %d)\n",
+                       follower_idx, platoon_position);
+            } else {
+                follower_idx = msg->payload.assigned_id;
+                platoon_position = msg->payload.assigned_id;
+                printf("\n[ID] Updated platoon position: %d \n",
+                       platoon_position);
+            }
             break;
-        }
 
-        switch (msg.type) {
-            case MSG_FT_EMERGENCY_BRAKE:{
-                Event emergency_evt = {.type = EVT_EMERGENCY};
-                push_event(&truck_EventQ, &emergency_evt);
-                break;}
-
-            case MSG_FT_POSITION:{
-                Event distance_evt = {.type = EVT_DISTANCE};
-                distance_evt.event_data.ft_pos = msg.payload.position;
-                push_event(&truck_EventQ, &distance_evt);
-                break;}
-                
-            case MSG_FT_INTRUDER_REPORT:
-                // Potential future use
-                break;
-                
-            default:
-                break;
-        }
+        case MSG_LDR_MCAST_JOIN:
+            follower_mcast_join(&msg->payload.mcast);
+            break;
+        default:
+            break;
     }
-    return NULL;
 }
 
 
-//FUNC: TCP Listener 
-void* tcp_listener(void* arg) {
+//FUNC: Bytes received from the leader: handle every complete leader frame
+static FrameDecoder leader_rx;
+static MatrixClock leader_clock_rx; /* delta base for clocks piggybacked by the leader */
 
-    LD_MESSAGE msg;
-    while (!follower_shutdown_requested) {
-            int local_tcp;
-            pthread_mutex_lock(&mutex_sockets);
-            local_tcp = tcp2Leader;
-            pthread_mutex_unlock(&mutex_sockets);
+static void leader_link_lost(const char* reason);
 
-            if (local_tcp < 0) break;
+void tcp_listener_handle(const TpIoEvent* ev) {
 
-            ssize_t rr = recv(local_tcp, &msg, sizeof(msg), 0);
-            if (rr <= 0) {
-                if (!follower_shutdown_requested) {
-                    follower_request_shutdown("tcp recv closed");
-                }
-                break;
-            }
+    if (ev->res <= 0) {
+        if (ev->res == -EINTR || ev->res == -EAGAIN) return;
+        leader_link_lost("tcp recv closed");
+        return;
+    }
+    if (frame_decoder_feed(&leader_rx, ev->data, (size_t)ev->res) < 0) {
+        leader_link_lost("tcp framing error");
+        return;
+    }
 
-            /* Any message from leader implies liveness */
-            follower_update_leader_rx_time();
+    LD_MESSAGE msg;
+    unsigned char wire[TPWIRE_MAX];
+    size_t len = 0;
+    int got;
+    while ((got = frame_decoder_next(&leader_rx, wire, sizeof(wire), &len)) == 1) {
+        if (tpwire_decode_ld_delta(wire, len, &leader_clock_rx, &msg) < 0) break;
+        leader_link_confirmed = 1;
+        handle_leader_message(&msg);
+    }
+    if (got == 1 || got < 0) {
+        leader_link_lost("tcp framing error");
+    }
+}
 
-            switch (msg.type){
-                case MSG_LDR_CMD:
-                    if (msg.payload.cmd.is_turning_event) {
-                    turn_queue_push(&follower_turns, msg.payload.cmd.turn_point_x, msg.payload.cmd.turn_point_y, msg.payload.cmd.turn_dir);
-                    }
-                    leader_base_speed = msg.payload.cmd.leader.speed;
-                    Event cmd_evt = {.type = EVT_CRUISE_CMD, .event_data.leader_cmd = msg.payload.cmd};
-                    push_event(&truck_EventQ, &cmd_evt);
-                    break;
-                case MSG_LDR_UPDATE_REAR: 
-                    pthread_mutex_lock(&mutex_topology);
-                    has_rearTruck = msg.payload.rearInfo.has_rearTruck;
-                    if (has_rearTruck){ rearTruck_Address = msg.payload.rearInfo.rearTruck_Address;}
-                    pthread_mutex_unlock(&mutex_topology);
-                    printf("\n[TOPOLOGY] Rear updated: has_rear=%d rear_port=%d\n", has_rearTruck, rearTruck_Address.udp_port);
-                    break; 
+static void leader_reconnect_arm(uint32_t delay_ms) {
+    Event ev = {.type = EVT_LEADER_RECONNECT};
+    timer_arm_event(&follower_timers, delay_ms, 0, &truck_EventQ, &ev);
+}
 
-                case MSG_LDR_EMERGENCY_BRAKE: {
-                    Event emergency_evt = {.type = EVT_EMERGENCY};
-                    push_event(&truck_EventQ, &emergency_evt);
-                    break;}
+//FUNC: Leader link closed or garbled: reconnect and resume the session, or
+// shut down if there is none yet
+static void leader_link_lost(const char* reason) {
+    if (follower_shutdown_requested) return;
+    if (!session_token) {
+        follower_request_shutdown(reason);
+        return;
+    }
+    if (leader_link >= 0) tpio_unwatch(&follower_io, leader_link);
+    pthread_mutex_lock(&mutex_sockets);
+    if (tcp2Leader >= 0) {
+        shutdown(tcp2Leader, SHUT_RDWR);
+        tpshm_close(tcp2Leader);
+        tcp2Leader = -1;
+    }
+    pthread_mutex_unlock(&mutex_sockets);
+    leader_link = -1;
+
+    /* A resume the leader turned away continues the same outage */
+    if (leader_link_confirmed) {
+        printf("\n[RESUME] Leader link lost (%s); reconnecting\n", reason);
+        leader_lost_ms = monotonic_ms();
+        reconnect_delay_ms = FOLLOWER_RECONNECT_MIN_MS;
+        leader_link_confirmed = 0;
+    } else if (monotonic_ms() - leader_lost_ms >= (uint64_t)LEADER_RESUME_MS) {
+        follower_request_shutdown("leader unreachable");
+        return;
+    }
+    leader_reconnect_arm(reconnect_delay_ms);
+}
 
-                case MSG_LDR_SPAWN:
-                    /* Leader-supplied spawn pose for realistic join near current platoon */
-                    pthread_mutex_lock(&mutex_follower);
-                    if (needs_spawn_snap) {
-                        follower.x = msg.payload.spawn.spawn_x;
-                        follower.y = msg.payload.spawn.spawn_y;
-                        follower.dir = msg.payload.spawn.spawn_dir;
-                        needs_spawn_snap = 0;
-                        have_front_position = 0;
-                        printf("\n[SPAWN] Leader spawn: (%.1f,%.1f) dir=%d pos=%d\n",
-                               follower.x, follower.y, follower.dir, msg.payload.spawn.assigned_id);
-                    }
-                    pthread_mutex_unlock(&mutex_follower);
-                    break;
-                    
-                case MSG_LDR_ASSIGN_ID:
-                    /*
-                     * Leader may resend MSG_LDR_ASSIGN_ID during topology reformation.
-                     * We must NOT reset/snap our physical position on reassign, otherwise
-                     * trucks "jump" back to their initial start slots.
-                     */
-                    if (follower_idx == 0) {
-                        follower_idx = msg.payload.assigned_id;
-                        platoon_position = msg.payload.assigned_id;
-                           /* Defer physical spawn/snap until first cruise command arrives (we need leader position). */
-                           needs_spawn_snap = 1;
-                           have_front_position = 0;
-                           printf("\n[ID] Initial ID: %d (Platoon pos: %d)\n",
-                               follower_idx, platoon_position);
-                    } else {
-                        follower_idx = msg.payload.assigned_id;
-                        platoon_position = msg.payload.assigned_id;
-                        printf("\n[ID] Updated platoon position: %d \n",
-                               platoon_position);
-                    }
-                    break;
-                default:
-                    break;
-            }
+//FUNC: EVT_LEADER_RECONNECT: new connection presenting the session token;
+// backs off up to FOLLOWER_RECONNECT_MAX_MS and gives up with the leader's
+// resume window
+static void leader_reconnect(void) {
+    if (follower_shutdown_requested || leader_link >= 0) return;
+    int fd = connect2Leader();
+    if (fd >= 0) {
+        /* Both directions start over: frame decoder and clock bases */
+        frame_decoder_reset(&leader_rx);
+        mc_init(&leader_clock_rx);
+        pthread_mutex_lock(&mutex_sockets);
+        tcp2Leader = fd;
+        reset_leader_clock_base();
+        int rc = resume_session(fd, LEADER_IP, self_udp_port, self_platoon, session_token,
+                                topo_epoch, have_leader_ref ? leader_ref.command_id : 0);
+        pthread_mutex_unlock(&mutex_sockets);
+        if (rc == 0 && tpio_watch(&follower_io, fd, TPIO_RECV, (uint64_t)fd) == 0) {
+            leader_link = fd;
+            printf("\n[RESUME] Reconnected to leader (fd=%d); resuming position %d\n", fd, platoon_position);
+            return;
         }
-        return NULL;
+        pthread_mutex_lock(&mutex_sockets);
+        shutdown(fd, SHUT_RDWR);
+        tpshm_close(fd);
+        tcp2Leader = -1;
+        pthread_mutex_unlock(&mutex_sockets);
     }
-    
-    
+    if (monotonic_ms() - leader_lost_ms >= (uint64_t)LEADER_RESUME_MS) {
+        follower_request_shutdown("leader unreachable");
+        return;
+    }
+    reconnect_delay_ms *= 2;
+    if (reconnect_delay_ms > FOLLOWER_RECONNECT_MAX_MS) reconnect_delay_ms = FOLLOWER_RECONNECT_MAX_MS;
+    leader_reconnect_arm(reconnect_delay_ms);
+}
+
+
 //FUNC: TRUCK State Machine Thread function
 void* truck_state_machine(void* arg) {
     (void)arg;
-    while (!follower_shutdown_requested) {
-        Event evnt = pop_event(&truck_EventQ);
+    Event batch[EVENT_BATCH_MAX];
+    TpIoEvent ready[FOLLOWER_EPOLL_MAX];
 
-        if (evnt.type == EVT_SHUTDOWN) {
-            break;
+    /* One I/O set: event queue + leader TCP + front-truck UDP (received by the backend) */
+    int queue_fd = event_queue_fd(&truck_EventQ);
+    int local_udp;
+    pthread_mutex_lock(&mutex_sockets);
+    local_udp = udp_sock;
+    leader_link = tcp2Leader;
+    pthread_mutex_unlock(&mutex_sockets);
+
+    /* Shared-memory links are served by the epoll backend only */
+    int shm = tpshm_enabled();
+    if (tpio_open(&follower_io, shm ? TPIO_POSIX : TPIO_AUTO) < 0) {
+        perror("tpio_open");
+        follower_request_shutdown("tpio_open failed");
+        return NULL;
+    }
+    printf("[FSM] I/O backend: %s\n", tpio_name(&follower_io));
+    int watch[3] = {queue_fd, local_udp, leader_link};
+    for (int k = 0; k < 3; k++) {
+        if (watch[k] < 0) continue;
+        uint32_t events = (watch[k] == queue_fd || (shm && watch[k] == local_udp)) ? TPIO_IN : TPIO_RECV;
+        if (tpio_watch(&follower_io, watch[k], events, (uint64_t)watch[k]) < 0) {
+            perror("tpio_watch");
         }
+    }
 
-        switch (follower.state) {
+    while (!follower_shutdown_requested) {
+        /* Block only when no events are pending; producers then signal queue_fd */
+        int timeout = event_queue_prepare_wait(&truck_EventQ) ? -1 : 0;
+        int nready = tpio_wait(&follower_io, ready, FOLLOWER_EPOLL_MAX, timeout);
+        int queue_ready = 0;
+        for (int k = 0; k < nready; k++) {
+            int fd = ready[k].fd;
+            if (fd == queue_fd) queue_ready = 1;
+            else if ((ready[k].token >> 32) == FOLLOWER_TOKEN_TRUCK) truck_link_handle(&ready[k]);
+            else if (fd == local_udp && shm) truck_links_accept(local_udp);
+            else if (fd == local_udp) udp_listener_handle(&ready[k]);
+            else if (fd == leader_link) tcp_listener_handle(&ready[k]);
+            else if (fd == mcast_fd) mcast_listener_handle(&ready[k]);
+        }
+        event_queue_finish_wait(&truck_EventQ, queue_ready);
 
-        case PLATOONING:
-            switch (evnt.type) {
-            case EVT_CRUISE_CMD:
-                pthread_mutex_lock(&mutex_follower);
-                follower.state = CRUISE;
-                handle_cruise_cmd(&evnt);
-                pthread_mutex_unlock(&mutex_follower);
-                break;
-            case EVT_EMERGENCY:
-                enter_emergency();
-                break;
-            case EVT_LEADER_TIMEOUT:
-                /* Ignore: leader may be quiet during formation. */
-                break;
-            default:
-                break;
-            }
-            break;
+        int n = try_pop_events(&truck_EventQ, batch, EVENT_BATCH_MAX);
+        for (int i = 0; i < n; i++) {
+            Event evnt = batch[i];
+            uint64_t handle_start_ns = lat_now_ns();
 
-        case CRUISE:
-            switch (evnt.type) {
+            if (evnt.type == EVT_SHUTDOWN) {
+                tpio_close(&follower_io);
+                if (mcast_fd >= 0) close(mcast_fd);
+                return NULL;
+            }
+            if (evnt.type == EVT_LEADER_TIMEOUT && !leader_watchdog_expired()) {
+                continue;
+            }
+            if (evnt.type == EVT_LEADER_RECONNECT) {
+                leader_reconnect();
+                continue;
+            }
 
-            case EVT_CRUISE_CMD:
-                pthread_mutex_lock(&mutex_follower);
-                handle_cruise_cmd(&evnt);
-                pthread_mutex_unlock(&mutex_follower);
-                break;
+            switch (follower.state) {
 
-            case EVT_DISTANCE : 
-                //adjust_distance_from_front(evnt.event_data.ft_pos);
-                pthread_mutex_lock(&mutex_follower);
-                handle_distance_update(&evnt);
-                pthread_mutex_unlock(&mutex_follower);
-                break;
-            case EVT_INTRUDER:
-                // INLINE state change - consistent lock pattern
-                pthread_mutex_lock(&mutex_follower);
-                current_intruder = evnt.event_data.intruder;
-                current_target_gap = TARGET_GAP + (float)current_intruder.length;
-                follower.state = INTRUDER_FOLLOW;
-                if (follower.speed == 0) {
-                    follower.speed = (float)current_intruder.speed;
+            case PLATOONING:
+                switch (evnt.type) {
+                case EVT_CRUISE_CMD:
+                    pthread_mutex_lock(&mutex_follower);
+                    follower.state = CRUISE;
+                    handle_cruise_cmd(&evnt);
+                    pthread_mutex_unlock(&mutex_follower);
+                    break;
+                case EVT_EMERGENCY:
+                    enter_emergency();
+                    break;
+                case EVT_LEADER_TIMEOUT:
+                    /* Ignore: leader may be quiet during formation. */
+                    break;
+                default:
+                    break;
                 }
-                mc_local_event(&follower_clock, follower_idx);
-                pthread_mutex_unlock(&mutex_follower);
-                
-                notify_leader_intruder(evnt.event_data.intruder);
-                printf("[STATE] Follower entering INTRUDER_FOLLOW: speed=%d, length=%d, target_gap=%.1f\n",
-                       current_intruder.speed, current_intruder.length, current_target_gap);
-                break;
-
-            case EVT_EMERGENCY:
-                enter_emergency();
                 break;
 
-            case EVT_LEADER_TIMEOUT:
-                pthread_mutex_lock(&mutex_follower);
-                follower.speed = 0;
-                follower.state = STOPPED;
-                pthread_mutex_unlock(&mutex_follower);
-                printf("\n[WATCHDOG] Leader messages stale -> STOPPED\n");
-                break;
+            case CRUISE:
+                switch (evnt.type) {
 
-            case EVT_EMERGENCY_TIMER: 
-                // Timer for now,  event is not relevent during cruise 
-                break; 
-            default: 
-                break; 
-            }
-            break;
-
-        case INTRUDER_FOLLOW:
-            switch (evnt.type) { 
-                case EVT_CRUISE_CMD: 
-                    // FIX: PROCESS cruise commands with intruder-adjusted gap!
+                case EVT_CRUISE_CMD:
                     pthread_mutex_lock(&mutex_follower);
                     handle_cruise_cmd(&evnt);
                     pthread_mutex_unlock(&mutex_follower);
                     break;
-                case EVT_DISTANCE:
-                    // FIX: PROCESS distance updates with intruder-adjusted gap!
+
+                case EVT_LEADER_PREDICT:
+                    pthread_mutex_lock(&mutex_follower);
+                    handle_leader_predict();
+                    pthread_mutex_unlock(&mutex_follower);
+                    break;
+
+                case EVT_DISTANCE : 
+                    //adjust_distance_from_front(evnt.event_data.ft_pos);
                     pthread_mutex_lock(&mutex_follower);
                     handle_distance_update(&evnt);
                     pthread_mutex_unlock(&mutex_follower);
                     break;
                 case EVT_INTRUDER:
-                    // Update intruder info and recalculate target gap
+                    // INLINE state change - consistent lock pattern
                     pthread_mutex_lock(&mutex_follower);
                     current_intruder = evnt.event_data.intruder;
-                    // Target gap = base gap + intruder length
                     current_target_gap = TARGET_GAP + (float)current_intruder.length;
-                    // IMPORTANT: Start at intruder speed, but DON'T LOCK IT
-                    // Let cruise control adjust speed to maintain the intruder gap
+                    follower.state = INTRUDER_FOLLOW;
                     if (follower.speed == 0) {
-                        follower.speed = (float)current_intruder.speed;  // Initialize only if stopped
+                        follower.speed = (float)current_intruder.speed;
                     }
-                    pthread_mutex_unlock(&mutex_follower);
-                    mc_local_event(&follower_clock, follower_idx);
-                    break;
-
-                case EVT_INTRUDER_CLEAR:
-                    // Clear intruder and restore normal gap target
-                    pthread_mutex_lock(&mutex_follower);
-                    current_intruder = (IntruderInfo){0};
-                    current_target_gap = TARGET_GAP;  // Restore normal gap
-                    // INLINE state change - avoid calling exit_intruder_follow() which re-locks!
-                    follower.state = CRUISE;
                     mc_local_event(&follower_clock, follower_idx);
                     pthread_mutex_unlock(&mutex_follower);
-                    
-                    IntruderInfo intruder_clear = {0};
-                    notify_leader_intruder(intruder_clear);
+                
+                    notify_leader_intruder(evnt.event_data.intruder);
+                    printf("[STATE] Follower entering INTRUDER_FOLLOW: speed=%d, length=%d, target_gap=%.1f\n",
+                           current_intruder.speed, current_intruder.length, current_target_gap);
                     break;
 
                 case EVT_EMERGENCY:
                     enter_emergency();
                     break;
-                case EVT_EMERGENCY_TIMER: 
-                    break; 
 
                 case EVT_LEADER_TIMEOUT:
                     pthread_mutex_lock(&mutex_follower);
                     follower.speed = 0;
                     follower.state = STOPPED;
                     pthread_mutex_unlock(&mutex_follower);
-                    printf("\n[WATCHDOG] Leader messages stale (intruder) -> STOPPED\n");
+                    printf("\n[WATCHDOG] Leader messages stale -> STOPPED\n");
                     break;
 
-                default:
+                case EVT_EMERGENCY_TIMER: 
+                    // Timer for now,  event is not relevent during cruise 
+                    break; 
+                default: 
+                    break; 
+                }
+                break;
+
+            case INTRUDER_FOLLOW:
+                switch (evnt.type) { 
+                    case EVT_CRUISE_CMD: 
+                        // FIX: PROCESS cruise commands with intruder-adjusted gap!
+                        pthread_mutex_lock(&mutex_follower);
+                        handle_cruise_cmd(&evnt);
+                        pthread_mutex_unlock(&mutex_follower);
+                        break;
+                    case EVT_LEADER_PREDICT:
+                        pthread_mutex_lock(&mutex_follower);
+                        handle_leader_predict();
+                        pthread_mutex_unlock(&mutex_follower);
+                        break;
+                    case EVT_DISTANCE:
+                        // FIX: PROCESS distance updates with intruder-adjusted gap!
+                        pthread_mutex_lock(&mutex_follower);
+                        handle_distance_update(&evnt);
+                        pthread_mutex_unlock(&mutex_follower);
+                        break;
+                    case EVT_INTRUDER:
+                        // Update intruder info and recalculate target gap
+                        pthread_mutex_lock(&mutex_follower);
+                        current_intruder = evnt.event_data.intruder;
+                        // Target gap = base gap + intruder length
+                        current_target_gap = TARGET_GAP + (float)current_intruder.length;
+                        // IMPORTANT: Start at intruder speed, but DON'T LOCK IT
+                        // Let cruise control adjust speed to maintain the intruder gap
+                        if (follower.speed == 0) {
+                            follower.speed = (float)current_intruder.speed;  // Initialize only if stopped
+                        }
+                        pthread_mutex_unlock(&mutex_follower);
+                        mc_local_event(&follower_clock, follower_idx);
+                        break;
+
+                    case EVT_INTRUDER_CLEAR:
+                        // Clear intruder and restore normal gap target
+                        pthread_mutex_lock(&mutex_follower);
+                        current_intruder = (IntruderInfo){0};
+                        current_target_gap = TARGET_GAP;  // Restore normal gap
+                        // INLINE state change - avoid calling exit_intruder_follow() which re-locks!
+                        follower.state = CRUISE;
+                        mc_local_event(&follower_clock, follower_idx);
+                        pthread_mutex_unlock(&mutex_follower);
+                    
+                        IntruderInfo intruder_clear = {0};
+                        notify_leader_intruder(intruder_clear);
+                        break;
+
+                    case EVT_EMERGENCY:
+                        enter_emergency();
+                        break;
+                    case EVT_EMERGENCY_TIMER: 
+                        break; 
+
+                    case EVT_LEADER_TIMEOUT:
+                        pthread_mutex_lock(&mutex_follower);
+                        follower.speed = 0;
+                        follower.state = STOPPED;
+                        pthread_mutex_unlock(&mutex_follower);
+                        printf("\n[WATCHDOG] Leader messages stale (intruder) -> STOPPED\n");
+                        break;
+
+                    default:
+                        break;
+                    }
                     break;
+
+            case EMERGENCY_BRAKE:
+                switch (evnt.type) {
+                    case EVT_CRUISE_CMD: 
+                        printf("\r[EMERGENCY] Ignoring cruise cmd, in emergency mode");
+                        break;
+                    case EVT_DISTANCE:
+                        printf("\r[EMERGENCY] Ignoring distance update, in emergency mode");
+                        break;
+                    case EVT_INTRUDER: 
+                        printf("\r[EMERGENCY] Ignoring intruder event, in emergency mode");
+                        break;
+                    case EVT_INTRUDER_CLEAR: 
+                        printf("\r[EMERGENCY] Ignoring intruder clear, in emergency mode");
+                        break;
+                    case EVT_EMERGENCY_TIMER:
+                            exit_emergency(); 
+                        break;
+
+                    case EVT_EMERGENCY:
+                        break; // remain in emergency and do nothing. wait for timeout 
+
+                    case EVT_LEADER_TIMEOUT:
+                        break; // ignore; already in safe mode
+
+                    default:
+                        break;
                 }
                 break;
 
-        case EMERGENCY_BRAKE:
-            switch (evnt.type) {
-                case EVT_CRUISE_CMD: 
-                    printf("\r[EMERGENCY] Ignoring cruise cmd, in emergency mode");
+            case STOPPED:
+                switch (evnt.type) {
+                case EVT_CRUISE_CMD:
+                    pthread_mutex_lock(&mutex_follower);
+                    follower.state = CRUISE;
+                    handle_cruise_cmd(&evnt);
+                    pthread_mutex_unlock(&mutex_follower);
+                    printf("\n[WATCHDOG] Leader messages resumed -> CRUISE\n");
                     break;
                 case EVT_DISTANCE:
-                    printf("\r[EMERGENCY] Ignoring distance update, in emergency mode");
-                    break;
-                case EVT_INTRUDER: 
-                    printf("\r[EMERGENCY] Ignoring intruder event, in emergency mode");
-                    break;
-                case EVT_INTRUDER_CLEAR: 
-                    printf("\r[EMERGENCY] Ignoring intruder clear, in emergency mode");
-                    break;
-                case EVT_EMERGENCY_TIMER:
-                        exit_emergency(); 
+                    /* Stay safely stopped on stale leader. We can still update our notion of the front
+                     * truck position for gap display, but MUST NOT run cruise control here.
+                     */
+                    if (platoon_position > 1) {
+                        have_front_position = 1;
+                        front_ref.x = evnt.event_data.ft_pos.x;
+                        front_ref.y = evnt.event_data.ft_pos.y;
+                        front_speed = evnt.event_data.ft_pos.speed;
+                    }
                     break;
-
                 case EVT_EMERGENCY:
-                    break; // remain in emergency and do nothing. wait for timeout 
-
+                    enter_emergency();
+                    break;
                 case EVT_LEADER_TIMEOUT:
-                    break; // ignore; already in safe mode
-
+                    break;
                 default:
                     break;
-            }
-            break;
-
-        case STOPPED:
-            switch (evnt.type) {
-            case EVT_CRUISE_CMD:
-                pthread_mutex_lock(&mutex_follower);
-                follower.state = CRUISE;
-                handle_cruise_cmd(&evnt);
-                pthread_mutex_unlock(&mutex_follower);
-                printf("\n[WATCHDOG] Leader messages resumed -> CRUISE\n");
-                break;
-            case EVT_DISTANCE:
-                /* Stay safely stopped on stale leader. We can still update our notion of the front
-                 * truck position for gap display, but MUST NOT run cruise control here.
-                 */
-                if (platoon_position > 1) {
-                    have_front_position = 1;
-                    front_ref.x = evnt.event_data.ft_pos.x;
-                    front_ref.y = evnt.event_data.ft_pos.y;
-                    front_speed = evnt.event_data.ft_pos.speed;
                 }
                 break;
-            case EVT_EMERGENCY:
-                enter_emergency();
-                break;
-            case EVT_LEADER_TIMEOUT:
-                break;
-            default:
-                break;
             }
-            break;
+            event_latency_record_service(&follower_latency, evnt.type, lat_now_ns() - handle_start_ns);
         }
     }
+    tpio_close(&follower_io);
     return NULL;
 }
 
@@ -772,6 +1084,17 @@ static void handle_cruise_cmd(Event *evnt) {
     }
 }
 
+// Helper to run cruise control on the extrapolated leader while full commands are sparse
+static void handle_leader_predict(void) {
+    if (!have_leader_ref) return;
+    uint64_t now = monotonic_ms();
+    if (now - leader_ref_rx_ms < LEADER_PREDICT_AFTER_MS) return;
+    /* Stale leader: the watchdog decides, nothing is extrapolated */
+    if (now - last_leader_rx_ms > (uint64_t)LEADER_RX_TIMEOUT_MS) return;
+    Event predicted = {.type = EVT_CRUISE_CMD, .event_data.leader_cmd = leader_predict(now)};
+    handle_cruise_cmd(&predicted);
+}
+
 // Helper to handle distance update from truck ahead
 static void handle_distance_update(Event *evnt) {
   // Use platoon_position (not follower_idx) to determine if we receive UDP updates
@@ -830,15 +1153,12 @@ void send_position_to_rear(void) {
     pthread_mutex_unlock(&mutex_topology);
 
     if (local_has_rear) {
-    struct sockaddr_in dst = {.sin_family = AF_INET,
-                                                            .sin_port = htons(local_rear.udp_port)};
-        inet_pton(AF_INET, local_rear.ip, &dst.sin_addr);
-
     FT_MESSAGE msg = {.type = MSG_FT_POSITION,
                       .payload.position = {.x = follower.x,
                                            .y = follower.y,
                                            .speed = follower.speed}};
-    sendto(udp_sock, &msg, sizeof(msg), 0, (struct sockaddr *)&dst,
-           sizeof(dst));
+    unsigned char wire[TPWIRE_MAX];
+    size_t len = tpwire_encode_ft(&msg, wire, sizeof(wire));
+    sendToTruck(udp_sock, &local_rear, wire, len);
   }
 }
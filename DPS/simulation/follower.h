@@ -6,6 +6,8 @@
 #include "truckplatoon.h"
 #include "event.h"
 #include "tpnet.h"
+#include "tpio.h"
+#include "timer_wheel.h"
 #include <pthread.h>
 #include <time.h>
 
@@ -16,7 +18,7 @@ extern int32_t has_rearTruck;
 extern int8_t simulation_running;
 
 /* Thread IDs */
-extern pthread_t udp_tid, tcp_tid, sm_tid;
+extern pthread_t sm_tid;
 
 extern pthread_mutex_t mutex_follower;
 extern pthread_mutex_t mutex_topology;  // FOR has_rearTruck, rearTruck_Address
@@ -25,6 +27,9 @@ extern pthread_mutex_t mutex_sockets;   // FOR udp_sock, tcp2Leader
 /* Event Queue */
 extern EventQueue truck_EventQ;
 
+/* Emergency/intruder hold timers and the leader watchdog */
+extern TimerWheel follower_timers;
+
 /* Sockets */
 extern int udp_sock;
 extern int32_t tcp2Leader;
@@ -38,10 +43,15 @@ extern MatrixClock follower_clock;
 extern IntruderInfo current_intruder;
 extern float current_target_gap;
 
+#define FOLLOWER_EPOLL_MAX 8
+#define FOLLOWER_TOKEN_TRUCK 1      // tpio token tag (bits 32+) of front-truck shm links
+
 /* Thread Functions */
-void* udp_listener(void* arg);
-void* tcp_listener(void* arg);
-void* truck_state_machine(void* arg);
+void* truck_state_machine(void* arg);   /* waits on truck_EventQ + udp_sock + tcp2Leader via tpio */
+
+/* Socket receive handlers, called by the state machine with what the backend received */
+void udp_listener_handle(const TpIoEvent* ev);
+void tcp_listener_handle(const TpIoEvent* ev);
 
 /* Event Queue Functions */
 void set_realtime_priority(pthread_t tid, int policy, int priority);
@@ -61,6 +71,7 @@ int intruder_speed(void);
 int intruder_length(void);
 uint32_t intruder_duration(void);
 void notify_leader_intruder(IntruderInfo intruder);
+void reset_leader_clock_base(void);     /* new leader connection (mutex_sockets held) */
 void start_intruder_timer(uint32_t duration_ms);
 void start_emergency_timer(uint32_t duration_ms);
 void maybe_intruder(void);
@@ -3,7 +3,6 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
-#include <sys/timerfd.h>
 #include <sys/socket.h>
 #include <sys/poll.h>
 #include <unistd.h>
@@ -47,41 +46,13 @@ typedef struct {
 
 
 
-// intruder Time-out event generation 
-void* intruder_timer_thread(void* arg) {
-    uint32_t duration_ms = *(uint32_t*)arg;
-    free(arg);
-
-    int tfd = timerfd_create(CLOCK_MONOTONIC, 0);
-    if (tfd < 0) {
-        perror("timerfd_create");
-        return NULL;
-    }
-
-    struct itimerspec its = {0};
-    its.it_value.tv_sec  = duration_ms / 1000;
-    its.it_value.tv_nsec = (duration_ms % 1000) * 1000000;
-
-    timerfd_settime(tfd, 0, &its, NULL);
-
-    uint64_t expirations;
-    read(tfd, &expirations, sizeof(expirations));
-
-    Event e = {.type = EVT_INTRUDER_CLEAR};
-    push_event(&truck_EventQ, &e);
-
-    close(tfd);
-    return NULL;
-}
-
+// intruder Time-out event generation: EVT_INTRUDER_CLEAR after duration_ms
+static TimerId intruder_timer = TIMER_INVALID;
 
 void start_intruder_timer(uint32_t duration_ms) {
-    pthread_t tid;
-    uint32_t* arg = malloc(sizeof(uint32_t));
-    *arg = duration_ms;
-
-    pthread_create(&tid, NULL, intruder_timer_thread, arg);
-    pthread_detach(tid);
+    timer_cancel(&follower_timers, intruder_timer);
+    Event e = {.type = EVT_INTRUDER_CLEAR};
+    intruder_timer = timer_arm_event(&follower_timers, duration_ms, 0, &truck_EventQ, &e);
 }
 
 
@@ -168,6 +139,13 @@ void exit_intruder_follow(void) {
     printf("[STATE] Intruder cleared → back to CRUISE\n");
 }
 
+static MatrixClock clock_sent_to_leader; /* delta base for the leader connection (under mutex_sockets) */
+
+// Helper: A resumed leader connection decodes from an empty base
+void reset_leader_clock_base(void) {
+    mc_init(&clock_sent_to_leader);
+}
+
 // Helper: Notify leader about intruder
 void notify_leader_intruder(IntruderInfo intruder) {
 
@@ -177,10 +155,11 @@ void notify_leader_intruder(IntruderInfo intruder) {
     msg.payload.intruder = intruder;
 
     pthread_mutex_lock(&mutex_sockets);
-    int temp_clock[NUM_TRUCKS][NUM_TRUCKS]; //mc
-    memcpy(temp_clock, follower_clock.mc, sizeof(follower_clock.mc)); //mc
-    //memcpy(msg.matrix_clock, follower_clock.mc, sizeof(follower_clock.mc)); //mc
-    ssize_t ret = send(tcp2Leader, &msg, sizeof(msg), 0);
+    memcpy(msg.matrix_clock.mc, follower_clock.mc, sizeof(follower_clock.mc)); //mc
+    /* Only the entries that changed since the last report go on the wire */
+    unsigned char wire[TPWIRE_MAX];
+    size_t len = tpwire_encode_ft_delta(&msg, &clock_sent_to_leader, 1, wire, sizeof(wire));
+    int ret = tpframe_send(tcp2Leader, wire, len);
     pthread_mutex_unlock(&mutex_sockets);
     
     if (ret < 0) {
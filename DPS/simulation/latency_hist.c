@@ -0,0 +1,89 @@
+//File: latency_hist.c
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <time.h>
+
+#include "latency_hist.h"
+
+
+uint64_t lat_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void lat_hist_reset(LatencyHist* h) {
+    memset(h, 0, sizeof(*h));
+}
+
+/* Bucket index: linear below SUB_COUNT, then SUB_COUNT sub-buckets per power of two */
+static int bucket_of(uint64_t ns) {
+    if (ns < LAT_HIST_SUB_COUNT) {
+        return (int)ns;
+    }
+    int exp = 63 - __builtin_clzll(ns);
+    if (exp > LAT_HIST_MAX_EXP) {
+        return LAT_HIST_BUCKETS - 1;
+    }
+    int sub = (int)((ns >> (exp - LAT_HIST_SUB_BITS)) & (LAT_HIST_SUB_COUNT - 1));
+    return (exp - LAT_HIST_SUB_BITS + 1) * LAT_HIST_SUB_COUNT + sub;
+}
+
+/* Largest value that maps to bucket b */
+static uint64_t bucket_upper(int b) {
+    if (b < LAT_HIST_SUB_COUNT) {
+        return (uint64_t)b;
+    }
+    int exp = b / LAT_HIST_SUB_COUNT + LAT_HIST_SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(b % LAT_HIST_SUB_COUNT);
+    uint64_t width = 1ULL << (exp - LAT_HIST_SUB_BITS);
+    return (1ULL << exp) + (sub + 1) * width - 1;
+}
+
+void lat_hist_record(LatencyHist* h, uint64_t ns) {
+    __atomic_fetch_add(&h->counts[bucket_of(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum_ns, ns, __ATOMIC_RELAXED);
+
+    uint64_t cur = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    while (ns > cur &&
+           !__atomic_compare_exchange_n(&h->max_ns, &cur, ns, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+uint64_t lat_hist_percentile(const LatencyHist* h, double q) {
+    uint64_t total = __atomic_load_n(&h->total, __ATOMIC_RELAXED);
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t)((q / 100.0) * (double)total + 0.5);
+    if (rank < 1) rank = 1;
+
+    uint64_t seen = 0;
+    for (int b = 0; b < LAT_HIST_BUCKETS; b++) {
+        seen += __atomic_load_n(&h->counts[b], __ATOMIC_RELAXED);
+        if (seen >= rank) {
+            uint64_t upper = bucket_upper(b);
+            uint64_t max = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+            return upper < max ? upper : max;
+        }
+    }
+    return __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+}
+
+void lat_hist_print(const LatencyHist* h, FILE* out, const char* label) {
+    uint64_t total = __atomic_load_n(&h->total, __ATOMIC_RELAXED);
+    if (total == 0) {
+        return;
+    }
+    double mean_us = (double)__atomic_load_n(&h->sum_ns, __ATOMIC_RELAXED) / (double)total / 1000.0;
+    fprintf(out, "%-28s n=%-8llu mean=%9.1fus p50=%9.1fus p90=%9.1fus p99=%9.1fus p99.9=%9.1fus max=%9.1fus\n",
+            label, (unsigned long long)total, mean_us,
+            (double)lat_hist_percentile(h, 50.0) / 1000.0,
+            (double)lat_hist_percentile(h, 90.0) / 1000.0,
+            (double)lat_hist_percentile(h, 99.0) / 1000.0,
+            (double)lat_hist_percentile(h, 99.9) / 1000.0,
+            (double)__atomic_load_n(&h->max_ns, __ATOMIC_RELAXED) / 1000.0);
+}
@@ -0,0 +1,38 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Log-linear (HDR-style) latency histogram in nanoseconds.
+ * Values below 2^LAT_HIST_SUB_BITS get one bucket each; above that every power
+ * of two is split into 2^LAT_HIST_SUB_BITS linear sub-buckets, so the recorded
+ * value is within ~6% of the true one. Values above 2^LAT_HIST_MAX_EXP ns
+ * (~18 min) land in the last bucket.
+ * Recording is lock-free (atomic adds) and safe from any thread.
+ */
+#define LAT_HIST_SUB_BITS 4
+#define LAT_HIST_SUB_COUNT (1 << LAT_HIST_SUB_BITS)
+#define LAT_HIST_MAX_EXP 40
+#define LAT_HIST_BUCKETS ((LAT_HIST_MAX_EXP - LAT_HIST_SUB_BITS + 2) * LAT_HIST_SUB_COUNT)
+
+typedef struct {
+    uint64_t counts[LAT_HIST_BUCKETS];
+    uint64_t total;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+} LatencyHist;
+
+/* Monotonic clock in nanoseconds */
+uint64_t lat_now_ns(void);
+
+void lat_hist_reset(LatencyHist* h);
+void lat_hist_record(LatencyHist* h, uint64_t ns);
+
+/* Value at percentile q (0..100), upper edge of the matching bucket; 0 if empty */
+uint64_t lat_hist_percentile(const LatencyHist* h, double q);
+
+/* One line: count, mean, p50/p90/p99/p99.9, max (microseconds) */
+void lat_hist_print(const LatencyHist* h, FILE* out, const char* label);
+
+#endif
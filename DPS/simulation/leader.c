@@ -2,6 +2,7 @@
 
 
 #define _POSIX_C_SOURCE 200809L
+#define _DEFAULT_SOURCE /* SO_REUSEPORT */
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,93 +12,190 @@
 #include <pthread.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
-#include <sys/select.h>
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
 #include <termios.h>
 #include <signal.h>
+#include <semaphore.h>
 
 #include "truckplatoon.h"
 #include "matrix_clock.h"
 #include "event.h"
 #include "tpnet.h"
 #include "intruder.h"
-
-/* Leader truck state */
-int leader_socket_fd = -1;
-
-
-FollowerSession followers[MAX_FOLLOWERS];
-pthread_mutex_t mutex_followers; 
+#include "timer_wheel.h"
+#include "tpframe.h"
+#include "tpwire.h"
+#include "tpio.h"
+#include "tpshm.h"
+#include "session_table.h"
+#include "leader.h"
 
 #define MIN_FOLLOWERS 3
-int formation_complete = 0;
-int active_follower_count = 0;
-
-pthread_mutex_t mutex_client_fd_list;
-pthread_mutex_t mutex_leader_state;
-pthread_t sender_tid;
-pthread_t acceptor_tid;
-pthread_t receiver_tid;  
-pthread_t input_tid;
-pthread_t state_tid; 
-
-/* Leader Event Queue */
-EventQueue leader_EventQ;
-
-Truck leader;
-uint64_t cmd_id = 0;
-CommandQueue cmd_queue; 
-int pending_turn = 0;
-DIRECTION next_turn_dir;
-int leader_intruder_length = 0;
-
-/* If set, leader keeps connections but stops sending periodic cruise commands.
- * Used to simulate network/leader stalls so follower watchdog can trigger.
- */
-static int leader_stale_mode = 0;
-
-MatrixClock leader_clock; //matrix clock declaration
+
+/* Hosted platoons, indexed by platoon ID, and the shards running them.
+ * Both are fixed once leader_server_init() returns. */
+static Platoon** leader_platoons = NULL;
+static int leader_platoon_total = 0;
+static LeaderShard* leader_shards = NULL;
+static int leader_shard_total = 0;
+
+/* I/O reactor: each shard has one tpio backend (io_uring or epoll) for its
+ * follower sockets and a shutdown eventfd. Shards that accept also watch a
+ * listening socket and their pending joins; shard 0 reads stdin. Joins and
+ * followers keep a receive posted; followers also report writable edges.
+ * Shared-memory links (TP_NET=shm) are handled exactly like follower sockets,
+ * once the connector's segment has arrived on the accepted socket (LR_SHM_SETUP,
+ * under the same join deadline).
+ * Token = (kind << 56) | (platoon << 32) | fd */
+enum { LR_LISTEN = 1, LR_PENDING, LR_FOLLOWER, LR_STDIN, LR_WAKE, LR_SHM_LISTEN, LR_SHM_SETUP };
+
+/* Optional multicast data plane (--mcast): one datagram per cruise command for
+ * the whole platoon, to the platoon's own group port. -1 = commands go to each
+ * follower over TCP. */
+static int leader_mcast_fd = -1;
+
+/* --latest-wins: a sender that falls behind sends each platoon's newest
+ * cruise command instead of the backlog (turns are always sent) */
+static CmdQueueMode leader_cmd_mode = CMDQ_FIFO;
+
+/* --on-change: full cruise commands only when followers could not predict them */
+static int leader_on_change = 0;
+
+/* --resume-ms: how long a dropped follower's slot waits for it to reconnect */
+static int leader_resume_ms = LEADER_RESUME_MS;
+
+/* Session tokens: distinct for every session of a leader run and never 0
+ * (splitmix64 over a counter, offset by a per-run base) */
+static uint64_t leader_token_base;
+static uint64_t leader_token_count;
+
+static uint64_t leader_new_token(void) {
+    uint64_t z = leader_token_base +
+                 __atomic_add_fetch(&leader_token_count, 1, __ATOMIC_RELAXED) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
 
 static volatile sig_atomic_t leader_shutdown_requested = 0;
 static volatile sig_atomic_t leader_sig_received = 0;
+static volatile sig_atomic_t leader_dump_requested = 0; /* SIGUSR1: print queue stats */
+static sem_t leader_main_wake; /* posted by signals and shutdown; main waits on it */
 
 static void leader_request_shutdown(const char* reason);
 static void leader_close_all_sockets(void);
 static void leader_on_signal(int signo);
 
-void* accept_handler(void* arg);
-void* send_handler(void* arg);
-void* follower_message_receiver(void* arg);
-void *input_handler(void *arg); //BW
-void* leader_state_machine(void* arg); //MSR
-void move_truck(Truck* t, float dt);
-void queue_commands(LeaderCommand* ldr_cmd);
-void broadcast_emergency_to_followers(void);
+static void send_spawn_to_follower(Platoon* p, FollowerSession* s);
+static int follower_resume_locked(Platoon* p, FollowerSession* s, int fd, const FollowerRegisterMsg* reg);
+static void follower_queue_locked(FollowerSession* s, const LD_MESSAGE* msg);
+static void follower_flush_locked(Platoon* p, FollowerSession* s);
+static int leader_reactor_watch(LeaderShard* sh, int fd, int kind, int platoon);
+static int leader_reactor_frames(Platoon* p, int fd, LeaderConnRx* conn);
 
-void register_new_follower(int fd, FollowerRegisterMsg* reg_msg);
-void broadcast_to_followers(const void* msg_data, size_t msg_len);
-static void compact_followers_locked(void);
-static void send_spawn_to_follower(int fd, int assigned_id);
+/* Platoon 0 owns the console: per-tick status and keyboard feedback */
+static int platoon_console(const Platoon* p) {
+    return p->id == 0;
+}
 
 #ifndef TEST_LEADER
+static TimerWheel leader_timers;
+
+static void leader_dump_event_stats(void);
+
+/* Periodic timer (timer thread): one EVT_TICK_UPDATE per LEADER_TICK_DT per shard */
+static void leader_tick(void* arg) {
+    LeaderShard* sh = arg;
+    Event tick_ev = {.type = EVT_TICK_UPDATE, .event_data.tick.seq = ++sh->tick_seq};
+    push_event(&sh->events, &tick_ev);
+}
+
+/* Multicast sender for cruise commands: TTL 1, looped back to local members */
+static int leader_mcast_open(void) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("multicast socket");
+        return -1;
+    }
+    unsigned char ttl = 1, loop = 1;
+    struct in_addr ifaddr;
+    inet_pton(AF_INET, LEADER_IP, &ifaddr);
+    if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &ifaddr, sizeof(ifaddr)) < 0) {
+        perror("multicast setsockopt");
+        close(fd);
+        return -1;
+    }
+    leader_mcast_fd = fd;
+    return 0;
+}
+
+/* Parse a positive integer option value; -1 if invalid */
+static long leader_parse_count(const char* s, long max) {
+    char* endp = NULL;
+    long v = strtol(s, &endp, 10);
+    if (endp == s || *endp != '\0' || v <= 0 || v > max) return -1;
+    return v;
+}
+
 int main(int argc, char** argv) {
     uint16_t leader_port = LEADER_PORT;
-    if (argc > 2) {
-        fprintf(stderr, "Usage: %s [LEADER_TCP_PORT]\n", argv[0]);
+    int use_mcast = 0, use_reuseport = 0;
+    long platoon_count = 1, shard_count = 1;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--mcast") == 0) {
+            use_mcast = 1;
+            continue;
+        }
+        if (strcmp(argv[a], "--reuseport") == 0) {
+            use_reuseport = 1;
+            continue;
+        }
+        if (strcmp(argv[a], "--latest-wins") == 0) {
+            leader_cmd_mode = CMDQ_LATEST_WINS;
+            continue;
+        }
+        if (strcmp(argv[a], "--on-change") == 0) {
+            leader_on_change = 1;
+            continue;
+        }
+        if (strcmp(argv[a], "--resume-ms") == 0 && a + 1 < argc) {
+            const char* v = argv[++a];
+            long ms = strcmp(v, "0") == 0 ? 0 : leader_parse_count(v, 600000);
+            if (ms >= 0) {
+                leader_resume_ms = (int)ms;
+                continue;
+            }
+        } else if (strcmp(argv[a], "--platoons") == 0 && a + 1 < argc) {
+            platoon_count = leader_parse_count(argv[++a], LEADER_MAX_PLATOONS);
+            if (platoon_count > 0) continue;
+        } else if (strcmp(argv[a], "--shards") == 0 && a + 1 < argc) {
+            shard_count = leader_parse_count(argv[++a], LEADER_MAX_SHARDS);
+            if (shard_count > 0) continue;
+        } else {
+            long p = leader_parse_count(argv[a], 65535);
+            if (p > 0) {
+                leader_port = (uint16_t)p;
+                continue;
+            }
+        }
+        fprintf(stderr, "Invalid argument: %s\nUsage: %s [LEADER_TCP_PORT] [--mcast] [--platoons N] [--shards N] [--reuseport] [--latest-wins] [--on-change] [--resume-ms MS]\n",
+                argv[a], argv[0]);
         return 1;
     }
-    if (argc == 2) {
-        char* endp = NULL;
-        long p = strtol(argv[1], &endp, 10);
-        if (endp == argv[1] || *endp != '\0' || p <= 0 || p > 65535) {
-            fprintf(stderr, "Invalid port: %s\nUsage: %s [LEADER_TCP_PORT]\n", argv[1], argv[0]);
-            return 1;
-        }
-        leader_port = (uint16_t)p;
+    if (use_mcast && leader_mcast_open() < 0) {
+        fprintf(stderr, "Multicast unavailable; cruise commands stay on TCP\n");
     }
 
     srand(time(NULL));
+    sem_init(&leader_main_wake, 0, 0);
 
     struct sigaction sa = {0};
     sa.sa_handler = leader_on_signal;
@@ -105,120 +203,320 @@ int main(int argc, char** argv) {
     sa.sa_flags = 0;
     sigaction(SIGINT, &sa, NULL);
     sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGUSR1, &sa, NULL);
 
-    pthread_mutex_init(&mutex_client_fd_list, NULL);
-    pthread_mutex_init(&mutex_leader_state, NULL);
-
-    /* Initialize follower sessions */
-    pthread_mutex_init(&mutex_followers, NULL);
-    for (int i = 0; i < MAX_FOLLOWERS; i++) {
-        followers[i].active = 0;
-        followers[i].fd = -1;
-        followers[i].id = i + 1; /* logical IDs start at 1 */
-        followers[i].address.udp_port = 0;
-        followers[i].address.ip[0] = '\0';
+    /* Platoons, shards, their event queues and I/O backends */
+    if (leader_server_init((int)platoon_count, (int)shard_count) < 0) {
+        fprintf(stderr, "Leader setup failed\n");
+        return 1;
     }
+    LeaderShard* shard0 = leader_shard(0);
 
-//Init leader
-    leader = (Truck){.x = 0.0f, .y = 0.0f, .speed = 0.0f, .dir = NORTH, .state = STOPPED};
-//Init Event queue
-    event_queue_init(&leader_EventQ);
-//Leader FSM
-    if (pthread_create(&state_tid, NULL, leader_state_machine, NULL) != 0) {
-        perror("pthread_create state");
-        return 1;
-    }   
-    mc_init(&leader_clock); // MHK:  matrix clock
+    /* Leader FSMs */
+    for (int i = 0; i < leader_shard_total; i++) {
+        if (pthread_create(&leader_shards[i].fsm_tid, NULL, leader_state_machine, &leader_shards[i]) != 0) {
+            perror("pthread_create state");
+            return 1;
+        }
+    }
 
 //Leader TCP Sock
-    leader_socket_fd = socket(AF_INET, SOCK_STREAM, 0);
-    struct sockaddr_in addr = {
-        .sin_family = AF_INET,
-        .sin_port = htons(leader_port),
-        .sin_addr.s_addr = INADDR_ANY
-    };
-
-    if (bind(leader_socket_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        perror("bind");
+    if (leader_listen(leader_port, use_reuseport) < 0) {
         return 1;
     }
-    if (listen(leader_socket_fd, MAX_FOLLOWERS) < 0) {
-        perror("listen");
-        return 1;
-    }
-
-    /* Initialize command queue */
-    cmd_queue.head = 0;
-    cmd_queue.tail = 0;
-    pthread_mutex_init(&cmd_queue.mutex, NULL);
-    pthread_cond_init(&cmd_queue.not_empty, NULL);
 
-    /* Start acceptor and sender threads */
-    if (pthread_create(&acceptor_tid, NULL, accept_handler, NULL) != 0) {
-        perror("pthread_create acceptor");
-        return 1;
+    /* Raw keyboard input, read by shard 0's reactor and handed to every shard */
+    struct termios oldt, newt;
+    int have_tty = (tcgetattr(STDIN_FILENO, &oldt) == 0);
+    if (have_tty) {
+        newt = oldt;
+        newt.c_lflag &= ~(ICANON | ECHO);
+        tcsetattr(STDIN_FILENO, TCSANOW, &newt);
     }
-    if (pthread_create(&sender_tid, NULL, send_handler, NULL) != 0) {
-        perror("pthread_create sender");
-        return 1;
-    }
-    if (pthread_create(&receiver_tid, NULL, follower_message_receiver, NULL) != 0) {
-        perror("pthread_create receiver");
-        return 1;
+    if (leader_reactor_watch(shard0, STDIN_FILENO, LR_STDIN, 0) < 0) {
+        fprintf(stderr, "stdin is not pollable; keyboard controls disabled\n");
     }
-    if (pthread_create(&input_tid, NULL, input_handler, NULL) != 0) {
-    perror("pthread_create input");
-    return 1;
+
+    /* Start reactor (accept + follower rx + keyboard) and sender threads */
+    for (int i = 0; i < leader_shard_total; i++) {
+        if (pthread_create(&leader_shards[i].reactor_tid, NULL, leader_reactor, &leader_shards[i]) != 0) {
+            perror("pthread_create reactor");
+            return 1;
+        }
+        if (pthread_create(&leader_shards[i].sender_tid, NULL, send_handler, &leader_shards[i]) != 0) {
+            perror("pthread_create sender");
+            return 1;
+        }
     }
 
+        if (leader_mcast_fd >= 0) {
+            printf("Cruise commands on multicast %s:%d (+ platoon ID)\n", LEADER_MCAST_GROUP, LEADER_MCAST_PORT);
+        }
+        if (leader_platoon_total > 1) {
+            printf("Hosting %d platoons on %d shards\n", leader_platoon_total, leader_shard_total);
+        }
+        if (use_reuseport) {
+            printf("Accepting joins on %d SO_REUSEPORT listeners\n", leader_shard_total);
+        }
         printf("Leader started on TCP port %u.\nControls:\n\t[w/s] Speed\n\t [a/d] Turn \n\t [space] Brake \n\t [p] ToggleStale \n\t [q] Quit\n",
             (unsigned)leader_port);
 
-    struct timespec next_tick;
-    clock_gettime(CLOCK_MONOTONIC, &next_tick);
-
-
-    while (!leader_shutdown_requested) {
-                if (leader_sig_received) {
-                        leader_request_shutdown("signal");
-                        break;
-                }
-        next_tick.tv_nsec += (long)(LEADER_TICK_DT * 1e9);
-    if (next_tick.tv_nsec >= 1e9) {
-      next_tick.tv_sec += 1;
-      next_tick.tv_nsec -= 1e9;
+    /* Tick generation runs on the timer service; main only handles signals */
+    const uint32_t tick_ms = (uint32_t)(LEADER_TICK_DT * 1000.0f);
+    if (timer_wheel_start(&leader_timers) < 0) {
+        leader_request_shutdown("timer service failed");
+    }
+    for (int i = 0; i < leader_shard_total && !leader_shutdown_requested; i++) {
+        if (timer_arm_fn(&leader_timers, tick_ms, tick_ms, leader_tick, &leader_shards[i]) == TIMER_INVALID) {
+            leader_request_shutdown("timer service failed");
+        }
     }
 
-    /* push  EVT_TICK_UPDATE event for the leader state machine*/
-    Event tick_ev = {.type = EVT_TICK_UPDATE};
-    push_event(&leader_EventQ, &tick_ev);
-
-    int rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_tick, NULL);
-    if (rc == EINTR && leader_sig_received) {
-        leader_request_shutdown("signal");
-        break;
+    while (!leader_shutdown_requested) {
+        sem_wait(&leader_main_wake);
+        if (leader_sig_received) {
+            leader_request_shutdown("signal");
+            break;
+        }
+        if (leader_dump_requested) {
+            leader_dump_requested = 0;
+            leader_dump_event_stats();
+        }
     }
-  }
 
   leader_request_shutdown("main exit");
 
-  pthread_join(input_tid, NULL);
-  pthread_join(acceptor_tid, NULL);
-  pthread_join(receiver_tid, NULL);
-  pthread_join(sender_tid, NULL);
-  pthread_join(state_tid, NULL);
+  for (int i = 0; i < leader_shard_total; i++) {
+      pthread_join(leader_shards[i].reactor_tid, NULL);
+      pthread_join(leader_shards[i].sender_tid, NULL);
+      pthread_join(leader_shards[i].fsm_tid, NULL);
+  }
+  timer_wheel_stop(&leader_timers);
+  if (have_tty) {
+      tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+  }
 
   leader_close_all_sockets();
+  leader_dump_event_stats();
+  /* Every thread has exited: nothing waits on or writes through the backends any more */
+  for (int i = 0; i < leader_shard_total; i++) {
+      LeaderShard* sh = &leader_shards[i];
+      if (!sh->io_ready) continue;
+      sh->io_ready = 0;
+      tpio_close(&sh->tx);
+      tpio_close(&sh->io);
+  }
   return 0;
-    
+
 }
 #endif
 
+/* Shard setup: queues, I/O backends and egress scratch */
+static int leader_shard_init(LeaderShard* sh, int index, int platoon_count) {
+    sh->index = index;
+    sh->platoons = calloc((size_t)platoon_count, sizeof(*sh->platoons));
+    sh->wake_fd = -1;
+    sh->listen_fd = -1;
+    sh->shm_listen_fd = -1;
+    sh->tx_ops = calloc(LEADER_TX_BATCH, sizeof(*sh->tx_ops));
+    sh->tx_iov = calloc(LEADER_TX_BATCH, sizeof(*sh->tx_iov));
+    sh->tx_total = calloc(LEADER_TX_BATCH, sizeof(*sh->tx_total));
+    if (!sh->platoons || !sh->tx_ops || !sh->tx_iov || !sh->tx_total) return -1;
+    pthread_mutex_init(&sh->rx_lock, NULL);
+    pthread_mutex_init(&sh->tx_lock, NULL);
+
+//Init Event queue
+    event_queue_init(&sh->events);
+    /* A late FSM handles one tick carrying the seq of the newest one */
+    event_queue_set_coalesce(&sh->events, EVT_TICK_UPDATE, 1);
+    /* Back-pressure the receiver briefly rather than losing follower reports */
+    event_queue_set_overflow(&sh->events, EVT_FOLLOWER_MSG, EVQ_OVERFLOW_BLOCK, 50);
+    event_queue_attach_latency(&sh->events, &sh->latency);
+
+    /* Command queue: room for CMD_QUEUE_SIZE commands per platoon */
+    if (cmdq_init(&sh->cmd_queue, platoon_count, leader_cmd_mode) < 0) return -1;
+
+    /* Without a backend, writes fall back to plain sends and nothing is received.
+     * Shared-memory links are served by the epoll backend only. */
+    if (tpio_open(&sh->io, tpshm_enabled() ? TPIO_POSIX : TPIO_AUTO) < 0) {
+        perror("tpio_open");
+        return 0;
+    }
+    if (tpio_open(&sh->tx, sh->io.kind) < 0) {
+        perror("tpio_open");
+        tpio_close(&sh->io);
+        return 0;
+    }
+    sh->io_ready = 1;
+    sh->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (sh->wake_fd >= 0) {
+        leader_reactor_watch(sh, sh->wake_fd, LR_WAKE, 0);
+    }
+    return 0;
+}
+
+static int leader_platoon_init(Platoon* p, int id, LeaderShard* sh) {
+    p->id = id;
+    p->shard = sh;
+    p->slot = sh->platoon_count;
+    p->leader = (Truck){.x = 0.0f, .y = 0.0f, .speed = 0.0f, .dir = NORTH, .state = STOPPED};
+    pthread_mutex_init(&p->mutex_state, NULL);
+    pthread_mutex_init(&p->mutex_followers, NULL);
+    mc_init(&p->clock); // MHK:  matrix clock
+    p->mcast_dst = (struct sockaddr_in){.sin_family = AF_INET, .sin_port = htons(LEADER_MCAST_PORT + id)};
+    inet_pton(AF_INET, LEADER_MCAST_GROUP, &p->mcast_dst.sin_addr);
+    sh->platoons[sh->platoon_count++] = p;
+    return 0;
+}
+
+int leader_server_init(int platoons, int shards) {
+    if (platoons <= 0 || platoons > LEADER_MAX_PLATOONS || shards <= 0) return -1;
+    if (shards > platoons) shards = platoons;
+    if (shards > LEADER_MAX_SHARDS) shards = LEADER_MAX_SHARDS;
+
+    leader_token_base = lat_now_ns() ^ ((uint64_t)getpid() << 32);
+    leader_shards = calloc((size_t)shards, sizeof(*leader_shards));
+    leader_platoons = calloc((size_t)platoons, sizeof(*leader_platoons));
+    if (!leader_shards || !leader_platoons) return -1;
+    for (int i = 0; i < shards; i++) {
+        int hosted = platoons / shards + (i < platoons % shards ? 1 : 0);
+        if (leader_shard_init(&leader_shards[i], i, hosted) < 0) return -1;
+    }
+    for (int id = 0; id < platoons; id++) {
+        leader_platoons[id] = calloc(1, sizeof(Platoon));
+        if (!leader_platoons[id]) return -1;
+        leader_platoon_init(leader_platoons[id], id, &leader_shards[id % shards]);
+    }
+    leader_shard_total = shards;
+    leader_platoon_total = platoons;
+    return 0;
+}
+
+Platoon* leader_platoon(int id) {
+    if (id < 0 || id >= leader_platoon_total) return NULL;
+    return leader_platoons[id];
+}
+
+int leader_shard_count(void) {
+    return leader_shard_total;
+}
+
+LeaderShard* leader_shard(int index) {
+    if (index < 0 || index >= leader_shard_total) return NULL;
+    return &leader_shards[index];
+}
+
+/* Non-blocking listening socket on port, so a reactor can accept until EAGAIN; -1 on failure */
+static int leader_listen_socket(uint16_t port, int reuseport) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = INADDR_ANY
+    };
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+        perror("SO_REUSEPORT");
+        close(fd);
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+    /* Deep enough that a mass join never overflows the accept queue */
+    if (listen(fd, LEADER_LISTEN_BACKLOG) < 0) {
+        perror("listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int leader_listen(uint16_t port, int reuseport) {
+    int acceptors = reuseport ? leader_shard_total : 1;
+    for (int i = 0; i < acceptors; i++) {
+        LeaderShard* sh = &leader_shards[i];
+        sh->listen_fd = leader_listen_socket(port, reuseport);
+        if (sh->listen_fd < 0) return -1;
+        if (leader_reactor_watch(sh, sh->listen_fd, LR_LISTEN, 0) < 0) return -1;
+    }
+    if (tpshm_enabled()) {
+        LeaderShard* sh = &leader_shards[0];
+        char name[64];
+        tpshm_name(name, sizeof(name), "leader", port);
+        sh->shm_listen_fd = tpshm_listen(name);
+        if (sh->shm_listen_fd < 0) {
+            perror("shared-memory listen");
+            return -1;
+        }
+        if (leader_reactor_watch(sh, sh->shm_listen_fd, LR_SHM_LISTEN, 0) < 0) return -1;
+        printf("[LEADER] Shared-memory links on %s\n", name);
+    }
+    return 0;
+}
+
 static void leader_on_signal(int signo) {
-    (void)signo;
-    leader_sig_received = 1;
+    if (signo == SIGUSR1) {
+        leader_dump_requested = 1;
+    } else {
+        leader_sig_received = 1;
+    }
+    sem_post(&leader_main_wake); /* async-signal-safe */
 }
 
+#ifndef TEST_LEADER
+static void leader_dump_event_stats(void) {
+    char label[32];
+    for (int i = 0; i < leader_shard_total; i++) {
+        LeaderShard* sh = &leader_shards[i];
+        if (leader_shard_total > 1) snprintf(label, sizeof(label), "LEADER shard %d", i);
+        else snprintf(label, sizeof(label), "LEADER");
+        event_queue_dump_stats(&sh->events, stderr, label);
+        event_latency_dump(&sh->latency, stderr, label);
+        if (sh->io_ready) {
+            fprintf(stderr, "[%s] io backend=%s reactor syscalls=%llu send syscalls=%llu\n", label,
+                    tpio_name(&sh->io),
+                    (unsigned long long)__atomic_load_n(&sh->io.syscalls, __ATOMIC_RELAXED),
+                    (unsigned long long)__atomic_load_n(&sh->tx.syscalls, __ATOMIC_RELAXED));
+        }
+        CmdQueueStats cq;
+        cmdq_get_stats(&sh->cmd_queue, &cq);
+        fprintf(stderr, "[%s] cmd queue %s: pushed=%llu dropped=%llu replaced=%llu wakeups=%llu\n", label,
+                leader_cmd_mode == CMDQ_LATEST_WINS ? "latest-wins" : "fifo",
+                (unsigned long long)cq.pushed, (unsigned long long)cq.dropped,
+                (unsigned long long)cq.replaced, (unsigned long long)cq.wakeups);
+    }
+
+    for (int id = 0; id < leader_platoon_total; id++) {
+        Platoon* p = leader_platoons[id];
+        pthread_mutex_lock(&p->mutex_followers);
+        for (FollowerSession* f = p->followers.head; f; f = f->next) {
+            fprintf(stderr, "[LEADER] platoon %d follower %d outbound: sent=%llu dropped=%llu queued=%u writes=%llu\n",
+                    p->id, f->id, (unsigned long long)f->out.sent,
+                    (unsigned long long)f->out.dropped, f->out.count,
+                    (unsigned long long)f->out.writes);
+        }
+        pthread_mutex_unlock(&p->mutex_followers);
+        if (leader_on_change) {
+            fprintf(stderr, "[LEADER] platoon %d on-change: commands=%llu heartbeats=%llu ticks=%lu\n", p->id,
+                    (unsigned long long)p->cmds_full, (unsigned long long)p->cmds_heartbeat, p->tick_count);
+        }
+        if (p->mcast_sent) {
+            fprintf(stderr, "[LEADER] platoon %d multicast commands sent=%llu next_seq=%u\n", p->id,
+                    (unsigned long long)p->mcast_sent,
+                    __atomic_load_n(&p->mcast_seq, __ATOMIC_ACQUIRE));
+        }
+    }
+}
+#endif
+
 static void leader_request_shutdown(const char* reason) {
     if (leader_shutdown_requested) return;
     leader_shutdown_requested = 1;
@@ -227,173 +525,336 @@ static void leader_request_shutdown(const char* reason) {
         fprintf(stderr, "\n[LEADER] Shutdown requested (%s)\n", reason);
     }
 
-    /* Wake the FSM and sender thread */
-    Event ev = {.type = EVT_SHUTDOWN};
-    push_event(&leader_EventQ, &ev);
+    /* Wake main, then every shard's reactor, FSM and sender thread */
+    sem_post(&leader_main_wake);
+    for (int i = 0; i < leader_shard_total; i++) {
+        LeaderShard* sh = &leader_shards[i];
+        if (sh->wake_fd >= 0) {
+            uint64_t one = 1;
+            ssize_t wr = write(sh->wake_fd, &one, sizeof(one));
+            (void)wr;
+        }
+        Event ev = {.type = EVT_SHUTDOWN};
+        push_event(&sh->events, &ev);
 
-    pthread_mutex_lock(&cmd_queue.mutex);
-    pthread_cond_broadcast(&cmd_queue.not_empty);
-    pthread_mutex_unlock(&cmd_queue.mutex);
+        cmdq_close(&sh->cmd_queue);
+    }
 
-    /* Unblock accept() / recv() / select() by closing sockets */
+    /* Close listening and follower sockets */
     leader_close_all_sockets();
 }
 
 static void leader_close_all_sockets(void) {
-    /* Close listening socket */
-    if (leader_socket_fd >= 0) {
-        shutdown(leader_socket_fd, SHUT_RDWR);
-        close(leader_socket_fd);
-        leader_socket_fd = -1;
+    /* Close listening sockets */
+    for (int i = 0; i < leader_shard_total; i++) {
+        LeaderShard* sh = &leader_shards[i];
+        if (sh->listen_fd >= 0) {
+            shutdown(sh->listen_fd, SHUT_RDWR);
+            close(sh->listen_fd);
+            sh->listen_fd = -1;
+        }
+        if (sh->shm_listen_fd >= 0) {
+            close(sh->shm_listen_fd);
+            sh->shm_listen_fd = -1;
+        }
+    }
+    if (leader_mcast_fd >= 0) {
+        close(leader_mcast_fd);
+        leader_mcast_fd = -1;
     }
 
     /* Close all follower sockets */
-    pthread_mutex_lock(&mutex_followers);
-    for (int i = 0; i < MAX_FOLLOWERS; i++) {
-        if (!followers[i].active) continue;
-        int fd = followers[i].fd;
-        followers[i].active = 0;
-        followers[i].fd = -1;
-        if (fd >= 0) {
-            shutdown(fd, SHUT_RDWR);
-            close(fd);
+    for (int id = 0; id < leader_platoon_total; id++) {
+        Platoon* p = leader_platoons[id];
+        pthread_mutex_lock(&p->mutex_followers);
+        for (int i = 0; i < p->followers.count; i++) {
+            FollowerSession* f = p->followers.dense[i];
+            outq_free(&f->out);
+            if (f->fd < 0) continue; /* held for a resume */
+            shutdown(f->fd, SHUT_RDWR);
+            tpshm_close(f->fd);
         }
+        session_table_clear(&p->followers);
+        pthread_mutex_unlock(&p->mutex_followers);
     }
-    pthread_mutex_unlock(&mutex_followers);
 }
 
 
-void* accept_handler(void* arg) {
-    (void)arg;
-
-    while (!leader_shutdown_requested) {
-        if (leader_socket_fd < 0) break;
-
-        fd_set rfds;
-        FD_ZERO(&rfds);
-        FD_SET(leader_socket_fd, &rfds);
-        struct timeval tv = {.tv_sec = 0, .tv_usec = 200000};
+/* Function: Queue a message to one follower without writing (mutex_followers held).
+ * Cruise commands are shed oldest-first when the follower falls behind; every
+ * other message is kept. A follower that cannot keep up even with those is shut
+ * down, and the reactor then runs the normal disconnect path. */
+static void follower_queue_locked(FollowerSession* s, const LD_MESSAGE* msg) {
+    if (s->fd < 0) return; /* held: a resume replays what the follower missed */
+    /* A stalled follower only needs the newest heartbeat; it must never crowd out a command */
+    OutPolicy policy = msg->type == MSG_LDR_CMD         ? OUTQ_DROP_OLDEST
+                       : msg->type == MSG_LDR_HEARTBEAT ? OUTQ_REPLACE
+                                                        : OUTQ_NEVER_DROP;
+    unsigned char frame[TPFRAME_HDR + TPWIRE_MAX];
+    /* Only never-dropped messages may advance the clock base: a shed command never reaches the follower */
+    size_t len = tpwire_encode_ld_delta(msg, &s->clock_sent, policy == OUTQ_NEVER_DROP,
+                                        frame + TPFRAME_HDR, TPWIRE_MAX);
+    if (len == 0) return;
+    tpframe_write_header(frame, len);
+    if (outq_push(&s->out, frame, TPFRAME_HDR + len, policy) < 0) {
+        fprintf(stderr, "[LEADER] Follower %d not draining its socket; disconnecting\n", s->id);
+        shutdown(s->fd, SHUT_RDWR);
+    }
+}
 
-        int ready = select(leader_socket_fd + 1, &rfds, NULL, NULL, &tv);
-        if (ready < 0) {
-            if (errno == EINTR) continue;
-            if (leader_shutdown_requested) break;
-            perror("select accept");
-            continue;
+/* Function: Write what is queued for the listed followers in tpio batches of up
+ * to LEADER_TX_BATCH writes: one io_uring_enter each on io_uring, one gathered
+ * sendmsg per follower on POSIX. A follower drops out of the pass once its
+ * queue is empty or its socket is full (the platoon's mutex_followers held). */
+static void followers_flush_locked(LeaderShard* sh, FollowerSession* const* list, int count) {
+    pthread_mutex_lock(&sh->tx_lock);
+    if (count > sh->tx_pending_cap) {
+        FollowerSession** grown = realloc(sh->tx_pending, sizeof(*grown) * (size_t)count);
+        if (!grown) {
+            pthread_mutex_unlock(&sh->tx_lock);
+            return;
         }
-        if (ready == 0) continue;
-        if (!FD_ISSET(leader_socket_fd, &rfds)) continue;
+        sh->tx_pending = grown;
+        sh->tx_pending_cap = count;
+    }
+    FollowerSession** pending = sh->tx_pending;
+    int left = 0;
+    for (int i = 0; i < count; i++) {
+        if (list[i]->out.count) pending[left++] = list[i];
+    }
 
-        int follower_fd = accept(leader_socket_fd, NULL, NULL);
-        if (follower_fd < 0) {
-            if (leader_shutdown_requested) break;
-            continue;
+    while (left > 0) {
+        int n = left < LEADER_TX_BATCH ? left : LEADER_TX_BATCH;
+        for (int k = 0; k < n; k++) {
+            FollowerSession* s = pending[k];
+            int iovcnt = outq_prepare(&s->out, sh->tx_iov[k], OUTQ_IOV_MAX, &sh->tx_total[k]);
+            sh->tx_ops[k] = (TpIoSend){.fd = s->fd, .iov = sh->tx_iov[k], .iovcnt = iovcnt};
         }
-
-        if (leader_shutdown_requested) {
-            shutdown(follower_fd, SHUT_RDWR);
-            close(follower_fd);
+        if (!sh->io_ready || tpio_send_batch(&sh->tx, sh->tx_ops, n) < 0) {
+            /* No backend: write each queue directly */
+            for (int k = 0; k < left; k++) {
+                FollowerSession* s = pending[k];
+                if (outq_flush(&s->out, s->fd) < 0) shutdown(s->fd, SHUT_RDWR);
+            }
             break;
         }
+        /* Keep the ones with more to send, behind the rest of this pass */
+        int keep = 0;
+        for (int k = 0; k < n; k++) {
+            FollowerSession* s = pending[k];
+            int rc = outq_complete(&s->out, sh->tx_ops[k].res, sh->tx_total[k]);
+            if (rc < 0) shutdown(s->fd, SHUT_RDWR);
+            /* A full socket resumes on its writable edge */
+            if (rc > 0 && s->out.count) pending[keep++] = s;
+        }
+        memmove(pending + keep, pending + n, sizeof(*pending) * (size_t)(left - n));
+        left = keep + (left - n);
+    }
+    pthread_mutex_unlock(&sh->tx_lock);
+}
 
-        FollowerRegisterMsg reg_msg;
-        recv(follower_fd, &reg_msg, sizeof(reg_msg), 0);
-
-        /* Matrix clock local event */
-        mc_local_event(&leader_clock,0); // 0 = leader ID
-        mc_print(&leader_clock);
-
-        // Register and handle topology 
-        register_new_follower(follower_fd, &reg_msg);
+/* Function: Write everything queued for one follower (mutex_followers held) */
+static void follower_flush_locked(Platoon* p, FollowerSession* s) {
+    followers_flush_locked(p->shard, &s, 1);
+}
 
-        printf("Follower registered (socket=%d %s:%d)\n",
-               follower_fd, reg_msg.selfAddress.ip, reg_msg.selfAddress.udp_port);
-    }
-    return NULL;
+/* Function: Write everything queued for every follower of a platoon in one batch (mutex_followers held) */
+static void followers_flush_all_locked(Platoon* p) {
+    followers_flush_locked(p->shard, p->followers.dense, p->followers.count);
 }
 
-/* Function: Broadcast a raw message to all active followers (thread-safe) */
-void broadcast_to_followers(const void* msg_data, size_t msg_len) {
-    pthread_mutex_lock(&mutex_followers);
-    for (int i = 0; i < MAX_FOLLOWERS; i++) {
-        if (!followers[i].active) continue;
-        ssize_t sret = send(followers[i].fd, msg_data, msg_len, 0);
-        if (sret < 0) {
-            perror("broadcast send");
+/* Function: Send a batch of leader messages to all of a platoon's followers (thread-safe, never blocks).
+ * Every follower's share is queued first, then all of it goes out in one flush. */
+static void broadcast_batch_to_followers(Platoon* p, const LD_MESSAGE* msgs, int n) {
+    pthread_mutex_lock(&p->mutex_followers);
+    /* Remember what a resuming follower would need again */
+    for (int m = 0; m < n; m++) {
+        if (msgs[m].type != MSG_LDR_CMD) continue;
+        p->cmd_last = msgs[m];
+        if (msgs[m].payload.cmd.is_turning_event) {
+            p->turns[p->turn_total++ % LEADER_RESUME_TURNS] = msgs[m];
+        }
+    }
+    for (int i = 0; i < p->followers.count; i++) {
+        for (int m = 0; m < n; m++) {
+            follower_queue_locked(p->followers.dense[i], &msgs[m]);
         }
     }
-    pthread_mutex_unlock(&mutex_followers);
+    followers_flush_all_locked(p);
+    pthread_mutex_unlock(&p->mutex_followers);
+}
+
+/* Function: Broadcast a leader message to all of a platoon's followers (thread-safe, never blocks) */
+void broadcast_to_followers(Platoon* p, const void* msg_data, size_t msg_len) {
+    (void)msg_len; /* always an LD_MESSAGE */
+    broadcast_batch_to_followers(p, (const LD_MESSAGE*)msg_data, 1);
 }
 
 /* Function: Register a newly connected follower, send assigned ID and topology updates */
 void register_new_follower(int fd, FollowerRegisterMsg* reg_msg) {
     if (leader_shutdown_requested) {
-        close(fd);
+        tpshm_close(fd);
         return;
     }
-    pthread_mutex_lock(&mutex_followers);
-
-    /* Keep active followers packed so new joiners become last. */
-    compact_followers_locked();
+    Platoon* p = leader_platoon(reg_msg->platoon_id);
+    if (!p) {
+        fprintf(stderr, "No platoon %d here; rejecting connection\n", reg_msg->platoon_id);
+        tpshm_close(fd);
+        return;
+    }
+    pthread_mutex_lock(&p->mutex_followers);
+
+    /* A follower back on a new connection keeps its slot */
+    if (reg_msg->resume_token) {
+        FollowerSession* held = session_table_find_token(&p->followers, reg_msg->resume_token);
+        if (held) {
+            int resumed = follower_resume_locked(p, held, fd, reg_msg);
+            pthread_mutex_unlock(&p->mutex_followers);
+            if (!resumed) tpshm_close(fd);
+            return;
+        }
+        printf("[RESUME] Session in platoon %d has expired; joining as a new follower\n", p->id);
+    }
 
-    int idx = -1;
-    for (int i = 0; i < MAX_FOLLOWERS; i++) {
-        if (!followers[i].active) { idx = i; break; }
+    if (p->followers.count >= MAX_FOLLOWERS) {
+        fprintf(stderr, "Platoon %d full (%d followers); rejecting connection\n", p->id, MAX_FOLLOWERS);
+        pthread_mutex_unlock(&p->mutex_followers);
+        tpshm_close(fd);
+        return;
     }
-    if (idx == -1) {
-        fprintf(stderr, "No free follower slots; rejecting connection\n");
-        pthread_mutex_unlock(&mutex_followers);
-        close(fd);
+
+    /* New joiners become last in platoon order */
+    FollowerSession* s = session_table_add(&p->followers, fd);
+    if (!s || outq_init(&s->out) < 0) {
+        fprintf(stderr, "Out of memory for follower session; rejecting connection\n");
+        if (s) session_table_remove(&p->followers, s);
+        pthread_mutex_unlock(&p->mutex_followers);
+        tpshm_close(fd);
         return;
     }
+    /* Writes go through the session's outbound queue and never block */
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
 
-    followers[idx].fd = fd;
-    followers[idx].address = reg_msg->selfAddress;
-    followers[idx].id = idx + 1;
-    followers[idx].active = 1;
+    s->address = reg_msg->selfAddress;
+    s->id = p->followers.count;
+    s->told_id = s->id;
+    s->token = leader_new_token();
+    mc_init(&s->clock_sent);
+    leader_reactor_watch(p->shard, fd, LR_FOLLOWER, p->id);
 
-    int assigned_id = followers[idx].id;
+    int assigned_id = s->id;
 
     /* Send assigned ID */
     LD_MESSAGE idMsg = {0};
     idMsg.type = MSG_LDR_ASSIGN_ID;
     idMsg.payload.assigned_id = assigned_id;
-    send(fd, &idMsg, sizeof(idMsg), 0);
+    idMsg.topo_epoch = p->topo_epoch;
+    idMsg.session_token = s->token;
+    follower_queue_locked(s, &idMsg);
 
     /* Send spawn pose for realistic join near current leader position */
-    send_spawn_to_follower(fd, assigned_id);
+    send_spawn_to_follower(p, s);
+
+    /* Cruise commands arrive on the platoon's multicast group from now on */
+    if (leader_mcast_fd >= 0) {
+        LD_MESSAGE join = {0};
+        join.type = MSG_LDR_MCAST_JOIN;
+        strncpy(join.payload.mcast.group.ip, LEADER_MCAST_GROUP, sizeof(join.payload.mcast.group.ip) - 1);
+        join.payload.mcast.group.udp_port = ntohs(p->mcast_dst.sin_port);
+        join.payload.mcast.next_seq = __atomic_load_n(&p->mcast_seq, __ATOMIC_ACQUIRE);
+        follower_queue_locked(s, &join);
+    }
+
+    /* ID, spawn pose and group go out together */
+    follower_flush_locked(p, s);
 
     /* Increment active follower count and log formation progress */
-    active_follower_count++;
-    printf("[FORMATION] Active followers: %d/%d\n", active_follower_count, MIN_FOLLOWERS);
+    p->active_follower_count++;
+    printf("[FORMATION] Active followers: %d/%d\n", p->active_follower_count, MIN_FOLLOWERS);
 
     int formed = 0;
-    if (active_follower_count == MIN_FOLLOWERS) formed = 1;
+    if (p->active_follower_count == MIN_FOLLOWERS) formed = 1;
 
-    pthread_mutex_unlock(&mutex_followers);
+    pthread_mutex_unlock(&p->mutex_followers);
 
-    /* If this is the formation event (first time reaching MIN_FOLLOWERS) -> notify FSM */
-    if (formed) {
-        Event ev = {.type = EVT_PLATOON_FORMED};
-        push_event(&leader_EventQ, &ev);
-        return;
+    /* Formation (first time reaching MIN_FOLLOWERS), or a join after it: the FSM (re)finalizes topology */
+    if (formed || p->formation_complete) {
+        Event ev = {.type = EVT_PLATOON_FORMED, .event_data.platoon.platoon_id = p->id};
+        push_event(&p->shard->events, &ev);
     }
+}
 
-    /* If formation is already complete and a new follower joins, re-finalize topology */
-    if (formation_complete) {
-        Event ev = {.type = EVT_PLATOON_FORMED};
-        push_event(&leader_EventQ, &ev);
+/* Function: Rebind a held session to fd and replay what its follower missed
+ * (mutex_followers held): its position, which also confirms the resume, the
+ * rear neighbour if the topology epoch moved on, then the turns and the
+ * newest command after last_cmd_id.
+ * Returns 0 without taking fd if the session's old connection is still open:
+ * that one is shut down, and the follower's next attempt finds the slot held. */
+static int follower_resume_locked(Platoon* p, FollowerSession* s, int fd, const FollowerRegisterMsg* reg) {
+    if (s->fd >= 0) {
+        printf("[RESUME] Follower %d reconnected before its old link closed; closing that one\n", s->id);
+        shutdown(s->fd, SHUT_RDWR);
+        return 0;
     }
+    if (session_table_rebind(&p->followers, s, fd) < 0) return 0;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    s->held_until_ns = 0;
+    p->held_count--;
+    /* The new connection's receiver starts from an empty clock base */
+    mc_init(&s->clock_sent);
+    leader_reactor_watch(p->shard, fd, LR_FOLLOWER, p->id);
+
+    LD_MESSAGE idMsg = {0};
+    idMsg.type = MSG_LDR_ASSIGN_ID;
+    idMsg.payload.assigned_id = s->told_id;
+    idMsg.topo_epoch = p->topo_epoch;
+    idMsg.session_token = s->token;
+    mc_send_event(&p->clock, 0);
+    memcpy(idMsg.matrix_clock.mc, p->clock.mc, sizeof(p->clock.mc));
+    follower_queue_locked(s, &idMsg);
+
+    int replayed = 0;
+    if (reg->topo_epoch != p->topo_epoch) {
+        LD_MESSAGE update = {0};
+        update.type = MSG_LDR_UPDATE_REAR;
+        update.payload.rearInfo.has_rearTruck = s->told_has_rear;
+        if (s->told_has_rear) update.payload.rearInfo.rearTruck_Address = s->told_rear;
+        update.topo_epoch = p->topo_epoch;
+        mc_send_event(&p->clock, 0);
+        memcpy(update.matrix_clock.mc, p->clock.mc, sizeof(p->clock.mc));
+        follower_queue_locked(s, &update);
+        replayed++;
+    }
+
+    /* Turns are events, so each missed one goes again; plain commands are
+     * state, so only the newest does (commands on multicast were never missed) */
+    uint64_t last = reg->last_cmd_id;
+    uint64_t first = p->turn_total > LEADER_RESUME_TURNS ? p->turn_total - LEADER_RESUME_TURNS : 0;
+    for (uint64_t i = first; i < p->turn_total; i++) {
+        const LD_MESSAGE* turn = &p->turns[i % LEADER_RESUME_TURNS];
+        if (turn->payload.cmd.command_id <= last) continue;
+        follower_queue_locked(s, turn);
+        last = turn->payload.cmd.command_id;
+        replayed++;
+    }
+    if (p->cmd_last.payload.cmd.command_id > last) {
+        follower_queue_locked(s, &p->cmd_last);
+        replayed++;
+    }
+    follower_flush_locked(p, s);
+    printf("[RESUME] Follower %d resumed on socket %d (%d missed message(s) replayed)\n", s->id, fd, replayed);
+    return 1;
 }
 
-static void send_spawn_to_follower(int fd, int assigned_id) {
+static void send_spawn_to_follower(Platoon* p, FollowerSession* s) {
+    int assigned_id = s->id;
     Truck leader_snapshot;
     int intr_len;
 
-    pthread_mutex_lock(&mutex_leader_state);
-    leader_snapshot = leader;
-    intr_len = leader_intruder_length;
-    pthread_mutex_unlock(&mutex_leader_state);
+    pthread_mutex_lock(&p->mutex_state);
+    leader_snapshot = p->leader;
+    intr_len = p->intruder_length;
+    pthread_mutex_unlock(&p->mutex_state);
 
     float offset = ((float)assigned_id * TARGET_GAP) + (float)INTRUDER_LENGTH + (float)intr_len;
 
@@ -401,6 +862,7 @@ static void send_spawn_to_follower(int fd, int assigned_id) {
     spawnMsg.type = MSG_LDR_SPAWN;
     spawnMsg.payload.spawn.assigned_id = assigned_id;
     spawnMsg.payload.spawn.spawn_dir = leader_snapshot.dir;
+    spawnMsg.topo_epoch = p->topo_epoch;
 
     switch (leader_snapshot.dir) {
     case NORTH:
@@ -421,453 +883,883 @@ static void send_spawn_to_follower(int fd, int assigned_id) {
         break;
     }
 
-    mc_send_event(&leader_clock, 0);
-    memcpy(spawnMsg.matrix_clock.mc, leader_clock.mc, sizeof(leader_clock.mc));
+    mc_send_event(&p->clock, 0);
+    memcpy(spawnMsg.matrix_clock.mc, p->clock.mc, sizeof(p->clock.mc));
 
-    ssize_t sret = send(fd, &spawnMsg, sizeof(spawnMsg), 0);
-    if (sret < 0) perror("send spawn");
+    follower_queue_locked(s, &spawnMsg);
 }
 
-/* Finalize topology once minimum followers have joined */
-void finalize_topology(void) {
-    pthread_mutex_lock(&mutex_followers);
+static int netinfo_equal(const NetInfo* a, const NetInfo* b) {
+    return a->udp_port == b->udp_port && strcmp(a->ip, b->ip) == 0;
+}
+
+/* Finalize a platoon's topology once minimum followers have joined */
+int finalize_topology(Platoon* p) {
+    pthread_mutex_lock(&p->mutex_followers);
     /*
-     * Reformation must do two things atomically:
-     *  1) Compact active followers so joiners become last
-     *  2) Reassign sequential platoon positions (IDs) and broadcast both ID + rear topology
+     * Reformation renumbers platoon positions (IDs) 1..N in platoon order. Only
+     * followers whose position or rear neighbour differs from what they were
+     * last told get an update: a join at the back touches the old last truck,
+     * a leave touches the truck in front and renumbers the ones behind.
+     * Everything sent carries a new epoch so followers can drop stale updates.
      */
-    compact_followers_locked();
+    int active_count = p->followers.count;
+    uint32_t epoch = ++p->topo_epoch;
+    if (active_count > p->topo_changed_cap) {
+        FollowerSession** grown = realloc(p->topo_changed, sizeof(*grown) * (size_t)active_count);
+        if (grown) {
+            p->topo_changed = grown;
+            p->topo_changed_cap = active_count;
+        }
+    }
 
-    int active_count = 0;
-    for (int i = 0; i < MAX_FOLLOWERS; i++) {
-        if (followers[i].active) active_count++;
+    int pos = 0, changed = 0;
+    for (FollowerSession* f = p->followers.head; f; f = f->next) {
+        f->id = ++pos;
+        const NetInfo* rear = f->next ? &f->next->address : NULL;
+        int new_id = f->told_id != f->id;
+        int new_rear = (rear != NULL) != f->told_has_rear || (rear && !netinfo_equal(rear, &f->told_rear));
+        if (!new_id && !new_rear) continue;
+
+        /* The position first so the follower switches control source immediately */
+        if (new_id) {
+            LD_MESSAGE idMsg = {0};
+            idMsg.type = MSG_LDR_ASSIGN_ID;
+            idMsg.payload.assigned_id = f->id;
+            idMsg.topo_epoch = epoch;
+
+            mc_send_event(&p->clock, 0);
+            memcpy(idMsg.matrix_clock.mc, p->clock.mc, sizeof(p->clock.mc));
+
+            follower_queue_locked(f, &idMsg);
+            f->told_id = f->id;
+        }
+        if (new_rear) {
+            LD_MESSAGE update = {0};
+            update.type = MSG_LDR_UPDATE_REAR;
+            update.payload.rearInfo.has_rearTruck = rear ? 1 : 0;
+            if (rear) update.payload.rearInfo.rearTruck_Address = *rear;
+            update.topo_epoch = epoch;
+
+            mc_send_event(&p->clock, 0);
+            memcpy(update.matrix_clock.mc, p->clock.mc, sizeof(p->clock.mc));
+
+            follower_queue_locked(f, &update);
+            f->told_has_rear = rear ? 1 : 0;
+            if (rear) f->told_rear = *rear;
+        }
+        if (changed < p->topo_changed_cap) p->topo_changed[changed] = f;
+        changed++;
     }
 
-    /* Reassign IDs as contiguous positions (1..N) */
-    int pos = 0;
-    for (int i = 0; i < MAX_FOLLOWERS; i++) {
-        if (!followers[i].active) continue;
-        followers[i].id = ++pos;
+    /* One flush for the followers that changed: each one's ID and rear pointer leave in a single gathered write */
+    if (changed <= p->topo_changed_cap) {
+        followers_flush_locked(p->shard, p->topo_changed, changed);
+    } else {
+        followers_flush_all_locked(p); /* no scratch: flush everyone, idle queues are skipped */
     }
 
-    /* Broadcast updated assigned IDs first so followers switch control source immediately */
-    for (int i = 0; i < MAX_FOLLOWERS; i++) {
-        if (!followers[i].active) continue;
+    /* Formation remains complete as long as at least one follower exists */
+    p->formation_complete = (active_count > 0) ? 1 : 0;
+    /* Joiners need a full command to spawn near the leader */
+    p->cmd_force = 1;
+    pthread_mutex_unlock(&p->mutex_followers);
+    return changed;
+}
+
+/* Wrapper with logging/tracing to make finalization observable and atomic from the FSM perspective */
+static void finalize_topology_atomic(Platoon* p) {
+    printf("[FORMATION] Finalization START (platoon=%d active=%d)\n", p->id, p->active_follower_count);
+    int changed = finalize_topology(p);
+    printf("[FORMATION] Finalization DONE (epoch %u, %d follower(s) updated)\n", p->topo_epoch, changed);
+}
+
 
-        LD_MESSAGE idMsg = {0};
-        idMsg.type = MSG_LDR_ASSIGN_ID;
-        idMsg.payload.assigned_id = followers[i].id;
+/* Add an fd to a shard's reactor, or retag it if it is already there */
+static int leader_reactor_watch(LeaderShard* sh, int fd, int kind, int platoon) {
+    if (!sh->io_ready) return -1;
+
+    /* Sockets that carry frames keep a receive posted. Followers also get
+     * TPIO_OUT: edge-triggered, it only fires once a full send buffer drains,
+     * which is exactly when queued messages can go out. */
+    uint32_t events = TPIO_IN;
+    if (kind == LR_PENDING) events = TPIO_RECV;
+    if (kind == LR_FOLLOWER) events = TPIO_RECV | TPIO_OUT;
+    uint64_t token = ((uint64_t)kind << 56) | ((uint64_t)(uint32_t)platoon << 32) | (uint32_t)fd;
+    if (tpio_watch(&sh->io, fd, events, token) == 0) return 0;
+    if (kind != LR_STDIN) perror("tpio_watch");
+    return -1;
+}
 
-        mc_send_event(&leader_clock, 0);
-        memcpy(idMsg.matrix_clock.mc, leader_clock.mc, sizeof(leader_clock.mc));
+/* Position of the follower on fd in platoon p, or -1 */
+static int leader_follower_id(Platoon* p, int fd) {
+    pthread_mutex_lock(&p->mutex_followers);
+    FollowerSession* s = session_table_find(&p->followers, fd);
+    int fid = s ? s->id : -1;
+    pthread_mutex_unlock(&p->mutex_followers);
+    return fid;
+}
 
-        ssize_t sret = send(followers[i].fd, &idMsg, sizeof(idMsg), 0);
-        if (sret < 0) perror("send assign_id");
+/* Receive state for fd on a shard, created on first use */
+static LeaderConnRx* leader_rx_get(LeaderShard* sh, int fd) {
+    if (fd < 0) return NULL;
+    LeaderConnRx* conn = NULL;
+    pthread_mutex_lock(&sh->rx_lock);
+    if (fd >= sh->rx_cap) {
+        int cap = sh->rx_cap ? sh->rx_cap : 16;
+        while (cap <= fd) cap *= 2;
+        LeaderConnRx** grown = realloc(sh->rx, sizeof(*grown) * (size_t)cap);
+        if (!grown) goto out;
+        memset(grown + sh->rx_cap, 0, sizeof(*grown) * (size_t)(cap - sh->rx_cap));
+        sh->rx = grown;
+        sh->rx_cap = cap;
     }
+    if (!sh->rx[fd]) sh->rx[fd] = calloc(1, sizeof(LeaderConnRx));
+    conn = sh->rx[fd];
+out:
+    pthread_mutex_unlock(&sh->rx_lock);
+    return conn;
+}
 
-    /* Then broadcast rear pointers based on new ordering (i -> i+1) */
-    for (int i = 0; i < MAX_FOLLOWERS; i++) {
-        if (!followers[i].active) continue;
+/* fd's receive state on a shard, or NULL (never creates one) */
+static LeaderConnRx* leader_rx_peek(LeaderShard* sh, int fd) {
+    LeaderConnRx* conn = NULL;
+    pthread_mutex_lock(&sh->rx_lock);
+    if (fd >= 0 && fd < sh->rx_cap) conn = sh->rx[fd];
+    pthread_mutex_unlock(&sh->rx_lock);
+    return conn;
+}
 
-        LD_MESSAGE update = {0};
-        update.type = MSG_LDR_UPDATE_REAR;
+/* Take fd's receive state off a shard (NULL if it had none) */
+static LeaderConnRx* leader_rx_detach(LeaderShard* sh, int fd) {
+    LeaderConnRx* conn = NULL;
+    pthread_mutex_lock(&sh->rx_lock);
+    if (fd >= 0 && fd < sh->rx_cap) {
+        conn = sh->rx[fd];
+        sh->rx[fd] = NULL;
+    }
+    pthread_mutex_unlock(&sh->rx_lock);
+    return conn;
+}
 
-        int found = 0;
-        NetInfo rearAddr = {0};
-        for (int j = i + 1; j < MAX_FOLLOWERS; j++) {
-            if (!followers[j].active) continue;
-            found = 1;
-            rearAddr = followers[j].address;
-            break;
-        }
+static void leader_rx_release(LeaderShard* sh, int fd) {
+    free(leader_rx_detach(sh, fd));
+}
 
-        update.payload.rearInfo.has_rearTruck = found ? 1 : 0;
-        if (found) update.payload.rearInfo.rearTruck_Address = rearAddr;
+/* Hand fd's receive state to the shard that now owns fd. Frees it if the
+ * shard cannot take it; the owner then starts from an empty decoder. */
+static void leader_rx_attach(LeaderShard* sh, int fd, LeaderConnRx* conn) {
+    LeaderConnRx* slot = leader_rx_get(sh, fd);
+    if (slot && conn) *slot = *conn;
+    free(conn);
+}
 
-        mc_send_event(&leader_clock, 0);
-        memcpy(update.matrix_clock.mc, leader_clock.mc, sizeof(leader_clock.mc));
+/* Hand a posted receive to the decoder. 0 = bytes buffered, -1 = closed or failed */
+static int leader_rx_feed(const TpIoEvent* ev, FrameDecoder* d) {
+    if (!(ev->events & TPIO_RECV)) return (ev->events & TPIO_HUP) ? -1 : 0;
+    if (ev->res <= 0) return -1;
+    return frame_decoder_feed(d, ev->data, (size_t)ev->res);
+}
 
-        ssize_t sret = send(followers[i].fd, &update, sizeof(update), 0);
-        if (sret < 0) perror("send topology");
-    }
+static void leader_reactor_close(LeaderShard* sh, int fd) {
+    tpio_unwatch(&sh->io, fd);
+    leader_rx_release(sh, fd);
+    shutdown(fd, SHUT_RDWR);
+    tpshm_close(fd);
+}
 
-    /* Formation remains complete as long as at least one follower exists */
-    formation_complete = (active_count > 0) ? 1 : 0;
-    pthread_mutex_unlock(&mutex_followers);
+/* Bytes queued on a socket or tty; -1 on error */
+static int leader_bytes_available(int fd) {
+    int n = 0;
+    if (ioctl(fd, FIONREAD, &n) < 0) return -1;
+    return n;
 }
 
-/* Keep active followers packed at the front of the array (stable order). Call with mutex_followers held. */
-static void compact_followers_locked(void) {
-    int write_idx = 0;
-    for (int read_idx = 0; read_idx < MAX_FOLLOWERS; read_idx++) {
-        if (!followers[read_idx].active) continue;
-        if (write_idx != read_idx) {
-            followers[write_idx] = followers[read_idx];
+/* Start fd's join handshake clock; -1 if it cannot be tracked */
+static int leader_join_begin(LeaderShard* sh, int fd) {
+    LeaderConnRx* conn = leader_rx_get(sh, fd);
+    if (!conn) return -1;
+    if (sh->join_len == sh->join_cap) {
+        if (sh->join_head > 0) {
+            /* Reuse the room expired entries left at the front */
+            sh->join_len -= sh->join_head;
+            memmove(sh->joins, sh->joins + sh->join_head, sizeof(*sh->joins) * (size_t)sh->join_len);
+            sh->join_head = 0;
+        } else {
+            int cap = sh->join_cap ? sh->join_cap * 2 : 64;
+            LeaderPendingJoin* grown = realloc(sh->joins, sizeof(*grown) * (size_t)cap);
+            if (!grown) return -1;
+            sh->joins = grown;
+            sh->join_cap = cap;
         }
-        write_idx++;
     }
+    conn->join_deadline_ns = lat_now_ns() + (uint64_t)LEADER_JOIN_TIMEOUT_MS * 1000000ull;
+    sh->joins[sh->join_len++] = (LeaderPendingJoin){.fd = fd, .deadline_ns = conn->join_deadline_ns};
+    return 0;
+}
 
-    for (int i = write_idx; i < MAX_FOLLOWERS; i++) {
-        followers[i].active = 0;
-        followers[i].fd = -1;
-        followers[i].id = i + 1;
-        followers[i].address.udp_port = 0;
-        followers[i].address.ip[0] = '\0';
+/* Close every connection whose join handshake ran out of time */
+static void leader_join_expire(LeaderShard* sh) {
+    uint64_t now = lat_now_ns();
+    while (sh->join_head < sh->join_len && sh->joins[sh->join_head].deadline_ns <= now) {
+        LeaderPendingJoin j = sh->joins[sh->join_head++];
+        /* Joined, closed, or the fd now belongs to a newer connection: nothing to do */
+        LeaderConnRx* conn = leader_rx_peek(sh, j.fd);
+        if (!conn || conn->join_deadline_ns != j.deadline_ns) continue;
+        fprintf(stderr, "[FORMATION] No join from socket %d within %d ms; closing\n", j.fd, LEADER_JOIN_TIMEOUT_MS);
+        leader_reactor_close(sh, j.fd);
     }
+    if (sh->join_head == sh->join_len) sh->join_head = sh->join_len = 0;
 }
 
-/* Wrapper with logging/tracing to make finalization observable and atomic from the FSM perspective */
-void finalize_topology_atomic(void) {
-    printf("[FORMATION] Finalization START (active=%d)\n", active_follower_count);
-    finalize_topology();
-    printf("[FORMATION] Finalization DONE\n");
+/* Reactor wait timeout: until the oldest open handshake or a held session expires, or -1 */
+static int leader_reactor_wait_ms(const LeaderShard* sh) {
+    uint64_t deadline = sh->resume_due_ns;
+    if (sh->join_head < sh->join_len && (!deadline || sh->joins[sh->join_head].deadline_ns < deadline)) {
+        deadline = sh->joins[sh->join_head].deadline_ns;
+    }
+    if (!deadline) return -1;
+    uint64_t now = lat_now_ns();
+    if (deadline <= now) return 0;
+    return (int)((deadline - now + 999999) / 1000000);
 }
 
+/* Listening socket readable: accept every queued connection (links too, with shm set) */
+static void leader_reactor_accept(LeaderShard* sh, int shm) {
+    for (;;) {
+        int fd = shm ? tpshm_accept_socket(sh->shm_listen_fd) : accept(sh->listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK && !leader_shutdown_requested) {
+                perror("accept");
+            }
+            return;
+        }
+        if (leader_shutdown_requested) {
+            shutdown(fd, SHUT_RDWR);
+            tpshm_close(fd);
+            return;
+        }
+        /* Registered once its FollowerRegisterMsg frame has fully arrived.
+         * The fd number may be reused, so start from an empty decoder. */
+        leader_rx_release(sh, fd);
+        if (leader_join_begin(sh, fd) < 0 || leader_reactor_watch(sh, fd, shm ? LR_SHM_SETUP : LR_PENDING, 0) < 0) {
+            leader_rx_release(sh, fd);
+            tpshm_close(fd);
+        }
+    }
+}
 
-/* Thread: Receive and process messages from followers */
-void* follower_message_receiver(void* arg) {
-    (void)arg;
+/* Accepted link socket readable: attach the connector's segment, then wait
+ * for the join frame on the link like any other pending join */
+static void leader_reactor_shm_setup(LeaderShard* sh, int fd) {
+    if (tpshm_attach(fd) == 0) {
+        if (leader_reactor_watch(sh, fd, LR_PENDING, 0) < 0) leader_reactor_close(sh, fd);
+        return;
+    }
+    if (errno == EAGAIN) return;
+    perror("tpshm handshake");
+    leader_reactor_close(sh, fd);
+}
 
-    printf("[RECEIVER] Follower message receiver thread started\n");
+/* Accepted connection received bytes: once its join frame is here, hand it to
+ * the shard running the requested platoon and register the follower. A partial
+ * frame just waits for more bytes; no reactor ever blocks on a slow joiner. */
+static void leader_reactor_join(LeaderShard* sh, const TpIoEvent* ev) {
+    int fd = ev->fd;
+    LeaderConnRx* conn = leader_rx_get(sh, fd);
+    if (!conn) {
+        leader_reactor_close(sh, fd);
+        return;
+    }
+    int rc = leader_rx_feed(ev, &conn->frames);
+
+    FollowerRegisterMsg reg_msg;
+    unsigned char wire[TPWIRE_MAX];
+    size_t len = 0;
+    int got = frame_decoder_next(&conn->frames, wire, sizeof(wire), &len);
+    if (got == 1 && tpwire_decode_reg(wire, len, &reg_msg) == 0) {
+        conn->join_deadline_ns = 0;
+        Platoon* p = leader_platoon(reg_msg.platoon_id);
+        if (!p) {
+            fprintf(stderr, "[FORMATION] Join for unknown platoon %d; closing\n", reg_msg.platoon_id);
+            leader_reactor_close(sh, fd);
+            return;
+        }
+        /* The owning shard's reactor takes over the socket and what is buffered behind the join */
+        LeaderShard* owner = p->shard;
+        if (owner != sh) {
+            tpio_unwatch(&sh->io, fd);
+            leader_rx_attach(owner, fd, leader_rx_detach(sh, fd));
+            conn = NULL;
+        }
 
-    while (!leader_shutdown_requested) {
-        fd_set readfds;
-        FD_ZERO(&readfds);
-        int maxfd = -1;
-
-        pthread_mutex_lock(&mutex_followers);
-        for (int i = 0; i < MAX_FOLLOWERS; i++) {
-            if (!followers[i].active) continue;
-            FD_SET(followers[i].fd, &readfds);
-            if (followers[i].fd > maxfd) maxfd = followers[i].fd;
-        }
-        pthread_mutex_unlock(&mutex_followers);
-
-        if (maxfd == -1) {
-            /* No connected followers - sleep briefly */
-            struct timeval tv = {.tv_sec = 0, .tv_usec = 200000};
-            select(0, NULL, NULL, NULL, &tv);
-            continue;
+        /* Matrix clock local event */
+        mc_local_event(&p->clock, 0); // 0 = leader ID
+        mc_print(&p->clock);
+
+        // Register and handle topology (retags fd as LR_FOLLOWER on the owner)
+        register_new_follower(fd, &reg_msg);
+        if (leader_follower_id(p, fd) < 0) {
+            /* Rejected: register_new_follower already closed the socket */
+            leader_rx_release(owner, fd);
+            return;
         }
 
-        struct timeval tv = {.tv_sec = 0, .tv_usec = 100000}; // 100ms timeout
-        int ready = select(maxfd + 1, &readfds, NULL, NULL, &tv);
-        if (ready < 0) {
-            if (errno == EINTR) continue;
-            if (leader_shutdown_requested) break;
-            continue;
+        printf("Follower registered (socket=%d %s:%d platoon=%d)\n",
+               fd, reg_msg.selfAddress.ip, reg_msg.selfAddress.udp_port, p->id);
+
+        /* Frames that arrived behind the join are already buffered. Another
+         * shard decodes them with its first event for fd (the writable edge). */
+        if (conn) leader_reactor_frames(p, fd, conn);
+        return;
+    }
+    if (got != 0 || rc < 0) {
+        leader_reactor_close(sh, fd);
+    }
+    /* Partial frame: the rest arrives with the next receive */
+}
+
+/* Drop a session for good and have the FSM re-finalize topology (mutex_followers held) */
+static void follower_drop_locked(Platoon* p, FollowerSession* s) {
+    int disconnected_id = s->id;
+    if (s->held_until_ns) p->held_count--;
+    outq_free(&s->out);
+    session_table_remove(&p->followers, s);
+    p->active_follower_count--;
+    printf("[FORMATION] Follower %d disconnected -> active=%d/%d\n", disconnected_id, p->active_follower_count, MIN_FOLLOWERS);
+
+    /* Re-finalize topology for any remaining follower(s) so platoon_position updates (1..N) */
+    if (p->formation_complete && p->active_follower_count >= 1) {
+        Event ev = {.type = EVT_PLATOON_FORMED, .event_data.platoon.platoon_id = p->id};
+        push_event(&p->shard->events, &ev);
+    } else if (p->active_follower_count < 1) {
+        p->formation_complete = 0;
+        printf("[FORMATION] Not enough followers, waiting for more to join\n");
+    }
+}
+
+/* Follower socket closed: hold the session for a resume, or drop it and
+ * re-finalize topology (owner shard's reactor) */
+static void leader_follower_disconnected(Platoon* p, int fd) {
+    pthread_mutex_lock(&p->mutex_followers);
+    FollowerSession* s = session_table_find(&p->followers, fd);
+    if (s) {
+        printf("\n[RECEIVER] Follower %d disconnected\n", s->id);
+        leader_reactor_close(p->shard, fd);
+
+        if (leader_resume_ms > 0 && !leader_shutdown_requested &&
+            session_table_rebind(&p->followers, s, -1) == 0) {
+            /* Nothing queued survives the connection; the rest of the platoon is not told */
+            outq_reset(&s->out);
+            s->held_until_ns = lat_now_ns() + (uint64_t)leader_resume_ms * 1000000ull;
+            p->held_count++;
+            LeaderShard* sh = p->shard;
+            if (!sh->resume_due_ns || s->held_until_ns < sh->resume_due_ns) sh->resume_due_ns = s->held_until_ns;
+            printf("[RESUME] Holding follower %d's slot for %d ms\n", s->id, leader_resume_ms);
+        } else {
+            follower_drop_locked(p, s);
         }
-        if (ready == 0) continue;
-
-        pthread_mutex_lock(&mutex_followers);
-        for (int i = 0; i < MAX_FOLLOWERS; i++) {
-            if (!followers[i].active) continue;
-            int fd = followers[i].fd;
-            if (!FD_ISSET(fd, &readfds)) continue;
-
-            FT_MESSAGE msg = {0};  /* FIXED: Initialize to zero to avoid garbage in padding */
-            ssize_t r = recv(fd, &msg, sizeof(msg), 0);
-            if (r <= 0) {
-                if (r == 0) printf("\n[RECEIVER] Follower %d disconnected\n", followers[i].id);
-                else perror("recv");
-                shutdown(fd, SHUT_RDWR);
-                close(fd);
-
-                /* Update session state and active count */
-                int disconnected_id = followers[i].id;
-                followers[i].active = 0;
-                active_follower_count--;
-                printf("[FORMATION] Follower %d disconnected -> active=%d/%d\n", disconnected_id, active_follower_count, MIN_FOLLOWERS);
-
-                /* Re-finalize topology for any remaining follower(s) so platoon_position updates (1..N) */
-                if (formation_complete && active_follower_count >= 1) {
-                    Event ev = {.type = EVT_PLATOON_FORMED};
-                    push_event(&leader_EventQ, &ev);
-                } else if (active_follower_count < 1) {
-                    formation_complete = 0;
-                    printf("[FORMATION] Not enough followers, waiting for more to join\n");
-                }
+    }
+    pthread_mutex_unlock(&p->mutex_followers);
+}
 
-                continue;
+/* Drop every held session whose window has passed (owner shard's reactor) */
+static void leader_resume_expire(LeaderShard* sh) {
+    uint64_t now = lat_now_ns();
+    if (!sh->resume_due_ns || sh->resume_due_ns > now) return;
+    uint64_t next = 0;
+    for (int i = 0; i < sh->platoon_count; i++) {
+        Platoon* p = sh->platoons[i];
+        pthread_mutex_lock(&p->mutex_followers);
+        for (int k = 0; p->held_count > 0 && k < p->followers.count; k++) {
+            FollowerSession* s = p->followers.dense[k];
+            if (!s->held_until_ns) continue;
+            if (s->held_until_ns <= now) {
+                printf("[RESUME] Follower %d did not come back within %d ms\n", s->id, leader_resume_ms);
+                follower_drop_locked(p, s);
+                k--; /* the last session moved into this slot */
+            } else if (!next || s->held_until_ns < next) {
+                next = s->held_until_ns;
             }
+        }
+        pthread_mutex_unlock(&p->mutex_followers);
+    }
+    sh->resume_due_ns = next;
+}
+
+/* Follower socket writable (edge): push out whatever its outbound queue holds */
+static void leader_reactor_flush(Platoon* p, int fd) {
+    pthread_mutex_lock(&p->mutex_followers);
+    FollowerSession* s = session_table_find(&p->followers, fd);
+    if (s) follower_flush_locked(p, s);
+    pthread_mutex_unlock(&p->mutex_followers);
+}
 
-            int fid = followers[i].id;
-            pthread_mutex_unlock(&mutex_followers);
+/* Decode every complete FT_MESSAGE frame buffered for a follower into events.
+ * Returns -1 if the stream is malformed. */
+static int leader_reactor_frames(Platoon* p, int fd, LeaderConnRx* conn) {
+    int fid = leader_follower_id(p, fd);
+    if (fid < 0) return 0;
+
+    FT_MESSAGE msg;
+    unsigned char wire[TPWIRE_MAX];
+    size_t len = 0;
+    int got;
+    while ((got = frame_decoder_next(&conn->frames, wire, sizeof(wire), &len)) == 1) {
+        /* Rebuilds the full matrix clock from the delta against this connection's base */
+        if (tpwire_decode_ft_delta(wire, len, &conn->clock, &msg) < 0) {
+            got = -1;
+            break;
+        }
+        Event ev = {0};
+        ev.type = EVT_FOLLOWER_MSG;
+        ev.event_data.follower_msg.follower_id = fid;
+        ev.event_data.follower_msg.platoon_id = p->id;
+        ev.event_data.follower_msg.msg = msg;
+        push_event(&p->shard->events, &ev);
+    }
+    if (got < 0) {
+        fprintf(stderr, "[RECEIVER] Malformed frame from follower %d\n", fid);
+        return -1;
+    }
+    return 0;
+}
+
+/* Follower socket event: flush on writable, then decode what its receive
+ * brought in (and anything buffered before the socket came to this shard) */
+static void leader_reactor_follower(LeaderShard* sh, const TpIoEvent* ev) {
+    int fd = ev->fd;
+    Platoon* p = leader_platoon((int)((ev->token >> 32) & 0xFFFFFF));
+    if (!p) return;
+    if (ev->events & TPIO_OUT) {
+        leader_reactor_flush(p, fd);
+    }
+    LeaderConnRx* conn = leader_rx_get(sh, fd);
+    if (leader_follower_id(p, fd) < 0 || !conn) return;
 
-            Event ev = {0};
-            ev.type = EVT_FOLLOWER_MSG;
-            ev.event_data.follower_msg.follower_id = fid;
-            ev.event_data.follower_msg.msg = msg;
-            push_event(&leader_EventQ, &ev);
+    if (leader_rx_feed(ev, &conn->frames) < 0 || leader_reactor_frames(p, fd, conn) < 0) {
+        leader_follower_disconnected(p, fd);
+    }
+}
 
-            pthread_mutex_lock(&mutex_followers);
+/* Keyboard readable: one EVT_USER_INPUT per key, to every shard */
+static void leader_reactor_stdin(LeaderShard* sh) {
+    char keys[64];
+    int avail = leader_bytes_available(STDIN_FILENO);
+    if (avail <= 0) avail = 1; /* EOF polls readable with nothing queued; read() tells */
+
+    while (avail > 0) {
+        size_t want = (size_t)avail < sizeof(keys) ? (size_t)avail : sizeof(keys);
+        ssize_t n = read(STDIN_FILENO, keys, want);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            /* EOF or error: stop watching instead of spinning on it */
+            tpio_unwatch(&sh->io, STDIN_FILENO);
+            return;
+        }
+        avail -= (int)n;
+        for (ssize_t k = 0; k < n; k++) {
+            Event evt = {0};
+            evt.type = EVT_USER_INPUT;
+            evt.event_data.input.key = keys[k];
+            for (int i = 0; i < leader_shard_total; i++) {
+                push_event(&leader_shards[i].events, &evt);
+            }
         }
-        pthread_mutex_unlock(&mutex_followers);
     }
+}
 
+/* Thread: a shard's I/O reactor (follower messages; on shard 0 also accept and keyboard) */
+void* leader_reactor(void* arg) {
+    LeaderShard* sh = arg;
+    TpIoEvent ready[LEADER_IO_EVENTS];
+
+    if (!sh->io_ready) return NULL;
+    printf("[REACTOR] Leader I/O reactor %d started (%s)\n", sh->index, tpio_name(&sh->io));
+
+    while (!leader_shutdown_requested) {
+        int nready = tpio_wait(&sh->io, ready, LEADER_IO_EVENTS, leader_reactor_wait_ms(sh));
+        if (nready < 0) {
+            perror("tpio_wait");
+            break;
+        }
+        for (int k = 0; k < nready; k++) {
+            int kind = (int)(ready[k].token >> 56);
+            int fd = ready[k].fd;
+            switch (kind) {
+                case LR_LISTEN:   leader_reactor_accept(sh, 0); break;
+                case LR_SHM_LISTEN: leader_reactor_accept(sh, 1); break;
+                case LR_SHM_SETUP: leader_reactor_shm_setup(sh, fd); break;
+                case LR_PENDING:  leader_reactor_join(sh, &ready[k]); break;
+                case LR_FOLLOWER: leader_reactor_follower(sh, &ready[k]); break;
+                case LR_STDIN:    leader_reactor_stdin(sh); break;
+                case LR_WAKE: {
+                    uint64_t v;
+                    ssize_t rr = read(fd, &v, sizeof(v));
+                    (void)rr;
+                    break;
+                }
+                default: break;
+            }
+        }
+        leader_join_expire(sh);
+        leader_resume_expire(sh);
+    }
     return NULL;
 }
 
 
 
 
-
-/* Broadcast emergency brake to all followers */
-void broadcast_emergency_to_followers(void) {
+/* Broadcast emergency brake to all of a platoon's followers */
+void broadcast_emergency_to_followers(Platoon* p) {
     printf("[LEADER] Broadcasting emergency brake to all followers\n");
-    
+
     LD_MESSAGE emergency_msg = {0};
     emergency_msg.type = MSG_LDR_EMERGENCY_BRAKE;
-    
-    mc_send_event(&leader_clock, 0);
-    memcpy(emergency_msg.matrix_clock.mc, leader_clock.mc, sizeof(leader_clock.mc));
-    broadcast_to_followers(&emergency_msg, sizeof(emergency_msg));
-}
 
+    mc_send_event(&p->clock, 0);
+    memcpy(emergency_msg.matrix_clock.mc, p->clock.mc, sizeof(p->clock.mc));
+    broadcast_to_followers(p, &emergency_msg, sizeof(emergency_msg));
+}
 
 
 
-//Helper function for queuing commands 
-void queue_commands(LeaderCommand* ldr_cmd) {
-    pthread_mutex_lock(&cmd_queue.mutex);
 
-    int next_tail = (cmd_queue.tail + 1) % CMD_QUEUE_SIZE;
-    if (next_tail == cmd_queue.head) {
+//Helper function for queuing commands (shard FSM: the queue's only producer)
+void queue_commands(Platoon* p, LeaderCommand* ldr_cmd) {
+    if (cmdq_push(&p->shard->cmd_queue, p->slot, ldr_cmd) < 0) {
         /* Queue full; drop the message and log */
         fprintf(stderr, "cmd_queue full, dropping command %lu\n", ldr_cmd->command_id);
-        pthread_mutex_unlock(&cmd_queue.mutex);
-        return;
     }
+}
 
-    cmd_queue.queue[cmd_queue.tail] = *ldr_cmd;
-    cmd_queue.tail = next_tail;
+/* Sequenced datagrams to the platoon's multicast group, whatever the platoon
+ * size: one sendmmsg per CMD_QUEUE_SIZE commands (sender thread) */
+static void leader_mcast_send_batch(Platoon* p, const LD_MESSAGE* msgs, int n) {
+    unsigned char wire[CMD_QUEUE_SIZE][TPWIRE_MAX];
+    Datagram dgrams[CMD_QUEUE_SIZE];
+    for (int done = 0; done < n; done += CMD_QUEUE_SIZE) {
+        uint32_t seq = __atomic_load_n(&p->mcast_seq, __ATOMIC_RELAXED);
+        int count = 0;
+        for (int i = done; i < n && i < done + CMD_QUEUE_SIZE; i++) {
+            const LD_MESSAGE* m = &msgs[i];
+            LD_MESSAGE beat;
+            if (m->type == MSG_LDR_HEARTBEAT) {
+                /* Datagrams carry whole clocks; a heartbeat does without */
+                beat = *m;
+                memset(&beat.matrix_clock, 0, sizeof(beat.matrix_clock));
+                m = &beat;
+            }
+            size_t len = tpwire_encode_ld_seq(m, seq + (uint32_t)count, wire[count], TPWIRE_MAX);
+            if (len == 0) continue;
+            dgrams[count] = (Datagram){.data = wire[count], .len = len, .dst = &p->mcast_dst};
+            count++;
+        }
+        if (count == 0) continue;
 
-    pthread_cond_signal(&cmd_queue.not_empty);
-    pthread_mutex_unlock(&cmd_queue.mutex);
+        /* The seqs are used up even if a send fails; followers count them as a gap */
+        __atomic_store_n(&p->mcast_seq, seq + (uint32_t)count, __ATOMIC_RELEASE);
+        int32_t sent = sendDatagrams(leader_mcast_fd, dgrams, (uint32_t)count);
+        if (sent < count) perror("multicast sendmmsg");
+        if (sent > 0) p->mcast_sent += (uint64_t)sent;
+    }
 }
 
-// Dedicated thread function to handle sending cruise commands 
+// Dedicated thread function to handle sending a shard's cruise commands
 void* send_handler(void* arg) {
-    (void)arg;
-
-    while (!leader_shutdown_requested) {
-        pthread_mutex_lock(&cmd_queue.mutex);
+    LeaderShard* sh = arg;
+    CommandQueue* q = &sh->cmd_queue;
+    int max = cmdq_batch_max(q);
+    LeaderCommand* cmds = calloc((size_t)max, sizeof(*cmds));
+    LD_MESSAGE* batch = calloc((size_t)max, sizeof(*batch));
+    if (!cmds || !batch) {
+        perror("send_handler");
+        free(cmds);
+        free(batch);
+        return NULL;
+    }
 
-        while (cmd_queue.head == cmd_queue.tail && !leader_shutdown_requested) {
-            pthread_cond_wait(&cmd_queue.not_empty, &cmd_queue.mutex);
+    /* Take every queued command: the whole backlog leaves in one batch per
+     * platoon. Sleeps only while the queue is empty; 0 once it is closed. */
+    int n;
+    while (!leader_shutdown_requested && (n = cmdq_pop(q, cmds, max)) > 0) {
+        for (int i = 0; i < n; i++) {
+            batch[i].type = cmds[i].is_heartbeat ? MSG_LDR_HEARTBEAT : MSG_LDR_CMD;
+            batch[i].payload.cmd = cmds[i];
         }
 
-        if (leader_shutdown_requested) {
-            pthread_mutex_unlock(&cmd_queue.mutex);
-            break;
+        /* Runs of commands for one platoon: prepare matrix clocks and broadcast to its followers */
+        for (int start = 0, end; start < n; start = end) {
+            Platoon* p = leader_platoon(batch[start].payload.cmd.platoon_id);
+            for (end = start + 1; end < n && batch[end].payload.cmd.platoon_id == batch[start].payload.cmd.platoon_id; end++) {
+            }
+            if (!p) continue;
+            for (int i = start; i < end; i++) {
+                /* A heartbeat is not an event: it carries the clock unchanged */
+                if (batch[i].type == MSG_LDR_CMD) mc_send_event(&p->clock, 0);  // 0 = leader ID
+                memcpy(batch[i].matrix_clock.mc, p->clock.mc, sizeof(p->clock.mc));
+            }
+            if (leader_mcast_fd >= 0) {
+                leader_mcast_send_batch(p, &batch[start], end - start);
+            } else {
+                broadcast_batch_to_followers(p, &batch[start], end - start);
+            }
         }
+    }
 
-        LeaderCommand ldr_cmd = cmd_queue.queue[cmd_queue.head];
-        cmd_queue.head = (cmd_queue.head + 1) % CMD_QUEUE_SIZE;
+    free(cmds);
+    free(batch);
+    return NULL;
+}
 
-        LD_MESSAGE ldr_cmd_msg;
-        ldr_cmd_msg.type = MSG_LDR_CMD;
-        ldr_cmd_msg.payload.cmd = ldr_cmd;
+void leader_set_resume_ms(int ms) {
+    leader_resume_ms = ms > 0 ? ms : 0;
+}
 
-        pthread_mutex_unlock(&cmd_queue.mutex);
+void leader_set_send_on_change(int on) {
+    leader_on_change = on ? 1 : 0;
+}
 
-        /* Prepare matrix clock and broadcast to active followers */
-        mc_send_event(&leader_clock, 0);  // 0 = leader ID
-        memcpy(ldr_cmd_msg.matrix_clock.mc, leader_clock.mc, sizeof(leader_clock.mc));
-        broadcast_to_followers(&ldr_cmd_msg, sizeof(ldr_cmd_msg));
+//FUNC: Full command, heartbeat or nothing for this tick (shard FSM)
+LeaderEmit leader_emit_decide(Platoon* p, const LeaderCommand* cmd, float dt) {
+    p->cmd_ref_age += dt;
+    p->cmd_quiet += dt;
+
+    const Truck* ref = &p->cmd_ref.leader;
+    int full = !leader_on_change || p->cmd_force || cmd->is_turning_event ||
+               cmd->leader.speed != ref->speed || cmd->leader.dir != ref->dir ||
+               cmd->leader.state != ref->state ||
+               p->cmd_ref_age * 1000.0f >= (float)LEADER_CMD_REFRESH_MS;
+    if (!full) {
+        /* Where followers think the leader is */
+        Truck predicted = *ref;
+        move_truck(&predicted, p->cmd_ref_age);
+        float dx = predicted.x - cmd->leader.x, dy = predicted.y - cmd->leader.y;
+        full = dx * dx + dy * dy > LEADER_DR_THRESHOLD * LEADER_DR_THRESHOLD;
     }
 
-    return NULL;
+    if (full) {
+        p->cmd_ref = *cmd;
+        p->cmd_ref_age = 0.0f;
+        p->cmd_quiet = 0.0f;
+        p->cmd_force = 0;
+        p->cmds_full++;
+        return LEADER_EMIT_COMMAND;
+    }
+    if (p->cmd_quiet * 1000.0f >= (float)LEADER_HEARTBEAT_MS) {
+        p->cmd_quiet = 0.0f;
+        p->cmds_heartbeat++;
+        return LEADER_EMIT_HEARTBEAT;
+    }
+    return LEADER_EMIT_NONE;
 }
 
-/* Centralized leader state machine: single writer for leader state */
-void* leader_state_machine(void* arg) {
-    (void)arg;
-    unsigned long tick_count = 0;
-    while (!leader_shutdown_requested) {
-        Event ev = pop_event(&leader_EventQ);
-        switch (ev.type) {
-            case EVT_SHUTDOWN:
-                return NULL;
-            case EVT_PLATOON_FORMED: {
-                printf("\n[FORMATION] EVT_PLATOON_FORMED received - scheduling finalization\n");
-                finalize_topology_atomic();
-                printf("[FORMATION] Topology finalized. Controls unlocked.\n");
-                break;
-            }
+/* Physics tick for one platoon: move its leader and queue a cruise command (shard FSM) */
+static void leader_platoon_tick(Platoon* p, uint64_t elapsed_ticks) {
+    if (!p->formation_complete) {
+        /* Stall physics until formation completes */
+        return;
+    }
 
-            case EVT_TICK_UPDATE: {
-                if (!formation_complete) {
-                    /* Stall physics until formation completes */
-                    break;
-                }
+    if (p->stale_mode) {
+        /* Simulate leader/control plane stall: do not move and do not send commands. */
+        return;
+    }
 
-                if (leader_stale_mode) {
-                    /* Simulate leader/control plane stall: do not move and do not send commands. */
-                    break;
-                }
+    p->tick_count++;
 
-                tick_count++;
+    LeaderCommand ldr_cmd = {.command_id = ++p->cmd_id, .is_turning_event = 0, .platoon_id = p->id};
+    if (p->pending_turn) {
+        ldr_cmd.is_turning_event = 1;
+        ldr_cmd.turn_point_x = p->leader.x;
+        ldr_cmd.turn_point_y = p->leader.y;
+        ldr_cmd.turn_dir = p->next_turn_dir;
 
-                LeaderCommand ldr_cmd = {.command_id = ++cmd_id, .is_turning_event = 0};
-                if (pending_turn) {
-                    ldr_cmd.is_turning_event = 1;
-                    ldr_cmd.turn_point_x = leader.x;
-                    ldr_cmd.turn_point_y = leader.y;
-                    ldr_cmd.turn_dir = next_turn_dir;
+        p->leader.dir = p->next_turn_dir;
+        p->pending_turn = 0;
+        if (platoon_console(p)) {
+            printf("\n[TURN] Leader at (%.2f, %.2f) to %d\n", ldr_cmd.turn_point_x,
+                   ldr_cmd.turn_point_y, p->next_turn_dir);
+        }
+    }
 
-                    leader.dir = next_turn_dir;
-                    pending_turn = 0;
-                    printf("\n[TURN] Leader at (%.2f, %.2f) to %d\n", ldr_cmd.turn_point_x,
-                           ldr_cmd.turn_point_y, next_turn_dir);
-                }
+    pthread_mutex_lock(&p->mutex_state);
+    move_truck(&p->leader, LEADER_TICK_DT * (float)elapsed_ticks);
+    ldr_cmd.leader = p->leader;
+    pthread_mutex_unlock(&p->mutex_state);
+
+    mc_local_event(&p->clock, 0);
+    switch (leader_emit_decide(p, &ldr_cmd, LEADER_TICK_DT * (float)elapsed_ticks)) {
+        case LEADER_EMIT_COMMAND:
+            queue_commands(p, &ldr_cmd);
+            break;
+        case LEADER_EMIT_HEARTBEAT: {
+            LeaderCommand beat = {.command_id = p->cmd_ref.command_id, .platoon_id = p->id, .is_heartbeat = 1};
+            queue_commands(p, &beat);
+            break;
+        }
+        default:
+            break;
+    }
+
+      if (platoon_console(p) &&
+          (LEADER_PRINT_EVERY_N <= 1 || (p->tick_count % (unsigned long)LEADER_PRINT_EVERY_N) == 0)) {
+          printf("\rLeader: POS(%.1f,%.1f) SPD=%.1f DIR=%d STATE=%d    ", p->leader.x,
+              p->leader.y, p->leader.speed, p->leader.dir, p->leader.state);
+          //mc_print(&p->clock);
+          fflush(stdout);
+      }
+}
 
-                pthread_mutex_lock(&mutex_leader_state);
-                move_truck(&leader, LEADER_TICK_DT);
-                ldr_cmd.leader = leader;
-                pthread_mutex_unlock(&mutex_leader_state);
-
-                mc_local_event(&leader_clock, 0);
-                queue_commands(&ldr_cmd);
-
-                  if (LEADER_PRINT_EVERY_N <= 1 || (tick_count % (unsigned long)LEADER_PRINT_EVERY_N) == 0) {
-                      printf("\rLeader: POS(%.1f,%.1f) SPD=%.1f DIR=%d STATE=%d    ", leader.x,
-                          leader.y, leader.speed, leader.dir, leader.state);
-                      //mc_print(&leader_clock);
-                      fflush(stdout);
-                  }
-                break;
+/* Keyboard command for one platoon (shard FSM) */
+static void leader_platoon_key(Platoon* p, char c) {
+    Truck* leader = &p->leader;
+    if (!p->formation_complete) {
+        if (platoon_console(p)) printf("Waiting for followers...\n");
+        return;
+    }
+
+    if (c == 'w') {
+        leader->speed += 0.5f;
+        leader->state = CRUISE;
+    } else if (c == 's') {
+        leader->speed -= 0.5f;
+        leader->state = CRUISE;
+        if (leader->speed <= 0) {
+            leader->speed = 0;
+            leader->state = STOPPED;
+        }
+    } else if (c == 'a') {
+        p->next_turn_dir = (leader->dir + 3) % 4; // Left
+        p->pending_turn = 1;
+        leader->state = CRUISE;
+    } else if (c == 'd') {
+        p->next_turn_dir = (leader->dir + 1) % 4; // Right
+        p->pending_turn = 1;
+        leader->state = CRUISE;
+    } else if (c == ' ') {
+        leader->speed = 0;
+        leader->state = EMERGENCY_BRAKE;
+        /* Also broadcast emergency to followers */
+        broadcast_emergency_to_followers(p);
+    } else if (c == 'p' || c == 'P') {
+        p->stale_mode = !p->stale_mode;
+        if (!p->stale_mode) p->cmd_force = 1; /* followers stopped extrapolating */
+        if (!platoon_console(p)) return;
+        if (p->stale_mode) {
+            printf("\n[LEADER] Stale mode ON: pausing cruise commands\n");
+        } else {
+            printf("\n[LEADER] Stale mode OFF: resuming cruise commands\n");
+        }
+    }
+}
+
+/* Message from one of a platoon's followers (shard FSM) */
+static void leader_platoon_follower_msg(Platoon* p, int fid, FT_MESSAGE* msg) {
+    /* Merge matrix clocks on receive */
+    mc_receive_event(&p->clock, &msg->matrix_clock, 0);
+
+    switch (msg->type) {
+        case MSG_FT_INTRUDER_REPORT:
+            if (msg->payload.intruder.speed == 0) {
+                p->leader.state = CRUISE;
+                pthread_mutex_lock(&p->mutex_state);
+                p->intruder_length = 0;
+                pthread_mutex_unlock(&p->mutex_state);
+                printf("\n[LEADER] Intruder cleared by follower %d\n", fid);
+            } else {
+                p->leader.state = INTRUDER_FOLLOW;
+                p->leader.speed = msg->payload.intruder.speed;
+                pthread_mutex_lock(&p->mutex_state);
+                p->intruder_length = msg->payload.intruder.length;
+                pthread_mutex_unlock(&p->mutex_state);
+                printf("\n[LEADER] Intruder reported by follower %d: speed=%d length=%d\n",
+                       fid, msg->payload.intruder.speed, msg->payload.intruder.length);
             }
+            break;
 
-            case EVT_USER_INPUT: {
-                if (!formation_complete) {
-                    printf("Waiting for followers...\n");
+        case MSG_FT_POSITION:
+            printf("\n[LEADER] Follower %d position: x=%.1f, y=%.1f\n",
+                   fid, msg->payload.position.x, msg->payload.position.y);
+            break;
+
+        case MSG_FT_EMERGENCY_BRAKE:
+            printf("\n[LEADER] Emergency brake from follower %d\n", fid);
+            broadcast_emergency_to_followers(p);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* Shard leader state machine: single writer for the leader state of its platoons */
+void* leader_state_machine(void* arg) {
+    LeaderShard* sh = arg;
+    Event batch[EVENT_BATCH_MAX];
+    while (!leader_shutdown_requested) {
+        int n = pop_events(&sh->events, batch, EVENT_BATCH_MAX);
+        for (int i = 0; i < n; i++) {
+            Event ev = batch[i];
+            uint64_t handle_start_ns = lat_now_ns();
+            switch (ev.type) {
+                case EVT_SHUTDOWN:
+                    return NULL;
+                case EVT_PLATOON_FORMED: {
+                    Platoon* p = leader_platoon(ev.event_data.platoon.platoon_id);
+                    if (!p) break;
+                    printf("\n[FORMATION] EVT_PLATOON_FORMED received - scheduling finalization\n");
+                    finalize_topology_atomic(p);
+                    printf("[FORMATION] Topology finalized. Controls unlocked.\n");
                     break;
                 }
 
-                char c = ev.event_data.input.key;
-                if (c == 'w') {
-                    leader.speed += 0.5f;
-                    leader.state = CRUISE;
-                } else if (c == 's') {
-                    leader.speed -= 0.5f;
-                    leader.state = CRUISE;
-                    if (leader.speed <= 0) {
-                        leader.speed = 0;
-                        leader.state = STOPPED;
+                case EVT_TICK_UPDATE: {
+                    /* Coalesced ticks: advance physics by every tick that elapsed */
+                    uint64_t elapsed_ticks = 1;
+                    if (ev.event_data.tick.seq > sh->last_tick_seq && sh->last_tick_seq != 0) {
+                        elapsed_ticks = ev.event_data.tick.seq - sh->last_tick_seq;
                     }
-                } else if (c == 'a') {
-                    next_turn_dir = (leader.dir + 3) % 4; // Left
-                    pending_turn = 1;
-                    leader.state = CRUISE;
-                } else if (c == 'd') {
-                    next_turn_dir = (leader.dir + 1) % 4; // Right
-                    pending_turn = 1;
-                    leader.state = CRUISE;
-                } else if (c == ' ') {
-                    leader.speed = 0;
-                    leader.state = EMERGENCY_BRAKE;
-                    /* Also broadcast emergency to followers */
-                    broadcast_emergency_to_followers();
-                } else if (c == 'p' || c == 'P') {
-                    leader_stale_mode = !leader_stale_mode;
-                    if (leader_stale_mode) {
-                        printf("\n[LEADER] Stale mode ON: pausing cruise commands\n");
-                    } else {
-                        printf("\n[LEADER] Stale mode OFF: resuming cruise commands\n");
+                    sh->last_tick_seq = ev.event_data.tick.seq;
+
+                    for (int k = 0; k < sh->platoon_count; k++) {
+                        leader_platoon_tick(sh->platoons[k], elapsed_ticks);
                     }
-                } else if (c == 'q') {
-                    leader_request_shutdown("user");
+                    break;
                 }
-                break;
-            }
-
-            case EVT_FOLLOWER_MSG: {
-                int fid = ev.event_data.follower_msg.follower_id;
-                FT_MESSAGE msg = ev.event_data.follower_msg.msg;
-                /* Merge matrix clocks on receive */
-                mc_receive_event(&leader_clock, &msg.matrix_clock, 0);
-
-                switch (msg.type) {
-                    case MSG_FT_INTRUDER_REPORT:
-                        if (msg.payload.intruder.speed == 0) {
-                            leader.state = CRUISE;
-                            pthread_mutex_lock(&mutex_leader_state);
-                            leader_intruder_length = 0;
-                            pthread_mutex_unlock(&mutex_leader_state);
-                            printf("\n[LEADER] Intruder cleared by follower %d\n", fid);
-                        } else {
-                            leader.state = INTRUDER_FOLLOW;
-                            leader.speed = msg.payload.intruder.speed;
-                            pthread_mutex_lock(&mutex_leader_state);
-                            leader_intruder_length = msg.payload.intruder.length;
-                            pthread_mutex_unlock(&mutex_leader_state);
-                            printf("\n[LEADER] Intruder reported by follower %d: speed=%d length=%d\n",
-                                   fid, msg.payload.intruder.speed, msg.payload.intruder.length);
-                        }
-                        break;
-
-                    case MSG_FT_POSITION:
-                        printf("\n[LEADER] Follower %d position: x=%.1f, y=%.1f\n",
-                               fid, msg.payload.position.x, msg.payload.position.y);
-                        break;
 
-                    case MSG_FT_EMERGENCY_BRAKE:
-                        printf("\n[LEADER] Emergency brake from follower %d\n", fid);
-                        broadcast_emergency_to_followers();
+                case EVT_USER_INPUT: {
+                    char c = ev.event_data.input.key;
+                    if (c == 'q') {
+                        leader_request_shutdown("user");
                         break;
+                    }
+                    for (int k = 0; k < sh->platoon_count; k++) {
+                        leader_platoon_key(sh->platoons[k], c);
+                    }
+                    break;
+                }
 
-                    default:
-                        break;
+                case EVT_FOLLOWER_MSG: {
+                    Platoon* p = leader_platoon(ev.event_data.follower_msg.platoon_id);
+                    if (!p) break;
+                    leader_platoon_follower_msg(p, ev.event_data.follower_msg.follower_id,
+                                                &ev.event_data.follower_msg.msg);
+                    break;
                 }
-                break;
-            }
 
-            default:
-                //Unhandled event types relevant to follower truck
-                break;
+                default:
+                    //Unhandled event types relevant to follower truck
+                    break;
+            }
+            event_latency_record_service(&sh->latency, ev.type, lat_now_ns() - handle_start_ns);
         }
     }
     return NULL;
 }
 
-/* Keyboard Input Handler */
-void *input_handler(void *arg) {
-  (void)arg;
-  struct termios oldt, newt;
-  tcgetattr(STDIN_FILENO, &oldt);
-  newt = oldt;
-  newt.c_lflag &= ~(ICANON | ECHO);
-  tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-
-    while (!leader_shutdown_requested) {
-                fd_set rfds;
-                FD_ZERO(&rfds);
-                FD_SET(STDIN_FILENO, &rfds);
-                struct timeval tv = {.tv_sec = 0, .tv_usec = 200000};
-
-                int ready = select(STDIN_FILENO + 1, &rfds, NULL, NULL, &tv);
-                if (ready < 0) {
-                        if (errno == EINTR) continue;
-                        break;
-                }
-                if (ready == 0) continue;
-                if (!FD_ISSET(STDIN_FILENO, &rfds)) continue;
-
-                char c = 0;
-                ssize_t n = read(STDIN_FILENO, &c, 1);
-                if (n <= 0) continue;
-
-    Event evt = {0};
-    evt.type = EVT_USER_INPUT;
-    evt.event_data.input.key = c;
-    push_event(&leader_EventQ, &evt);
-  }
-
-    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-  return NULL;
-}
-
 /*Function: Move Truck*/
 void move_truck(Truck *t, float dt) {
     float dx = 0, dy = 0;
@@ -888,4 +1780,3 @@ void move_truck(Truck *t, float dt) {
     t->x += dx;
     t->y += dy;
 }
-
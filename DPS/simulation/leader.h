@@ -0,0 +1,190 @@
+#ifndef LEADER_H
+#define LEADER_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+#include "truckplatoon.h"
+#include "event.h"
+#include "tpio.h"
+#include "tpframe.h"
+#include "session_table.h"
+#include "cmdq.h"
+
+/* Leader server: one process hosts independent platoons, each a Platoon
+ * context, sharded over a fixed set of LeaderShards. Platoon p runs on shard
+ * p % shard count. A shard owns an event queue, an I/O reactor, an FSM thread
+ * and a sender thread for its platoons; nothing is shared between shards but
+ * the listening socket, the keyboard and shutdown. The plain leader is one
+ * shard hosting platoon 0.
+ *
+ * Followers pick their platoon in FollowerRegisterMsg.platoon_id. Joins are
+ * accepted and decoded on shard 0 (on every shard with SO_REUSEPORT), then
+ * handed to the owning shard. The join handshake never blocks a reactor: a
+ * connection that has not sent its whole join within LEADER_JOIN_TIMEOUT_MS
+ * is closed.
+ *
+ * A follower whose connection drops keeps its session, without an fd, for
+ * the resume window (LEADER_RESUME_MS, --resume-ms). A join presenting the
+ * session's token rebinds it; only when the window passes does the follower
+ * leave and the platoon reform.
+ */
+#define LEADER_MAX_PLATOONS 4096
+#define LEADER_MAX_SHARDS 64
+#define LEADER_IO_EVENTS 64
+#define LEADER_TX_BATCH TPIO_RING_ENTRIES   // follower writes per tpio batch
+#define LEADER_LISTEN_BACKLOG 4096          // the kernel clamps it to net.core.somaxconn
+#define LEADER_JOIN_TIMEOUT_MS 2000         // accept to complete join frame
+#define LEADER_RESUME_TURNS 8               // recent turning commands kept for resumes
+
+typedef struct LeaderShard LeaderShard;
+
+/* What a physics tick sends for its platoon */
+typedef enum {
+    LEADER_EMIT_NONE = 0,
+    LEADER_EMIT_HEARTBEAT,
+    LEADER_EMIT_COMMAND
+} LeaderEmit;
+
+/* Per-connection receive state: the frame decoder and the delta base for
+ * clocks received on it */
+typedef struct {
+    FrameDecoder frames;
+    MatrixClock clock;
+    uint64_t join_deadline_ns;  // handshake still open (lat_now_ns clock); 0 once joined
+} LeaderConnRx;
+
+/* Accepted connection waiting for its join frame */
+typedef struct {
+    int fd;
+    uint64_t deadline_ns;
+} LeaderPendingJoin;
+
+typedef struct {
+    int id;
+    LeaderShard* shard;
+    int slot;                   // index in shard->platoons (command queue slot)
+
+    /* Leader truck: the shard FSM writes it; mutex_state guards the fields
+     * other threads read (spawn pose, intruder length) */
+    Truck leader;
+    int intruder_length;
+    pthread_mutex_t mutex_state;
+
+    /* FSM state */
+    MatrixClock clock;
+    uint64_t cmd_id;
+    int pending_turn;
+    DIRECTION next_turn_dir;
+    int stale_mode;             // keep connections, stop sending cruise commands
+    unsigned long tick_count;
+
+    /* Send-on-change emission (FSM) */
+    LeaderCommand cmd_ref;      // last full command: what followers extrapolate from
+    float cmd_ref_age;          // seconds of leader motion since cmd_ref
+    float cmd_quiet;            // seconds since the last command or heartbeat
+    int cmd_force;              // next tick sends a full command
+    uint64_t cmds_full, cmds_heartbeat;
+
+    /* Followers (mutex_followers) */
+    SessionTable followers;
+    pthread_mutex_t mutex_followers;
+    int formation_complete;
+    int active_follower_count;
+    uint32_t topo_epoch;        // bumped by every finalize_topology
+    FollowerSession** topo_changed;     // finalize scratch
+    int topo_changed_cap;
+
+    /* Session resume (mutex_followers): what a returning follower may have missed */
+    int held_count;             // sessions waiting for their follower to reconnect
+    LD_MESSAGE cmd_last;        // newest full command sent over TCP (command_id 0 = none yet)
+    LD_MESSAGE turns[LEADER_RESUME_TURNS];  // the last turning commands, a ring
+    uint64_t turn_total;
+
+    /* Multicast data plane (--mcast): this platoon's group */
+    struct sockaddr_in mcast_dst;
+    uint32_t mcast_seq;         // seq of the next datagram (atomic)
+    uint64_t mcast_sent;
+} Platoon;
+
+struct LeaderShard {
+    int index;
+    Platoon** platoons;         // the platoons this shard runs
+    int platoon_count;
+
+    EventQueue events;
+    EventLatency latency;
+    CommandQueue cmd_queue;     // FSM -> sender (lock-free SPSC)
+    uint64_t tick_seq;          // timer thread
+    uint64_t last_tick_seq;     // FSM
+
+    /* I/O: the reactor waits on io; follower writes go through tx */
+    TpIo io;
+    TpIo tx;
+    int io_ready;
+    int wake_fd;
+    int listen_fd;              // -1 unless this shard accepts
+    int shm_listen_fd;          // TP_NET=shm: link listener on shard 0, else -1
+
+    /* Open join handshakes, oldest first (reactor thread). Entries for
+     * connections that joined or closed meanwhile are skipped on expiry. */
+    LeaderPendingJoin* joins;
+    int join_head, join_len, join_cap;
+    uint64_t resume_due_ns;     // earliest end of a held session's window, 0 = none (reactor thread)
+
+    /* Receive state by fd (rx_lock; joins are handed over from shard 0) */
+    LeaderConnRx** rx;
+    int rx_cap;
+    pthread_mutex_t rx_lock;
+
+    /* Egress batch scratch (tx_lock, taken inside a platoon's mutex_followers) */
+    pthread_mutex_t tx_lock;
+    TpIoSend* tx_ops;
+    struct iovec (*tx_iov)[OUTQ_IOV_MAX];
+    size_t* tx_total;
+    FollowerSession** tx_pending;
+    int tx_pending_cap;
+
+    pthread_t reactor_tid, fsm_tid, sender_tid;
+};
+
+/* Create the platoons and shards (threads are started separately); 0 or -1 */
+int leader_server_init(int platoons, int shards);
+Platoon* leader_platoon(int id);        // NULL if not hosted here
+int leader_shard_count(void);
+LeaderShard* leader_shard(int index);
+
+/* Listen on port: on shard 0, or on every shard with its own SO_REUSEPORT
+ * socket so the kernel spreads accepts over the reactors. With TP_NET=shm,
+ * shard 0 also takes shared-memory links (tpshm.h) for the same port. 0 or -1 */
+int leader_listen(uint16_t port, int reuseport);
+
+/* Threads, one of each per shard; arg is the LeaderShard */
+void* leader_reactor(void* arg);
+void* leader_state_machine(void* arg);
+void* send_handler(void* arg);
+
+/* Register a connected follower with the platoon its join names (rejects and
+ * closes fd if there is no such platoon or it is full). A join carrying the
+ * token of a held session resumes that session on fd instead. */
+void register_new_follower(int fd, FollowerRegisterMsg* reg_msg);
+/* Renumber the platoon and tell followers what changed since they last heard;
+ * returns how many were notified */
+int finalize_topology(Platoon* p);
+
+void broadcast_to_followers(Platoon* p, const void* msg_data, size_t msg_len);
+void broadcast_emergency_to_followers(Platoon* p);
+void queue_commands(Platoon* p, LeaderCommand* ldr_cmd);
+
+/* How long a follower's slot is held after its connection drops (0: it leaves at once) */
+void leader_set_resume_ms(int ms);
+
+/* Send-on-change mode (off: every tick sends a full command) */
+void leader_set_send_on_change(int on);
+/* Decide what the tick that produced cmd sends, dt seconds after the last one
+ * (shard FSM). A full command becomes the new dead-reckoning reference. */
+LeaderEmit leader_emit_decide(Platoon* p, const LeaderCommand* cmd, float dt);
+void move_truck(Truck* t, float dt);
+
+#endif
@@ -21,6 +21,7 @@ void mc_init(MatrixClock *clock)
 //not required
 void mc_local_event(MatrixClock *clock, int truck_id)
 {
+    if (truck_id < 0 || truck_id >= NUM_TRUCKS) return;
     clock->mc[truck_id][truck_id]++;
 }
 
@@ -28,6 +29,7 @@ void mc_local_event(MatrixClock *clock, int truck_id)
 void mc_send_event(MatrixClock *clock, int truck_id)
 {
     // sending is a local event
+    if (truck_id < 0 || truck_id >= NUM_TRUCKS) return;
     clock->mc[truck_id][truck_id]++;
 }
 
@@ -44,6 +46,7 @@ void mc_receive_event(MatrixClock *local, MatrixClock *received, int truck_id)
     }
 
     // Step 2: receiving itself is a local event
+    if (truck_id < 0 || truck_id >= NUM_TRUCKS) return;
     local->mc[truck_id][truck_id]++;
 }
 
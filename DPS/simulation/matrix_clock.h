@@ -3,7 +3,7 @@
 
 #include <stdio.h>
 
-#define NUM_TRUCKS 4   // 1 Leader + 3 Followers
+#define NUM_TRUCKS 4   // 1 Leader + 3 Followers; trucks further back do not tick a row of their own
 
 // Matrix Clock structure
 typedef struct {
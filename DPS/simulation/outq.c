@@ -0,0 +1,164 @@
+//File: outq.c
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+#include "outq.h"
+#include "tpshm.h"
+
+#if (OUTQ_SOFT_LIMIT & (OUTQ_SOFT_LIMIT - 1)) != 0
+#error "OUTQ_SOFT_LIMIT must be a power of two"
+#endif
+
+int outq_init(OutQueue* q) {
+    memset(q, 0, sizeof(*q));
+    q->msgs = malloc(sizeof(OutMsg) * OUTQ_SOFT_LIMIT);
+    if (!q->msgs) return -1;
+    q->cap = OUTQ_SOFT_LIMIT;
+    return 0;
+}
+
+void outq_free(OutQueue* q) {
+    free(q->msgs);
+    memset(q, 0, sizeof(*q));
+}
+
+void outq_reset(OutQueue* q) {
+    q->dropped += q->count;
+    q->head = q->count = q->head_off = 0;
+}
+
+static OutMsg* at(OutQueue* q, uint32_t i) {
+    return &q->msgs[(q->head + i) & (q->cap - 1)];
+}
+
+/* Double the ring, unwrapping it so head is 0 */
+static int grow(OutQueue* q) {
+    uint32_t cap = q->cap * 2;
+    OutMsg* msgs = malloc(sizeof(OutMsg) * cap);
+    if (!msgs) return -1;
+    for (uint32_t i = 0; i < q->count; i++) {
+        msgs[i] = *at(q, i);
+    }
+    free(q->msgs);
+    q->msgs = msgs;
+    q->cap = cap;
+    q->head = 0;
+    return 0;
+}
+
+/* Remove the oldest message that has not started going out and has at least
+ * the given droppable level. Returns 0 if there is none. */
+static int shed_oldest(OutQueue* q, uint8_t level) {
+    uint32_t first = q->head_off ? 1 : 0;
+    for (uint32_t i = first; i < q->count; i++) {
+        if (at(q, i)->droppable < level) continue;
+        for (uint32_t j = i; j + 1 < q->count; j++) {
+            *at(q, j) = *at(q, j + 1);
+        }
+        q->count--;
+        q->dropped++;
+        return 1;
+    }
+    return 0;
+}
+
+int outq_push(OutQueue* q, const void* msg, size_t len, OutPolicy policy) {
+    if (len > OUTQ_MSG_MAX || !q->msgs) return -1;
+
+    if (policy == OUTQ_REPLACE) shed_oldest(q, 2);
+    if (policy != OUTQ_NEVER_DROP) {
+        if (q->count >= OUTQ_SOFT_LIMIT && !shed_oldest(q, 1)) {
+            /* Backlog is all control traffic: the new message is the one to go */
+            q->dropped++;
+            return 0;
+        }
+    } else if (q->count == q->cap) {
+        if (q->cap >= OUTQ_HARD_LIMIT || grow(q) < 0) return -1;
+    }
+
+    OutMsg* m = at(q, q->count);
+    m->len = (uint16_t)len;
+    m->droppable = policy == OUTQ_NEVER_DROP ? 0 : policy == OUTQ_REPLACE ? 2 : 1;
+    memcpy(m->data, msg, len);
+    q->count++;
+    return 0;
+}
+
+int outq_prepare(const OutQueue* q, struct iovec* iov, int max, size_t* total) {
+    int n = (int)q->count < max ? (int)q->count : max;
+    *total = 0;
+    for (int i = 0; i < n; i++) {
+        OutMsg* m = &q->msgs[(q->head + (uint32_t)i) & (q->cap - 1)];
+        uint32_t off = (i == 0) ? q->head_off : 0;
+        iov[i].iov_base = m->data + off;
+        iov[i].iov_len = m->len - off;
+        *total += iov[i].iov_len;
+    }
+    return n;
+}
+
+int outq_complete(OutQueue* q, ssize_t res, size_t total) {
+    q->writes++;
+    if (res < 0) return (res == -EAGAIN || res == -EWOULDBLOCK || res == -EINTR) ? 0 : -1;
+
+    /* Retire every message that went out whole; the rest keeps its offset */
+    size_t left = (size_t)res;
+    while (left) {
+        size_t rest = at(q, 0)->len - q->head_off;
+        if (left < rest) {
+            q->head_off += (uint32_t)left;
+            break;
+        }
+        left -= rest;
+        q->head = (q->head + 1) & (q->cap - 1);
+        q->count--;
+        q->head_off = 0;
+        q->sent++;
+    }
+    return (size_t)res < total ? 0 : 1; /* short write: the socket buffer is full */
+}
+
+int outq_flush(OutQueue* q, int fd) {
+    while (q->count) {
+        struct iovec iov[OUTQ_IOV_MAX];
+        size_t total;
+        int n_iov = outq_prepare(q, iov, OUTQ_IOV_MAX, &total);
+
+        struct msghdr mh = {.msg_iov = iov, .msg_iovlen = (size_t)n_iov};
+        ssize_t n;
+        do {
+            n = tpshm_is_link(fd) ? tpshm_sendv(fd, iov, n_iov) : sendmsg(fd, &mh, MSG_DONTWAIT | MSG_NOSIGNAL);
+        } while (n < 0 && errno == EINTR);
+        int rc = outq_complete(q, n < 0 ? -errno : n, total);
+        if (rc <= 0) return rc;
+    }
+    return 1;
+}
+
+int outq_send(OutQueue* q, int fd, const void* msg, size_t len, OutPolicy policy) {
+    if (q->count == 0) {
+        ssize_t n;
+        do {
+            n = tpshm_is_link(fd) ? tpshm_send(fd, msg, len) : send(fd, msg, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+            q->writes++;
+        } while (n < 0 && errno == EINTR);
+
+        if (n == (ssize_t)len) {
+            q->sent++;
+            return 1;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+        if (outq_push(q, msg, len, policy) < 0) return -1;
+        /* Remember the part already on the wire (n may be 0 or -1 here) */
+        q->head_off = n > 0 ? (uint32_t)n : 0;
+        if (n > 0) q->msgs[q->head].droppable = 0; /* must be completed */
+        return 0;
+    }
+    if (outq_push(q, msg, len, policy) < 0) return -1;
+    return outq_flush(q, fd);
+}
@@ -0,0 +1,77 @@
+#ifndef OUTQ_H
+#define OUTQ_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/* Per-connection outbound message ring for non-blocking sockets.
+ * outq_send() writes straight to the socket while nothing is queued and keeps
+ * only what the kernel would not take; the rest is written by outq_flush()
+ * when the socket becomes writable. Messages are queued whole, so a partially
+ * written head is always completed before anything else goes out.
+ *
+ * Batching: outq_push() a tick's or a topology change's worth of messages, then
+ * one outq_flush() hands up to OUTQ_IOV_MAX of them to the kernel in a single
+ * gathered sendmsg().
+ *
+ * Overflow: OUTQ_DROP_OLDEST messages (periodic commands, where only the newest
+ * matters) are limited to OUTQ_SOFT_LIMIT queued messages and shed oldest-first.
+ * OUTQ_NEVER_DROP messages (emergency, topology) grow the ring instead, up to
+ * OUTQ_HARD_LIMIT, at which point the peer is treated as dead.
+ * OUTQ_REPLACE messages (heartbeats) are droppable too, and a new one takes
+ * the place of one still queued: it is removed and the new one goes last.
+ */
+#define OUTQ_MSG_MAX 256
+#define OUTQ_SOFT_LIMIT 16       // power of two; also the initial capacity
+#define OUTQ_HARD_LIMIT 1024
+#define OUTQ_IOV_MAX 64          // messages per gathered write
+
+typedef enum {
+    OUTQ_DROP_OLDEST = 0,
+    OUTQ_NEVER_DROP,
+    OUTQ_REPLACE
+} OutPolicy;
+
+typedef struct {
+    uint16_t len;
+    uint8_t droppable;           // 0 = must go, 1 = may be shed, 2 = may also be replaced
+    unsigned char data[OUTQ_MSG_MAX];
+} OutMsg;
+
+typedef struct {
+    OutMsg* msgs;                // ring; capacity is a power of two
+    uint32_t cap;
+    uint32_t head;
+    uint32_t count;
+    uint32_t head_off;           // bytes of msgs[head] already written
+    uint64_t sent;
+    uint64_t dropped;
+    uint64_t writes;             // send/sendmsg calls
+} OutQueue;
+
+int outq_init(OutQueue* q);      // 0, or -1 if the ring cannot be allocated
+void outq_free(OutQueue* q);
+void outq_reset(OutQueue* q);    // drop everything queued (the connection is gone); keeps the ring
+
+/* Queue a message without writing. 0 on success (including a shed command or heartbeat),
+ * -1 if it is larger than OUTQ_MSG_MAX or the hard limit is reached. */
+int outq_push(OutQueue* q, const void* msg, size_t len, OutPolicy policy);
+
+/* Write queued messages. 1 = drained, 0 = socket full, -1 = socket error. */
+int outq_flush(OutQueue* q, int fd);
+
+/* outq_flush() in two halves, for callers that submit the write themselves
+ * (e.g. several queues in one tpio_send_batch()). outq_prepare() points iov at
+ * up to max queued messages, stores their byte count in *total and returns the
+ * iov count (0 = empty). outq_complete() takes the write's result (bytes or
+ * -errno): 1 = all of it went out, 0 = socket full, -1 = socket error. */
+int outq_prepare(const OutQueue* q, struct iovec* iov, int max, size_t* total);
+int outq_complete(OutQueue* q, ssize_t res, size_t total);
+
+/* Write now if possible, queue the rest. Same returns as outq_flush, plus -1
+ * for a failed outq_push. */
+int outq_send(OutQueue* q, int fd, const void* msg, size_t len, OutPolicy policy);
+
+#endif
@@ -0,0 +1,93 @@
+// session_table.c
+
+#include "session_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void order_unlink(SessionTable* t, FollowerSession* s) {
+    if (s->prev) s->prev->next = s->next;
+    else t->head = s->next;
+    if (s->next) s->next->prev = s->prev;
+    else t->tail = s->prev;
+    s->prev = s->next = NULL;
+}
+
+static void order_insert_after(SessionTable* t, FollowerSession* s, FollowerSession* after) {
+    s->prev = after;
+    s->next = after ? after->next : t->head;
+    if (s->next) s->next->prev = s;
+    else t->tail = s;
+    if (after) after->next = s;
+    else t->head = s;
+}
+
+static int grow(FollowerSession*** arr, int* cap, int need) {
+    if (need < *cap) return 0;
+    int n = *cap ? *cap : 16;
+    while (n <= need) n *= 2;
+    FollowerSession** grown = realloc(*arr, sizeof(*grown) * (size_t)n);
+    if (!grown) return -1;
+    memset(grown + *cap, 0, sizeof(*grown) * (size_t)(n - *cap));
+    *arr = grown;
+    *cap = n;
+    return 0;
+}
+
+FollowerSession* session_table_add(SessionTable* t, int fd) {
+    if (fd < 0 || grow(&t->by_fd, &t->fd_cap, fd) < 0 || grow(&t->dense, &t->cap, t->count) < 0) {
+        return NULL;
+    }
+    FollowerSession* s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->fd = fd;
+    s->slot = t->count;
+    t->dense[t->count++] = s;
+    t->by_fd[fd] = s;
+    order_insert_after(t, s, t->tail);
+    return s;
+}
+
+void session_table_remove(SessionTable* t, FollowerSession* s) {
+    FollowerSession* last = t->dense[--t->count];
+    t->dense[s->slot] = last;
+    last->slot = s->slot;
+    t->dense[t->count] = NULL;
+    if (s->fd >= 0 && s->fd < t->fd_cap && t->by_fd[s->fd] == s) t->by_fd[s->fd] = NULL;
+    order_unlink(t, s);
+    free(s);
+}
+
+FollowerSession* session_table_find(const SessionTable* t, int fd) {
+    if (fd < 0 || fd >= t->fd_cap) return NULL;
+    return t->by_fd[fd];
+}
+
+int session_table_rebind(SessionTable* t, FollowerSession* s, int fd) {
+    if (fd >= 0 && grow(&t->by_fd, &t->fd_cap, fd) < 0) return -1;
+    if (s->fd >= 0 && s->fd < t->fd_cap && t->by_fd[s->fd] == s) t->by_fd[s->fd] = NULL;
+    s->fd = fd;
+    if (fd >= 0) t->by_fd[fd] = s;
+    return 0;
+}
+
+FollowerSession* session_table_find_token(const SessionTable* t, uint64_t token) {
+    if (token == 0) return NULL;
+    for (int i = 0; i < t->count; i++) {
+        if (t->dense[i]->token == token) return t->dense[i];
+    }
+    return NULL;
+}
+
+void session_table_move_after(SessionTable* t, FollowerSession* s, FollowerSession* after) {
+    if (s == after) return;
+    order_unlink(t, s);
+    order_insert_after(t, s, after);
+}
+
+void session_table_clear(SessionTable* t) {
+    for (int i = 0; i < t->count; i++) free(t->dense[i]);
+    free(t->dense);
+    free(t->by_fd);
+    memset(t, 0, sizeof(*t));
+}
@@ -0,0 +1,48 @@
+#ifndef SESSION_TABLE_H
+#define SESSION_TABLE_H
+
+#include "tpnet.h"
+
+/* Growable table of the leader's follower sessions.
+ *
+ * dense: every session once, in no particular order. Broadcasts walk it;
+ *   removal swaps the last entry into the hole.
+ * by_fd: fd -> session, for the reactor's per-socket events.
+ * head/tail: platoon order (front truck first) as a doubly linked list through
+ *   the sessions, so joins append, leaves unlink and reorders relink in O(1).
+ *
+ * Sessions are heap-allocated and never move while in the table. Not
+ * thread-safe: the leader holds mutex_followers. A zeroed table is empty and
+ * ready to use.
+ */
+typedef struct {
+    FollowerSession** dense;
+    int count, cap;
+    FollowerSession** by_fd;
+    int fd_cap;
+    FollowerSession* head;
+    FollowerSession* tail;
+} SessionTable;
+
+/* New zeroed session for fd, appended last in platoon order; NULL if out of memory */
+FollowerSession* session_table_add(SessionTable* t, int fd);
+
+/* Unlink and free s (its OutQueue and socket are the caller's) */
+void session_table_remove(SessionTable* t, FollowerSession* s);
+
+/* Session on fd, or NULL */
+FollowerSession* session_table_find(const SessionTable* t, int fd);
+
+/* Move s to another fd, keeping its place; fd == -1 leaves it on none. 0, or -1 if out of memory */
+int session_table_rebind(SessionTable* t, FollowerSession* s, int fd);
+
+/* Session holding a resume token, or NULL (a scan: resumes are rare) */
+FollowerSession* session_table_find_token(const SessionTable* t, uint64_t token);
+
+/* Move s to just behind after in platoon order; after == NULL makes it first */
+void session_table_move_after(SessionTable* t, FollowerSession* s, FollowerSession* after);
+
+/* Remove and free every session, and release the table's own storage */
+void session_table_clear(SessionTable* t);
+
+#endif
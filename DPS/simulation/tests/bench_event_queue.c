@@ -0,0 +1,139 @@
+/* Contention benchmark: lock-free EventQueue vs. the previous mutex/condvar queue.
+ *
+ * P producer threads push events of their own EventType into one queue while a
+ * single consumer drains it in priority order (the FSM pattern). Each producer
+ * keeps at most one ring's worth of events in flight so neither queue drops.
+ *
+ * Build/run: make bench
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "../event.h"
+
+#define EVENTS_PER_PRODUCER 200000
+#define MAX_PRODUCERS 8
+
+/* ---------------- Baseline: the mutex/condvar queue this replaced ---------------- */
+typedef struct {
+    Event queue[MAX_EVENTS];
+    int head;
+    int tail;
+} MutexRing;
+
+typedef struct {
+    MutexRing rings[NUM_PRIORITIES];
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} MutexQueue;
+
+static void mq_init(MutexQueue* q) {
+    memset(q, 0, sizeof(*q));
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_cond_init(&q->cond, NULL);
+}
+
+static void mq_push(MutexQueue* q, Event* e) {
+    pthread_mutex_lock(&q->mutex);
+    MutexRing* r = &q->rings[e->type];
+    int next_tail = (r->tail + 1) % MAX_EVENTS;
+    if (next_tail != r->head) {
+        r->queue[r->tail] = *e;
+        r->tail = next_tail;
+    }
+    pthread_cond_signal(&q->cond);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+static Event mq_pop(MutexQueue* q) {
+    pthread_mutex_lock(&q->mutex);
+    while (1) {
+        for (int p = 0; p < NUM_PRIORITIES; p++) {
+            MutexRing* r = &q->rings[p];
+            if (r->head != r->tail) {
+                Event e = r->queue[r->head];
+                r->head = (r->head + 1) % MAX_EVENTS;
+                pthread_mutex_unlock(&q->mutex);
+                return e;
+            }
+        }
+        pthread_cond_wait(&q->cond, &q->mutex);
+    }
+}
+
+/* ---------------- Harness ---------------- */
+typedef struct {
+    int use_mutex;
+    MutexQueue mq;
+    EventQueue lq;
+    long consumed[NUM_PRIORITIES];   /* written by consumer, read by producers */
+} Bench;
+
+typedef struct {
+    Bench* b;
+    EventType type;
+} ProducerArg;
+
+static void* producer(void* arg) {
+    ProducerArg* pa = arg;
+    Bench* b = pa->b;
+    Event ev = {.type = pa->type};
+
+    for (long i = 0; i < EVENTS_PER_PRODUCER; i++) {
+        /* Flow control: never exceed the ring capacity for our type */
+        while (i - __atomic_load_n(&b->consumed[pa->type], __ATOMIC_ACQUIRE) >= MAX_EVENTS - 1) {
+            sched_yield();
+        }
+        ev.event_data.ft_pos.x = (float)i;
+        if (b->use_mutex) mq_push(&b->mq, &ev);
+        else push_event(&b->lq, &ev);
+    }
+    return NULL;
+}
+
+static double run(int use_mutex, int producers) {
+    static Bench b;
+    memset(&b, 0, sizeof(b));
+    b.use_mutex = use_mutex;
+    mq_init(&b.mq);
+    event_queue_init(&b.lq);
+
+    pthread_t tids[MAX_PRODUCERS];
+    ProducerArg args[MAX_PRODUCERS];
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    for (int i = 0; i < producers; i++) {
+        args[i].b = &b;
+        args[i].type = (EventType)i;
+        pthread_create(&tids[i], NULL, producer, &args[i]);
+    }
+
+    long total = (long)producers * EVENTS_PER_PRODUCER;
+    for (long n = 0; n < total; n++) {
+        Event e = use_mutex ? mq_pop(&b.mq) : pop_event(&b.lq);
+        __atomic_store_n(&b.consumed[e.type], b.consumed[e.type] + 1, __ATOMIC_RELEASE);
+    }
+
+    for (int i = 0; i < producers; i++) pthread_join(tids[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    double ns = (double)(t1.tv_sec - t0.tv_sec) * 1e9 + (double)(t1.tv_nsec - t0.tv_nsec);
+    return ns / (double)total;
+}
+
+int main(void) {
+    printf("EventQueue contention benchmark (%d events per producer)\n", EVENTS_PER_PRODUCER);
+    printf("%-10s %-18s %-18s\n", "producers", "mutex ns/event", "lock-free ns/event");
+    for (int p = 1; p <= MAX_PRODUCERS; p *= 2) {
+        double m = run(1, p);
+        double l = run(0, p);
+        printf("%-10d %-18.1f %-18.1f\n", p, m, l);
+    }
+    return 0;
+}
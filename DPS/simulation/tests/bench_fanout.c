@@ -0,0 +1,174 @@
+/* Leader fan-out benchmark: one write per message vs. batched egress.
+ *
+ * Stream (one socketpair per follower, like the per-follower TCP sessions): a
+ * topology change sends every follower its MSG_LDR_ASSIGN_ID and
+ * MSG_LDR_UPDATE_REAR. Compared: outq_send() per message (one send() each) vs.
+ * outq_push() both and one outq_flush() (one gathered sendmsg() per follower).
+ *
+ * Datagram (one UDP receiver per follower on loopback): a cruise command to
+ * every follower. Compared: sendto() per follower vs. sendDatagrams()
+ * (sendmmsg(), TPNET_DGRAM_BATCH per call).
+ *
+ * Prints syscalls and wall time per broadcast at 5, 50 and 500 followers.
+ * Receivers are drained outside the timed section.
+ *
+ * Build/run: make bench
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../outq.h"
+#include "../tpframe.h"
+#include "../tpwire.h"
+#include "../tpnet.h"
+
+#define ROUNDS 200
+#define MAX_N 500
+
+static const int sizes[] = {5, 50, 500};
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static size_t frame_ld(const LD_MESSAGE* m, unsigned char* frame) {
+    size_t len = tpwire_encode_ld(m, frame + TPFRAME_HDR, TPWIRE_MAX);
+    tpframe_write_header(frame, len);
+    return TPFRAME_HDR + len;
+}
+
+static void drain(int fd) {
+    unsigned char buf[4096];
+    while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+    }
+}
+
+static void row(const char* transport, int n, const char* mode, uint64_t calls, double ns) {
+    printf("%-10s %-6d %-22s %-14.1f %.1f\n", transport, n, mode,
+           (double)calls / ROUNDS, ns / ROUNDS / 1000.0);
+}
+
+static int bench_stream(int n) {
+    static int sv[MAX_N][2];
+    static OutQueue q[MAX_N];
+    for (int i = 0; i < n; i++) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv[i]) < 0 || outq_init(&q[i]) < 0) {
+            perror("socketpair");
+            return -1;
+        }
+        fcntl(sv[i][0], F_SETFL, fcntl(sv[i][0], F_GETFL) | O_NONBLOCK);
+    }
+
+    /* Topology change: ID, then rear pointer */
+    unsigned char id_frame[TPFRAME_HDR + TPWIRE_MAX], rear_frame[TPFRAME_HDR + TPWIRE_MAX];
+    LD_MESSAGE id = {.type = MSG_LDR_ASSIGN_ID, .payload.assigned_id = 3};
+    LD_MESSAGE rear = {.type = MSG_LDR_UPDATE_REAR};
+    rear.payload.rearInfo.has_rearTruck = 1;
+    strcpy(rear.payload.rearInfo.rearTruck_Address.ip, "127.0.0.1");
+    rear.payload.rearInfo.rearTruck_Address.udp_port = 5004;
+    size_t id_len = frame_ld(&id, id_frame);
+    size_t rear_len = frame_ld(&rear, rear_frame);
+
+    for (int batched = 0; batched <= 1; batched++) {
+        double ns = 0;
+        for (int i = 0; i < n; i++) q[i].writes = 0;
+        for (int r = 0; r < ROUNDS; r++) {
+            double t0 = now_ns();
+            for (int i = 0; i < n; i++) {
+                if (batched) {
+                    outq_push(&q[i], id_frame, id_len, OUTQ_NEVER_DROP);
+                    outq_push(&q[i], rear_frame, rear_len, OUTQ_NEVER_DROP);
+                    outq_flush(&q[i], sv[i][0]);
+                } else {
+                    outq_send(&q[i], sv[i][0], id_frame, id_len, OUTQ_NEVER_DROP);
+                    outq_send(&q[i], sv[i][0], rear_frame, rear_len, OUTQ_NEVER_DROP);
+                }
+            }
+            ns += now_ns() - t0;
+            for (int i = 0; i < n; i++) drain(sv[i][1]);
+        }
+        uint64_t calls = 0;
+        for (int i = 0; i < n; i++) calls += q[i].writes;
+        row("stream", n, batched ? "push+flush (sendmsg)" : "send per message", calls, ns);
+    }
+
+    for (int i = 0; i < n; i++) {
+        outq_free(&q[i]);
+        close(sv[i][0]);
+        close(sv[i][1]);
+    }
+    return 0;
+}
+
+static int bench_datagram(int n) {
+    static int rx[MAX_N];
+    static struct sockaddr_in dst[MAX_N];
+    static Datagram dgrams[MAX_N];
+    int tx = socket(AF_INET, SOCK_DGRAM, 0);
+    if (tx < 0) {
+        perror("socket");
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        rx[i] = socket(AF_INET, SOCK_DGRAM, 0);
+        struct sockaddr_in a = {.sin_family = AF_INET};
+        inet_pton(AF_INET, "127.0.0.1", &a.sin_addr);
+        socklen_t alen = sizeof(a);
+        if (rx[i] < 0 || bind(rx[i], (struct sockaddr*)&a, sizeof(a)) < 0 ||
+            getsockname(rx[i], (struct sockaddr*)&dst[i], &alen) < 0) {
+            perror("udp receiver");
+            return -1;
+        }
+    }
+
+    unsigned char wire[TPWIRE_MAX];
+    LD_MESSAGE cmd = {.type = MSG_LDR_CMD};
+    cmd.payload.cmd.leader = (Truck){.x = 120.0f, .y = 845.5f, .speed = 60.0f, .dir = NORTH, .state = CRUISE};
+    size_t len = tpwire_encode_ld_seq(&cmd, 1, wire, sizeof(wire));
+    for (int i = 0; i < n; i++) {
+        dgrams[i] = (Datagram){.data = wire, .len = len, .dst = &dst[i]};
+    }
+
+    for (int batched = 0; batched <= 1; batched++) {
+        double ns = 0;
+        uint64_t calls = 0;
+        for (int r = 0; r < ROUNDS; r++) {
+            double t0 = now_ns();
+            if (batched) {
+                if (sendDatagrams(tx, dgrams, (uint32_t)n) != n) return -1;
+                calls += ((uint64_t)n + TPNET_DGRAM_BATCH - 1) / TPNET_DGRAM_BATCH;
+            } else {
+                for (int i = 0; i < n; i++) {
+                    if (sendto(tx, wire, len, 0, (struct sockaddr*)&dst[i], sizeof(dst[i])) < 0) return -1;
+                }
+                calls += (uint64_t)n;
+            }
+            ns += now_ns() - t0;
+            for (int i = 0; i < n; i++) drain(rx[i]);
+        }
+        row("datagram", n, batched ? "sendmmsg" : "sendto per follower", calls, ns);
+    }
+
+    for (int i = 0; i < n; i++) close(rx[i]);
+    close(tx);
+    return 0;
+}
+
+int main(void) {
+    printf("Leader fan-out per broadcast (%d rounds)\n", ROUNDS);
+    printf("%-10s %-6s %-22s %-14s %s\n", "transport", "N", "mode", "syscalls", "us");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        if (bench_stream(sizes[s]) < 0 || bench_datagram(sizes[s]) < 0) return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,238 @@
+/* Time-to-formation benchmark: many followers join one leader at once.
+ *
+ * Each scenario forks a leader (leader_server_init + leader_listen, one
+ * reactor and one FSM thread per shard, no tick timer) on a loopback port.
+ * N joiner threads are released together; each connects, sends its join frame
+ * and then reads until the leader has been quiet for QUIET_MS. Some scenarios
+ * first open stalled clients that connect and send half a frame header: they
+ * must neither delay the real joiners nor stay open past LEADER_JOIN_TIMEOUT_MS.
+ *
+ * Prints, per scenario: time until every joiner is registered (ASSIGN_ID and
+ * SPAWN received), the join latency distribution, time until the last
+ * topology update (formation), the topology updates sent after registration,
+ * and how many stalled clients were closed.
+ * Checks that every platoon ended with positions 1..n.
+ *
+ * Build/run: make bench   (tests/bench_formation [JOINERS] [PORT])
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../leader.h"
+#include "../tpframe.h"
+#include "../tpwire.h"
+#include "../latency_hist.h"
+
+#define MAX_JOINERS 1000
+#define QUIET_MS 500
+#define STALLED 32
+
+typedef struct {
+    const char* name;
+    int platoons, shards, reuseport, stalled;
+} Scenario;
+
+static const Scenario scenarios[] = {
+    {"1 platoon, 1 acceptor",                1, 1, 0, 0},
+    {"1 platoon, 1 acceptor, stalled",       1, 1, 0, STALLED},
+    {"4 platoons/4 shards, 1 acceptor",      4, 4, 0, STALLED},
+    {"4 platoons/4 shards, SO_REUSEPORT",    4, 4, 1, STALLED},
+};
+
+typedef struct {
+    int index, platoon, fd;
+    int last_id;
+    int updates;                    // topology messages after registration
+    uint64_t registered_ns, formed_ns;
+} Joiner;
+
+static Joiner joiners[MAX_JOINERS];
+static pthread_barrier_t start_line, done_line;
+static uint16_t bench_port;
+static int bench_platoons;
+
+static int connect_leader(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(bench_port)};
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+/* One framed LD_MESSAGE; 0, or -1 on timeout or EOF */
+static int read_ld(int fd, MatrixClock* base, LD_MESSAGE* out) {
+    unsigned char hdr[TPFRAME_HDR];
+    unsigned char wire[TPWIRE_MAX];
+    if (recv(fd, hdr, sizeof(hdr), MSG_WAITALL) != (ssize_t)sizeof(hdr)) return -1;
+    size_t len = ((size_t)hdr[0] << 24) | ((size_t)hdr[1] << 16) | ((size_t)hdr[2] << 8) | hdr[3];
+    if (len > sizeof(wire) || recv(fd, wire, len, MSG_WAITALL) != (ssize_t)len) return -1;
+    return tpwire_decode_ld_delta(wire, len, base, out);
+}
+
+static void* joiner_main(void* arg) {
+    Joiner* j = arg;
+    MatrixClock base;
+    mc_init(&base);
+
+    FollowerRegisterMsg reg = {0};
+    snprintf(reg.selfAddress.ip, sizeof(reg.selfAddress.ip), "127.0.0.1");
+    reg.selfAddress.udp_port = (uint16_t)(20000 + j->index);
+    reg.platoon_id = j->platoon;
+    unsigned char wire[TPWIRE_MAX];
+    size_t len = tpwire_encode_reg(&reg, wire, sizeof(wire));
+
+    pthread_barrier_wait(&start_line);
+    j->fd = connect_leader();
+    if (tpframe_send(j->fd, wire, len) != 0) {
+        perror("send join");
+        exit(1);
+    }
+
+    struct timeval quiet = {.tv_sec = 0, .tv_usec = QUIET_MS * 1000};
+    setsockopt(j->fd, SOL_SOCKET, SO_RCVTIMEO, &quiet, sizeof(quiet));
+    int spawned = 0;
+    LD_MESSAGE msg;
+    while (read_ld(j->fd, &base, &msg) == 0) {
+        uint64_t now = lat_now_ns();
+        if (msg.type == MSG_LDR_ASSIGN_ID) j->last_id = msg.payload.assigned_id;
+        if (msg.type == MSG_LDR_SPAWN && !spawned) {
+            spawned = 1;
+            j->registered_ns = j->formed_ns = now;
+        } else if (spawned && (msg.type == MSG_LDR_ASSIGN_ID || msg.type == MSG_LDR_UPDATE_REAR)) {
+            j->updates++;
+            j->formed_ns = now;
+        }
+    }
+
+    /* Stay connected until everyone is done: a leave would reshuffle the others */
+    pthread_barrier_wait(&done_line);
+    return NULL;
+}
+
+/* Every platoon's final positions are 1..n */
+static void check_positions(int n) {
+    for (int p = 0; p < bench_platoons; p++) {
+        int count = 0;
+        char seen[MAX_JOINERS + 1] = {0};
+        for (int i = 0; i < n; i++) {
+            if (joiners[i].platoon != p) continue;
+            count++;
+            assert(joiners[i].last_id >= 1 && joiners[i].last_id <= MAX_JOINERS);
+            assert(!seen[joiners[i].last_id]);
+            seen[joiners[i].last_id] = 1;
+        }
+        for (int id = 1; id <= count; id++) assert(seen[id]);
+    }
+}
+
+static void run(const Scenario* sc, int n, FILE* report) {
+    bench_platoons = sc->platoons;
+    if (leader_server_init(sc->platoons, sc->shards) < 0 || leader_listen(bench_port, sc->reuseport) < 0) {
+        fprintf(report, "%-38s leader setup failed\n", sc->name);
+        exit(1);
+    }
+    for (int i = 0; i < leader_shard_count(); i++) {
+        LeaderShard* sh = leader_shard(i);
+        pthread_create(&sh->reactor_tid, NULL, leader_reactor, sh);
+        pthread_create(&sh->fsm_tid, NULL, leader_state_machine, sh);
+    }
+
+    /* Half-open clients get to the accept queue first */
+    int stalled[STALLED];
+    for (int i = 0; i < sc->stalled; i++) {
+        stalled[i] = connect_leader();
+        unsigned char half[2] = {0, 0};
+        if (send(stalled[i], half, sizeof(half), 0) != (ssize_t)sizeof(half)) perror("send");
+    }
+
+    pthread_barrier_init(&start_line, NULL, (unsigned)n + 1);
+    pthread_barrier_init(&done_line, NULL, (unsigned)n + 1);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 256 * 1024);
+    pthread_t tids[MAX_JOINERS];
+    for (int i = 0; i < n; i++) {
+        joiners[i] = (Joiner){.index = i, .platoon = i % sc->platoons};
+        pthread_create(&tids[i], &attr, joiner_main, &joiners[i]);
+    }
+
+    pthread_barrier_wait(&start_line);
+    uint64_t t0 = lat_now_ns();
+    pthread_barrier_wait(&done_line);
+
+    LatencyHist join_lat;
+    lat_hist_reset(&join_lat);
+    uint64_t registered = 0, formed = 0, updates = 0;
+    for (int i = 0; i < n; i++) {
+        assert(joiners[i].registered_ns);
+        updates += (uint64_t)joiners[i].updates;
+        lat_hist_record(&join_lat, joiners[i].registered_ns - t0);
+        if (joiners[i].registered_ns - t0 > registered) registered = joiners[i].registered_ns - t0;
+        if (joiners[i].formed_ns - t0 > formed) formed = joiners[i].formed_ns - t0;
+    }
+    check_positions(n);
+
+    /* Stalled clients: the leader closes them once their handshake times out */
+    int closed = 0;
+    struct timeval wait = {.tv_sec = LEADER_JOIN_TIMEOUT_MS / 1000 + 1};
+    for (int i = 0; i < sc->stalled; i++) {
+        char b;
+        setsockopt(stalled[i], SOL_SOCKET, SO_RCVTIMEO, &wait, sizeof(wait));
+        if (recv(stalled[i], &b, 1, 0) == 0) closed++;
+    }
+
+    fprintf(report, "%-38s joiners=%d  all registered %7.1f ms  join p50=%7.1f ms p99=%7.1f ms  formed %7.1f ms  updates %llu",
+            sc->name, n, (double)registered / 1e6,
+            (double)lat_hist_percentile(&join_lat, 50.0) / 1e6,
+            (double)lat_hist_percentile(&join_lat, 99.0) / 1e6, (double)formed / 1e6,
+            (unsigned long long)updates);
+    if (sc->stalled) fprintf(report, "  stalled closed %d/%d", closed, sc->stalled);
+    fprintf(report, "\n");
+    fflush(report);
+}
+
+int main(int argc, char** argv) {
+    int n = argc > 1 ? atoi(argv[1]) : 256;
+    int port = argc > 2 ? atoi(argv[2]) : 5900;
+    if (n < 1 || n > MAX_JOINERS || port <= 0 || port > 65535 - 16) {
+        fprintf(stderr, "Usage: %s [JOINERS 1..%d] [PORT]\n", argv[0], MAX_JOINERS);
+        return 1;
+    }
+    printf("Time to formation, %d simultaneous joiners (join timeout %d ms)\n", n, LEADER_JOIN_TIMEOUT_MS);
+    fflush(stdout);
+
+    for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            /* A fresh leader per scenario; its own logging is discarded */
+            FILE* report = fdopen(dup(STDOUT_FILENO), "w");
+            if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) return 1;
+            bench_port = (uint16_t)(port + (int)s);
+            run(&scenarios[s], n, report);
+            _exit(0);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "%s: failed\n", scenarios[s].name);
+            return 1;
+        }
+    }
+    return 0;
+}
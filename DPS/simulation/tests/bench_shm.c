@@ -0,0 +1,242 @@
+/* Transport benchmark: loopback TCP vs. shared-memory links (TP_NET=shm).
+ *
+ * Both sides are separate processes, as leader and followers are on a rig.
+ *
+ * Round trip: the parent sends a MSG_LEN message, a forked echo process sends
+ * it back; both block in between (recv() on TCP, tpshm_wait() on a link).
+ * Prints p50/p99/p99.9 of the round-trip time.
+ *
+ * Stream: the parent writes STREAM_MSGS messages as fast as the transport
+ * takes them (waiting for room when it is full); the forked reader receives
+ * through a TPIO_POSIX watch, as the leader reactor and follower loop do.
+ * Prints messages per second and the reader's syscalls per message (as
+ * counted by tpio; zero for data taken straight from a link's ring).
+ *
+ * Build/run: make bench   (tests/bench_shm [PORT])
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "../tpshm.h"
+#include "../tpio.h"
+#include "../latency_hist.h"
+
+#define ROUNDS 20000
+#define STREAM_MSGS 200000
+#define MSG_LEN 32
+
+typedef enum { NET_TCP, NET_SHM } Net;
+
+static uint16_t bench_port;
+static char shm_name[64];
+
+static int tcp_listener(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(bench_port)};
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+        perror("tcp listen");
+        exit(1);
+    }
+    return fd;
+}
+
+static int tcp_nodelay(int fd) {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+static int net_listen(Net net) {
+    return net == NET_TCP ? tcp_listener() : tpshm_listen(shm_name);
+}
+
+static int net_connect(Net net) {
+    if (net == NET_SHM) return tpshm_connect(shm_name, TPSHM_STREAM);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(bench_port)};
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) return -1;
+    return tcp_nodelay(fd);
+}
+
+static int net_accept(Net net, int listen_fd) {
+    if (net == NET_TCP) return tcp_nodelay(accept(listen_fd, NULL, NULL));
+    struct pollfd pfd = {.fd = listen_fd, .events = POLLIN};
+    if (poll(&pfd, 1, 5000) != 1) return -1;
+    return tpshm_accept(listen_fd);
+}
+
+/* Blocking: exactly len bytes; -1 on EOF or error */
+static int net_read(Net net, int fd, void* buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = net == NET_TCP ? recv(fd, (char*)buf + got, len - got, 0)
+                                   : tpshm_recv(fd, (char*)buf + got, len - got);
+        if (n == 0) return -1;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (net == NET_SHM && errno == EAGAIN && tpshm_wait(fd, -1) >= 0) continue;
+            return -1;
+        }
+        got += (size_t)n;
+    }
+    return 0;
+}
+
+/* Non-blocking write of a whole message, waiting for room when the transport is full */
+static int net_write(Net net, int fd, const void* buf, size_t len) {
+    size_t off = 0;
+    while (off < len) {
+        ssize_t n = net == NET_TCP ? send(fd, (const char*)buf + off, len - off, MSG_DONTWAIT | MSG_NOSIGNAL)
+                                   : tpshm_send(fd, (const char*)buf + off, len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+            if (net == NET_SHM) {
+                tpshm_wait(fd, -1);
+            } else {
+                struct pollfd pfd = {.fd = fd, .events = POLLOUT};
+                poll(&pfd, 1, -1);
+            }
+            continue;
+        }
+        off += (size_t)n;
+    }
+    return 0;
+}
+
+static void net_close(Net net, int fd) {
+    if (net == NET_SHM) tpshm_close(fd);
+    else close(fd);
+}
+
+static const char* net_name(Net net) {
+    return net == NET_TCP ? "loopback TCP" : "shm link";
+}
+
+static void round_trip(Net net) {
+    int listen_fd = net_listen(net);
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = net_connect(net);
+        char msg[MSG_LEN];
+        while (fd >= 0 && net_read(net, fd, msg, sizeof(msg)) == 0) {
+            if (net_write(net, fd, msg, sizeof(msg)) < 0) break;
+        }
+        _exit(0);
+    }
+    int fd = net_accept(net, listen_fd);
+    if (fd < 0) {
+        perror("accept");
+        exit(1);
+    }
+
+    static LatencyHist hist;
+    lat_hist_reset(&hist);
+    char msg[MSG_LEN] = {0};
+    for (int i = 0; i < ROUNDS; i++) {
+        uint64_t t0 = lat_now_ns();
+        if (net_write(net, fd, msg, sizeof(msg)) < 0 || net_read(net, fd, msg, sizeof(msg)) < 0) {
+            fprintf(stderr, "%s: round trip failed\n", net_name(net));
+            exit(1);
+        }
+        lat_hist_record(&hist, lat_now_ns() - t0);
+    }
+    net_close(net, fd);
+    close(listen_fd);
+    waitpid(pid, NULL, 0);
+    printf("round trip  %-13s %d x %d B  p50=%7.1f us  p99=%7.1f us  p99.9=%7.1f us\n",
+           net_name(net), ROUNDS, MSG_LEN,
+           (double)lat_hist_percentile(&hist, 50.0) / 1e3,
+           (double)lat_hist_percentile(&hist, 99.0) / 1e3,
+           (double)lat_hist_percentile(&hist, 99.9) / 1e3);
+}
+
+/* Reader process: receive everything through tpio; reports syscalls over the pipe */
+static void stream_reader(Net net, int report) {
+    int fd = net_connect(net);
+    TpIo io;
+    if (fd < 0 || tpio_open(&io, TPIO_POSIX) < 0 || tpio_watch(&io, fd, TPIO_RECV, 0) < 0) _exit(1);
+    uint64_t want = (uint64_t)STREAM_MSGS * MSG_LEN, got = 0, start = io.syscalls;
+    TpIoEvent ev[16];
+    while (got < want) {
+        int n = tpio_wait(&io, ev, 16, 1000);
+        if (n < 0) _exit(1);
+        for (int i = 0; i < n; i++) {
+            if (ev[i].res <= 0) _exit(1);
+            got += (uint64_t)ev[i].res;
+        }
+    }
+    uint64_t syscalls = io.syscalls - start;
+    if (write(report, &syscalls, sizeof(syscalls)) != (ssize_t)sizeof(syscalls)) _exit(1);
+    /* Stay until the writer is done so its last sends see a live peer */
+    char b;
+    if (read(report, &b, 1) < 0) _exit(1);
+    tpio_close(&io);
+    _exit(0);
+}
+
+static void stream(Net net) {
+    int listen_fd = net_listen(net);
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) exit(1);
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(sv[0]);
+        stream_reader(net, sv[1]);
+    }
+    close(sv[1]);
+    int fd = net_accept(net, listen_fd);
+    if (fd < 0) {
+        perror("accept");
+        exit(1);
+    }
+
+    char msg[MSG_LEN] = {0};
+    uint64_t t0 = lat_now_ns();
+    for (int i = 0; i < STREAM_MSGS; i++) {
+        if (net_write(net, fd, msg, sizeof(msg)) < 0) {
+            fprintf(stderr, "%s: stream write failed\n", net_name(net));
+            exit(1);
+        }
+    }
+    uint64_t syscalls = 0;
+    if (read(sv[0], &syscalls, sizeof(syscalls)) != (ssize_t)sizeof(syscalls)) {
+        fprintf(stderr, "%s: reader failed\n", net_name(net));
+        exit(1);
+    }
+    uint64_t elapsed = lat_now_ns() - t0;
+    close(sv[0]);
+    waitpid(pid, NULL, 0);
+    net_close(net, fd);
+    close(listen_fd);
+    printf("stream      %-13s %d x %d B  %10.0f msg/s  reader syscalls/msg=%.4f\n",
+           net_name(net), STREAM_MSGS, MSG_LEN,
+           (double)STREAM_MSGS * 1e9 / (double)elapsed, (double)syscalls / STREAM_MSGS);
+}
+
+int main(int argc, char** argv) {
+    int port = argc > 1 ? atoi(argv[1]) : 5950;
+    if (port <= 0 || port > 65535) {
+        fprintf(stderr, "Usage: %s [PORT]\n", argv[0]);
+        return 1;
+    }
+    bench_port = (uint16_t)port;
+    snprintf(shm_name, sizeof(shm_name), "bench-%d", (int)getpid());
+    printf("Loopback TCP vs. shared-memory link, separate processes\n");
+    for (Net net = NET_TCP; net <= NET_SHM; net++) round_trip(net);
+    for (Net net = NET_TCP; net <= NET_SHM; net++) stream(net);
+    return 0;
+}
@@ -0,0 +1,111 @@
+/* I/O backend benchmark: epoll + recv()/sendmsg() vs. io_uring.
+ *
+ * N stream socketpairs stand in for the leader's follower sessions. Each round
+ * one TpIo sends a small frame on every pair with tpio_send_batch() (the leader
+ * fan-out) and a second TpIo with a TPIO_RECV watch on every peer waits until
+ * all N have been received (the follower/reactor side).
+ *
+ * Prints, per backend and N: messages per second, syscalls per message (both
+ * sides, as counted by the backend) and p50/p99/p99.9 of the time from batch
+ * submission to each message being handed to the reader.
+ *
+ * Build/run: make bench
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include "../tpio.h"
+#include "../latency_hist.h"
+
+#define ROUNDS 2000
+#define MAX_N 500
+#define MSG_LEN 32
+
+static const int sizes[] = {5, 50, 500};
+
+static int bench(TpIoKind kind, int n) {
+    static int sv[MAX_N][2];
+    static TpIoSend ops[MAX_N];
+    static struct iovec iov[MAX_N];
+    static TpIoEvent ev[MAX_N];
+    static LatencyHist hist;
+    static char msg[MSG_LEN];
+
+    TpIo tx, rx;
+    if (tpio_open(&tx, kind) < 0) return -1;
+    if (tpio_open(&rx, kind) < 0) {
+        tpio_close(&tx);
+        return -1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv[i]) < 0) {
+            perror("socketpair");
+            return -1;
+        }
+        fcntl(sv[i][0], F_SETFL, fcntl(sv[i][0], F_GETFL) | O_NONBLOCK);
+        fcntl(sv[i][1], F_SETFL, fcntl(sv[i][1], F_GETFL) | O_NONBLOCK);
+        if (tpio_watch(&rx, sv[i][1], TPIO_RECV, (uint64_t)i) < 0) {
+            perror("tpio_watch");
+            return -1;
+        }
+        iov[i] = (struct iovec){.iov_base = msg, .iov_len = MSG_LEN};
+    }
+
+    lat_hist_reset(&hist);
+    uint64_t calls0 = tx.syscalls + rx.syscalls;
+    uint64_t t_start = lat_now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < n; i++) ops[i] = (TpIoSend){.fd = sv[i][0], .iov = &iov[i], .iovcnt = 1};
+        uint64_t t0 = lat_now_ns();
+        if (tpio_send_batch(&tx, ops, n) < 0) return -1;
+        size_t want = (size_t)n * MSG_LEN, got = 0;
+        while (got < want) {
+            int k = tpio_wait(&rx, ev, MAX_N, -1);
+            if (k < 0) return -1;
+            uint64_t t = lat_now_ns();
+            for (int j = 0; j < k; j++) {
+                if (ev[j].res <= 0) return -1;
+                got += (size_t)ev[j].res;
+                lat_hist_record(&hist, t - t0);
+            }
+        }
+    }
+    double secs = (double)(lat_now_ns() - t_start) / 1e9;
+    double msgs = (double)ROUNDS * n;
+    uint64_t calls = tx.syscalls + rx.syscalls - calls0;
+
+    printf("%-9s %-5d %-12.0f %-14.3f %-9.1f %-9.1f %.1f\n", tpio_name(&tx), n, msgs / secs,
+           (double)calls / msgs, lat_hist_percentile(&hist, 50) / 1000.0,
+           lat_hist_percentile(&hist, 99) / 1000.0, lat_hist_percentile(&hist, 99.9) / 1000.0);
+
+    for (int i = 0; i < n; i++) {
+        tpio_unwatch(&rx, sv[i][1]);
+        close(sv[i][0]);
+        close(sv[i][1]);
+    }
+    tpio_close(&rx);
+    tpio_close(&tx);
+    return 0;
+}
+
+int main(void) {
+    printf("I/O backend: batched send + receive of %d-byte frames (%d rounds)\n", MSG_LEN, ROUNDS);
+    printf("%-9s %-5s %-12s %-14s %-9s %-9s %s\n", "backend", "N", "msgs/s", "syscalls/msg",
+           "p50 us", "p99 us", "p99.9 us");
+    const TpIoKind kinds[] = {TPIO_POSIX, TPIO_URING};
+    for (size_t k = 0; k < 2; k++) {
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            if (bench(kinds[k], sizes[s]) < 0) {
+                printf("%-9s %-5d unavailable (%s)\n", kinds[k] == TPIO_URING ? "io_uring" : "epoll",
+                       sizes[s], strerror(errno));
+                break;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+/* Wire size benchmark: raw struct vs tpwire encoding.
+ *
+ * Per leader tick every follower receives one framed MSG_LDR_CMD over TCP and
+ * one MSG_FT_POSITION datagram from the truck ahead of it. This prints the bytes
+ * each costs per follower per tick in both encodings (steady cruise and a
+ * command that carries a turn), the matrix clock's share of a command as a full
+ * clock vs. a delta against the per-follower base, the leader's bytes on a
+ * straight segment with and without send-on-change (heartbeats between full
+ * commands), plus encode/decode cost.
+ *
+ * Build/run: make bench
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../tpframe.h"
+#include "../tpwire.h"
+
+#define ITERATIONS 2000000
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static LD_MESSAGE make_cmd(int turning) {
+    LD_MESSAGE m = {.type = MSG_LDR_CMD};
+    m.payload.cmd.command_id = 4711;
+    m.payload.cmd.leader = (Truck){.x = 120.0f, .y = 845.5f, .speed = 60.0f, .dir = NORTH, .state = CRUISE};
+    m.payload.cmd.is_turning_event = turning;
+    if (turning) {
+        m.payload.cmd.turn_point_x = 120.0f;
+        m.payload.cmd.turn_point_y = 900.0f;
+        m.payload.cmd.turn_dir = EAST;
+    }
+    /* A running platoon: every truck has sent and received a few hundred messages */
+    for (int i = 0; i < NUM_TRUCKS; i++)
+        for (int j = 0; j < NUM_TRUCKS; j++)
+            m.matrix_clock.mc[i][j] = 300 + 7 * i + j;
+    return m;
+}
+
+static void row(const char* what, size_t raw, size_t wire) {
+    printf("%-28s %-12zu %-12zu %.1fx\n", what, raw, wire, (double)raw / (double)wire);
+}
+
+int main(void) {
+    unsigned char wire[TPWIRE_MAX];
+    LD_MESSAGE cruise = make_cmd(0);
+    LD_MESSAGE turn = make_cmd(1);
+    FT_MESSAGE pos = {.type = MSG_FT_POSITION, .payload.position = {.x = 120.0f, .y = 830.0f, .speed = 59.5f}};
+
+    size_t cruise_len = tpwire_encode_ld(&cruise, wire, sizeof(wire));
+    size_t turn_len = tpwire_encode_ld(&turn, wire, sizeof(wire));
+    size_t pos_len = tpwire_encode_ft(&pos, wire, sizeof(wire));
+
+    printf("Wire size per follower per tick (%.0f ms tick)\n", LEADER_TICK_DT * 1000.0f);
+    printf("%-28s %-12s %-12s %s\n", "message", "struct B", "tpwire B", "ratio");
+    row("LDR_CMD (TCP, framed)", TPFRAME_HDR + sizeof(LD_MESSAGE), TPFRAME_HDR + cruise_len);
+    row("LDR_CMD + turn (TCP, framed)", TPFRAME_HDR + sizeof(LD_MESSAGE), TPFRAME_HDR + turn_len);
+    row("FT_POSITION (UDP)", sizeof(FT_MESSAGE), pos_len);
+    row("tick total", TPFRAME_HDR + sizeof(LD_MESSAGE) + sizeof(FT_MESSAGE),
+        TPFRAME_HDR + cruise_len + pos_len);
+    double per_s = 1.0 / LEADER_TICK_DT;
+    printf("steady cruise: %.0f B/s -> %.0f B/s per follower\n",
+           (double)(TPFRAME_HDR + sizeof(LD_MESSAGE) + sizeof(FT_MESSAGE)) * per_s,
+           (double)(TPFRAME_HDR + cruise_len + pos_len) * per_s);
+
+    /* Clock share of one command, 40 ticks after the last committed (control) message */
+    MatrixClock sent = cruise.matrix_clock;
+    LD_MESSAGE later = cruise;
+    later.matrix_clock.mc[0][0] += 40;
+    size_t delta_len = tpwire_encode_ld_delta(&later, &sent, 0, wire, sizeof(wire));
+    LD_MESSAGE no_clock = cruise;
+    memset(&no_clock.matrix_clock, 0, sizeof(no_clock.matrix_clock));
+    size_t body_len = tpwire_encode_ld(&no_clock, wire, sizeof(wire));
+    printf("\nMatrix clock bytes per LDR_CMD (%dx%d)\n", NUM_TRUCKS, NUM_TRUCKS);
+    printf("%-28s %zu\n", "struct", sizeof(MatrixClock));
+    printf("%-28s %zu\n", "tpwire full", cruise_len - body_len);
+    printf("%-28s %zu\n", "tpwire delta", delta_len - body_len);
+
+    /* Straight segment: a full command per tick (each one ticks the leader's
+     * clock), or heartbeats with an unchanged clock and a periodic refresh */
+    MatrixClock base = cruise.matrix_clock;
+    LD_MESSAGE next = cruise;
+    next.matrix_clock.mc[0][0] += 1;
+    size_t tick_len = TPFRAME_HDR + tpwire_encode_ld_delta(&next, &base, 1, wire, sizeof(wire));
+    LD_MESSAGE beat = {.type = MSG_LDR_HEARTBEAT, .matrix_clock = base};
+    beat.payload.cmd.command_id = 4711;
+    size_t beat_len = TPFRAME_HDR + tpwire_encode_ld_delta(&beat, &base, 1, wire, sizeof(wire));
+    double every_tick = (double)tick_len / LEADER_TICK_DT;
+    double on_change = (double)beat_len * 1000.0 / LEADER_HEARTBEAT_MS +
+                       (double)tick_len * 1000.0 / LEADER_CMD_REFRESH_MS;
+    printf("\nLeader -> follower on a straight segment (TCP, framed)\n");
+    printf("%-28s %zu B every %.0f ms: %.1f B/s\n", "command per tick", tick_len,
+           LEADER_TICK_DT * 1000.0f, every_tick);
+    printf("%-28s %zu B every %d ms + refresh every %d ms: %.1f B/s (%.1fx less)\n",
+           "send-on-change", beat_len, LEADER_HEARTBEAT_MS, LEADER_CMD_REFRESH_MS, on_change,
+           every_tick / on_change);
+
+    /* Codec cost */
+    volatile size_t sink = 0;
+    size_t last_len = 0;
+    LD_MESSAGE out;
+    double t0 = now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        cruise.payload.cmd.command_id = (uint64_t)i;
+        last_len = tpwire_encode_ld(&cruise, wire, sizeof(wire));
+        sink += last_len;
+    }
+    double t1 = now_ns();
+    for (int i = 0; i < ITERATIONS; i++) {
+        if (tpwire_decode_ld(wire, last_len, &out) < 0) return 1;
+        sink += out.payload.cmd.command_id;
+    }
+    double t2 = now_ns();
+    printf("\nLDR_CMD encode %.1f ns, decode %.1f ns\n",
+           (t1 - t0) / ITERATIONS, (t2 - t1) / ITERATIONS);
+    (void)sink;
+    return 0;
+}
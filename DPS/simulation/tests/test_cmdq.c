@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "../cmdq.h"
+
+static LeaderCommand cmd(int platoon, uint64_t id, int turning) {
+    LeaderCommand c = {.command_id = id, .is_turning_event = turning, .platoon_id = platoon};
+    c.leader.speed = (float)id;
+    return c;
+}
+
+/* In order, no coalescing, a full ring drops the newest */
+static void test_fifo(void) {
+    CommandQueue q;
+    assert(cmdq_init(&q, 1, CMDQ_FIFO) == 0);
+    int cap = cmdq_batch_max(&q);
+    assert(cap >= CMD_QUEUE_SIZE && (cap & (cap - 1)) == 0);
+    LeaderCommand out[64];
+    assert(cmdq_try_pop(&q, out, 64) == 0);
+
+    for (int i = 1; i <= cap; i++) {
+        LeaderCommand c = cmd(0, (uint64_t)i, 0);
+        assert(cmdq_push(&q, 0, &c) == 0);
+    }
+    LeaderCommand extra = cmd(0, 999, 0);
+    assert(cmdq_push(&q, 0, &extra) == -1);
+    CmdQueueStats st;
+    cmdq_get_stats(&q, &st);
+    assert(st.pushed == (uint64_t)cap && st.dropped == 1);
+
+    assert(cmdq_try_pop(&q, out, 3) == 3);
+    assert(out[0].command_id == 1 && out[2].command_id == 3);
+    assert(cmdq_try_pop(&q, out, 64) == cap - 3);
+    assert(out[0].command_id == 4 && out[cap - 4].command_id == (uint64_t)cap);
+    assert(cmdq_push(&q, 7, &extra) == -1); /* no such slot */
+    cmdq_destroy(&q);
+    printf("[PASS] fifo\n");
+}
+
+/* Each platoon keeps only its newest state; turns are never coalesced */
+static void test_latest_wins(void) {
+    CommandQueue q;
+    assert(cmdq_init(&q, 3, CMDQ_LATEST_WINS) == 0);
+    LeaderCommand out[128];
+    int max = cmdq_batch_max(&q);
+    assert(max <= 128);
+
+    for (uint64_t id = 1; id <= 50; id++) {
+        LeaderCommand a = cmd(10, id, 0);
+        LeaderCommand b = cmd(12, id, 0);
+        assert(cmdq_push(&q, 0, &a) == 0);
+        assert(cmdq_push(&q, 2, &b) == 0);
+    }
+    int n = cmdq_try_pop(&q, out, max);
+    assert(n == 2);
+    assert(out[0].platoon_id == 10 && out[0].command_id == 50 && out[0].leader.speed == 50.0f);
+    assert(out[1].platoon_id == 12 && out[1].command_id == 50);
+    CmdQueueStats st;
+    cmdq_get_stats(&q, &st);
+    assert(st.replaced == 98 && st.dropped == 0);
+    assert(cmdq_try_pop(&q, out, max) == 0);
+
+    /* State, turn, newer state: all three, in command order */
+    LeaderCommand s1 = cmd(10, 51, 0), turn = cmd(10, 52, 1), s2 = cmd(10, 53, 0);
+    cmdq_push(&q, 0, &s1);
+    cmdq_push(&q, 0, &turn);
+    cmdq_push(&q, 0, &s2);
+    n = cmdq_try_pop(&q, out, max);
+    assert(n == 2);
+    assert(out[0].command_id == 52 && out[0].is_turning_event);
+    assert(out[1].command_id == 53);
+
+    /* A heartbeat does not replace the command it names and follows it out */
+    LeaderCommand named = cmd(10, 54, 0), beat = cmd(10, 54, 0);
+    beat.is_heartbeat = 1;
+    cmdq_push(&q, 0, &named);
+    cmdq_push(&q, 0, &beat);
+    n = cmdq_try_pop(&q, out, max);
+    assert(n == 2 && !out[0].is_heartbeat && out[1].is_heartbeat && out[1].command_id == 54);
+
+    /* A pop that runs out of room leaves the other mailboxes pending */
+    LeaderCommand a = cmd(10, 60, 0), b = cmd(11, 60, 0);
+    cmdq_push(&q, 0, &a);
+    cmdq_push(&q, 1, &b);
+    assert(cmdq_try_pop(&q, out, 1) == 1 && out[0].platoon_id == 10);
+    assert(cmdq_try_pop(&q, out, max) == 1 && out[0].platoon_id == 11);
+    cmdq_destroy(&q);
+    printf("[PASS] latest wins\n");
+}
+
+/* Threaded: the consumer parks while idle and sees every command in order */
+#define STREAM 200000
+
+static CommandQueue stream_q;
+static uint64_t stream_seen, stream_turns, stream_last;
+
+static void pause_us(long us) {
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = us * 1000L};
+    nanosleep(&ts, NULL);
+}
+
+static void* stream_consumer(void* arg) {
+    (void)arg;
+    LeaderCommand out[256];
+    uint64_t last = 0;
+    int n;
+    while ((n = cmdq_pop(&stream_q, out, 256)) > 0) {
+        for (int i = 0; i < n; i++) {
+            assert(out[i].command_id > last);
+            last = out[i].command_id;
+            __atomic_store_n(&stream_last, last, __ATOMIC_RELAXED);
+            __atomic_store_n(&stream_seen, stream_seen + 1, __ATOMIC_RELAXED);
+            if (out[i].is_turning_event) stream_turns++;
+        }
+    }
+    return NULL;
+}
+
+static void test_threads(CmdQueueMode mode) {
+    assert(cmdq_init(&stream_q, 4, mode) == 0);
+    stream_seen = stream_turns = stream_last = 0;
+    pthread_t tid;
+    pthread_create(&tid, NULL, stream_consumer, NULL);
+
+    uint64_t accepted = 0;
+    for (uint64_t id = 1; id <= STREAM; id++) {
+        LeaderCommand c = cmd(0, id, mode == CMDQ_LATEST_WINS && id % 1000 == 0);
+        if (cmdq_push(&stream_q, 0, &c) == 0) accepted++;
+        if (id % 5000 == 0) pause_us(200); /* let the consumer go idle now and then */
+    }
+    /* Wait for the consumer to catch up before closing (the last command is a
+     * turn in latest-wins mode, so it always arrives) */
+    for (int spins = 0; spins < 5000; spins++) {
+        if (mode == CMDQ_FIFO && __atomic_load_n(&stream_seen, __ATOMIC_RELAXED) == accepted) break;
+        if (mode == CMDQ_LATEST_WINS && __atomic_load_n(&stream_last, __ATOMIC_RELAXED) == STREAM) break;
+        pause_us(1000);
+    }
+    cmdq_close(&stream_q);
+    pthread_join(tid, NULL);
+
+    CmdQueueStats st;
+    cmdq_get_stats(&stream_q, &st);
+    if (mode == CMDQ_FIFO) {
+        assert(stream_seen == accepted && accepted + st.dropped == STREAM);
+    } else {
+        /* Every turn arrives; states in between may be overwritten */
+        assert(st.dropped == 0 && stream_turns == STREAM / 1000);
+    }
+    assert(stream_q.parks > 0 && st.wakeups > 0);
+    printf("[PASS] threads (%s): %llu of %d handed out, %llu parks\n",
+           mode == CMDQ_FIFO ? "fifo" : "latest wins",
+           (unsigned long long)stream_seen, STREAM, (unsigned long long)stream_q.parks);
+    cmdq_destroy(&stream_q);
+}
+
+int main(void) {
+    printf("Starting command queue test...\n");
+    test_fifo();
+    test_latest_wins();
+    test_threads(CMDQ_FIFO);
+    test_threads(CMDQ_LATEST_WINS);
+    printf("Command queue test passed\n");
+    return 0;
+}
@@ -0,0 +1,300 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <poll.h>
+
+#include "../event.h"
+
+static EventQueue q;
+
+/* Pops come out highest priority first, FIFO within a type */
+static void test_priority_order(void) {
+    event_queue_init(&q);
+
+    Event tick = {.type = EVT_TICK_UPDATE};
+    Event dist = {.type = EVT_DISTANCE};
+    Event emer = {.type = EVT_EMERGENCY};
+
+    dist.event_data.ft_pos.x = 1.0f;
+    push_event(&q, &tick);
+    push_event(&q, &dist);
+    dist.event_data.ft_pos.x = 2.0f;
+    push_event(&q, &dist);
+    push_event(&q, &emer);
+
+    Event e = pop_event(&q);
+    assert(e.type == EVT_EMERGENCY);
+    e = pop_event(&q);
+    assert(e.type == EVT_DISTANCE && e.event_data.ft_pos.x == 1.0f);
+    e = pop_event(&q);
+    assert(e.type == EVT_DISTANCE && e.event_data.ft_pos.x == 2.0f);
+    e = pop_event(&q);
+    assert(e.type == EVT_TICK_UPDATE);
+    printf("[PASS] priority order\n");
+}
+
+/* pop_events drains several events in one call, still in priority order */
+static void test_batch_drain(void) {
+    event_queue_init(&q);
+
+    for (int i = 0; i < 3; i++) {
+        Event in = {.type = EVT_USER_INPUT};
+        in.event_data.input.key = (char)('a' + i);
+        push_event(&q, &in);
+    }
+    Event cmd = {.type = EVT_CRUISE_CMD};
+    push_event(&q, &cmd);
+
+    Event out[EVENT_BATCH_MAX];
+    int n = pop_events(&q, out, EVENT_BATCH_MAX);
+    assert(n == 4);
+    assert(out[0].type == EVT_CRUISE_CMD);
+    assert(out[1].event_data.input.key == 'a');
+    assert(out[3].event_data.input.key == 'c');
+
+    /* max bounds the batch */
+    for (int i = 0; i < 3; i++) {
+        Event in = {.type = EVT_USER_INPUT};
+        push_event(&q, &in);
+    }
+    n = pop_events(&q, out, 2);
+    assert(n == 2);
+    n = pop_events(&q, out, 2);
+    assert(n == 1);
+    printf("[PASS] batch drain\n");
+}
+
+/* Coalesced types keep only the newest pending event */
+static void test_coalesce(void) {
+    event_queue_init(&q);
+    event_queue_set_coalesce(&q, EVT_DISTANCE, 1);
+
+    for (int i = 1; i <= 100; i++) {
+        Event d = {.type = EVT_DISTANCE};
+        d.event_data.ft_pos.x = (float)i;
+        push_event(&q, &d);
+    }
+    Event tick = {.type = EVT_TICK_UPDATE};
+    push_event(&q, &tick);
+
+    Event out[EVENT_BATCH_MAX];
+    int n = pop_events(&q, out, EVENT_BATCH_MAX);
+    assert(n == 2);
+    assert(out[0].type == EVT_DISTANCE && out[0].event_data.ft_pos.x == 100.0f);
+    assert(out[1].type == EVT_TICK_UPDATE);
+    printf("[PASS] coalesce latest-value-wins\n");
+}
+
+/* Full ring: DROP_NEWEST counts rejects, DROP_OLDEST evicts from the front */
+static void test_overflow_drop(void) {
+    event_queue_init(&q);
+    EventQueueStats st;
+    Event out[EVENT_BATCH_MAX];
+
+    for (int i = 0; i < MAX_EVENTS + 5; i++) {
+        Event in = {.type = EVT_USER_INPUT};
+        in.event_data.input.key = (char)i;
+        push_event(&q, &in);
+    }
+    event_queue_get_stats(&q, EVT_USER_INPUT, &st);
+    assert(st.dropped_newest == 5);
+    assert(pop_event(&q).event_data.input.key == 0);
+    while (try_pop_events(&q, out, EVENT_BATCH_MAX) > 0) {
+    }
+
+    event_queue_init(&q);
+    event_queue_set_overflow(&q, EVT_DISTANCE, EVQ_OVERFLOW_DROP_OLDEST, 0);
+    for (int i = 0; i < MAX_EVENTS + 5; i++) {
+        Event d = {.type = EVT_DISTANCE};
+        d.event_data.ft_pos.x = (float)i;
+        push_event(&q, &d);
+    }
+    event_queue_get_stats(&q, EVT_DISTANCE, &st);
+    assert(st.dropped_oldest == 5 && st.dropped_newest == 0);
+    assert(pop_event(&q).event_data.ft_pos.x == 5.0f);
+    printf("[PASS] overflow drop policies\n");
+}
+
+/* ARENA policy: nothing is shed and FIFO order holds across ring and arena */
+static void test_overflow_arena(void) {
+    event_queue_init(&q);
+    event_queue_set_overflow(&q, EVT_DISTANCE, EVQ_OVERFLOW_ARENA, 0);
+    const int total = MAX_EVENTS * 4;
+
+    for (int i = 0; i < total; i++) {
+        Event e = {.type = EVT_DISTANCE};
+        e.event_data.ft_pos.x = (float)i;
+        push_event(&q, &e);
+    }
+    EventQueueStats st;
+    event_queue_get_stats(&q, EVT_DISTANCE, &st);
+    assert(st.dropped_newest == 0 && st.spilled == (uint64_t)(total - MAX_EVENTS));
+
+    /* Interleave pops with new pushes: order must stay FIFO across ring and arena */
+    int expect = 0, next = total;
+    Event out[EVENT_BATCH_MAX];
+    while (expect < total + 16) {
+        int n = try_pop_events(&q, out, EVENT_BATCH_MAX);
+        for (int i = 0; i < n; i++) {
+            assert(out[i].event_data.ft_pos.x == (float)expect);
+            expect++;
+        }
+        if (next < total + 16) {
+            Event e = {.type = EVT_DISTANCE};
+            e.event_data.ft_pos.x = (float)next++;
+            push_event(&q, &e);
+        }
+    }
+    assert(try_pop_events(&q, out, EVENT_BATCH_MAX) == 0);
+
+    /* EVT_EMERGENCY defaults to the arena */
+    for (int i = 0; i < total; i++) {
+        Event e = {.type = EVT_EMERGENCY};
+        push_event(&q, &e);
+    }
+    event_queue_get_stats(&q, EVT_EMERGENCY, &st);
+    assert(st.dropped_newest == 0 && st.spilled == (uint64_t)(total - MAX_EVENTS));
+    int drained = 0, n_drain;
+    while ((n_drain = try_pop_events(&q, out, EVENT_BATCH_MAX)) > 0) {
+        drained += n_drain;
+    }
+    assert(drained == total);
+    printf("[PASS] overflow arena\n");
+}
+
+/* Pooled payloads (> EVENT_INLINE_BYTES) round-trip, and pool slots are recycled */
+static void test_payload_pool(void) {
+    event_queue_init(&q);
+    assert(sizeof(EventHeader) <= 24);
+
+    Event out[EVENT_BATCH_MAX];
+    for (int round = 0; round < 4 * EVENT_POOL_SIZE; round++) {
+        Event c = {.type = EVT_CRUISE_CMD};
+        c.event_data.leader_cmd.command_id = (uint64_t)round;
+        c.event_data.leader_cmd.leader.speed = (float)(round * 2);
+        c.event_data.leader_cmd.turn_point_x = 1.5f;
+        push_event(&q, &c);
+        assert(pop_events(&q, out, EVENT_BATCH_MAX) == 1);
+        assert(out[0].type == EVT_CRUISE_CMD);
+        assert(out[0].event_data.leader_cmd.command_id == (uint64_t)round);
+        assert(out[0].event_data.leader_cmd.leader.speed == (float)(round * 2));
+        assert(out[0].event_data.leader_cmd.turn_point_x == 1.5f);
+    }
+
+    /* DROP_OLDEST evictions hand their pool slot back */
+    event_queue_set_overflow(&q, EVT_CRUISE_CMD, EVQ_OVERFLOW_DROP_OLDEST, 0);
+    for (int i = 0; i < 4 * EVENT_POOL_SIZE; i++) {
+        Event c = {.type = EVT_CRUISE_CMD};
+        c.event_data.leader_cmd.command_id = (uint64_t)i;
+        push_event(&q, &c);
+    }
+    int n, last = -1, count = 0;
+    while ((n = try_pop_events(&q, out, EVENT_BATCH_MAX)) > 0) {
+        for (int i = 0; i < n; i++) {
+            assert((int)out[i].event_data.leader_cmd.command_id > last);
+            last = (int)out[i].event_data.leader_cmd.command_id;
+            count++;
+        }
+    }
+    assert(count == MAX_EVENTS && last == 4 * EVENT_POOL_SIZE - 1);
+    printf("[PASS] payload pool\n");
+}
+
+/* Histogram percentiles stay within one sub-bucket (~6%) of the true value */
+static void test_latency_hist(void) {
+    static LatencyHist h;
+    lat_hist_reset(&h);
+    for (uint64_t v = 1; v <= 1000; v++) {
+        lat_hist_record(&h, v * 1000); /* 1us .. 1ms */
+    }
+    uint64_t p50 = lat_hist_percentile(&h, 50.0);
+    uint64_t p99 = lat_hist_percentile(&h, 99.0);
+    assert(p50 >= 500000 && p50 <= 500000 + 500000 / 16 + 1);
+    assert(p99 >= 990000 && p99 <= 1000000);
+    assert(lat_hist_percentile(&h, 100.0) == 1000000);
+
+    /* Queue-wait is recorded per type on dequeue */
+    static EventLatency lat;
+    memset(&lat, 0, sizeof(lat));
+    event_queue_init(&q);
+    event_queue_attach_latency(&q, &lat);
+    Event d = {.type = EVT_DISTANCE};
+    push_event(&q, &d);
+    push_event(&q, &d);
+    Event out[EVENT_BATCH_MAX];
+    assert(pop_events(&q, out, EVENT_BATCH_MAX) == 2);
+    assert(out[0].enqueue_ns != 0);
+    assert(lat.wait[EVT_DISTANCE].total == 2);
+    assert(lat.wait[EVT_TICK_UPDATE].total == 0);
+    event_latency_record_service(&lat, EVT_DISTANCE, 1234);
+    assert(lat.service[EVT_DISTANCE].total == 1);
+    printf("[PASS] latency histograms\n");
+}
+
+/* A consumer parked in pop_event is woken by a push from another thread */
+static void* late_producer(void* arg) {
+    (void)arg;
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = 50 * 1000 * 1000};
+    nanosleep(&ts, NULL);
+    Event e = {.type = EVT_SHUTDOWN};
+    push_event(&q, &e);
+    return NULL;
+}
+
+static void test_wakeup(void) {
+    event_queue_init(&q);
+    pthread_t tid;
+    pthread_create(&tid, NULL, late_producer, NULL);
+    Event e = pop_event(&q);
+    assert(e.type == EVT_SHUTDOWN);
+    pthread_join(tid, NULL);
+    printf("[PASS] parked consumer wakeup\n");
+}
+
+/* EVENT_QUEUE_EVENTFD: a consumer blocked in poll() on the queue fd is woken by a push */
+static void test_eventfd_mode(void) {
+    assert(event_queue_init_ex(&q, EVENT_QUEUE_EVENTFD) == 0);
+    int fd = event_queue_fd(&q);
+    assert(fd >= 0);
+
+    pthread_t tid;
+    pthread_create(&tid, NULL, late_producer, NULL);
+
+    Event out[EVENT_BATCH_MAX];
+    int n = 0;
+    while (n == 0) {
+        int timeout = event_queue_prepare_wait(&q) ? 2000 : 0;
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        int ready = poll(&pfd, 1, timeout);
+        assert(ready >= 0);
+        event_queue_finish_wait(&q, ready > 0 && (pfd.revents & POLLIN));
+        n = try_pop_events(&q, out, EVENT_BATCH_MAX);
+    }
+    assert(n == 1 && out[0].type == EVT_SHUTDOWN);
+    pthread_join(tid, NULL);
+
+    /* Nothing pending: the consumer may block */
+    assert(try_pop_events(&q, out, EVENT_BATCH_MAX) == 0);
+    assert(event_queue_prepare_wait(&q) == 1);
+    event_queue_finish_wait(&q, 0);
+    close(fd);
+    printf("[PASS] eventfd mode\n");
+}
+
+int main(void) {
+    printf("Starting event queue test...\n");
+    test_priority_order();
+    test_batch_drain();
+    test_coalesce();
+    test_overflow_drop();
+    test_overflow_arena();
+    test_payload_pool();
+    test_latency_hist();
+    test_wakeup();
+    test_eventfd_mode();
+    printf("Event queue test passed\n");
+    return 0;
+}
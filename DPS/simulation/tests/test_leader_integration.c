@@ -2,40 +2,56 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <errno.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <pthread.h>
+#include <time.h>
 
 #include "../event.h"
-
-/* Externs from leader.c */
-extern EventQueue leader_EventQ;
-extern void register_new_follower(int fd, FollowerRegisterMsg* reg_msg);
-extern void* follower_message_receiver(void* arg);
-extern MatrixClock leader_clock;
-extern Truck leader;
-extern pthread_mutex_t mutex_leader_state;
+#include "../tpframe.h"
+#include "../tpwire.h"
+#include "../leader.h"
 
 /* We need to include the actual definitions used in messages */
 #include "../truckplatoon.h"
 
-/* helper to read LD_MESSAGE */
+/* helper to read one framed, wire-encoded LD_MESSAGE; 0 on success.
+ * Clocks arrive as deltas, so each connection keeps its own base. */
+static MatrixClock clock_rx[64];
+
 ssize_t read_ld_message(int fd, LD_MESSAGE* out) {
-    return recv(fd, out, sizeof(*out), MSG_WAITALL);
+    unsigned char hdr[TPFRAME_HDR];
+    unsigned char wire[TPWIRE_MAX];
+    if (recv(fd, hdr, sizeof(hdr), MSG_WAITALL) != (ssize_t)sizeof(hdr)) return -1;
+    size_t len = ((size_t)hdr[0] << 24) | ((size_t)hdr[1] << 16) | ((size_t)hdr[2] << 8) | hdr[3];
+    if (len > sizeof(wire)) return -1;
+    if (recv(fd, wire, len, MSG_WAITALL) != (ssize_t)len) return -1;
+    return tpwire_decode_ld_delta(wire, len, &clock_rx[fd], out);
 }
 
-int main(void) {
-    printf("Starting leader integration test...\n");
+static void sleep_ms(long ms) {
+    struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
 
-    /* Initialize event queue */
-    event_queue_init(&leader_EventQ);
+/* Nothing further was sent to fd */
+static void assert_quiet(int fd) {
+    char b;
+    assert(recv(fd, &b, 1, MSG_DONTWAIT) == -1 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
 
-    /* Initialize leader matrix clock (opaque) */
-    mc_init(&leader_clock);
+int main(void) {
+    printf("Starting leader integration test...\n");
 
-    /* Initialize leader state for spawn computations */
-    leader = (Truck){.x = 0.0f, .y = 0.0f, .speed = 0.0f, .dir = NORTH, .state = STOPPED};
-    pthread_mutex_init(&mutex_leader_state, NULL);
+    /* Two platoons on two shards; the sequence below runs on platoon 0 */
+    assert(leader_server_init(2, 2) == 0);
+    assert(leader_shard_count() == 2);
+    Platoon* p = leader_platoon(0);
+    Platoon* p1 = leader_platoon(1);
+    assert(p && p1 && p->shard != p1->shard);
+    assert(leader_platoon(2) == NULL);
+    EventQueue* events = &p->shard->events;
 
     /* We'll create 4 socketpairs to simulate followers (test reconfiguration on disconnect) */
     const int N = 4;
@@ -56,13 +72,15 @@ int main(void) {
 
     LD_MESSAGE msg0;
     ssize_t r = read_ld_message(sv[0][1], &msg0);
-    assert(r == sizeof(msg0));
+    assert(r == 0);
     assert(msg0.type == MSG_LDR_ASSIGN_ID);
     assert(msg0.payload.assigned_id == 1);
+    uint64_t token0 = msg0.session_token;
+    assert(token0 != 0);
 
     /* Spawn message follows */
     r = read_ld_message(sv[0][1], &msg0);
-    assert(r == sizeof(msg0));
+    assert(r == 0);
     assert(msg0.type == MSG_LDR_SPAWN);
     assert(msg0.payload.spawn.assigned_id == 1);
 
@@ -75,12 +93,14 @@ int main(void) {
 
     LD_MESSAGE msg1;
     r = read_ld_message(sv[1][1], &msg1);
-    assert(r == sizeof(msg1));
+    assert(r == 0);
     assert(msg1.type == MSG_LDR_ASSIGN_ID);
     assert(msg1.payload.assigned_id == 2);
+    uint64_t token1 = msg1.session_token;
+    assert(token1 != 0 && token1 != token0);
 
     r = read_ld_message(sv[1][1], &msg1);
-    assert(r == sizeof(msg1));
+    assert(r == 0);
     assert(msg1.type == MSG_LDR_SPAWN);
     assert(msg1.payload.spawn.assigned_id == 2);
 
@@ -93,55 +113,37 @@ int main(void) {
 
     LD_MESSAGE msg2;
     r = read_ld_message(sv[2][1], &msg2);
-    assert(r == sizeof(msg2));
+    assert(r == 0);
     assert(msg2.type == MSG_LDR_ASSIGN_ID);
     assert(msg2.payload.assigned_id == 3);
 
     r = read_ld_message(sv[2][1], &msg2);
-    assert(r == sizeof(msg2));
+    assert(r == 0);
     assert(msg2.type == MSG_LDR_SPAWN);
     assert(msg2.payload.spawn.assigned_id == 3);
 
     /* Pop the formation event */
-    Event formed_ev = pop_event(&leader_EventQ);
+    Event formed_ev = pop_event(events);
     assert(formed_ev.type == EVT_PLATOON_FORMED);
 
-    /* Finalize topology and verify each follower receives update */
-    extern void finalize_topology(void);
-    finalize_topology();
+    /* Finalize topology: positions already match the join order, so only the
+     * first two followers hear about a rear neighbour */
+    assert(finalize_topology(p) == 2);
 
-    /* finalize_topology broadcasts fresh IDs first */
     r = read_ld_message(sv[0][1], &msg0);
-    assert(r == sizeof(msg0));
-    assert(msg0.type == MSG_LDR_ASSIGN_ID);
-    assert(msg0.payload.assigned_id == 1);
-
-    r = read_ld_message(sv[0][1], &msg0);
-    assert(r == sizeof(msg0));
+    assert(r == 0);
     assert(msg0.type == MSG_LDR_UPDATE_REAR);
+    assert(msg0.topo_epoch == 1);
     assert(msg0.payload.rearInfo.has_rearTruck == 1);
     assert(msg0.payload.rearInfo.rearTruck_Address.udp_port == 5002);
 
     r = read_ld_message(sv[1][1], &msg1);
-    assert(r == sizeof(msg1));
-    assert(msg1.type == MSG_LDR_ASSIGN_ID);
-    assert(msg1.payload.assigned_id == 2);
-
-    r = read_ld_message(sv[1][1], &msg1);
-    assert(r == sizeof(msg1));
+    assert(r == 0);
     assert(msg1.type == MSG_LDR_UPDATE_REAR);
     assert(msg1.payload.rearInfo.has_rearTruck == 1);
     assert(msg1.payload.rearInfo.rearTruck_Address.udp_port == 5003);
 
-    r = read_ld_message(sv[2][1], &msg2);
-    assert(r == sizeof(msg2));
-    assert(msg2.type == MSG_LDR_ASSIGN_ID);
-    assert(msg2.payload.assigned_id == 3);
-
-    r = read_ld_message(sv[2][1], &msg2);
-    assert(r == sizeof(msg2));
-    assert(msg2.type == MSG_LDR_UPDATE_REAR);
-    assert(msg2.payload.rearInfo.has_rearTruck == 0);
+    assert_quiet(sv[2][1]);
 
     /* Register a 4th follower and expect topology re-finalization */
     FollowerRegisterMsg reg3 = {0};
@@ -151,113 +153,128 @@ int main(void) {
     register_new_follower(sv[3][0], &reg3);
     LD_MESSAGE msg3;
     r = read_ld_message(sv[3][1], &msg3);
-    assert(r == sizeof(msg3));
+    assert(r == 0);
     assert(msg3.type == MSG_LDR_ASSIGN_ID);
     assert(msg3.payload.assigned_id == 4);
+    assert(msg3.topo_epoch == 1);
 
     r = read_ld_message(sv[3][1], &msg3);
-    assert(r == sizeof(msg3));
+    assert(r == 0);
     assert(msg3.type == MSG_LDR_SPAWN);
     assert(msg3.payload.spawn.assigned_id == 4);
 
     /* Since formation is already complete, register_new_follower should push EVT_PLATOON_FORMED -- pop it */
-    Event reformed = pop_event(&leader_EventQ);
+    Event reformed = pop_event(events);
     assert(reformed.type == EVT_PLATOON_FORMED);
 
-    /* Re-finalize topology to include the 4th follower */
-    finalize_topology();
-
-    /* IDs first */
-    r = read_ld_message(sv[0][1], &msg0);
-    assert(r == sizeof(msg0));
-    assert(msg0.type == MSG_LDR_ASSIGN_ID);
-    assert(msg0.payload.assigned_id == 1);
-
-    r = read_ld_message(sv[0][1], &msg0);
-    assert(r == sizeof(msg0));
-    assert(msg0.type == MSG_LDR_UPDATE_REAR);
-    assert(msg0.payload.rearInfo.has_rearTruck == 1);
-    assert(msg0.payload.rearInfo.rearTruck_Address.udp_port == 5002);
-
-    r = read_ld_message(sv[1][1], &msg1);
-    assert(r == sizeof(msg1));
-    assert(msg1.type == MSG_LDR_ASSIGN_ID);
-    assert(msg1.payload.assigned_id == 2);
-
-    r = read_ld_message(sv[1][1], &msg1);
-    assert(r == sizeof(msg1));
-    assert(msg1.type == MSG_LDR_UPDATE_REAR);
-    assert(msg1.payload.rearInfo.has_rearTruck == 1);
-    assert(msg1.payload.rearInfo.rearTruck_Address.udp_port == 5003);
+    /* A join at the back only changes the old last truck's rear neighbour */
+    assert(finalize_topology(p) == 1);
 
     r = read_ld_message(sv[2][1], &msg2);
-    assert(r == sizeof(msg2));
-    assert(msg2.type == MSG_LDR_ASSIGN_ID);
-    assert(msg2.payload.assigned_id == 3);
-
-    r = read_ld_message(sv[2][1], &msg2);
-    assert(r == sizeof(msg2));
+    assert(r == 0);
     assert(msg2.type == MSG_LDR_UPDATE_REAR);
+    assert(msg2.topo_epoch == 2);
     assert(msg2.payload.rearInfo.has_rearTruck == 1);
     assert(msg2.payload.rearInfo.rearTruck_Address.udp_port == 5004);
 
-    r = read_ld_message(sv[3][1], &msg3);
-    assert(r == sizeof(msg3));
-    assert(msg3.type == MSG_LDR_ASSIGN_ID);
-    assert(msg3.payload.assigned_id == 4);
-
-    r = read_ld_message(sv[3][1], &msg3);
-    assert(r == sizeof(msg3));
-    assert(msg3.type == MSG_LDR_UPDATE_REAR);
-    assert(msg3.payload.rearInfo.has_rearTruck == 0);
+    assert_quiet(sv[0][1]);
+    assert_quiet(sv[1][1]);
+    assert_quiet(sv[3][1]);
 
-    /* Start the receiver thread */
+    /* Start the reactor thread (follower sockets were added by register_new_follower) */
     pthread_t recv_tid;
-    pthread_create(&recv_tid, NULL, follower_message_receiver, NULL);
-
-    /* Now simulate a disconnect of follower 2 (middle one) and expect re-finalization */
-    close(sv[1][1]); /* follower side closes */
+    pthread_create(&recv_tid, NULL, leader_reactor, p->shard);
+
+    /* Follower 2's link drops: its slot is held for a resume, nothing reforms */
+    close(sv[1][1]);
+    int held = 0;
+    for (int tries = 0; tries < 2000 && !held; tries++) {
+        pthread_mutex_lock(&p->mutex_followers);
+        held = p->held_count;
+        pthread_mutex_unlock(&p->mutex_followers);
+        if (!held) sleep_ms(1);
+    }
+    assert(held == 1);
+    Event none;
+    assert(try_pop_events(events, &none, 1) == 0);
+    assert(p->active_follower_count == 4);
+
+    /* Commands while it is away: the others get them at once */
+    LD_MESSAGE turn = {0}, cmd = {0};
+    turn.type = cmd.type = MSG_LDR_CMD;
+    turn.payload.cmd.command_id = 7;
+    turn.payload.cmd.is_turning_event = 1;
+    cmd.payload.cmd.command_id = 8;
+    broadcast_to_followers(p, &turn, sizeof(turn));
+    broadcast_to_followers(p, &cmd, sizeof(cmd));
+    int live[] = {0, 2, 3};
+    for (int i = 0; i < 3; i++) {
+        LD_MESSAGE m;
+        assert(read_ld_message(sv[live[i]][1], &m) == 0 && m.payload.cmd.command_id == 7);
+        assert(read_ld_message(sv[live[i]][1], &m) == 0 && m.payload.cmd.command_id == 8);
+    }
 
-    /* Pop the EVT_PLATOON_FORMED event emitted by the receiver after handling disconnect */
-    Event disconnect_ev = pop_event(&leader_EventQ);
+    /* It comes back on a new connection with a stale epoch: same position and
+     * token, the rear neighbour it missed, then the turn and the newest command */
+    int rs[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, rs) == 0);
+    FollowerRegisterMsg resume = reg1;
+    resume.resume_token = token1;
+    resume.topo_epoch = 1;
+    resume.last_cmd_id = 0;
+    register_new_follower(rs[0], &resume);
+
+    LD_MESSAGE rm;
+    assert(read_ld_message(rs[1], &rm) == 0);
+    assert(rm.type == MSG_LDR_ASSIGN_ID);
+    assert(rm.payload.assigned_id == 2 && rm.session_token == token1 && rm.topo_epoch == 2);
+    assert(read_ld_message(rs[1], &rm) == 0);
+    assert(rm.type == MSG_LDR_UPDATE_REAR && rm.topo_epoch == 2);
+    assert(rm.payload.rearInfo.rearTruck_Address.udp_port == 5003);
+    assert(read_ld_message(rs[1], &rm) == 0);
+    assert(rm.type == MSG_LDR_CMD && rm.payload.cmd.command_id == 7 && rm.payload.cmd.is_turning_event);
+    assert(read_ld_message(rs[1], &rm) == 0);
+    assert(rm.type == MSG_LDR_CMD && rm.payload.cmd.command_id == 8);
+    assert_quiet(rs[1]);
+    assert(p->held_count == 0 && p->active_follower_count == 4);
+    assert(try_pop_events(events, &none, 1) == 0);
+    for (int i = 0; i < 3; i++) assert_quiet(sv[live[i]][1]);
+
+    /* Now it drops for good: once the window passes the platoon re-finalizes */
+    leader_set_resume_ms(50);
+    close(rs[1]);
+
+    /* Pop the EVT_PLATOON_FORMED event emitted by the reactor after handling disconnect */
+    Event disconnect_ev = pop_event(events);
     assert(disconnect_ev.type == EVT_PLATOON_FORMED);
 
-    /* Re-finalize topology */
-    finalize_topology();
-
-    /* IDs first: follower 3 becomes position 2, follower 4 becomes position 3 */
-    r = read_ld_message(sv[0][1], &msg0);
-    assert(r == sizeof(msg0));
-    assert(msg0.type == MSG_LDR_ASSIGN_ID);
-    assert(msg0.payload.assigned_id == 1);
+    /* The truck in front gets a new rear neighbour, the ones behind move up a position */
+    assert(finalize_topology(p) == 3);
 
-    /* Verify updated topology for remaining followers (1 -> 3, 3 -> 4, 4 -> none) */
     r = read_ld_message(sv[0][1], &msg0);
-    assert(r == sizeof(msg0));
+    assert(r == 0);
     assert(msg0.type == MSG_LDR_UPDATE_REAR);
+    assert(msg0.topo_epoch == 3);
     assert(msg0.payload.rearInfo.has_rearTruck == 1);
     assert(msg0.payload.rearInfo.rearTruck_Address.udp_port == 5003);
 
     r = read_ld_message(sv[2][1], &msg2);
-    assert(r == sizeof(msg2));
+    assert(r == 0);
     assert(msg2.type == MSG_LDR_ASSIGN_ID);
+    assert(msg2.topo_epoch == 3);
     assert(msg2.payload.assigned_id == 2);
 
-    r = read_ld_message(sv[2][1], &msg2);
-    assert(r == sizeof(msg2));
-    assert(msg2.type == MSG_LDR_UPDATE_REAR);
-    assert(msg2.payload.rearInfo.has_rearTruck == 1);
-    assert(msg2.payload.rearInfo.rearTruck_Address.udp_port == 5004);
-
     r = read_ld_message(sv[3][1], &msg3);
-    assert(r == sizeof(msg3));
+    assert(r == 0);
     assert(msg3.type == MSG_LDR_ASSIGN_ID);
     assert(msg3.payload.assigned_id == 3);
 
-    r = read_ld_message(sv[3][1], &msg3);
-    assert(r == sizeof(msg3));
-    assert(msg3.type == MSG_LDR_UPDATE_REAR);
-    assert(msg3.payload.rearInfo.has_rearTruck == 0);
+    assert_quiet(sv[0][1]);
+    assert_quiet(sv[2][1]);
+    assert_quiet(sv[3][1]);
+
+    /* Nothing changed: nobody is told anything */
+    assert(finalize_topology(p) == 0);
 
     /* Receiver is already running; send an intruder report from follower 1 (sv[0][1]) */
     FT_MESSAGE fmsg = {0};
@@ -265,16 +282,115 @@ int main(void) {
     fmsg.payload.intruder.speed = 42;
     fmsg.payload.intruder.length = 5;
 
-    send(sv[0][1], &fmsg, sizeof(fmsg), 0);
+    unsigned char wire[TPWIRE_MAX];
+    size_t wire_len = tpwire_encode_ft(&fmsg, wire, sizeof(wire));
+    assert(wire_len > 0);
+    assert(tpframe_send(sv[0][1], wire, wire_len) == 0);
 
     /* Pop event from leader event queue */
-    Event ev = pop_event(&leader_EventQ);
+    Event ev = pop_event(events);
     assert(ev.type == EVT_FOLLOWER_MSG);
     assert(ev.event_data.follower_msg.msg.type == MSG_FT_INTRUDER_REPORT);
     assert(ev.event_data.follower_msg.msg.payload.intruder.speed == 42);
+    assert(ev.event_data.follower_msg.platoon_id == 0);
+
+    /* A join for platoon 1 starts that platoon's numbering and leaves platoon 0 alone */
+    int other[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, other) == 0);
+    FollowerRegisterMsg reg_other = {0};
+    strncpy(reg_other.selfAddress.ip, "127.0.0.1", sizeof(reg_other.selfAddress.ip));
+    reg_other.selfAddress.udp_port = 5101;
+    reg_other.platoon_id = 1;
+    register_new_follower(other[0], &reg_other);
+
+    LD_MESSAGE omsg;
+    assert(read_ld_message(other[1], &omsg) == 0);
+    assert(omsg.type == MSG_LDR_ASSIGN_ID);
+    assert(omsg.payload.assigned_id == 1);
+    assert(read_ld_message(other[1], &omsg) == 0);
+    assert(omsg.type == MSG_LDR_SPAWN);
+    assert(omsg.payload.spawn.assigned_id == 1);
+    assert(p1->active_follower_count == 1);
+    assert(p->active_follower_count == 3);
+
+    /* A join for a platoon this leader does not host is closed */
+    int stray[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, stray) == 0);
+    FollowerRegisterMsg reg_stray = reg_other;
+    reg_stray.platoon_id = 5;
+    register_new_follower(stray[0], &reg_stray);
+    char b;
+    assert(recv(stray[1], &b, 1, 0) == 0);
+    close(stray[1]);
+
+    /* Send-on-change: after a full command, a straight run at constant speed
+     * only needs heartbeats until the refresh interval */
+    leader_set_send_on_change(1);
+    LeaderCommand c = {.command_id = 1, .platoon_id = 1};
+    c.leader = (Truck){.x = 0.0f, .y = 0.0f, .speed = 10.0f, .dir = NORTH, .state = CRUISE};
+    assert(leader_emit_decide(p1, &c, LEADER_TICK_DT) == LEADER_EMIT_COMMAND);
+    int ticks_to_refresh = (int)(LEADER_CMD_REFRESH_MS / (LEADER_TICK_DT * 1000.0f));
+    int per_beat = (int)(LEADER_HEARTBEAT_MS / (LEADER_TICK_DT * 1000.0f));
+    int full = 0, beats = 0;
+    for (int t = 1; t < ticks_to_refresh; t++) {
+        c.command_id++;
+        move_truck(&c.leader, LEADER_TICK_DT);
+        LeaderEmit e = leader_emit_decide(p1, &c, LEADER_TICK_DT);
+        if (e == LEADER_EMIT_COMMAND) full++;
+        if (e == LEADER_EMIT_HEARTBEAT) beats++;
+    }
+    assert(full == 0 && beats == (ticks_to_refresh - 1) / per_beat);
+    move_truck(&c.leader, LEADER_TICK_DT);
+    assert(leader_emit_decide(p1, &c, LEADER_TICK_DT) == LEADER_EMIT_COMMAND); /* refresh */
+
+    /* Speed, turns and drift beyond the threshold go out at once */
+    move_truck(&c.leader, LEADER_TICK_DT);
+    assert(leader_emit_decide(p1, &c, LEADER_TICK_DT) == LEADER_EMIT_NONE);
+    c.leader.speed = 12.0f;
+    assert(leader_emit_decide(p1, &c, LEADER_TICK_DT) == LEADER_EMIT_COMMAND);
+    c.is_turning_event = 1;
+    assert(leader_emit_decide(p1, &c, LEADER_TICK_DT) == LEADER_EMIT_COMMAND);
+    c.is_turning_event = 0;
+    move_truck(&c.leader, LEADER_TICK_DT);
+    assert(leader_emit_decide(p1, &c, LEADER_TICK_DT) == LEADER_EMIT_NONE);
+    c.leader.x += 2.0f * LEADER_DR_THRESHOLD;
+    assert(leader_emit_decide(p1, &c, LEADER_TICK_DT) == LEADER_EMIT_COMMAND);
+
+    /* A reformation makes the next tick a full command for the joiners */
+    assert(leader_emit_decide(p1, &c, 0.0f) == LEADER_EMIT_NONE);
+    assert(finalize_topology(p1) == 0);
+    assert(leader_emit_decide(p1, &c, 0.0f) == LEADER_EMIT_COMMAND);
+    assert_quiet(other[1]);
+
+    /* Default mode: every tick is a full command */
+    leader_set_send_on_change(0);
+    assert(leader_emit_decide(p1, &c, 0.0f) == LEADER_EMIT_COMMAND);
+
+    /* An unknown token joins as a new follower */
+    int late[2];
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, late) == 0);
+    FollowerRegisterMsg reg_late = reg_other;
+    reg_late.selfAddress.udp_port = 5102;
+    reg_late.resume_token = token0 ^ token1;
+    register_new_follower(late[0], &reg_late);
+    assert(read_ld_message(late[1], &omsg) == 0);
+    assert(omsg.type == MSG_LDR_ASSIGN_ID && omsg.payload.assigned_id == 2);
+    assert(omsg.session_token != 0 && omsg.session_token != reg_late.resume_token);
+    assert(p1->active_follower_count == 2);
+
+    /* A resume while the old link is still open: the new one is refused and
+     * the old one shut down, so the follower's next attempt finds it held */
+    uint64_t late_token = omsg.session_token;
+    assert(read_ld_message(late[1], &omsg) == 0 && omsg.type == MSG_LDR_SPAWN);
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, stray) == 0);
+    reg_late.resume_token = late_token;
+    register_new_follower(stray[0], &reg_late);
+    assert(recv(stray[1], &b, 1, 0) == 0);
+    assert(recv(late[1], &b, 1, 0) == 0);
+    close(stray[1]);
 
     /* Clean up
-       Cancel receiver thread (select is a cancellation point) */
+       Cancel reactor thread (tpio_wait is a cancellation point) */
     pthread_cancel(recv_tid);
     pthread_join(recv_tid, NULL);
 
@@ -282,6 +398,10 @@ int main(void) {
         close(sv[i][0]);
         close(sv[i][1]);
     }
+    close(other[0]);
+    close(other[1]);
+    close(late[0]);
+    close(late[1]);
 
     printf("Leader integration test passed \n");
     return 0;
@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+
+#include "../outq.h"
+
+/* 100-byte test message: tag + sequence number */
+typedef struct {
+    char tag;            // 'c' = command (droppable), 'h' = heartbeat (replaceable), 'x' = control
+    int seq;
+    char pad[92];
+} TestMsg;
+
+static int sv[2];
+
+static void open_pair(void) {
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    int small = 4096;
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+    fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+}
+
+static void close_pair(void) {
+    close(sv[0]);
+    close(sv[1]);
+}
+
+/* Read every whole message currently readable (partial writes are reassembled) */
+static unsigned char rxbuf[sizeof(TestMsg)];
+static size_t rxlen = 0;
+
+static int drain(TestMsg* out, int max) {
+    int n = 0;
+    while (n < max) {
+        ssize_t r = recv(sv[1], rxbuf + rxlen, sizeof(rxbuf) - rxlen, 0);
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        assert(r > 0);
+        rxlen += (size_t)r;
+        if (rxlen == sizeof(TestMsg)) {
+            memcpy(&out[n++], rxbuf, sizeof(TestMsg));
+            rxlen = 0;
+        }
+    }
+    return n;
+}
+
+/* Fill the socket until outq_send starts queueing */
+static int fill_socket(OutQueue* q, int* seq) {
+    for (;;) {
+        TestMsg m = {.tag = 'c', .seq = (*seq)++};
+        int rc = outq_send(q, sv[0], &m, sizeof(m), OUTQ_DROP_OLDEST);
+        assert(rc >= 0);
+        if (rc == 0) return *seq - 1;
+    }
+}
+
+/* With a free socket, messages go straight out and nothing is queued */
+static void test_direct(void) {
+    OutQueue q;
+    open_pair();
+    assert(outq_init(&q) == 0);
+
+    TestMsg m = {.tag = 'x', .seq = 7};
+    assert(outq_send(&q, sv[0], &m, sizeof(m), OUTQ_NEVER_DROP) == 1);
+    assert(q.count == 0 && q.sent == 1);
+
+    TestMsg got[4];
+    assert(drain(got, 4) == 1 && got[0].seq == 7);
+    outq_free(&q);
+    close_pair();
+    printf("[PASS] direct send\n");
+}
+
+/* Pushed messages leave in one gathered write, in order */
+static void test_batch(void) {
+    OutQueue q;
+    open_pair();
+    assert(outq_init(&q) == 0);
+
+    for (int i = 0; i < 5; i++) {
+        TestMsg m = {.tag = i ? 'c' : 'x', .seq = i};
+        assert(outq_push(&q, &m, sizeof(m), i ? OUTQ_DROP_OLDEST : OUTQ_NEVER_DROP) == 0);
+    }
+    assert(q.count == 5 && q.writes == 0);
+    assert(outq_flush(&q, sv[0]) == 1);
+    assert(q.count == 0 && q.sent == 5 && q.writes == 1);
+
+    TestMsg got[8];
+    assert(drain(got, 8) == 5);
+    for (int i = 0; i < 5; i++) assert(got[i].seq == i);
+    outq_free(&q);
+    close_pair();
+    printf("[PASS] batched flush\n");
+}
+
+/* Stalled peer: commands are shed oldest-first, control messages are kept,
+ * and the stream stays in order once the peer reads again */
+static void test_backpressure(void) {
+    OutQueue q;
+    open_pair();
+    assert(outq_init(&q) == 0);
+
+    int seq = 0;
+    fill_socket(&q, &seq);
+
+    /* Interleave: 3 control messages among 40 more commands */
+    for (int i = 0; i < 40; i++) {
+        TestMsg c = {.tag = 'c', .seq = seq++};
+        assert(outq_send(&q, sv[0], &c, sizeof(c), OUTQ_DROP_OLDEST) == 0);
+        if (i % 15 == 0) {
+            TestMsg x = {.tag = 'x', .seq = 1000 + i};
+            assert(outq_send(&q, sv[0], &x, sizeof(x), OUTQ_NEVER_DROP) == 0);
+        }
+    }
+    /* Commands are bounded; the control messages ride on top of that bound */
+    assert(q.count >= OUTQ_SOFT_LIMIT && q.count <= OUTQ_SOFT_LIMIT + 3);
+    assert(q.dropped > 0);
+    int last_cmd = seq - 1;
+
+    /* Peer catches up */
+    static TestMsg got[2048];
+    int total = 0;
+    for (int round = 0; round < 1000; round++) {
+        total += drain(got + total, 2048 - total);
+        int rc = outq_flush(&q, sv[0]);
+        assert(rc >= 0);
+        if (rc == 1) break;
+    }
+    total += drain(got + total, 2048 - total);
+    assert(q.count == 0 && rxlen == 0);
+
+    int controls = 0, prev_cmd = -1, saw_last = 0;
+    for (int i = 0; i < total; i++) {
+        if (got[i].tag == 'x') {
+            controls++;
+            continue;
+        }
+        assert(got[i].seq > prev_cmd);
+        prev_cmd = got[i].seq;
+        if (got[i].seq == last_cmd) saw_last = 1;
+    }
+    assert(controls == 3);
+    assert(saw_last);
+    assert((uint64_t)total == q.sent);
+    outq_free(&q);
+    close_pair();
+    printf("[PASS] backpressure drop-oldest\n");
+}
+
+/* Stalled peer on a straight run: heartbeats replace each other, so they
+ * never pile up and the next full command still goes out */
+static void test_heartbeats(void) {
+    OutQueue q;
+    open_pair();
+    assert(outq_init(&q) == 0);
+
+    int seq = 0;
+    int last_fill = fill_socket(&q, &seq);
+    uint32_t queued = q.count;
+    for (int i = 0; i < 4 * OUTQ_SOFT_LIMIT; i++) {
+        TestMsg h = {.tag = 'h', .seq = 2000 + i};
+        assert(outq_send(&q, sv[0], &h, sizeof(h), OUTQ_REPLACE) == 0);
+    }
+    assert(q.count == queued + 1);
+    TestMsg c = {.tag = 'c', .seq = 3000};
+    assert(outq_send(&q, sv[0], &c, sizeof(c), OUTQ_DROP_OLDEST) == 0);
+    assert(q.count == queued + 2);
+
+    static TestMsg got[2048];
+    int total = 0;
+    for (int round = 0; round < 1000; round++) {
+        total += drain(got + total, 2048 - total);
+        int rc = outq_flush(&q, sv[0]);
+        assert(rc >= 0);
+        if (rc == 1) break;
+    }
+    total += drain(got + total, 2048 - total);
+    assert(q.count == 0 && rxlen == 0);
+
+    /* Everything up to the fill, the newest heartbeat, then the command */
+    assert(total == last_fill + 3);
+    assert(got[total - 2].tag == 'h' && got[total - 2].seq == 2000 + 4 * OUTQ_SOFT_LIMIT - 1);
+    assert(got[total - 1].tag == 'c' && got[total - 1].seq == 3000);
+    outq_free(&q);
+    close_pair();
+    printf("[PASS] heartbeats replace each other\n");
+}
+
+/* Control messages grow the ring up to the hard limit, then report failure */
+static void test_hard_limit(void) {
+    OutQueue q;
+    open_pair();
+    assert(outq_init(&q) == 0);
+
+    int seq = 0;
+    fill_socket(&q, &seq);
+
+    TestMsg x = {.tag = 'x'};
+    int rc = 0, pushed = 0;
+    while ((rc = outq_send(&q, sv[0], &x, sizeof(x), OUTQ_NEVER_DROP)) == 0) {
+        pushed++;
+    }
+    assert(rc == -1);
+    assert(q.count == OUTQ_HARD_LIMIT && q.dropped == 0);
+    assert(pushed >= OUTQ_HARD_LIMIT - 1);
+
+    /* Oversized messages are refused outright */
+    static unsigned char big[OUTQ_MSG_MAX + 1];
+    assert(outq_push(&q, big, sizeof(big), OUTQ_NEVER_DROP) == -1);
+
+    /* A reset (the connection is gone) empties the ring and leaves it usable */
+    outq_reset(&q);
+    assert(q.count == 0 && q.dropped == OUTQ_HARD_LIMIT);
+    assert(outq_push(&q, &x, sizeof(x), OUTQ_NEVER_DROP) == 0 && q.count == 1);
+    outq_free(&q);
+    close_pair();
+    printf("[PASS] hard limit\n");
+}
+
+int main(void) {
+    printf("Starting outbound queue test...\n");
+    test_direct();
+    test_batch();
+    test_backpressure();
+    test_heartbeats();
+    test_hard_limit();
+    printf("Outbound queue test passed\n");
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+#include "../session_table.h"
+
+/* Platoon order as fds, front first; returns the count */
+static int order(const SessionTable* t, int* fds, int max) {
+    int n = 0;
+    const FollowerSession* prev = NULL;
+    for (FollowerSession* s = t->head; s; s = s->next) {
+        assert(s->prev == prev);
+        assert(n < max);
+        fds[n++] = s->fd;
+        prev = s;
+    }
+    assert(t->tail == prev);
+    return n;
+}
+
+/* Every session is in dense exactly once, at its own slot, and findable by fd (if it has one) */
+static void check_index(const SessionTable* t) {
+    for (int i = 0; i < t->count; i++) {
+        assert(t->dense[i]->slot == i);
+        if (t->dense[i]->fd >= 0) assert(session_table_find(t, t->dense[i]->fd) == t->dense[i]);
+    }
+}
+
+/* Joins append, leaves unlink from anywhere, lookups follow swap-removal */
+static void test_join_leave(void) {
+    SessionTable t = {0};
+    int fds[8];
+    assert(session_table_find(&t, 3) == NULL);
+
+    for (int fd = 3; fd < 8; fd++) assert(session_table_add(&t, fd) != NULL);
+    assert(t.count == 5);
+    assert(order(&t, fds, 8) == 5);
+    for (int i = 0; i < 5; i++) assert(fds[i] == 3 + i);
+    check_index(&t);
+
+    /* Middle, front and back */
+    session_table_remove(&t, session_table_find(&t, 5));
+    session_table_remove(&t, session_table_find(&t, 3));
+    session_table_remove(&t, session_table_find(&t, 7));
+    assert(t.count == 2);
+    assert(session_table_find(&t, 5) == NULL && session_table_find(&t, 3) == NULL);
+    assert(order(&t, fds, 8) == 2 && fds[0] == 4 && fds[1] == 6);
+    check_index(&t);
+
+    /* A rejoin on a reused fd goes to the back */
+    assert(session_table_add(&t, 3) != NULL);
+    assert(order(&t, fds, 8) == 3 && fds[0] == 4 && fds[1] == 6 && fds[2] == 3);
+    check_index(&t);
+
+    assert(session_table_add(&t, -1) == NULL);
+    session_table_clear(&t);
+    assert(t.count == 0 && t.head == NULL && t.tail == NULL);
+    printf("[PASS] join and leave\n");
+}
+
+static void test_reorder(void) {
+    SessionTable t = {0};
+    int fds[8];
+    FollowerSession* s[4];
+    for (int i = 0; i < 4; i++) s[i] = session_table_add(&t, 10 + i);
+
+    session_table_move_after(&t, s[0], s[3]);          /* front to back */
+    assert(order(&t, fds, 8) == 4 && fds[0] == 11 && fds[3] == 10);
+    session_table_move_after(&t, s[3], NULL);          /* to the front */
+    assert(order(&t, fds, 8) == 4 && fds[0] == 13 && fds[1] == 11 && fds[2] == 12 && fds[3] == 10);
+    session_table_move_after(&t, s[2], s[2]);          /* no-op */
+    session_table_move_after(&t, s[1], s[2]);          /* swap neighbours */
+    assert(order(&t, fds, 8) == 4 && fds[0] == 13 && fds[1] == 12 && fds[2] == 11 && fds[3] == 10);
+    check_index(&t);
+    session_table_clear(&t);
+    printf("[PASS] reorder\n");
+}
+
+/* A session whose link dropped keeps its place without an fd, and comes back on a new one */
+static void test_rebind(void) {
+    SessionTable t = {0};
+    int fds[8];
+    FollowerSession* s[3];
+    for (int i = 0; i < 3; i++) {
+        s[i] = session_table_add(&t, 4 + i);
+        s[i]->token = 100 + (uint64_t)i;
+    }
+    assert(session_table_find_token(&t, 101) == s[1]);
+    assert(session_table_find_token(&t, 0) == NULL && session_table_find_token(&t, 7) == NULL);
+
+    assert(session_table_rebind(&t, s[1], -1) == 0);
+    assert(s[1]->fd == -1 && session_table_find(&t, 5) == NULL);
+    assert(session_table_find_token(&t, 101) == s[1]);
+    check_index(&t);
+
+    /* The old fd may go to a new join meanwhile; the resume lands on a fresh, larger one */
+    FollowerSession* late = session_table_add(&t, 5);
+    assert(session_table_rebind(&t, s[1], 300) == 0);
+    assert(session_table_find(&t, 300) == s[1] && session_table_find(&t, 5) == late);
+    assert(order(&t, fds, 8) == 4 && fds[0] == 4 && fds[1] == 300 && fds[2] == 6 && fds[3] == 5);
+    check_index(&t);
+    session_table_clear(&t);
+    printf("[PASS] rebind\n");
+}
+
+/* Hundreds of sessions with scattered fds; remove every other one */
+static void test_many(void) {
+    enum { N = 600 };
+    SessionTable t = {0};
+    int* fds = malloc(sizeof(int) * N);
+    for (int i = 0; i < N; i++) assert(session_table_add(&t, 5 + i * 3) != NULL);
+    assert(t.count == N);
+    check_index(&t);
+
+    for (int i = 0; i < N; i += 2) session_table_remove(&t, session_table_find(&t, 5 + i * 3));
+    assert(t.count == N / 2);
+    check_index(&t);
+    int n = order(&t, fds, N);
+    assert(n == N / 2);
+    for (int i = 0; i < n; i++) assert(fds[i] == 5 + (2 * i + 1) * 3);
+
+    free(fds);
+    session_table_clear(&t);
+    printf("[PASS] many sessions\n");
+}
+
+int main(void) {
+    printf("Starting session table test...\n");
+    test_join_leave();
+    test_reorder();
+    test_rebind();
+    test_many();
+    printf("Session table test passed\n");
+    return 0;
+}
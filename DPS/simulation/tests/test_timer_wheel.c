@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+
+#include "../timer_wheel.h"
+
+static TimerWheel tw;
+static EventQueue q;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+static void sleep_ms(long ms) {
+    struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+/* One-shot timers post their event after the delay, in deadline order */
+static void test_one_shot(void) {
+    event_queue_init(&q);
+    Event a = {.type = EVT_INTRUDER_CLEAR};
+    Event b = {.type = EVT_EMERGENCY_TIMER};
+
+    uint64_t t0 = now_ms();
+    assert(timer_arm_event(&tw, 80, 0, &q, &a) != TIMER_INVALID);
+    assert(timer_arm_event(&tw, 30, 0, &q, &b) != TIMER_INVALID);
+
+    Event e = pop_event(&q);
+    uint64_t t1 = now_ms();
+    assert(e.type == EVT_EMERGENCY_TIMER);
+    assert(t1 - t0 >= 30 - TIMER_WHEEL_TICK_MS);
+
+    e = pop_event(&q);
+    uint64_t t2 = now_ms();
+    assert(e.type == EVT_INTRUDER_CLEAR);
+    assert(t2 - t0 >= 80 - TIMER_WHEEL_TICK_MS && t2 - t0 < 500);
+    printf("[PASS] one-shot\n");
+}
+
+/* Cancelled timers never fire; stale ids are rejected */
+static void test_cancel(void) {
+    event_queue_init(&q);
+    Event ev = {.type = EVT_LEADER_TIMEOUT};
+
+    TimerId id = timer_arm_event(&tw, 40, 0, &q, &ev);
+    assert(timer_cancel(&tw, id) == 1);
+    assert(timer_cancel(&tw, id) == 0);
+
+    TimerId fired = timer_arm_event(&tw, 10, 0, &q, &ev);
+    sleep_ms(100);
+    assert(timer_cancel(&tw, fired) == 0);
+
+    Event out[EVENT_BATCH_MAX];
+    assert(try_pop_events(&q, out, EVENT_BATCH_MAX) == 1);
+    assert(timer_cancel(&tw, TIMER_INVALID) == 0);
+    printf("[PASS] cancel\n");
+}
+
+/* Periodic callback timers keep their cadence and stop on cancel */
+static int ticks = 0;
+static void on_tick(void* arg) {
+    (void)arg;
+    __atomic_add_fetch(&ticks, 1, __ATOMIC_RELAXED);
+}
+
+static void test_periodic(void) {
+    TimerId id = timer_arm_fn(&tw, 20, 20, on_tick, NULL);
+    sleep_ms(210);
+    assert(timer_cancel(&tw, id) == 1);
+    int n = __atomic_load_n(&ticks, __ATOMIC_RELAXED);
+    assert(n >= 8 && n <= 11);
+
+    sleep_ms(60);
+    assert(__atomic_load_n(&ticks, __ATOMIC_RELAXED) == n);
+    printf("[PASS] periodic\n");
+}
+
+/* Delays longer than one wheel revolution wait for their own revolution */
+static void test_long_delay(void) {
+    event_queue_init(&q);
+    Event far = {.type = EVT_PLATOON_FORMED};
+    Event near = {.type = EVT_TICK_UPDATE};
+    uint32_t rev_ms = TIMER_WHEEL_SLOTS * TIMER_WHEEL_TICK_MS;
+
+    /* Same slot, one revolution apart */
+    uint64_t t0 = now_ms();
+    timer_arm_event(&tw, rev_ms + 50, 0, &q, &far);
+    timer_arm_event(&tw, 50, 0, &q, &near);
+
+    Event e = pop_event(&q);
+    assert(e.type == EVT_TICK_UPDATE);
+    e = pop_event(&q);
+    assert(e.type == EVT_PLATOON_FORMED);
+    assert(now_ms() - t0 >= rev_ms + 50 - TIMER_WHEEL_TICK_MS);
+    printf("[PASS] long delay\n");
+}
+
+/* The node pool bounds concurrent timers instead of allocating */
+static void test_capacity(void) {
+    TimerId ids[TIMER_WHEEL_MAX];
+    Event ev = {.type = EVT_TICK_UPDATE};
+    event_queue_init(&q);
+    for (int i = 0; i < TIMER_WHEEL_MAX; i++) {
+        ids[i] = timer_arm_event(&tw, 10000, 0, &q, &ev);
+        assert(ids[i] != TIMER_INVALID);
+    }
+    assert(timer_arm_event(&tw, 10000, 0, &q, &ev) == TIMER_INVALID);
+    for (int i = 0; i < TIMER_WHEEL_MAX; i++) {
+        assert(timer_cancel(&tw, ids[i]) == 1);
+    }
+    assert(timer_arm_event(&tw, 10, 0, &q, &ev) != TIMER_INVALID);
+    assert(pop_event(&q).type == EVT_TICK_UPDATE);
+    printf("[PASS] capacity\n");
+}
+
+int main(void) {
+    printf("Starting timer wheel test...\n");
+    assert(timer_wheel_start(&tw) == 0);
+    test_one_shot();
+    test_cancel();
+    test_periodic();
+    test_long_delay();
+    test_capacity();
+    timer_wheel_stop(&tw);
+    printf("Timer wheel test passed\n");
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "../tpframe.h"
+
+/* 100-byte test payload */
+typedef struct {
+    int seq;
+    char pad[96];
+} TestMsg;
+
+static int sv[2];
+
+static void open_pair(void) {
+    assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+}
+
+static void close_pair(void) {
+    close(sv[0]);
+    close(sv[1]);
+}
+
+static void send_frame(int seq) {
+    TestMsg m = {.seq = seq};
+    memset(m.pad, seq & 0xFF, sizeof(m.pad));
+    assert(tpframe_send(sv[0], &m, sizeof(m)) == 0);
+}
+
+static void expect_msg(const TestMsg* m, int seq) {
+    assert(m->seq == seq);
+    assert((unsigned char)m->pad[0] == (seq & 0xFF));
+    assert((unsigned char)m->pad[sizeof(m->pad) - 1] == (seq & 0xFF));
+}
+
+/* Many frames written back to back come out of a single fill */
+static void test_coalesced(void) {
+    FrameDecoder d;
+    frame_decoder_reset(&d);
+    open_pair();
+
+    for (int i = 0; i < 20; i++) send_frame(i);
+    ssize_t n = frame_decoder_fill(&d, sv[1]);
+    assert(n == 20 * (ssize_t)(TPFRAME_HDR + sizeof(TestMsg)));
+
+    TestMsg m;
+    size_t len;
+    for (int i = 0; i < 20; i++) {
+        assert(frame_decoder_next(&d, &m, sizeof(m), &len) == 1);
+        assert(len == sizeof(m));
+        expect_msg(&m, i);
+    }
+    assert(frame_decoder_next(&d, &m, sizeof(m), &len) == 0);
+    assert(frame_decoder_fill(&d, sv[1]) == -1 && errno == EAGAIN);
+    close_pair();
+    printf("[PASS] coalesced frames\n");
+}
+
+/* A frame trickling in a byte at a time is only yielded once complete */
+static void test_split(void) {
+    FrameDecoder d;
+    frame_decoder_reset(&d);
+    open_pair();
+
+    TestMsg m = {.seq = 77};
+    memset(m.pad, 77, sizeof(m.pad));
+    unsigned char frame[TPFRAME_HDR + sizeof(TestMsg)];
+    size_t total = tpframe_encode(frame, &m, sizeof(m));
+
+    TestMsg got;
+    size_t len;
+    for (size_t i = 0; i < total; i++) {
+        assert(frame_decoder_next(&d, &got, sizeof(got), &len) == 0);
+        assert(send(sv[0], frame + i, 1, 0) == 1);
+        assert(frame_decoder_fill(&d, sv[1]) == 1);
+    }
+    assert(frame_decoder_next(&d, &got, sizeof(got), &len) == 1);
+    expect_msg(&got, 77);
+    close_pair();
+    printf("[PASS] split frame\n");
+}
+
+/* Frames straddling the end of the ring are reassembled */
+static void test_wrap(void) {
+    FrameDecoder d;
+    frame_decoder_reset(&d);
+    open_pair();
+
+    TestMsg m;
+    size_t len;
+    int next_send = 0, next_recv = 0;
+    /* Leave one partial frame behind each round so head drifts around the ring */
+    for (int round = 0; round < 200; round++) {
+        send_frame(next_send++);
+        send_frame(next_send++);
+        unsigned char frame[TPFRAME_HDR + sizeof(TestMsg)];
+        TestMsg part = {.seq = next_send};
+        memset(part.pad, next_send & 0xFF, sizeof(part.pad));
+        tpframe_encode(frame, &part, sizeof(part));
+        size_t cut = 1 + (size_t)round % (sizeof(frame) - 1);
+        assert(send(sv[0], frame, cut, 0) == (ssize_t)cut);
+
+        assert(frame_decoder_fill(&d, sv[1]) > 0);
+        while (frame_decoder_next(&d, &m, sizeof(m), &len) == 1) {
+            expect_msg(&m, next_recv++);
+        }
+        assert(send(sv[0], frame + cut, sizeof(frame) - cut, 0) == (ssize_t)(sizeof(frame) - cut));
+        next_send++;
+    }
+    assert(frame_decoder_fill(&d, sv[1]) > 0);
+    while (frame_decoder_next(&d, &m, sizeof(m), &len) == 1) {
+        expect_msg(&m, next_recv++);
+    }
+    assert(next_recv == next_send && d.len == 0);
+    close_pair();
+    printf("[PASS] ring wrap-around\n");
+}
+
+/* Fed bytes (from a posted receive) decode like filled ones, across the wrap */
+static void test_feed(void) {
+    FrameDecoder d;
+    frame_decoder_reset(&d);
+
+    unsigned char stream[40 * (TPFRAME_HDR + sizeof(TestMsg))];
+    size_t total = 0;
+    for (int seq = 0; seq < 40; seq++) {
+        TestMsg m = {.seq = seq};
+        memset(m.pad, seq & 0xFF, sizeof(m.pad));
+        total += tpframe_encode(stream + total, &m, sizeof(m));
+    }
+
+    TestMsg m;
+    size_t len, off = 0;
+    int next = 0;
+    while (off < total) {
+        size_t chunk = 1 + (off * 7) % 333;           // arbitrary cut points
+        if (chunk > total - off) chunk = total - off;
+        assert(frame_decoder_feed(&d, stream + off, chunk) == 0);
+        off += chunk;
+        while (frame_decoder_next(&d, &m, sizeof(m), &len) == 1) {
+            expect_msg(&m, next++);
+        }
+    }
+    assert(next == 40 && d.len == 0);
+
+    /* More than the ring holds is refused */
+    static unsigned char big[TPFRAME_RX_RING + 1];
+    assert(frame_decoder_feed(&d, big, sizeof(big)) == -1);
+    printf("[PASS] feed\n");
+}
+
+/* Oversized lengths are rejected, EOF reads as 0 */
+static void test_malformed(void) {
+    FrameDecoder d;
+    frame_decoder_reset(&d);
+    open_pair();
+
+    unsigned char bad[TPFRAME_HDR] = {0x00, 0x01, 0x00, 0x00};   // 64 KiB
+    assert(send(sv[0], bad, sizeof(bad), 0) == (ssize_t)sizeof(bad));
+    assert(frame_decoder_fill(&d, sv[1]) == TPFRAME_HDR);
+    TestMsg m;
+    size_t len;
+    assert(frame_decoder_next(&d, &m, sizeof(m), &len) == -1);
+
+    /* A valid frame larger than the caller's buffer is also an error */
+    frame_decoder_reset(&d);
+    static unsigned char big[TPFRAME_MAX_PAYLOAD];
+    assert(tpframe_send(sv[0], big, sizeof(big)) == 0);
+    assert(frame_decoder_fill(&d, sv[1]) > 0);
+    assert(frame_decoder_next(&d, &m, sizeof(m), &len) == -1);
+    assert(tpframe_send(sv[0], big, TPFRAME_MAX_PAYLOAD + 1) == -1);
+
+    close(sv[0]);
+    frame_decoder_reset(&d);
+    assert(frame_decoder_fill(&d, sv[1]) == 0);
+    close(sv[1]);
+    printf("[PASS] malformed frames and EOF\n");
+}
+
+int main(void) {
+    printf("Starting framing decoder test...\n");
+    test_coalesced();
+    test_split();
+    test_wrap();
+    test_feed();
+    test_malformed();
+    printf("Framing decoder test passed\n");
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#include "../tpio.h"
+
+/* Wait until at least want events arrived (or a few empty polls), appending to ev */
+static int collect(TpIo* io, TpIoEvent* ev, int max, int want) {
+    int n = 0;
+    for (int tries = 0; n < want && tries < 50; tries++) {
+        int r = tpio_wait(io, ev + n, max - n, 20);
+        assert(r >= 0);
+        n += r;
+    }
+    return n;
+}
+
+static int nonblocking_pair(int type, int sv[2]) {
+    if (socketpair(AF_UNIX, type, 0, sv) < 0) return -1;
+    fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+    fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+    return 0;
+}
+
+/* Stream receive: bytes arrive in order with the watch's token, then end of stream */
+static void test_stream_recv(TpIoKind kind) {
+    TpIo io;
+    int sv[2];
+    assert(tpio_open(&io, kind) == 0);
+    assert(nonblocking_pair(SOCK_STREAM, sv) == 0);
+    assert(tpio_watch(&io, sv[0], TPIO_RECV, 42) == 0);
+
+    char got[64];
+    size_t got_len = 0;
+    assert(write(sv[1], "hello ", 6) == 6);
+    assert(write(sv[1], "world", 5) == 5);
+    TpIoEvent ev[8];
+    while (got_len < 11) {
+        int n = collect(&io, ev, 8, 1);
+        assert(n >= 1);
+        for (int i = 0; i < n; i++) {
+            assert(ev[i].token == 42 && ev[i].fd == sv[0] && (ev[i].events & TPIO_RECV));
+            assert(ev[i].res > 0);
+            memcpy(got + got_len, ev[i].data, (size_t)ev[i].res);
+            got_len += (size_t)ev[i].res;
+        }
+    }
+    assert(got_len == 11 && memcmp(got, "hello world", 11) == 0);
+
+    close(sv[1]);
+    int n = collect(&io, ev, 8, 1);
+    assert(n == 1 && (ev[0].events & TPIO_RECV) && ev[0].res == 0);
+
+    tpio_unwatch(&io, sv[0]);
+    close(sv[0]);
+    tpio_close(&io);
+}
+
+/* Datagram receive: one event per datagram, none lost behind the first */
+static void test_dgram_recv(TpIoKind kind) {
+    TpIo io;
+    int sv[2];
+    assert(tpio_open(&io, kind) == 0);
+    assert(nonblocking_pair(SOCK_DGRAM, sv) == 0);
+    assert(tpio_watch(&io, sv[0], TPIO_RECV, 7) == 0);
+
+    for (char c = 'a'; c < 'a' + 5; c++) assert(send(sv[1], &c, 1, 0) == 1);
+    TpIoEvent ev[16];
+    int n = collect(&io, ev, 16, 5);
+    assert(n == 5);
+    for (int i = 0; i < n; i++) {
+        assert(ev[i].res == 1);
+    }
+    /* All five were reported; nothing is left */
+    assert(tpio_wait(&io, ev, 16, 0) == 0);
+
+    tpio_unwatch(&io, sv[0]);
+    close(sv[0]);
+    close(sv[1]);
+    tpio_close(&io);
+}
+
+/* Readiness is edge-triggered: one event per transition, not per wait */
+static void test_edges(TpIoKind kind) {
+    TpIo io;
+    int sv[2];
+    assert(tpio_open(&io, kind) == 0);
+    int efd = eventfd(0, EFD_NONBLOCK);
+    assert(efd >= 0);
+    assert(nonblocking_pair(SOCK_STREAM, sv) == 0);
+    assert(tpio_watch(&io, efd, TPIO_IN, 1) == 0);
+    assert(tpio_watch(&io, sv[0], TPIO_RECV | TPIO_OUT, 2) == 0);
+
+    /* A fresh socket is writable once */
+    TpIoEvent ev[8];
+    int n = collect(&io, ev, 8, 1);
+    assert(n == 1 && ev[0].token == 2 && (ev[0].events & TPIO_OUT));
+    assert(tpio_wait(&io, ev, 8, 0) == 0);
+
+    uint64_t one = 1;
+    assert(write(efd, &one, sizeof(one)) == sizeof(one));
+    n = collect(&io, ev, 8, 1);
+    assert(n == 1 && ev[0].token == 1 && (ev[0].events & TPIO_IN));
+    assert(tpio_wait(&io, ev, 8, 0) == 0);   /* not drained, but no new edge */
+
+    /* Regular files cannot be watched */
+    FILE* f = tmpfile();
+    assert(f && tpio_watch(&io, fileno(f), TPIO_IN, 3) == -1 && errno == EPERM);
+    fclose(f);
+
+    /* Unwatched fds report nothing, even with data queued */
+    tpio_unwatch(&io, efd);
+    assert(write(efd, &one, sizeof(one)) == sizeof(one));
+    assert(tpio_wait(&io, ev, 8, 20) == 0);
+
+    tpio_unwatch(&io, sv[0]);
+    close(efd);
+    close(sv[0]);
+    close(sv[1]);
+    tpio_close(&io);
+}
+
+/* Rewatching retags an fd; only the new token is reported */
+static void test_rewatch(TpIoKind kind) {
+    TpIo io;
+    int sv[2];
+    assert(tpio_open(&io, kind) == 0);
+    assert(nonblocking_pair(SOCK_STREAM, sv) == 0);
+    assert(tpio_watch(&io, sv[0], TPIO_RECV, 10) == 0);
+    assert(tpio_watch(&io, sv[0], TPIO_RECV, 11) == 0);
+
+    assert(write(sv[1], "x", 1) == 1);
+    TpIoEvent ev[8];
+    int n = collect(&io, ev, 8, 1);
+    assert(n == 1 && ev[0].token == 11 && ev[0].res == 1 && ev[0].data[0] == 'x');
+
+    tpio_unwatch(&io, sv[0]);
+    close(sv[0]);
+    close(sv[1]);
+    tpio_close(&io);
+}
+
+/* A batch of gathered writes across sockets; io_uring submits it with one syscall */
+static void test_send_batch(TpIoKind kind) {
+    enum { N = 8 };
+    TpIo io;
+    int sv[N][2];
+    TpIoSend ops[N];
+    struct iovec iov[N][2];
+    assert(tpio_open(&io, kind) == 0);
+    for (int i = 0; i < N; i++) {
+        assert(nonblocking_pair(SOCK_STREAM, sv[i]) == 0);
+        iov[i][0] = (struct iovec){.iov_base = "ab", .iov_len = 2};
+        iov[i][1] = (struct iovec){.iov_base = "cde", .iov_len = 3};
+        ops[i] = (TpIoSend){.fd = sv[i][0], .iov = iov[i], .iovcnt = 2};
+    }
+    close(sv[N - 1][1]); /* peer gone: that write fails alone */
+
+    uint64_t before = io.syscalls;
+    assert(tpio_send_batch(&io, ops, N) == 0);
+    uint64_t calls = io.syscalls - before;
+    assert(calls == (io.kind == TPIO_URING ? 1u : (uint64_t)N));
+
+    for (int i = 0; i < N - 1; i++) {
+        char buf[8];
+        assert(ops[i].res == 5);
+        assert(read(sv[i][1], buf, sizeof(buf)) == 5 && memcmp(buf, "abcde", 5) == 0);
+        close(sv[i][1]);
+    }
+    assert(ops[N - 1].res == -EPIPE);
+    for (int i = 0; i < N; i++) close(sv[i][0]);
+    tpio_close(&io);
+}
+
+static void run(TpIoKind kind, const char* name) {
+    test_stream_recv(kind);
+    test_dgram_recv(kind);
+    test_edges(kind);
+    test_rewatch(kind);
+    test_send_batch(kind);
+    printf("[PASS] %s backend\n", name);
+}
+
+int main(void) {
+    printf("Starting I/O backend test...\n");
+    run(TPIO_POSIX, "epoll");
+
+    TpIo probe;
+    if (tpio_open(&probe, TPIO_URING) == 0) {
+        tpio_close(&probe);
+        run(TPIO_URING, "io_uring");
+    } else {
+        printf("[SKIP] io_uring backend unavailable (%s)\n", strerror(errno));
+    }
+    printf("I/O backend test passed\n");
+    return 0;
+}
@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <stddef.h>
+#include <sys/wait.h>
+
+#include "../tpshm.h"
+#include "../tpio.h"
+#include "../outq.h"
+#include "../tpframe.h"
+
+static char name[64];
+
+/* A connected pair in this process: *c connects, *a accepts */
+static void link_pair(int listen_fd, TpShmKind kind, int* c, int* a) {
+    *c = tpshm_connect(name, kind);
+    assert(*c >= 0 && tpshm_is_link(*c));
+    *a = tpshm_accept(listen_fd);
+    assert(*a >= 0 && tpshm_is_link(*a));
+}
+
+/* Stream: records pack into receives, split across short ones, wrap, fill up, end */
+static void test_stream(int listen_fd) {
+    int c, a;
+    link_pair(listen_fd, TPSHM_STREAM, &c, &a);
+    char buf[TPSHM_MAX_RECORD * 2];
+    assert(tpshm_recv(a, buf, sizeof(buf)) == -1 && errno == EAGAIN);
+
+    assert(tpshm_send(c, "hello ", 6) == 6);
+    assert(tpshm_send(c, "world", 5) == 5);
+    assert(tpshm_recv(a, buf, sizeof(buf)) == 11 && memcmp(buf, "hello world", 11) == 0);
+    assert(tpshm_send(a, "back", 4) == 4);
+    assert(tpshm_recv(c, buf, 2) == 2 && memcmp(buf, "ba", 2) == 0);
+    assert(tpshm_recv(c, buf, sizeof(buf)) == 2 && memcmp(buf, "ck", 2) == 0);
+
+    /* A byte sequence several times the ring size, in odd-sized records */
+    unsigned char out = 0, in = 0;
+    size_t total = 0, got = 0;
+    while (got < 4 * TPSHM_RING_BYTES) {
+        unsigned char rec[333];
+        for (size_t i = 0; i < sizeof(rec); i++) rec[i] = (unsigned char)(out + i);
+        if (tpshm_send(c, rec, sizeof(rec)) == (ssize_t)sizeof(rec)) {
+            out = (unsigned char)(out + sizeof(rec));
+            total += sizeof(rec);
+            continue;
+        }
+        assert(errno == EAGAIN); /* full: drain some */
+        ssize_t n = tpshm_recv(a, buf, 1000);
+        assert(n > 0);
+        for (ssize_t i = 0; i < n; i++) assert((unsigned char)buf[i] == in++);
+        got += (size_t)n;
+    }
+    ssize_t n;
+    while ((n = tpshm_recv(a, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; i++) assert((unsigned char)buf[i] == in++);
+        got += (size_t)n;
+    }
+    assert(got == total);
+
+    /* Too long for one record: a short write */
+    static char big[TPSHM_MAX_RECORD + 100];
+    assert(tpshm_send(c, big, sizeof(big)) == TPSHM_MAX_RECORD);
+
+    /* Close: the peer drains what was sent, then reads end of stream; sends fail */
+    assert(tpshm_send(c, "bye", 3) == 3);
+    assert(tpshm_close(c) == 0);
+    assert(!tpshm_is_link(c));
+    assert(tpshm_recv(a, buf, sizeof(buf)) == TPSHM_MAX_RECORD + 3);
+    assert(tpshm_recv(a, buf, sizeof(buf)) == 0);
+    assert(tpshm_send(a, "x", 1) == -1 && errno == EPIPE);
+    tpshm_close(a);
+    printf("[PASS] stream link\n");
+}
+
+/* Datagrams: one per receive, truncated to the buffer, whole or nothing */
+static void test_dgram(int listen_fd) {
+    int c, a;
+    link_pair(listen_fd, TPSHM_DGRAM, &c, &a);
+    char buf[64];
+    assert(tpshm_send(c, "one", 3) == 3);
+    assert(tpshm_send(c, "two!", 4) == 4);
+    assert(tpshm_send(c, "a longer datagram", 17) == 17);
+    assert(tpshm_recv(a, buf, sizeof(buf)) == 3 && memcmp(buf, "one", 3) == 0);
+    assert(tpshm_recv(a, buf, sizeof(buf)) == 4 && memcmp(buf, "two!", 4) == 0);
+    assert(tpshm_recv(a, buf, 8) == 8 && memcmp(buf, "a longer", 8) == 0);
+    assert(tpshm_recv(a, buf, sizeof(buf)) == -1 && errno == EAGAIN);
+
+    static char big[TPSHM_MAX_RECORD + 1];
+    assert(tpshm_send(c, big, sizeof(big)) == -1 && errno == EMSGSIZE);
+    int sent = 0;
+    while (tpshm_send(c, big, 1000) == 1000) sent++;
+    assert(errno == EAGAIN && sent > 0 && sent <= TPSHM_RING_BYTES / 1000);
+    tpshm_close(c);
+    tpshm_close(a);
+    printf("[PASS] datagram link (%d x 1000 B fill the ring)\n", sent);
+}
+
+/* Collect events until one for fd with any of want arrives */
+static int wait_for(TpIo* io, int fd, uint32_t want, TpIoEvent* out) {
+    TpIoEvent ev[8];
+    for (int tries = 0; tries < 50; tries++) {
+        int n = tpio_wait(io, ev, 8, 20);
+        assert(n >= 0);
+        for (int i = 0; i < n; i++) {
+            if (ev[i].fd == fd && (ev[i].events & want)) {
+                *out = ev[i];
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* tpio: receives, the writable edge after a full ring drains, and a hang-up */
+static void test_tpio(int listen_fd) {
+    int c, a;
+    link_pair(listen_fd, TPSHM_STREAM, &c, &a);
+    TpIo io;
+    assert(tpio_open(&io, TPIO_POSIX) == 0);
+    assert(tpio_watch(&io, a, TPIO_RECV | TPIO_OUT, 7) == 0);
+    TpIoEvent ev;
+    assert(wait_for(&io, a, TPIO_OUT, &ev)); /* the first edge */
+
+    assert(tpshm_send(c, "ping", 4) == 4);
+    assert(wait_for(&io, a, TPIO_RECV, &ev));
+    assert(ev.token == 7 && ev.res == 4 && memcmp(ev.data, "ping", 4) == 0);
+    uint64_t syscalls = io.syscalls;
+    assert(tpshm_send(c, "pong", 4) == 4);
+    assert(wait_for(&io, a, TPIO_RECV, &ev) && ev.res == 4);
+
+    /* Fill a's outbound ring; c draining it brings the writable edge */
+    static char chunk[4000];
+    while (tpshm_send(a, chunk, sizeof(chunk)) > 0) {
+    }
+    assert(errno == EAGAIN);
+    char buf[TPSHM_RING_BYTES];
+    assert(tpshm_recv(c, buf, sizeof(buf)) > 0);
+    assert(wait_for(&io, a, TPIO_OUT, &ev));
+    assert(tpshm_send(a, chunk, sizeof(chunk)) > 0);
+
+    /* A peer that dies without closing: its socket hangs up */
+    shutdown(c, SHUT_RDWR);
+    assert(wait_for(&io, a, TPIO_RECV, &ev) && ev.res == 0);
+    printf("[PASS] tpio over a link (%llu syscalls after the first receive)\n",
+           (unsigned long long)(io.syscalls - syscalls));
+    tpio_unwatch(&io, a);
+    tpio_close(&io);
+    tpshm_close(a);
+    tpshm_close(c);
+
+    /* io_uring cannot serve links */
+    if (tpio_open(&io, TPIO_URING) == 0) {
+        link_pair(listen_fd, TPSHM_STREAM, &c, &a);
+        assert(tpio_watch(&io, a, TPIO_RECV, 1) == -1 && errno == EOPNOTSUPP);
+        tpio_close(&io);
+        tpshm_close(a);
+        tpshm_close(c);
+    }
+}
+
+/* outq and tpframe write links like sockets */
+static void test_framing(int listen_fd) {
+    int c, a;
+    link_pair(listen_fd, TPSHM_STREAM, &c, &a);
+    assert(tpframe_send(c, "join", 4) == 0);
+
+    OutQueue q;
+    assert(outq_init(&q) == 0);
+    unsigned char frame[TPFRAME_HDR + 8];
+    for (int i = 0; i < 3; i++) {
+        size_t len = tpframe_encode(frame, "cmd-0", 5);
+        frame[len - 1] = (unsigned char)('0' + i);
+        assert(outq_send(&q, a, frame, len, OUTQ_NEVER_DROP) == 1);
+    }
+    outq_free(&q);
+
+    FrameDecoder d;
+    frame_decoder_reset(&d);
+    unsigned char buf[256], msg[16];
+    size_t len;
+    ssize_t n = tpshm_recv(a, buf, sizeof(buf));
+    assert(n == TPFRAME_HDR + 4 && frame_decoder_feed(&d, buf, (size_t)n) == 0);
+    assert(frame_decoder_next(&d, msg, sizeof(msg), &len) == 1 && len == 4 && memcmp(msg, "join", 4) == 0);
+    n = tpshm_recv(c, buf, sizeof(buf));
+    assert(n == 3 * (TPFRAME_HDR + 5) && frame_decoder_feed(&d, buf, (size_t)n) == 0);
+    for (int i = 0; i < 3; i++) {
+        assert(frame_decoder_next(&d, msg, sizeof(msg), &len) == 1 && len == 5 && msg[4] == '0' + i);
+    }
+    tpshm_close(a);
+    tpshm_close(c);
+    printf("[PASS] framing over a link\n");
+}
+
+/* The listener's socket without a link: a client that never sends its segment */
+static int bare_connect(void) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    size_t len = strlen(name);
+    memcpy(addr.sun_path + 1, name, len);
+    assert(fd >= 0 && connect(fd, (struct sockaddr*)&addr, (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + len)) == 0);
+    return fd;
+}
+
+/* Two-step accept: nothing waits for a slow connector */
+static void test_attach(int listen_fd) {
+    assert(tpshm_accept_socket(listen_fd) == -1 && errno == EAGAIN);
+
+    int slow = bare_connect();
+    int a = tpshm_accept_socket(listen_fd);
+    assert(a >= 0 && !tpshm_is_link(a));
+    assert(tpshm_attach(a) == -1 && errno == EAGAIN);
+    close(slow); /* gives up without a segment */
+    assert(tpshm_attach(a) == -1 && errno == EPROTO);
+    close(a);
+
+    int c = tpshm_connect(name, TPSHM_STREAM);
+    assert(c >= 0);
+    a = tpshm_accept_socket(listen_fd);
+    assert(a >= 0 && tpshm_attach(a) == 0 && tpshm_is_link(a));
+    char buf[8];
+    assert(tpshm_send(c, "hi", 2) == 2 && tpshm_recv(a, buf, sizeof(buf)) == 2);
+    tpshm_close(c);
+    tpshm_close(a);
+    printf("[PASS] accept without waiting\n");
+}
+
+/* Another process: ping-pong with blocking waits, then a crash */
+#define ROUNDS 20000
+
+static void test_fork(int listen_fd) {
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        int fd = tpshm_connect(name, TPSHM_STREAM);
+        if (fd < 0) _exit(1);
+        uint32_t v;
+        for (int i = 0; i < ROUNDS; i++) {
+            ssize_t n;
+            while ((n = tpshm_recv(fd, &v, sizeof(v))) < 0) tpshm_wait(fd, -1);
+            if (n != (ssize_t)sizeof(v)) _exit(2);
+            v++;
+            if (tpshm_send(fd, &v, sizeof(v)) != (ssize_t)sizeof(v)) _exit(3);
+        }
+        _exit(0); /* no tpshm_close: the parent learns from the socket */
+    }
+
+    int fd = -1;
+    while (fd < 0) {
+        struct pollfd pfd = {.fd = listen_fd, .events = POLLIN};
+        assert(poll(&pfd, 1, 5000) == 1);
+        fd = tpshm_accept(listen_fd);
+    }
+    uint32_t v = 0;
+    for (int i = 0; i < ROUNDS; i++) {
+        assert(tpshm_send(fd, &v, sizeof(v)) == (ssize_t)sizeof(v));
+        uint32_t r;
+        ssize_t n;
+        while ((n = tpshm_recv(fd, &r, sizeof(r))) < 0) assert(tpshm_wait(fd, 1000) == 1);
+        assert(n == (ssize_t)sizeof(r) && r == v + 1);
+        v = r + 1;
+    }
+    int status;
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    char b;
+    while (tpshm_recv(fd, &b, 1) < 0) assert(tpshm_wait(fd, 1000) == 1);
+    assert(tpshm_recv(fd, &b, 1) == 0);
+    tpshm_close(fd);
+    printf("[PASS] %d round trips with another process, then its exit\n", ROUNDS);
+}
+
+int main(void) {
+    printf("Starting shared-memory link test...\n");
+    snprintf(name, sizeof(name), "test-%d", (int)getpid());
+    int listen_fd = tpshm_listen(name);
+    assert(listen_fd >= 0);
+    int again = tpshm_accept(listen_fd);
+    assert(again == -1 && errno == EAGAIN);
+
+    test_stream(listen_fd);
+    test_dgram(listen_fd);
+    test_tpio(listen_fd);
+    test_framing(listen_fd);
+    test_attach(listen_fd);
+    test_fork(listen_fd);
+    close(listen_fd);
+    printf("Shared-memory link test passed\n");
+    return 0;
+}
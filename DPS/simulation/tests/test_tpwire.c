@@ -0,0 +1,303 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+
+#include "../tpwire.h"
+
+static void fill_clock(MatrixClock* c) {
+    for (int i = 0; i < NUM_TRUCKS; i++)
+        for (int j = 0; j < NUM_TRUCKS; j++)
+            c->mc[i][j] = i * 100 + j;
+}
+
+static LD_MESSAGE roundtrip_ld(const LD_MESSAGE* in, size_t* len_out) {
+    unsigned char wire[TPWIRE_MAX];
+    size_t len = tpwire_encode_ld(in, wire, sizeof(wire));
+    assert(len > 0);
+    LD_MESSAGE out;
+    assert(tpwire_decode_ld(wire, len, &out) == 0);
+    if (len_out) *len_out = len;
+    return out;
+}
+
+/* Every leader message type survives encode/decode */
+static void test_ld_roundtrip(void) {
+    LD_MESSAGE m = {0};
+    m.type = MSG_LDR_CMD;
+    m.payload.cmd.command_id = 1234567890123ULL;
+    m.payload.cmd.leader = (Truck){.x = -12.5f, .y = 300.25f, .speed = 42.0f, .dir = WEST, .state = CRUISE};
+    m.payload.cmd.is_turning_event = 1;
+    m.payload.cmd.turn_point_x = 99.5f;
+    m.payload.cmd.turn_point_y = -1.0f;
+    m.payload.cmd.turn_dir = SOUTH;
+    fill_clock(&m.matrix_clock);
+
+    size_t len;
+    LD_MESSAGE out = roundtrip_ld(&m, &len);
+    assert(out.type == MSG_LDR_CMD);
+    assert(out.payload.cmd.command_id == m.payload.cmd.command_id);
+    assert(out.payload.cmd.leader.x == -12.5f && out.payload.cmd.leader.y == 300.25f);
+    assert(out.payload.cmd.leader.speed == 42.0f);
+    assert(out.payload.cmd.leader.dir == WEST && out.payload.cmd.leader.state == CRUISE);
+    assert(out.payload.cmd.is_turning_event == 1);
+    assert(out.payload.cmd.turn_point_x == 99.5f && out.payload.cmd.turn_point_y == -1.0f);
+    assert(out.payload.cmd.turn_dir == SOUTH);
+    assert(memcmp(&out.matrix_clock, &m.matrix_clock, sizeof(MatrixClock)) == 0);
+    assert(len < sizeof(LD_MESSAGE));
+
+    /* Without a turn or a clock the command is much smaller still */
+    m.payload.cmd.is_turning_event = 0;
+    memset(&m.matrix_clock, 0, sizeof(m.matrix_clock));
+    size_t plain;
+    out = roundtrip_ld(&m, &plain);
+    assert(plain < 32);
+    assert(out.payload.cmd.turn_point_x == 0.0f);
+
+    /* A heartbeat is the header and the command it names */
+    LD_MESSAGE beat = {.type = MSG_LDR_HEARTBEAT};
+    beat.payload.cmd.command_id = 300;
+    size_t beat_len;
+    out = roundtrip_ld(&beat, &beat_len);
+    assert(out.type == MSG_LDR_HEARTBEAT && out.payload.cmd.command_id == 300);
+    assert(beat_len == 5 && beat_len * 4 < plain);
+
+    LD_MESSAGE rear = {.type = MSG_LDR_UPDATE_REAR};
+    rear.payload.rearInfo.has_rearTruck = 1;
+    strcpy(rear.payload.rearInfo.rearTruck_Address.ip, "192.168.100.200");
+    rear.payload.rearInfo.rearTruck_Address.udp_port = 65001;
+    rear.topo_epoch = 70000;
+    out = roundtrip_ld(&rear, NULL);
+    assert(out.payload.rearInfo.has_rearTruck == 1 && out.topo_epoch == 70000);
+    assert(strcmp(out.payload.rearInfo.rearTruck_Address.ip, "192.168.100.200") == 0);
+    assert(out.payload.rearInfo.rearTruck_Address.udp_port == 65001);
+
+    LD_MESSAGE id = {.type = MSG_LDR_ASSIGN_ID, .payload.assigned_id = 3, .topo_epoch = 9,
+                     .session_token = 0xF00DCAFE12345678ull};
+    out = roundtrip_ld(&id, NULL);
+    assert(out.type == MSG_LDR_ASSIGN_ID && out.payload.assigned_id == 3 && out.topo_epoch == 9);
+    assert(out.session_token == 0xF00DCAFE12345678ull);
+
+    LD_MESSAGE spawn = {.type = MSG_LDR_SPAWN};
+    spawn.payload.spawn = (SpawnInfoMsg){.assigned_id = 2, .spawn_x = 1.5f, .spawn_y = -80.0f, .spawn_dir = EAST};
+    spawn.topo_epoch = 9;
+    out = roundtrip_ld(&spawn, NULL);
+    assert(out.payload.spawn.assigned_id == 2 && out.payload.spawn.spawn_dir == EAST && out.topo_epoch == 9);
+    assert(out.payload.spawn.spawn_x == 1.5f && out.payload.spawn.spawn_y == -80.0f);
+
+    LD_MESSAGE brake = {.type = MSG_LDR_EMERGENCY_BRAKE};
+    out = roundtrip_ld(&brake, &len);
+    assert(out.type == MSG_LDR_EMERGENCY_BRAKE && len == 3);
+    printf("[PASS] leader message round-trip\n");
+}
+
+/* Follower and join messages survive encode/decode */
+static void test_ft_reg_roundtrip(void) {
+    unsigned char wire[TPWIRE_MAX];
+    FT_MESSAGE out;
+
+    FT_MESSAGE pos = {.type = MSG_FT_POSITION, .payload.position = {.x = 10.0f, .y = -20.5f, .speed = 33.0f}};
+    size_t len = tpwire_encode_ft(&pos, wire, sizeof(wire));
+    assert(len == 3 + 12);
+    assert(tpwire_decode_ft(wire, len, &out) == 0);
+    assert(out.type == MSG_FT_POSITION && out.payload.position.y == -20.5f && out.payload.position.speed == 33.0f);
+
+    FT_MESSAGE intr = {.type = MSG_FT_INTRUDER_REPORT, .payload.intruder = {.speed = -5, .length = 12, .duration_ms = 70000}};
+    fill_clock(&intr.matrix_clock);
+    len = tpwire_encode_ft(&intr, wire, sizeof(wire));
+    assert(tpwire_decode_ft(wire, len, &out) == 0);
+    assert(out.payload.intruder.speed == -5 && out.payload.intruder.length == 12);
+    assert(out.payload.intruder.duration_ms == 70000);
+    assert(out.matrix_clock.mc[3][2] == 302);
+
+    FT_MESSAGE warn = {.type = MSG_FT_EMERGENCY_BRAKE, .payload.warning = {.emergency_Flag = 1, .resendFlag = 1}};
+    len = tpwire_encode_ft(&warn, wire, sizeof(wire));
+    assert(tpwire_decode_ft(wire, len, &out) == 0);
+    assert(out.payload.warning.emergency_Flag == 1 && out.payload.warning.resendFlag == 1);
+
+    FollowerRegisterMsg reg = {0}, reg_out;
+    strcpy(reg.selfAddress.ip, "127.0.0.1");
+    reg.selfAddress.udp_port = 5003;
+    reg.platoon_id = 300;
+    len = tpwire_encode_reg(&reg, wire, sizeof(wire));
+    assert(tpwire_decode_reg(wire, len, &reg_out) == 0);
+    assert(strcmp(reg_out.selfAddress.ip, "127.0.0.1") == 0 && reg_out.selfAddress.udp_port == 5003);
+    assert(reg_out.platoon_id == 300 && reg_out.resume_token == 0);
+
+    /* A resume carries the token and what the follower has applied; a new join
+     * pays one byte for the absent token */
+    size_t join_len = len;
+    reg.resume_token = UINT64_MAX;
+    reg.topo_epoch = 70000;
+    reg.last_cmd_id = 123456789;
+    len = tpwire_encode_reg(&reg, wire, sizeof(wire));
+    assert(len > join_len && tpwire_decode_reg(wire, len, &reg_out) == 0);
+    assert(reg_out.resume_token == UINT64_MAX && reg_out.topo_epoch == 70000 && reg_out.last_cmd_id == 123456789);
+    assert(reg_out.platoon_id == 300 && reg_out.selfAddress.udp_port == 5003);
+    printf("[PASS] follower and join round-trip\n");
+}
+
+/* Fields are big-endian regardless of host byte order */
+static void test_layout(void) {
+    FT_MESSAGE pos = {.type = MSG_FT_POSITION, .payload.position = {.x = 1.0f, .y = -2.0f, .speed = 0.0f}};
+    unsigned char wire[TPWIRE_MAX];
+    size_t len = tpwire_encode_ft(&pos, wire, sizeof(wire));
+    const unsigned char expect[] = {
+        TPWIRE_VERSION, (TPWIRE_KIND_FT << 4) | MSG_FT_POSITION, 0,
+        0x3F, 0x80, 0x00, 0x00,     // 1.0f
+        0xC0, 0x00, 0x00, 0x00,     // -2.0f
+        0x00, 0x00, 0x00, 0x00      // 0.0f
+    };
+    assert(len == sizeof(expect) && memcmp(wire, expect, len) == 0);
+
+    LD_MESSAGE id = {.type = MSG_LDR_ASSIGN_ID, .payload.assigned_id = 300};
+    len = tpwire_encode_ld(&id, wire, sizeof(wire));
+    /* zigzag(300) = 600 = 0xD8 0x04 as a varint, then epoch 0 and token 0 */
+    assert(len == 7 && wire[3] == 0xD8 && wire[4] == 0x04 && wire[5] == 0x00 && wire[6] == 0x00);
+    printf("[PASS] explicit byte layout\n");
+}
+
+/* Wrong version, wrong kind, truncation and trailing bytes are all rejected */
+static void test_reject(void) {
+    LD_MESSAGE m = {.type = MSG_LDR_SPAWN};
+    fill_clock(&m.matrix_clock);
+    unsigned char wire[TPWIRE_MAX];
+    size_t len = tpwire_encode_ld(&m, wire, sizeof(wire));
+    LD_MESSAGE out;
+    FT_MESSAGE ft;
+
+    for (size_t cut = 0; cut < len; cut++) {
+        assert(tpwire_decode_ld(wire, cut, &out) == -1);
+    }
+    wire[len] = 0;
+    assert(tpwire_decode_ld(wire, len + 1, &out) == -1);
+    assert(tpwire_decode_ft(wire, len, &ft) == -1);
+
+    wire[0] = TPWIRE_VERSION + 1;
+    assert(tpwire_decode_ld(wire, len, &out) == -1);
+    wire[0] = TPWIRE_VERSION;
+    wire[1] = (TPWIRE_KIND_LD << 4) | 0x0F;
+    assert(tpwire_decode_ld(wire, len, &out) == -1);
+
+    /* Too small an output buffer reports 0 instead of overrunning */
+    assert(tpwire_encode_ld(&m, wire, 10) == 0);
+    assert(tpwire_encode_ld(&m, wire, 2) == 0);
+    printf("[PASS] malformed input rejected\n");
+}
+
+/* Delta clocks: only changed entries travel, the receiver rebuilds the full
+ * clock, and uncommitted (sheddable) messages can be lost without desync */
+static void test_clock_delta(void) {
+    MatrixClock sent, received, clock;
+    mc_init(&sent);
+    mc_init(&received);
+    fill_clock(&clock);
+
+    unsigned char wire[TPWIRE_MAX];
+    LD_MESSAGE m = {.type = MSG_LDR_EMERGENCY_BRAKE}, out;
+
+    /* First committed message carries every non-zero entry */
+    m.matrix_clock = clock;
+    size_t first = tpwire_encode_ld_delta(&m, &sent, 1, wire, sizeof(wire));
+    assert(tpwire_decode_ld_delta(wire, first, &received, &out) == 0);
+    assert(memcmp(&out.matrix_clock, &clock, sizeof(clock)) == 0);
+    assert(memcmp(&received, &clock, sizeof(clock)) == 0);
+
+    /* One local tick: a single (index, +1) pair */
+    clock.mc[0][0]++;
+    m.matrix_clock = clock;
+    size_t len = tpwire_encode_ld_delta(&m, &sent, 1, wire, sizeof(wire));
+    assert(len == 3 + 1 + 1 + 1);
+    assert(tpwire_decode_ld_delta(wire, len, &received, &out) == 0);
+    assert(out.matrix_clock.mc[0][0] == clock.mc[0][0]);
+    assert(memcmp(&out.matrix_clock, &clock, sizeof(clock)) == 0);
+
+    /* Unchanged clock: no clock section, receiver still sees the full clock */
+    len = tpwire_encode_ld_delta(&m, &sent, 1, wire, sizeof(wire));
+    assert(len == 3);
+    assert(tpwire_decode_ld_delta(wire, len, &received, &out) == 0);
+    assert(memcmp(&out.matrix_clock, &clock, sizeof(clock)) == 0);
+
+    /* Two uncommitted messages; the first is shed before it reaches the peer */
+    clock.mc[0][0]++;
+    clock.mc[2][1] += 5;
+    m.matrix_clock = clock;
+    tpwire_encode_ld_delta(&m, &sent, 0, wire, sizeof(wire));        /* dropped */
+    clock.mc[0][0]++;
+    m.matrix_clock = clock;
+    len = tpwire_encode_ld_delta(&m, &sent, 0, wire, sizeof(wire));
+    assert(tpwire_decode_ld_delta(wire, len, &received, &out) == 0);
+    assert(memcmp(&out.matrix_clock, &clock, sizeof(clock)) == 0);
+
+    /* Then a committed one still lines up with the receiver's base */
+    clock.mc[3][3]++;
+    m.matrix_clock = clock;
+    len = tpwire_encode_ld_delta(&m, &sent, 1, wire, sizeof(wire));
+    assert(tpwire_decode_ld_delta(wire, len, &received, &out) == 0);
+    assert(memcmp(&out.matrix_clock, &clock, sizeof(clock)) == 0);
+    assert(memcmp(&sent, &received, sizeof(sent)) == 0);
+
+    /* A delta without a base, or with an out-of-range index, is rejected */
+    clock.mc[1][1]++;
+    m.matrix_clock = clock;
+    len = tpwire_encode_ld_delta(&m, &sent, 1, wire, sizeof(wire));
+    assert(tpwire_decode_ld(wire, len, &out) == -1);
+    wire[4] = NUM_TRUCKS * NUM_TRUCKS;
+    assert(tpwire_decode_ld_delta(wire, len, &received, &out) == -1);
+    printf("[PASS] delta clock\n");
+}
+
+/* Multicast datagrams: sequenced commands, the join message and the gap detector */
+static void test_sequenced(void) {
+    unsigned char wire[TPWIRE_MAX];
+    LD_MESSAGE cmd = {.type = MSG_LDR_CMD}, out;
+    cmd.payload.cmd.command_id = 9;
+    cmd.payload.cmd.leader.speed = 55.0f;
+    fill_clock(&cmd.matrix_clock);
+
+    uint32_t seq = 0;
+    size_t len = tpwire_encode_ld_seq(&cmd, 70000, wire, sizeof(wire));
+    assert(tpwire_decode_ld_seq(wire, len, &seq, &out) == 0);
+    assert(seq == 70000 && out.payload.cmd.command_id == 9 && out.payload.cmd.leader.speed == 55.0f);
+    assert(memcmp(&out.matrix_clock, &cmd.matrix_clock, sizeof(MatrixClock)) == 0);
+    /* A sequenced datagram is not a stream message, and vice versa */
+    assert(tpwire_decode_ld(wire, len, &out) == -1);
+    len = tpwire_encode_ld(&cmd, wire, sizeof(wire));
+    assert(tpwire_decode_ld_seq(wire, len, &seq, &out) == -1);
+
+    LD_MESSAGE join = {.type = MSG_LDR_MCAST_JOIN};
+    strcpy(join.payload.mcast.group.ip, LEADER_MCAST_GROUP);
+    join.payload.mcast.group.udp_port = LEADER_MCAST_PORT;
+    join.payload.mcast.next_seq = 123;
+    out = roundtrip_ld(&join, NULL);
+    assert(strcmp(out.payload.mcast.group.ip, LEADER_MCAST_GROUP) == 0);
+    assert(out.payload.mcast.group.udp_port == LEADER_MCAST_PORT && out.payload.mcast.next_seq == 123);
+
+    /* Heartbeats go out on the group too */
+    LD_MESSAGE beat = {.type = MSG_LDR_HEARTBEAT};
+    beat.payload.cmd.command_id = 9;
+    len = tpwire_encode_ld_seq(&beat, 70001, wire, sizeof(wire));
+    assert(tpwire_decode_ld_seq(wire, len, &seq, &out) == 0);
+    assert(seq == 70001 && out.type == MSG_LDR_HEARTBEAT && out.payload.cmd.command_id == 9);
+
+    uint32_t next = 10;
+    assert(tpwire_seq_check(&next, 10) == 0 && next == 11);
+    assert(tpwire_seq_check(&next, 14) == 3 && next == 15);   /* 11..13 lost */
+    assert(tpwire_seq_check(&next, 12) == -1 && next == 15);  /* late duplicate */
+    next = 0xFFFFFFFEu;                                        /* wrap-around */
+    assert(tpwire_seq_check(&next, 0xFFFFFFFEu) == 0);
+    assert(tpwire_seq_check(&next, 1) == 2 && next == 2);
+    printf("[PASS] sequenced datagrams and gap detector\n");
+}
+
+int main(void) {
+    printf("Starting wire encoding test...\n");
+    test_ld_roundtrip();
+    test_ft_reg_roundtrip();
+    test_layout();
+    test_reject();
+    test_clock_delta();
+    test_sequenced();
+    printf("Wire encoding test passed\n");
+    return 0;
+}
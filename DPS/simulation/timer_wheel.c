@@ -0,0 +1,279 @@
+//File: timer_wheel.c
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/timerfd.h>
+
+#include "timer_wheel.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TICK_NS ((uint64_t)TIMER_WHEEL_TICK_MS * 1000000ULL)
+
+#if (TIMER_WHEEL_SLOTS & SLOT_MASK) != 0
+#error "TIMER_WHEEL_SLOTS must be a power of two"
+#endif
+
+/* One expiry copied out of the wheel, delivered after the lock is dropped */
+typedef struct {
+    EventQueue* queue;
+    Event event;
+    TimerFn fn;
+    void* arg;
+    uint32_t count;                // periods that elapsed (periodic catch-up)
+} TimerFired;
+
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t current_tick(const TimerWheel* tw) {
+    return (monotonic_ns() - tw->origin_ns) / TICK_NS;
+}
+
+static uint32_t ms_to_ticks(uint32_t ms) {
+    uint32_t ticks = (ms + TIMER_WHEEL_TICK_MS - 1) / TIMER_WHEEL_TICK_MS;
+    return ticks ? ticks : 1;
+}
+
+/* Program the one-shot timerfd for an absolute tick (0 disarms) */
+static void program_timerfd(TimerWheel* tw, uint64_t tick) {
+    struct itimerspec its = {0};
+    if (tick) {
+        uint64_t at = tw->origin_ns + tick * TICK_NS;
+        its.it_value.tv_sec = (time_t)(at / 1000000000ULL);
+        its.it_value.tv_nsec = (long)(at % 1000000000ULL);
+    }
+    if (timerfd_settime(tw->tfd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+        perror("timerfd_settime");
+    }
+    tw->deadline = tick;
+}
+
+
+/* Slot list helpers (caller holds tw->lock) */
+static void slot_insert(TimerWheel* tw, int32_t idx) {
+    TimerNode* n = &tw->nodes[idx];
+    int32_t* head = &tw->slots[n->expires & SLOT_MASK];
+    n->prev = -1;
+    n->next = *head;
+    if (*head >= 0) tw->nodes[*head].prev = idx;
+    *head = idx;
+}
+
+static void slot_remove(TimerWheel* tw, int32_t idx) {
+    TimerNode* n = &tw->nodes[idx];
+    if (n->prev >= 0) tw->nodes[n->prev].next = n->next;
+    else tw->slots[n->expires & SLOT_MASK] = n->next;
+    if (n->next >= 0) tw->nodes[n->next].prev = n->prev;
+}
+
+static void node_release(TimerWheel* tw, int32_t idx) {
+    TimerNode* n = &tw->nodes[idx];
+    n->armed = 0;
+    n->gen++;
+    n->next = tw->free_head;
+    tw->free_head = idx;
+    tw->armed_count--;
+}
+
+static TimerId node_id(const TimerWheel* tw, int32_t idx) {
+    return ((tw->nodes[idx].gen & 0xFFFFFFu) << 8) | (uint32_t)(idx + 1);
+}
+
+/* Earliest pending expiry, 0 if the wheel is empty */
+static uint64_t next_deadline(const TimerWheel* tw) {
+    uint64_t best = 0;
+    if (tw->armed_count == 0) return 0;
+    for (int i = 0; i < TIMER_WHEEL_MAX; i++) {
+        const TimerNode* n = &tw->nodes[i];
+        if (n->armed && (best == 0 || n->expires < best)) best = n->expires;
+    }
+    return best;
+}
+
+
+static TimerId timer_arm(TimerWheel* tw, uint32_t delay_ms, uint32_t period_ms,
+                         EventQueue* queue, const Event* event, TimerFn fn, void* arg) {
+    pthread_mutex_lock(&tw->lock);
+    int32_t idx = tw->free_head;
+    if (idx < 0 || !tw->running) {
+        pthread_mutex_unlock(&tw->lock);
+        return TIMER_INVALID;
+    }
+    TimerNode* n = &tw->nodes[idx];
+    tw->free_head = n->next;
+
+    n->armed = 1;
+    n->expires = current_tick(tw) + ms_to_ticks(delay_ms);
+    n->period_ticks = period_ms ? ms_to_ticks(period_ms) : 0;
+    n->queue = queue;
+    if (event) n->event = *event;
+    n->fn = fn;
+    n->arg = arg;
+    slot_insert(tw, idx);
+    tw->armed_count++;
+
+    if (tw->deadline == 0 || n->expires < tw->deadline) {
+        program_timerfd(tw, n->expires);
+    }
+    TimerId id = node_id(tw, idx);
+    pthread_mutex_unlock(&tw->lock);
+    return id;
+}
+
+//FUNC: Arm a timer that posts a copy of *event
+TimerId timer_arm_event(TimerWheel* tw, uint32_t delay_ms, uint32_t period_ms,
+                        EventQueue* queue, const Event* event) {
+    return timer_arm(tw, delay_ms, period_ms, queue, event, NULL, NULL);
+}
+
+//FUNC: Arm a timer that calls fn(arg) on the timer thread
+TimerId timer_arm_fn(TimerWheel* tw, uint32_t delay_ms, uint32_t period_ms,
+                     TimerFn fn, void* arg) {
+    return timer_arm(tw, delay_ms, period_ms, NULL, NULL, fn, arg);
+}
+
+//FUNC: Cancel a pending timer
+int timer_cancel(TimerWheel* tw, TimerId id) {
+    int32_t idx = (int32_t)(id & 0xFFu) - 1;
+    if (id == TIMER_INVALID || idx < 0 || idx >= TIMER_WHEEL_MAX) return 0;
+
+    pthread_mutex_lock(&tw->lock);
+    TimerNode* n = &tw->nodes[idx];
+    int ok = n->armed && node_id(tw, idx) == id;
+    if (ok) {
+        slot_remove(tw, idx);
+        node_release(tw, idx);
+        /* The timerfd may stay armed for this deadline; the thread then
+         * finds nothing due and reprograms for the next one. */
+    }
+    pthread_mutex_unlock(&tw->lock);
+    return ok;
+}
+
+
+/* Expire every slot between the last processed tick and now (caller holds lock) */
+static int wheel_advance(TimerWheel* tw, uint64_t now, TimerFired* fired) {
+    int nfired = 0;
+    uint64_t span = now - tw->processed;
+    if (span > TIMER_WHEEL_SLOTS) span = TIMER_WHEEL_SLOTS; // every slot once
+
+    for (uint64_t k = 1; k <= span; k++) {
+        int32_t idx = tw->slots[(tw->processed + k) & SLOT_MASK];
+        while (idx >= 0) {
+            TimerNode* n = &tw->nodes[idx];
+            int32_t next = n->next;
+            if (n->expires <= now) {
+                TimerFired* f = &fired[nfired++];
+                f->queue = n->queue;
+                f->event = n->event;
+                f->fn = n->fn;
+                f->arg = n->arg;
+                f->count = 1;
+
+                slot_remove(tw, idx);
+                if (n->period_ticks) {
+                    n->expires += n->period_ticks;
+                    while (n->expires <= now) {
+                        n->expires += n->period_ticks;
+                        f->count++;
+                    }
+                    slot_insert(tw, idx);
+                } else {
+                    node_release(tw, idx);
+                }
+            }
+            idx = next;
+        }
+    }
+    tw->processed = now;
+    return nfired;
+}
+
+static void* timer_wheel_thread(void* arg) {
+    TimerWheel* tw = arg;
+    TimerFired fired[TIMER_WHEEL_MAX];
+
+    for (;;) {
+        uint64_t expirations;
+        ssize_t rr = read(tw->tfd, &expirations, sizeof(expirations));
+        if (rr < 0 && errno == EINTR) continue;
+
+        pthread_mutex_lock(&tw->lock);
+        if (!tw->running) {
+            pthread_mutex_unlock(&tw->lock);
+            break;
+        }
+        int nfired = wheel_advance(tw, current_tick(tw), fired);
+        program_timerfd(tw, next_deadline(tw));
+        pthread_mutex_unlock(&tw->lock);
+
+        for (int i = 0; i < nfired; i++) {
+            for (uint32_t c = 0; c < fired[i].count; c++) {
+                if (fired[i].fn) fired[i].fn(fired[i].arg);
+                else push_event(fired[i].queue, &fired[i].event);
+            }
+        }
+    }
+    return NULL;
+}
+
+
+//FUNC: Create the timerfd and start the service thread
+int timer_wheel_start(TimerWheel* tw) {
+    memset(tw, 0, sizeof(*tw));
+    for (int s = 0; s < TIMER_WHEEL_SLOTS; s++) {
+        tw->slots[s] = -1;
+    }
+    for (int i = 0; i < TIMER_WHEEL_MAX; i++) {
+        tw->nodes[i].next = (i + 1 < TIMER_WHEEL_MAX) ? i + 1 : -1;
+    }
+    tw->free_head = 0;
+
+    tw->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (tw->tfd < 0) {
+        perror("timerfd_create");
+        return -1;
+    }
+    pthread_mutex_init(&tw->lock, NULL);
+    tw->origin_ns = monotonic_ns();
+    tw->running = 1;
+
+    if (pthread_create(&tw->tid, NULL, timer_wheel_thread, tw) != 0) {
+        perror("pthread_create timer");
+        close(tw->tfd);
+        tw->tfd = -1;
+        tw->running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+//FUNC: Stop the service thread
+void timer_wheel_stop(TimerWheel* tw) {
+    if (tw->tfd < 0) return;
+
+    pthread_mutex_lock(&tw->lock);
+    if (!tw->running) {
+        pthread_mutex_unlock(&tw->lock);
+        return;
+    }
+    tw->running = 0;
+    /* Fire immediately so the blocked read() returns */
+    struct itimerspec its = {.it_value = {.tv_sec = 0, .tv_nsec = 1}};
+    timerfd_settime(tw->tfd, 0, &its, NULL);
+    pthread_mutex_unlock(&tw->lock);
+
+    pthread_join(tw->tid, NULL);
+    close(tw->tfd);
+    tw->tfd = -1;
+    pthread_mutex_destroy(&tw->lock);
+}
@@ -0,0 +1,77 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "event.h"
+
+/* Timer service: one thread, one timerfd, one hashed timing wheel.
+ * Timers live in a preallocated node pool (no malloc, no thread per timer) and
+ * sit in the wheel slot of their absolute expiry tick, so arm/cancel are O(1).
+ * The timerfd is one-shot and always programmed for the earliest deadline, so
+ * an idle wheel does not wake up at all.
+ * On expiry a timer either posts a copy of its Event to an EventQueue or calls
+ * a function on the timer thread; periodic timers are rescheduled from their
+ * previous deadline so they do not drift.
+ */
+#define TIMER_WHEEL_TICK_MS 5      // resolution
+#define TIMER_WHEEL_SLOTS 256      // power of two; one revolution = 1.28 s
+#define TIMER_WHEEL_MAX 64         // concurrent timers
+
+#if TIMER_WHEEL_MAX > 255
+#error "TimerId packs the node index into 8 bits"
+#endif
+
+typedef uint32_t TimerId;          // (generation << 8) | (index + 1); 0 = none
+#define TIMER_INVALID 0u
+
+typedef void (*TimerFn)(void* arg);
+
+typedef struct {
+    int32_t prev, next;            // slot list links, -1 terminated
+    uint32_t gen;                  // bumped on release so stale ids never match
+    uint8_t armed;
+    uint64_t expires;              // absolute tick
+    uint32_t period_ticks;         // 0 = one-shot
+    EventQueue* queue;             // post mode
+    Event event;
+    TimerFn fn;                    // callback mode
+    void* arg;
+} TimerNode;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_t tid;
+    int tfd;
+    int running;
+    uint64_t origin_ns;            // CLOCK_MONOTONIC at tick 0
+    uint64_t processed;            // last tick whose slot was expired
+    uint64_t deadline;             // tick the timerfd is armed for (0 = disarmed)
+    int32_t slots[TIMER_WHEEL_SLOTS];
+    int32_t free_head;
+    uint32_t armed_count;
+    TimerNode nodes[TIMER_WHEEL_MAX];
+} TimerWheel;
+
+/* Create the timerfd and start the service thread. Returns 0, or -1 on error. */
+int timer_wheel_start(TimerWheel* tw);
+
+/* Stop the thread and release the timerfd; pending timers are discarded */
+void timer_wheel_stop(TimerWheel* tw);
+
+/* Post *event to queue after delay_ms, then every period_ms (0 = once).
+ * Returns TIMER_INVALID if all TIMER_WHEEL_MAX timers are in use. */
+TimerId timer_arm_event(TimerWheel* tw, uint32_t delay_ms, uint32_t period_ms,
+                        EventQueue* queue, const Event* event);
+
+/* Same, but call fn(arg) on the timer thread. fn must not block for long. */
+TimerId timer_arm_fn(TimerWheel* tw, uint32_t delay_ms, uint32_t period_ms,
+                     TimerFn fn, void* arg);
+
+/* Returns 1 if the timer was pending and is now cancelled, 0 if it already fired
+ * (one-shot) or the id is stale. An expiry being delivered concurrently may still
+ * reach the queue. */
+int timer_cancel(TimerWheel* tw, TimerId id);
+
+#endif
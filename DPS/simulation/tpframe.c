@@ -0,0 +1,146 @@
+//File: tpframe.c
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "tpframe.h"
+#include "tpshm.h"
+
+#define RING_MASK (TPFRAME_RX_RING - 1)
+
+#if (TPFRAME_RX_RING & RING_MASK) != 0 || TPFRAME_RX_RING < TPFRAME_HDR + TPFRAME_MAX_PAYLOAD
+#error "TPFRAME_RX_RING must be a power of two that holds a full frame"
+#endif
+
+void tpframe_write_header(unsigned char* out, size_t len) {
+    out[0] = (unsigned char)(len >> 24);
+    out[1] = (unsigned char)(len >> 16);
+    out[2] = (unsigned char)(len >> 8);
+    out[3] = (unsigned char)len;
+}
+
+size_t tpframe_encode(unsigned char* out, const void* payload, size_t len) {
+    tpframe_write_header(out, len);
+    memcpy(out + TPFRAME_HDR, payload, len);
+    return TPFRAME_HDR + len;
+}
+
+int tpframe_send(int fd, const void* payload, size_t len) {
+    unsigned char frame[TPFRAME_HDR + TPFRAME_MAX_PAYLOAD];
+    if (len > TPFRAME_MAX_PAYLOAD) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+    size_t total = tpframe_encode(frame, payload, len);
+
+    int shm = tpshm_is_link(fd);
+    size_t off = 0;
+    while (off < total) {
+        ssize_t n = shm ? tpshm_send(fd, frame + off, total - off)
+                        : send(fd, frame + off, total - off, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (shm && errno == EAGAIN) {
+                /* A link never blocks: wait for the peer to make room, as send() would */
+                struct timespec ts = {.tv_sec = 0, .tv_nsec = 200000L};
+                nanosleep(&ts, NULL);
+                continue;
+            }
+            return -1;
+        }
+        off += (size_t)n;
+    }
+    return 0;
+}
+
+void frame_decoder_reset(FrameDecoder* d) {
+    d->head = 0;
+    d->len = 0;
+}
+
+size_t frame_decoder_room(const FrameDecoder* d) {
+    return TPFRAME_RX_RING - d->len;
+}
+
+ssize_t frame_decoder_fill(FrameDecoder* d, int fd) {
+    size_t room = frame_decoder_room(d);
+    if (room == 0) {
+        /* Only reachable if the caller stopped calling frame_decoder_next() */
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    /* Free space is [tail, end) and, if it wraps, [0, head) */
+    uint32_t tail = (d->head + d->len) & RING_MASK;
+    struct iovec iov[2];
+    int iovcnt = 1;
+    iov[0].iov_base = d->buf + tail;
+    if (tail >= d->head) {
+        iov[0].iov_len = TPFRAME_RX_RING - tail;
+        if (d->head > 0) {
+            iov[1].iov_base = d->buf;
+            iov[1].iov_len = d->head;
+            iovcnt = 2;
+        }
+    } else {
+        iov[0].iov_len = room;
+    }
+
+    struct msghdr mh = {.msg_iov = iov, .msg_iovlen = (size_t)iovcnt};
+    ssize_t n;
+    do {
+        n = recvmsg(fd, &mh, MSG_DONTWAIT);
+    } while (n < 0 && errno == EINTR);
+
+    if (n > 0) d->len += (uint32_t)n;
+    return n;
+}
+
+int frame_decoder_feed(FrameDecoder* d, const void* data, size_t len) {
+    if (len > frame_decoder_room(d)) return -1;
+    uint32_t tail = (d->head + d->len) & RING_MASK;
+    size_t first = TPFRAME_RX_RING - tail;
+    if (first >= len) {
+        memcpy(d->buf + tail, data, len);
+    } else {
+        memcpy(d->buf + tail, data, first);
+        memcpy(d->buf, (const unsigned char*)data + first, len - first);
+    }
+    d->len += (uint32_t)len;
+    return 0;
+}
+
+/* Copy len bytes starting at ring offset off */
+static void ring_copy(const FrameDecoder* d, uint32_t off, void* out, size_t len) {
+    uint32_t start = (d->head + off) & RING_MASK;
+    size_t first = TPFRAME_RX_RING - start;
+    if (first >= len) {
+        memcpy(out, d->buf + start, len);
+    } else {
+        memcpy(out, d->buf + start, first);
+        memcpy((unsigned char*)out + first, d->buf, len - first);
+    }
+}
+
+int frame_decoder_next(FrameDecoder* d, void* out, size_t cap, size_t* out_len) {
+    if (d->len < TPFRAME_HDR) return 0;
+
+    unsigned char hdr[TPFRAME_HDR];
+    ring_copy(d, 0, hdr, TPFRAME_HDR);
+    uint32_t len = ((uint32_t)hdr[0] << 24) | ((uint32_t)hdr[1] << 16) |
+                   ((uint32_t)hdr[2] << 8) | (uint32_t)hdr[3];
+    if (len > TPFRAME_MAX_PAYLOAD || len > cap) return -1;
+    if (d->len < TPFRAME_HDR + len) return 0;
+
+    ring_copy(d, TPFRAME_HDR, out, len);
+    d->head = (d->head + TPFRAME_HDR + len) & RING_MASK;
+    d->len -= TPFRAME_HDR + len;
+    if (d->len == 0) d->head = 0; // keep the next read contiguous
+    *out_len = len;
+    return 1;
+}
@@ -0,0 +1,55 @@
+#ifndef TPFRAME_H
+#define TPFRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Length-prefixed framing for the leader/follower TCP stream.
+ * Every message is sent as a 4-byte big-endian payload length followed by the
+ * payload, so the receiver can split a byte stream back into messages no matter
+ * how TCP coalesced or fragmented them.
+ *
+ * FrameDecoder is a per-connection receive ring: frame_decoder_fill() reads
+ * everything the socket has (one recvmsg, both free regions of the ring), and
+ * frame_decoder_next() then yields each complete frame in turn. Bytes that an
+ * I/O backend already received go in with frame_decoder_feed() instead.
+ */
+#define TPFRAME_HDR 4
+#define TPFRAME_MAX_PAYLOAD 1024
+#define TPFRAME_RX_RING 4096     // power of two, > TPFRAME_HDR + TPFRAME_MAX_PAYLOAD
+
+typedef struct {
+    unsigned char buf[TPFRAME_RX_RING];
+    uint32_t head;               // offset of the first unread byte
+    uint32_t len;                // unread bytes
+} FrameDecoder;
+
+/* Write just the 4-byte header for a len-byte payload placed right after it */
+void tpframe_write_header(unsigned char* out, size_t len);
+
+/* Write header + payload to out (TPFRAME_HDR + len bytes). Returns the frame size. */
+size_t tpframe_encode(unsigned char* out, const void* payload, size_t len);
+
+/* Frame and send a payload on a blocking socket. Returns 0, or -1 on error. */
+int tpframe_send(int fd, const void* payload, size_t len);
+
+void frame_decoder_reset(FrameDecoder* d);
+
+/* Free space in the ring; a fill that returns less than this drained the socket */
+size_t frame_decoder_room(const FrameDecoder* d);
+
+/* One non-blocking read into the ring. Returns bytes read, 0 on EOF, -1 on error
+ * (errno EAGAIN/EWOULDBLOCK when nothing was pending). */
+ssize_t frame_decoder_fill(FrameDecoder* d, int fd);
+
+/* Append bytes that were received elsewhere (a posted tpio receive).
+ * 0, or -1 if they do not fit. */
+int frame_decoder_feed(FrameDecoder* d, const void* data, size_t len);
+
+/* Copy the next complete payload into out. Returns 1 and sets *out_len, 0 if no
+ * complete frame is buffered, -1 if the stream is malformed (length above
+ * TPFRAME_MAX_PAYLOAD or above cap). */
+int frame_decoder_next(FrameDecoder* d, void* out, size_t cap, size_t* out_len);
+
+#endif
@@ -0,0 +1,647 @@
+//File: tpio.c
+
+#define _GNU_SOURCE /* syscall(), POLLRDHUP */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#if defined(__NR_io_uring_setup) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define TPIO_HAVE_URING 1
+#endif
+#endif
+
+#include "tpio.h"
+#include "tpshm.h"
+
+#define TPIO_EPOLL_MAX 64
+
+static void count_syscalls(TpIo* io, uint64_t n) {
+    __atomic_fetch_add(&io->syscalls, n, __ATOMIC_RELAXED);
+}
+
+/* Watch slot for fd, grown on demand (lock held) */
+static TpIoWatch* watch_slot(TpIo* io, int fd) {
+    if (fd >= io->watch_cap) {
+        int cap = io->watch_cap ? io->watch_cap : 64;
+        while (cap <= fd) cap *= 2;
+        TpIoWatch* grown = realloc(io->watches, sizeof(*grown) * (size_t)cap);
+        if (!grown) return NULL;
+        memset(grown + io->watch_cap, 0, sizeof(*grown) * (size_t)(cap - io->watch_cap));
+        io->watches = grown;
+        io->watch_cap = cap;
+    }
+    return &io->watches[fd];
+}
+
+/* Queue fd for the next wait: another receive (POSIX) or a re-posted one (io_uring) */
+static void again_push(TpIo* io, int fd) {
+    TpIoWatch* w = &io->watches[fd];
+    if (w->again) return;
+    if (io->again_len == io->again_cap) {
+        int cap = io->again_cap ? io->again_cap * 2 : 64;
+        int* grown = realloc(io->again, sizeof(*grown) * (size_t)cap);
+        if (!grown) return;
+        io->again = grown;
+        io->again_cap = cap;
+    }
+    io->again[io->again_len++] = fd;
+    w->again = 1;
+}
+
+/* ---- POSIX backend: epoll + recv/sendmsg ---- */
+
+static int posix_open(TpIo* io) {
+    io->fd = epoll_create1(EPOLL_CLOEXEC);
+    count_syscalls(io, 1);
+    if (io->fd < 0) return -1;
+    io->kind = TPIO_POSIX;
+    return 0;
+}
+
+static int epoll_set(TpIo* io, int fd, struct epoll_event* ee) {
+    count_syscalls(io, 1);
+    if (epoll_ctl(io->fd, EPOLL_CTL_ADD, fd, ee) == 0) return 0;
+    if (errno != EEXIST) return -1;
+    count_syscalls(io, 1);
+    return epoll_ctl(io->fd, EPOLL_CTL_MOD, fd, ee);
+}
+
+static int posix_watch(TpIo* io, TpIoWatch* w, int fd) {
+    uint32_t ev = EPOLLET;
+    if (w->events & (TPIO_IN | TPIO_RECV)) ev |= EPOLLIN | EPOLLRDHUP;
+    if (w->events & TPIO_OUT) ev |= EPOLLOUT;
+    struct epoll_event ee = {.events = ev, .data.u64 = ((uint64_t)w->gen << 32) | (uint32_t)fd};
+    if (epoll_set(io, fd, &ee) < 0) return -1;
+    if (!w->shm) return 0;
+
+    /* Shared-memory link: the socket reports hang-ups, the doorbell new data
+     * and freed room. Both edges map to fd's watch. */
+    struct epoll_event bell = {.events = EPOLLIN | EPOLLET, .data.u64 = ee.data.u64};
+    return epoll_set(io, tpshm_rx_fd(fd), &bell);
+}
+
+/* One receive into the watch buffer. 1 = event filled in, 0 = nothing queued. */
+static int posix_recv(TpIo* io, TpIoWatch* w, int fd, TpIoEvent* ev) {
+    ssize_t n;
+    if (w->shm) {
+        n = tpshm_recv(fd, w->buf, TPIO_RECV_BUF);
+    } else {
+        do {
+            n = recv(fd, w->buf, TPIO_RECV_BUF, MSG_DONTWAIT);
+            count_syscalls(io, 1);
+        } while (n < 0 && errno == EINTR);
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+
+    ev->events |= TPIO_RECV;
+    ev->res = n < 0 ? -errno : (int)n;
+    ev->data = w->buf;
+    /* More may be queued behind a datagram or a full buffer; the edge will not repeat */
+    if (n > 0 && (!w->stream || n == TPIO_RECV_BUF)) again_push(io, fd);
+    return 1;
+}
+
+static int posix_wait(TpIo* io, TpIoEvent* out, int max, int timeout_ms) {
+    int n = 0;
+
+    /* Sockets that may still hold data get one receive each, ahead of new edges.
+     * Entries are re-queued at or before the slot being read. */
+    pthread_mutex_lock(&io->lock);
+    int len = io->again_len;
+    io->again_len = 0;
+    for (int i = 0; i < len; i++) {
+        int fd = io->again[i];
+        TpIoWatch* w = &io->watches[fd];
+        w->again = 0;
+        if (!w->active || !(w->events & TPIO_RECV)) continue;
+        if (n == max) {
+            again_push(io, fd);
+            continue;
+        }
+        out[n] = (TpIoEvent){.token = w->token, .fd = fd};
+        n += posix_recv(io, w, fd, &out[n]);
+    }
+    pthread_mutex_unlock(&io->lock);
+    if (n == max) return n;
+
+    struct epoll_event ready[TPIO_EPOLL_MAX];
+    int room = max - n < TPIO_EPOLL_MAX ? max - n : TPIO_EPOLL_MAX;
+    int nready = epoll_wait(io->fd, ready, room, n ? 0 : timeout_ms);
+    count_syscalls(io, 1);
+    if (nready < 0) return (errno == EINTR || n) ? n : -1;
+
+    pthread_mutex_lock(&io->lock);
+    for (int k = 0; k < nready; k++) {
+        int fd = (int)(uint32_t)ready[k].data.u64;
+        uint32_t gen = (uint32_t)(ready[k].data.u64 >> 32);
+        TpIoWatch* w = fd < io->watch_cap ? &io->watches[fd] : NULL;
+        if (!w || !w->active || w->gen != gen) continue;
+
+        uint32_t e = ready[k].events;
+        TpIoEvent ev = {.token = w->token, .fd = fd};
+        if (w->shm) {
+            if (e & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) tpshm_hangup(fd);
+            /* A doorbell may also mean the peer freed room */
+            if (e & EPOLLIN) e |= EPOLLOUT;
+        }
+        if (w->events & TPIO_RECV) {
+            if ((e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && !w->again) {
+                posix_recv(io, w, fd, &ev);
+            }
+        } else {
+            if ((w->events & TPIO_IN) && (e & EPOLLIN)) ev.events |= TPIO_IN;
+            if (e & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) ev.events |= TPIO_HUP;
+        }
+        if ((w->events & TPIO_OUT) && (e & EPOLLOUT)) ev.events |= TPIO_OUT;
+        if (ev.events) out[n++] = ev;
+    }
+    pthread_mutex_unlock(&io->lock);
+    return n;
+}
+
+static void posix_send_batch(TpIo* io, TpIoSend* ops, int n) {
+    for (int i = 0; i < n; i++) {
+        if (tpshm_is_link(ops[i].fd)) {
+            ssize_t r = tpshm_sendv(ops[i].fd, ops[i].iov, ops[i].iovcnt);
+            ops[i].res = r < 0 ? -errno : r;
+            continue;
+        }
+        struct msghdr mh = {.msg_iov = (struct iovec*)ops[i].iov, .msg_iovlen = (size_t)ops[i].iovcnt};
+        ssize_t r;
+        do {
+            r = sendmsg(ops[i].fd, &mh, MSG_DONTWAIT | MSG_NOSIGNAL);
+            count_syscalls(io, 1);
+        } while (r < 0 && errno == EINTR);
+        ops[i].res = r < 0 ? -errno : r;
+    }
+}
+
+/* ---- io_uring backend ---- */
+
+#ifdef TPIO_HAVE_URING
+
+struct TpIoRing {
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_array;
+    unsigned sq_mask, sq_entries;
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+    void* sq_map;
+    void* cq_map;
+    size_t sq_map_len, cq_map_len, sqes_len;
+    unsigned pending;               // SQEs queued since the last io_uring_enter()
+};
+
+/* user_data: op << 62 | (gen & GEN_MASK) << 32 | fd; send batches use the op index */
+enum { OP_SEND = 0, OP_POLL, OP_RECV, OP_CANCEL };
+#define GEN_MASK 0x3fffffffu
+
+static uint64_t ud_pack(uint64_t op, uint32_t gen, int fd) {
+    return (op << 62) | ((uint64_t)(gen & GEN_MASK) << 32) | (uint32_t)fd;
+}
+
+static int ring_enter(TpIo* io, unsigned submit, unsigned wait_nr, unsigned flags, const struct timespec* ts) {
+    count_syscalls(io, 1);
+    if (ts) {
+        struct io_uring_getevents_arg arg = {.ts = (uint64_t)(uintptr_t)ts};
+        return (int)syscall(__NR_io_uring_enter, io->fd, submit, wait_nr,
+                            flags | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    }
+    return (int)syscall(__NR_io_uring_enter, io->fd, submit, wait_nr, flags, NULL, 0);
+}
+
+/* Next free SQE, zeroed (lock held). Publish it with ring_push(). */
+static struct io_uring_sqe* ring_sqe(TpIo* io) {
+    TpIoRing* r = io->ring;
+    unsigned tail = *r->sq_tail;
+    if (tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries) {
+        /* Full: hand what is queued to the kernel first */
+        ring_enter(io, r->pending, 0, 0, NULL);
+        r->pending = 0;
+        if (tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->sq_entries) return NULL;
+    }
+    unsigned idx = tail & r->sq_mask;
+    memset(&r->sqes[idx], 0, sizeof(r->sqes[idx]));
+    r->sq_array[idx] = idx;
+    return &r->sqes[idx];
+}
+
+static void ring_push(TpIo* io) {
+    TpIoRing* r = io->ring;
+    __atomic_store_n(r->sq_tail, *r->sq_tail + 1, __ATOMIC_RELEASE);
+    r->pending++;
+}
+
+static void ring_poll(TpIo* io, TpIoWatch* w, int fd) {
+    uint32_t mask = 0;
+    if (w->events & TPIO_IN) mask |= POLLIN | POLLRDHUP;
+    if (w->events & TPIO_OUT) mask |= POLLOUT;
+    if (!mask) return;
+    struct io_uring_sqe* sqe = ring_sqe(io);
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = mask;      // multishot polls are edge-triggered
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = ud_pack(OP_POLL, w->gen, fd);
+    ring_push(io);
+}
+
+static void ring_recv(TpIo* io, TpIoWatch* w, int fd) {
+    struct io_uring_sqe* sqe = ring_sqe(io);
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)w->buf;
+    sqe->len = TPIO_RECV_BUF;
+    sqe->user_data = ud_pack(OP_RECV, w->gen, fd);
+    ring_push(io);
+    w->recv_posted = 1;
+}
+
+/* Cancel every request on fd; submitted right away so close(fd) really closes */
+static void ring_cancel(TpIo* io, int fd) {
+    struct io_uring_sqe* sqe = ring_sqe(io);
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = fd;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    sqe->user_data = ud_pack(OP_CANCEL, 0, fd);
+    ring_push(io);
+}
+
+static void ring_submit_now(TpIo* io) {
+    if (!io->ring->pending) return;
+    ring_enter(io, io->ring->pending, 0, 0, NULL);
+    io->ring->pending = 0;
+}
+
+static void ring_unmap(TpIoRing* r) {
+    if (r->sqes) munmap(r->sqes, r->sqes_len);
+    if (r->cq_map && r->cq_map != r->sq_map) munmap(r->cq_map, r->cq_map_len);
+    if (r->sq_map) munmap(r->sq_map, r->sq_map_len);
+    free(r);
+}
+
+static int uring_open(TpIo* io) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = IORING_SETUP_CQSIZE;
+    p.cq_entries = TPIO_RING_ENTRIES * 4;
+    int fd = (int)syscall(__NR_io_uring_setup, TPIO_RING_ENTRIES, &p);
+    count_syscalls(io, 1);
+    if (fd < 0) return -1;
+
+    /* Cancel-by-fd and edge-triggered multishot polls need 6.0+ (LINKED_FILE is from the same release) */
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_EXT_ARG) ||
+        !(p.features & IORING_FEAT_NODROP) || !(p.features & IORING_FEAT_LINKED_FILE)) {
+        close(fd);
+        errno = ENOSYS;
+        return -1;
+    }
+
+    TpIoRing* r = calloc(1, sizeof(*r));
+    if (!r) {
+        close(fd);
+        return -1;
+    }
+    size_t sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sq_map_len = r->cq_map_len = sq_len > cq_len ? sq_len : cq_len;
+    r->sq_map = mmap(NULL, r->sq_map_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (r->sq_map == MAP_FAILED || r->sqes == MAP_FAILED) {
+        if (r->sq_map == MAP_FAILED) r->sq_map = NULL;
+        if (r->sqes == MAP_FAILED) r->sqes = NULL;
+        ring_unmap(r);
+        close(fd);
+        return -1;
+    }
+    r->cq_map = r->sq_map;
+
+    unsigned char* sq = r->sq_map;
+    r->sq_head = (unsigned*)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    r->sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+    r->sq_entries = *(unsigned*)(sq + p.sq_off.ring_entries);
+    r->sq_array = (unsigned*)(sq + p.sq_off.array);
+    unsigned char* cq = r->cq_map;
+    r->cq_head = (unsigned*)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    r->cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+    io->fd = fd;
+    io->ring = r;
+    io->kind = TPIO_URING;
+    return 0;
+}
+
+static void uring_close(TpIo* io) {
+    ring_unmap(io->ring);
+    io->ring = NULL;
+}
+
+/* (Re)arm fd's requests for the current watch (lock held) */
+static void uring_watch(TpIo* io, TpIoWatch* w, int fd, int rewatch) {
+    if (rewatch) ring_cancel(io, fd);
+    ring_poll(io, w, fd);
+    if (w->events & TPIO_RECV) ring_recv(io, w, fd);
+    ring_submit_now(io);
+}
+
+/* One completion -> at most one event (lock held) */
+static int uring_complete(TpIo* io, const struct io_uring_cqe* cqe, TpIoEvent* ev) {
+    uint64_t op = cqe->user_data >> 62;
+    int fd = (int)(uint32_t)cqe->user_data;
+    uint32_t gen = (uint32_t)(cqe->user_data >> 32) & GEN_MASK;
+    if (op == OP_CANCEL || fd >= io->watch_cap) return 0;
+    TpIoWatch* w = &io->watches[fd];
+    if (!w->active || (w->gen & GEN_MASK) != gen || cqe->res == -ECANCELED) return 0;
+
+    *ev = (TpIoEvent){.token = w->token, .fd = fd};
+    if (op == OP_RECV) {
+        w->recv_posted = 0;
+        if (cqe->res == -EAGAIN || cqe->res == -EINTR) {
+            again_push(io, fd);
+            return 0;
+        }
+        ev->events = TPIO_RECV;
+        ev->res = cqe->res;
+        ev->data = w->buf;
+        /* Re-posted at the start of the next wait, once the caller is done with buf */
+        if (cqe->res > 0) again_push(io, fd);
+        return 1;
+    }
+
+    /* OP_POLL */
+    if (cqe->res < 0) {
+        ev->events = TPIO_HUP;
+        return 1;
+    }
+    if (!(cqe->flags & IORING_CQE_F_MORE)) ring_poll(io, w, fd); /* the kernel ended the multishot */
+    if ((w->events & TPIO_IN) && (cqe->res & POLLIN)) ev->events |= TPIO_IN;
+    if ((w->events & TPIO_OUT) && (cqe->res & POLLOUT)) ev->events |= TPIO_OUT;
+    /* Receive watches learn about hang-ups from the receive itself, as on POSIX */
+    if (!(w->events & TPIO_RECV) && (cqe->res & (POLLHUP | POLLERR | POLLRDHUP))) ev->events |= TPIO_HUP;
+    return ev->events != 0;
+}
+
+static int uring_wait(TpIo* io, TpIoEvent* out, int max, int timeout_ms) {
+    TpIoRing* r = io->ring;
+
+    /* Receives handed out by the previous wait go back into the ring with this enter */
+    pthread_mutex_lock(&io->lock);
+    for (int i = 0; i < io->again_len; i++) {
+        TpIoWatch* w = &io->watches[io->again[i]];
+        w->again = 0;
+        if (w->active && (w->events & TPIO_RECV) && !w->recv_posted) ring_recv(io, w, io->again[i]);
+    }
+    io->again_len = 0;
+    unsigned submit = r->pending;
+    r->pending = 0;
+    pthread_mutex_unlock(&io->lock);
+
+    int ready = *r->cq_head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    if (!ready && timeout_ms != 0) {
+        struct timespec ts = {.tv_sec = timeout_ms / 1000, .tv_nsec = (long)(timeout_ms % 1000) * 1000000L};
+        /* A blocking wait is a cancellation point, as epoll_wait() is; no lock is held here */
+        int oldtype;
+        pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+        int rc = ring_enter(io, submit, 1, IORING_ENTER_GETEVENTS, timeout_ms > 0 ? &ts : NULL);
+        int err = errno;
+        pthread_setcanceltype(oldtype, NULL);
+        if (rc < 0 && err != EINTR && err != ETIME && err != EBUSY) {
+            errno = err;
+            return -1;
+        }
+    } else if (submit) {
+        ring_enter(io, submit, 0, 0, NULL);
+    }
+
+    int n = 0;
+    pthread_mutex_lock(&io->lock);
+    unsigned head = *r->cq_head;
+    unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail && n < max) {
+        n += uring_complete(io, &r->cqes[head & r->cq_mask], &out[n]);
+        head++;
+    }
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&io->lock);
+    return n;
+}
+
+static int uring_send_batch(TpIo* io, TpIoSend* ops, int n) {
+    TpIoRing* r = io->ring;
+    struct msghdr mh[TPIO_RING_ENTRIES];
+
+    for (int done = 0; done < n;) {
+        int chunk = 0;
+        pthread_mutex_lock(&io->lock);
+        while (done + chunk < n && chunk < TPIO_RING_ENTRIES) {
+            TpIoSend* op = &ops[done + chunk];
+            struct io_uring_sqe* sqe = ring_sqe(io);
+            if (!sqe) break;
+            mh[chunk] = (struct msghdr){.msg_iov = (struct iovec*)op->iov, .msg_iovlen = (size_t)op->iovcnt};
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = op->fd;
+            sqe->addr = (uint64_t)(uintptr_t)&mh[chunk];
+            sqe->msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+            sqe->user_data = ud_pack(OP_SEND, 0, done + chunk);
+            ring_push(io);
+            chunk++;
+        }
+        unsigned submit = r->pending;
+        r->pending = 0;
+        pthread_mutex_unlock(&io->lock);
+        if (chunk == 0) return -1;
+
+        /* Non-blocking sends complete during submission: one enter for the chunk */
+        int got = 0, rc = ring_enter(io, submit, (unsigned)chunk, IORING_ENTER_GETEVENTS, NULL);
+        if (rc < 0 && errno != EINTR) return -1;
+        for (;;) {
+            unsigned head = *r->cq_head;
+            unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail; head++) {
+                const struct io_uring_cqe* cqe = &r->cqes[head & r->cq_mask];
+                int idx = (int)(uint32_t)cqe->user_data;
+                if (idx >= 0 && idx < n) ops[idx].res = cqe->res;
+                got++;
+            }
+            __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+            if (got >= chunk) break;
+            if (ring_enter(io, 0, (unsigned)(chunk - got), IORING_ENTER_GETEVENTS, NULL) < 0 && errno != EINTR) {
+                return -1;
+            }
+        }
+        done += chunk;
+    }
+    return 0;
+}
+
+#else /* !TPIO_HAVE_URING */
+
+struct TpIoRing {
+    int unused;
+};
+
+static int uring_open(TpIo* io) {
+    (void)io;
+    errno = ENOSYS;
+    return -1;
+}
+static void uring_close(TpIo* io) { (void)io; }
+static void uring_watch(TpIo* io, TpIoWatch* w, int fd, int rewatch) { (void)io; (void)w; (void)fd; (void)rewatch; }
+static void ring_cancel(TpIo* io, int fd) { (void)io; (void)fd; }
+static void ring_submit_now(TpIo* io) { (void)io; }
+static int uring_wait(TpIo* io, TpIoEvent* out, int max, int timeout_ms) {
+    (void)io; (void)out; (void)max; (void)timeout_ms;
+    return -1;
+}
+static int uring_send_batch(TpIo* io, TpIoSend* ops, int n) {
+    (void)io; (void)ops; (void)n;
+    return -1;
+}
+
+#endif
+
+/* ---- Public API ---- */
+
+int tpio_open(TpIo* io, TpIoKind kind) {
+    memset(io, 0, sizeof(*io));
+    io->fd = -1;
+    pthread_mutex_init(&io->lock, NULL);
+
+    const char* env = getenv("TP_IO");
+    if (kind == TPIO_AUTO && env && strcmp(env, "posix") == 0) kind = TPIO_POSIX;
+
+    if (kind != TPIO_POSIX && uring_open(io) == 0) return 0;
+    if (kind == TPIO_URING) {
+        pthread_mutex_destroy(&io->lock);
+        return -1;
+    }
+    if (posix_open(io) == 0) return 0;
+    pthread_mutex_destroy(&io->lock);
+    return -1;
+}
+
+void tpio_close(TpIo* io) {
+    if (io->kind == TPIO_URING) uring_close(io);
+    if (io->fd >= 0) close(io->fd);
+    for (int fd = 0; fd < io->watch_cap; fd++) free(io->watches[fd].buf);
+    free(io->watches);
+    free(io->again);
+    pthread_mutex_destroy(&io->lock);
+    memset(io, 0, sizeof(*io));
+    io->fd = -1;
+}
+
+const char* tpio_name(const TpIo* io) {
+    return io->kind == TPIO_URING ? "io_uring" : "epoll";
+}
+
+int tpio_watch(TpIo* io, int fd, uint32_t events, uint64_t token) {
+    if (fd < 0 || !(events & (TPIO_IN | TPIO_OUT | TPIO_RECV)) ||
+        ((events & TPIO_IN) && (events & TPIO_RECV))) {
+        errno = EINVAL;
+        return -1;
+    }
+    /* Regular files are always ready; refuse them as epoll does */
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        errno = EPERM;
+        return -1;
+    }
+    int shm = tpshm_is_link(fd);
+    if (shm && io->kind == TPIO_URING) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    int type = SOCK_STREAM;
+    socklen_t type_len = sizeof(type);
+    if ((events & TPIO_RECV) && !shm) {
+        getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &type_len);
+    }
+    count_syscalls(io, (events & TPIO_RECV) && !shm ? 2 : 1);
+
+    pthread_mutex_lock(&io->lock);
+    TpIoWatch* w = watch_slot(io, fd);
+    if (w && (events & TPIO_RECV) && !w->buf) w->buf = malloc(TPIO_RECV_BUF);
+    if (!w || ((events & TPIO_RECV) && !w->buf)) {
+        pthread_mutex_unlock(&io->lock);
+        errno = ENOMEM;
+        return -1;
+    }
+    int rewatch = w->active;
+    w->token = token;
+    w->events = events;
+    w->gen++;
+    w->active = 1;
+    w->shm = (uint8_t)shm;
+    /* A short shared-memory receive may stop at a record boundary: keep going until EAGAIN */
+    w->stream = (type == SOCK_STREAM) && !shm;
+    w->recv_posted = 0;
+
+    int rc = 0;
+    if (io->kind == TPIO_URING) {
+        uring_watch(io, w, fd, rewatch);
+    } else {
+        rc = posix_watch(io, w, fd);
+        if (rc < 0) w->active = 0;
+    }
+    pthread_mutex_unlock(&io->lock);
+    return rc;
+}
+
+void tpio_unwatch(TpIo* io, int fd) {
+    pthread_mutex_lock(&io->lock);
+    if (fd >= 0 && fd < io->watch_cap && io->watches[fd].active) {
+        TpIoWatch* w = &io->watches[fd];
+        w->active = 0;
+        w->gen++;
+        w->recv_posted = 0;
+        if (io->kind == TPIO_URING) {
+            ring_cancel(io, fd);
+            ring_submit_now(io);
+        } else {
+            count_syscalls(io, 1);
+            epoll_ctl(io->fd, EPOLL_CTL_DEL, fd, NULL);
+            if (w->shm && tpshm_rx_fd(fd) >= 0) {
+                count_syscalls(io, 1);
+                epoll_ctl(io->fd, EPOLL_CTL_DEL, tpshm_rx_fd(fd), NULL);
+            }
+        }
+    }
+    pthread_mutex_unlock(&io->lock);
+}
+
+int tpio_wait(TpIo* io, TpIoEvent* out, int max, int timeout_ms) {
+    if (max <= 0) return 0;
+    return io->kind == TPIO_URING ? uring_wait(io, out, max, timeout_ms)
+                                  : posix_wait(io, out, max, timeout_ms);
+}
+
+int tpio_send_batch(TpIo* io, TpIoSend* ops, int n) {
+    if (n <= 0) return 0;
+    if (io->kind == TPIO_URING) return uring_send_batch(io, ops, n);
+    posix_send_batch(io, ops, n);
+    return 0;
+}
@@ -0,0 +1,113 @@
+#ifndef TPIO_H
+#define TPIO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/* Pluggable I/O backend for the leader reactor and the follower event loop.
+ *
+ * TPIO_POSIX: epoll readiness plus one recv()/sendmsg() per operation.
+ * TPIO_URING: io_uring. Readiness watches are multishot polls, receives stay
+ *   posted in the ring for every watched socket and are re-posted together with
+ *   the next wait, and a send batch is a single io_uring_enter().
+ * tpio_open(TPIO_AUTO) takes io_uring and falls back to POSIX when the kernel
+ * (or a seccomp policy) refuses it; TP_IO=posix in the environment makes
+ * TPIO_AUTO pick POSIX.
+ *
+ * Watches are edge-triggered: TPIO_IN / TPIO_OUT report a transition and the
+ * owner reads or writes until EAGAIN. A TPIO_RECV watch receives for the owner:
+ * each event carries bytes (res > 0), end of stream (res == 0) or -errno, in
+ * a per-fd buffer that stays valid until the next tpio_wait().
+ *
+ * Shared-memory links (tpshm.h) are watched and written like sockets on the
+ * POSIX backend: receives and sends go through the link's rings, and its
+ * doorbell edge counts as readable and writable. io_uring refuses them
+ * (EOPNOTSUPP), so processes using them open TPIO_POSIX.
+ *
+ * Threads: tpio_watch/tpio_unwatch may be called from any thread; tpio_wait()
+ * belongs to one thread. Send batches must be serialized by the caller and use
+ * their own TpIo, so their completions never mix with a waiter's.
+ */
+#define TPIO_RECV_BUF 2048          // bytes per posted receive
+#define TPIO_RING_ENTRIES 256       // io_uring submission queue size
+
+/* Watch and event flags */
+#define TPIO_IN   0x01
+#define TPIO_OUT  0x02
+#define TPIO_HUP  0x04              // events only: hang-up or socket error
+#define TPIO_RECV 0x08
+
+typedef enum {
+    TPIO_AUTO = 0,
+    TPIO_POSIX,
+    TPIO_URING
+} TpIoKind;
+
+typedef struct {
+    uint64_t token;                 // as given to tpio_watch
+    uint32_t events;                // TPIO_* that fired
+    int fd;
+    int res;                        // TPIO_RECV: bytes, 0 = end of stream, or -errno
+    const unsigned char* data;      // TPIO_RECV: received bytes
+} TpIoEvent;
+
+/* One gathered write for tpio_send_batch() */
+typedef struct {
+    int fd;
+    const struct iovec* iov;
+    int iovcnt;
+    ssize_t res;                    // out: bytes written or -errno
+} TpIoSend;
+
+typedef struct {
+    uint64_t token;
+    uint32_t events;
+    uint32_t gen;                   // bumped on every (re)watch so stale completions never match
+    uint8_t active;
+    uint8_t stream;                 // SOCK_STREAM: a short read means drained
+    uint8_t recv_posted;            // io_uring: a receive is in the ring
+    uint8_t again;                  // listed in TpIo.again
+    uint8_t shm;                    // tpshm link: received from and sent to its rings
+    unsigned char* buf;             // TPIO_RECV_BUF bytes, kept until tpio_close()
+} TpIoWatch;
+
+typedef struct TpIoRing TpIoRing;
+
+typedef struct {
+    TpIoKind kind;
+    int fd;                         // epoll fd or io_uring fd
+    pthread_mutex_t lock;           // watch table and submission queue
+    TpIoWatch* watches;             // indexed by fd
+    int watch_cap;
+    int* again;                     // fds whose receive continues in the next wait
+    int again_len, again_cap;
+    TpIoRing* ring;                 // TPIO_URING only
+    uint64_t syscalls;              // every syscall the backend made
+} TpIo;
+
+/* 0 on success, -1 if no backend could be set up */
+int tpio_open(TpIo* io, TpIoKind kind);
+void tpio_close(TpIo* io);
+const char* tpio_name(const TpIo* io);
+
+/* Watch fd for TPIO_IN, TPIO_OUT and/or TPIO_RECV (not TPIO_IN and TPIO_RECV
+ * together). Watching an fd again replaces its watch; like tpio_unwatch, that
+ * drops anything received for the old watch but not yet reported.
+ * 0, or -1 with errno set. */
+int tpio_watch(TpIo* io, int fd, uint32_t events, uint64_t token);
+
+/* Stop watching fd. Call before close(fd). */
+void tpio_unwatch(TpIo* io, int fd);
+
+/* Wait for up to max events. timeout_ms: -1 = block, 0 = poll.
+ * Returns the number of events (0 on timeout or interruption), -1 on error. */
+int tpio_wait(TpIo* io, TpIoEvent* out, int max, int timeout_ms);
+
+/* Submit every write in ops (non-blocking) and fill in ops[i].res.
+ * Returns 0, or -1 if the batch could not be submitted at all. */
+int tpio_send_batch(TpIo* io, TpIoSend* ops, int n);
+
+#endif
@@ -1,5 +1,7 @@
 //FILE: tpnet.c
 
+#define _GNU_SOURCE /* struct ip_mreq, sendmmsg */
+
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,32 +9,63 @@
 #include <unistd.h>
 #include <time.h>
 #include <pthread.h>
+#include <errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 
 #include "truckplatoon.h"
 #include "event.h"
 #include "tpnet.h"
+#include "tpshm.h"
 
 
 
 //FUNC: Join Platoon
 
-int32_t join_platoon(int32_t leader_FD, const char *self_ip, uint16_t self_port){
-
-    FollowerRegisterMsg reg = {0};
-    strcpy(reg.selfAddress.ip, self_ip);
-    reg.selfAddress.udp_port = self_port;
-    int32_t platoon_join_status =  send(leader_FD, &reg, sizeof(reg), 0);
+static int32_t send_join(int32_t leader_FD, const FollowerRegisterMsg* reg){
+    unsigned char wire[TPWIRE_MAX];
+    size_t len = tpwire_encode_reg(reg, wire, sizeof(wire));
+    int32_t platoon_join_status = tpframe_send(leader_FD, wire, len);
     if(platoon_join_status <0){
         printf("Platoon join failed"); 
     }
     return platoon_join_status; 
 }
 
+int32_t join_platoon(int32_t leader_FD, const char *self_ip, uint16_t self_port, int32_t platoon_id){
+
+    FollowerRegisterMsg reg = {0};
+    strcpy(reg.selfAddress.ip, self_ip);
+    reg.selfAddress.udp_port = self_port;
+    reg.platoon_id = platoon_id;
+    return send_join(leader_FD, &reg);
+}
+
+//FUNC: Resume a session on a new leader connection
+
+int32_t resume_session(int32_t leader_FD, const char *self_ip, uint16_t self_port, int32_t platoon_id,
+                       uint64_t token, uint32_t topo_epoch, uint64_t last_cmd_id){
+    FollowerRegisterMsg reg = {0};
+    strcpy(reg.selfAddress.ip, self_ip);
+    reg.selfAddress.udp_port = self_port;
+    reg.platoon_id = platoon_id;
+    reg.resume_token = token;
+    reg.topo_epoch = topo_epoch;
+    reg.last_cmd_id = last_cmd_id;
+    return send_join(leader_FD, &reg);
+}
+
 //FUNC: Create TCP Socket and connect to Leader
 
 int32_t connect2Leader(){
+    if (tpshm_enabled()) {
+        char name[64];
+        tpshm_name(name, sizeof(name), "leader", LEADER_PORT);
+        int32_t link = tpshm_connect(name, TPSHM_STREAM);
+        if (link < 0) perror("Shared-memory link to leader failed");
+        return link;
+    }
     //Create
     int32_t leader_fd = socket(AF_INET, SOCK_STREAM, 0);
     if(leader_fd < 0){
@@ -52,6 +85,7 @@ int32_t connect2Leader(){
     status = connect(leader_fd, (struct sockaddr*)&leader_addr, sizeof(leader_addr)); 
     if (status < 0) {
         perror("Connection to leader failed");
+        close(leader_fd);
         return status;
     }
     // If creation and connection succeeds, return the socket fd
@@ -61,6 +95,14 @@ int32_t connect2Leader(){
 //FUNC: Create UDP Server to recieve warnings 
 
 int32_t createUDPServer(uint16_t udp_port){
+   if (tpshm_enabled()) {
+        /* Front trucks connect a link each; see sendToTruck() */
+        char name[64];
+        tpshm_name(name, sizeof(name), "truck", udp_port);
+        int32_t inbox = tpshm_listen(name);
+        if (inbox < 0) perror("Shared-memory truck inbox failed");
+        return inbox;
+   }
    int32_t udp_sock = socket(AF_INET, SOCK_DGRAM, 0);
 
    if(udp_sock < 0){
@@ -84,3 +126,121 @@ int32_t createUDPServer(uint16_t udp_port){
     return udp_sock; 
 }
 
+
+//FUNC: Create a UDP socket that receives a multicast group on the given interface
+
+int32_t createMulticastListener(const NetInfo* group, const char* if_ip){
+    int32_t mcast_sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if(mcast_sock < 0){
+        perror("Multicast socket creation failed");
+        return mcast_sock;
+    }
+    /* Every follower on this host binds the same group port */
+    int one = 1;
+    setsockopt(mcast_sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in mcast_addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(group->udp_port),
+        .sin_addr.s_addr = INADDR_ANY
+    };
+    struct ip_mreq mreq;
+    if (inet_pton(AF_INET, group->ip, &mreq.imr_multiaddr) != 1 ||
+        inet_pton(AF_INET, if_ip, &mreq.imr_interface) != 1 ||
+        bind(mcast_sock, (struct sockaddr*)&mcast_addr, sizeof(mcast_addr)) < 0 ||
+        setsockopt(mcast_sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        perror("Multicast join failed");
+        close(mcast_sock);
+        return -1;
+    }
+    return mcast_sock;
+}
+
+
+//FUNC: Send a batch of datagrams, TPNET_DGRAM_BATCH per sendmmsg() call
+
+int32_t sendDatagrams(int32_t fd, const Datagram* dgrams, uint32_t n){
+    struct mmsghdr msgs[TPNET_DGRAM_BATCH];
+    struct iovec iov[TPNET_DGRAM_BATCH];
+    uint32_t done = 0;
+
+    while (done < n) {
+        uint32_t batch = n - done < TPNET_DGRAM_BATCH ? n - done : TPNET_DGRAM_BATCH;
+        for (uint32_t i = 0; i < batch; i++) {
+            const Datagram* d = &dgrams[done + i];
+            iov[i].iov_base = (void*)d->data;
+            iov[i].iov_len = d->len;
+            msgs[i].msg_hdr = (struct msghdr){
+                .msg_name = (void*)d->dst,
+                .msg_namelen = sizeof(*d->dst),
+                .msg_iov = &iov[i],
+                .msg_iovlen = 1
+            };
+        }
+        int sent = sendmmsg(fd, msgs, batch, 0);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return done ? (int32_t)done : -1;
+        }
+        /* A datagram the kernel refused ends the batch early; retry from there */
+        done += (uint32_t)sent;
+        if (sent == 0) break;
+    }
+    return (int32_t)done;
+}
+
+
+//FUNC: Send one datagram to another truck; over a cached link with TP_NET=shm
+
+static pthread_mutex_t tpnet_peer_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+    int open;
+    uint16_t port;
+    int fd;
+} tpnet_peers[TPNET_SHM_PEERS];
+static int tpnet_peer_next;
+
+static int32_t sendToTruckShm(const NetInfo* dst, const void* data, size_t len){
+    pthread_mutex_lock(&tpnet_peer_lock);
+    int slot = -1;
+    for (int i = 0; i < TPNET_SHM_PEERS; i++) {
+        if (tpnet_peers[i].open && tpnet_peers[i].port == dst->udp_port) slot = i;
+    }
+    if (slot < 0) {
+        char name[64];
+        tpshm_name(name, sizeof(name), "truck", dst->udp_port);
+        int fd = tpshm_connect(name, TPSHM_DGRAM);
+        if (fd < 0) {
+            pthread_mutex_unlock(&tpnet_peer_lock);
+            return -1;
+        }
+        /* Topology changes retire old rear trucks: reuse the oldest entry */
+        slot = tpnet_peer_next;
+        tpnet_peer_next = (tpnet_peer_next + 1) % TPNET_SHM_PEERS;
+        if (tpnet_peers[slot].open) tpshm_close(tpnet_peers[slot].fd);
+        tpnet_peers[slot].open = 1;
+        tpnet_peers[slot].port = dst->udp_port;
+        tpnet_peers[slot].fd = fd;
+    }
+    ssize_t n = tpshm_send(tpnet_peers[slot].fd, data, len);
+    if (n < 0 && errno == EPIPE) {
+        /* That truck is gone; the next send reconnects */
+        tpshm_close(tpnet_peers[slot].fd);
+        tpnet_peers[slot].open = 0;
+    }
+    int err = errno;
+    pthread_mutex_unlock(&tpnet_peer_lock);
+    errno = err;
+    return (int32_t)n;
+}
+
+int32_t sendToTruck(int32_t udp_fd, const NetInfo* dst, const void* data, size_t len){
+    if (tpshm_enabled()) return sendToTruckShm(dst, data, len);
+
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(dst->udp_port)};
+    if (inet_pton(AF_INET, dst->ip, &addr.sin_addr) != 1) {
+        errno = EINVAL;
+        return -1;
+    }
+    return (int32_t)sendto(udp_fd, data, len, 0, (struct sockaddr*)&addr, sizeof(addr));
+}
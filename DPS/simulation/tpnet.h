@@ -2,6 +2,12 @@
 #define TPNET_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include <netinet/in.h>
+
+#include "outq.h"
+#include "tpframe.h"
+#include "tpwire.h"
 
 /* Network utility functions for truck communication */
 
@@ -10,13 +16,33 @@
  * @leader_FD: TCP socket connected to leader
  * @self_ip: Follower's IP address (null-terminated string)
  * @self_port: Follower's UDP listening port
+ * @platoon_id: Platoon to join (0 unless the leader hosts several)
  * 
  * Returns: Status code from send() operation
  */
-int32_t join_platoon(int32_t leader_FD, const char *self_ip, uint16_t self_port);
+int32_t join_platoon(int32_t leader_FD, const char *self_ip, uint16_t self_port, int32_t platoon_id);
+
+/**
+ * resume_session - Rejoin the leader on a new connection, keeping the platoon slot
+ * @leader_FD: New connection to the leader
+ * @self_ip: Follower's IP address (null-terminated string)
+ * @self_port: Follower's UDP listening port
+ * @platoon_id: Platoon joined before
+ * @token: Session token from MSG_LDR_ASSIGN_ID
+ * @topo_epoch: Newest topology epoch applied
+ * @last_cmd_id: Newest full cruise command applied
+ *
+ * The leader replays what was missed, or treats it as a new join if the slot
+ * is gone. Returns: Status code from send() operation
+ */
+int32_t resume_session(int32_t leader_FD, const char *self_ip, uint16_t self_port, int32_t platoon_id,
+                       uint64_t token, uint32_t topo_epoch, uint64_t last_cmd_id);
 
 /**
  * connect2Leader - Establish TCP connection to leader
+ *
+ * With TP_NET=shm this is a shared-memory link to the leader (tpshm.h),
+ * read and written through tpio, tpframe and outq like the TCP socket.
  * 
  * Returns: Socket file descriptor on success, negative on error
  */
@@ -25,18 +51,75 @@ int32_t connect2Leader(void);
 /**
  * createUDPServer - Create and bind UDP socket for receiving messages
  * @udp_port: UDP port number to listen on
+ *
+ * With TP_NET=shm this is a listener instead: accept each front truck's link
+ * with tpshm_accept() and receive the datagrams from the links.
  * 
  * Returns: Socket file descriptor on success, negative on error
  */
 int32_t createUDPServer(uint16_t udp_port);
 
+/**
+ * createMulticastListener - Create a UDP socket joined to a multicast group
+ * @group: group address and port
+ * @if_ip: local interface address to join on
+ *
+ * Returns: Socket file descriptor on success, negative on error
+ */
+int32_t createMulticastListener(const NetInfo* group, const char* if_ip);
+
+#define TPNET_SHM_PEERS 4        // shared-memory links kept open by sendToTruck()
 
-/* Follower session encapsulation */
+/**
+ * sendToTruck - Send one datagram to another truck's UDP server
+ * @udp_fd: this truck's socket from createUDPServer()
+ * @dst: the other truck's IP and UDP port
+ * @data: datagram
+ * @len: datagram length
+ *
+ * With TP_NET=shm (see tpshm.h) the datagram goes over a shared-memory link
+ * to the truck's inbox instead; links are opened on first use and kept for
+ * the next sends. Thread-safe.
+ * Returns: bytes sent, negative on error
+ */
+int32_t sendToTruck(int32_t udp_fd, const NetInfo* dst, const void* data, size_t len);
+
+/* One outgoing datagram for sendDatagrams() */
 typedef struct {
-    int id;           /* logical ID starting at 1 */
-    int fd;           /* socket FD */
+    const void* data;
+    size_t len;
+    const struct sockaddr_in* dst;
+} Datagram;
+
+#define TPNET_DGRAM_BATCH 256    // datagrams per sendmmsg() call
+
+/**
+ * sendDatagrams - Send a batch of datagrams with as few syscalls as possible
+ * @fd: UDP socket
+ * @dgrams: datagrams, each with its own destination
+ * @n: number of datagrams
+ *
+ * Uses sendmmsg(), TPNET_DGRAM_BATCH datagrams per call.
+ * Returns: Number of datagrams sent, negative if none could be sent
+ */
+int32_t sendDatagrams(int32_t fd, const Datagram* dgrams, uint32_t n);
+
+
+/* Follower session encapsulation (leader side, kept in a SessionTable) */
+typedef struct FollowerSession {
+    int id;           /* logical ID = platoon position, starting at 1 */
+    int fd;           /* socket FD; -1 while held for a resume */
     NetInfo address;  /* IP and UDP port */
-    int active;       /* 1 = connected, 0 = empty/disconnected */
+    OutQueue out;     /* pending outbound messages (leader side, socket is non-blocking) */
+    MatrixClock clock_sent; /* clock last committed to this follower (delta base) */
+    int slot;         /* index in SessionTable.dense */
+    int told_id;      /* position the follower last heard (ASSIGN_ID or SPAWN) */
+    int told_has_rear;      /* rear neighbour the follower last heard of */
+    NetInfo told_rear;
+    uint64_t token;         /* session token (ASSIGN_ID): a reconnect presenting it resumes this slot */
+    uint64_t held_until_ns; /* link lost: slot kept until then (lat_now_ns clock); 0 = connected */
+    struct FollowerSession* prev;  /* platoon order: truck in front, NULL = first */
+    struct FollowerSession* next;  /* truck behind, NULL = last */
 } FollowerSession;
 
 #endif
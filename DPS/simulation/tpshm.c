@@ -0,0 +1,469 @@
+//File: tpshm.c
+
+#define _GNU_SOURCE /* memfd_create, accept4, POLLRDHUP */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "tpshm.h"
+
+#define TPSHM_MAGIC 0x74707368u        // "tpsh"
+#define TPSHM_VERSION 1
+#define TPSHM_MASK (TPSHM_RING_BYTES - 1)
+#define TPSHM_WRAP 0xFFFFFFFFu          // record header: continue at the start of the ring
+
+#if (TPSHM_RING_BYTES & TPSHM_MASK) != 0 || TPSHM_RING_BYTES < 4 * TPSHM_MAX_RECORD
+#error "TPSHM_RING_BYTES must be a power of two with room for several records"
+#endif
+
+typedef struct {
+    /* Producer line */
+    uint64_t tail __attribute__((aligned(TPSHM_CACHELINE)));
+    uint64_t head_cache;
+    uint32_t closed;                    // the producer closed its end
+
+    /* Consumer line */
+    uint64_t head __attribute__((aligned(TPSHM_CACHELINE)));
+    uint64_t tail_cache;
+
+    /* Wakeup line */
+    uint32_t consumer_idle __attribute__((aligned(TPSHM_CACHELINE)));
+    uint32_t producer_waiting;          // ring was full: ring the producer's doorbell on progress
+
+    unsigned char data[TPSHM_RING_BYTES] __attribute__((aligned(TPSHM_CACHELINE)));
+} TpShmRing;
+
+/* ring[0]: connector -> acceptor, ring[1]: acceptor -> connector */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t kind;
+    TpShmRing ring[2];
+} TpShmSegment;
+
+typedef struct {
+    TpShmSegment* seg;
+    TpShmRing* tx;
+    TpShmRing* rx;
+    int rx_efd;                         // our doorbell
+    int tx_efd;                         // the peer's
+    TpShmKind kind;
+    uint32_t rx_off;                    // stream: bytes of the head record already received
+    int parked;                         // we announced ourselves idle on rx
+    int hangup;                         // the socket hung up
+} TpShmLink;
+
+static TpShmLink* tpshm_links[TPSHM_MAX_FD];
+
+static TpShmLink* link_of(int fd) {
+    if (fd < 0 || fd >= TPSHM_MAX_FD) return NULL;
+    return __atomic_load_n(&tpshm_links[fd], __ATOMIC_ACQUIRE);
+}
+
+static size_t record_size(size_t len) {
+    return (4 + len + 7) & ~(size_t)7;
+}
+
+static void ring_doorbell(int efd) {
+    uint64_t one = 1;
+    ssize_t w = write(efd, &one, sizeof(one));
+    (void)w; // EAGAIN only if the counter is saturated, i.e. already signaled
+}
+
+int tpshm_enabled(void) {
+    static int enabled = -1;
+    if (enabled < 0) {
+        const char* env = getenv("TP_NET");
+        enabled = env && strcmp(env, "shm") == 0;
+    }
+    return enabled;
+}
+
+void tpshm_name(char* out, size_t cap, const char* role, uint16_t port) {
+    snprintf(out, cap, "truckplatoon-%s-%u", role, (unsigned)port);
+}
+
+/* Abstract-namespace address: nothing to unlink, gone with the last fd */
+static socklen_t tpshm_addr(struct sockaddr_un* addr, const char* name) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    size_t len = strlen(name);
+    if (len > sizeof(addr->sun_path) - 1) len = sizeof(addr->sun_path) - 1;
+    memcpy(addr->sun_path + 1, name, len);
+    return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + len);
+}
+
+int tpshm_listen(const char* name) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_un addr;
+    socklen_t len = tpshm_addr(&addr, name);
+    if (bind(fd, (struct sockaddr*)&addr, len) < 0 || listen(fd, SOMAXCONN) < 0) {
+        int err = errno;
+        close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+/* Map a segment and register fd as its link; side 0 = connector */
+static int link_attach(int fd, int seg_fd, int side, int rx_efd, int tx_efd) {
+    if (fd >= TPSHM_MAX_FD) {
+        errno = EMFILE;
+        return -1;
+    }
+    TpShmLink* l = calloc(1, sizeof(*l));
+    if (!l) return -1;
+    void* map = mmap(NULL, sizeof(TpShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, seg_fd, 0);
+    if (map == MAP_FAILED) {
+        free(l);
+        return -1;
+    }
+    l->seg = map;
+    l->tx = &l->seg->ring[side];
+    l->rx = &l->seg->ring[1 - side];
+    l->rx_efd = rx_efd;
+    l->tx_efd = tx_efd;
+    l->kind = (TpShmKind)l->seg->kind;
+    l->parked = 1;
+    __atomic_store_n(&tpshm_links[fd], l, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Unregister fd's link and unmap it; the socket stays open */
+static void link_release(int fd) {
+    TpShmLink* l = link_of(fd);
+    if (!l) return;
+    __atomic_store_n(&tpshm_links[fd], NULL, __ATOMIC_RELEASE);
+    /* The peer reads end of stream once it has drained what we sent */
+    __atomic_store_n(&l->tx->closed, 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    ring_doorbell(l->tx_efd);
+    munmap(l->seg, sizeof(TpShmSegment));
+    close(l->rx_efd);
+    close(l->tx_efd);
+    free(l);
+}
+
+int tpshm_connect(const char* name, TpShmKind kind) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int seg_fd = -1, efd[2] = {-1, -1};
+    struct sockaddr_un addr;
+    socklen_t addr_len = tpshm_addr(&addr, name);
+    if (connect(fd, (struct sockaddr*)&addr, addr_len) < 0) goto fail;
+
+    /* The connector builds the segment, so connecting never waits for an accept */
+    seg_fd = memfd_create("truckplatoon-link", MFD_CLOEXEC);
+    efd[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);   // acceptor's doorbell
+    efd[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);   // ours
+    if (seg_fd < 0 || efd[0] < 0 || efd[1] < 0) goto fail;
+    if (ftruncate(seg_fd, sizeof(TpShmSegment)) < 0) goto fail;
+    TpShmSegment* seg = mmap(NULL, sizeof(TpShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, seg_fd, 0);
+    if (seg == MAP_FAILED) goto fail;
+    seg->magic = TPSHM_MAGIC;
+    seg->version = TPSHM_VERSION;
+    seg->kind = (uint32_t)kind;
+    /* Nobody has received yet: the first send on each ring rings the doorbell */
+    seg->ring[0].consumer_idle = seg->ring[1].consumer_idle = 1;
+    munmap(seg, sizeof(TpShmSegment));
+
+    int fds[3] = {seg_fd, efd[0], efd[1]};
+    char cbuf[CMSG_SPACE(sizeof(fds))];
+    memset(cbuf, 0, sizeof(cbuf));
+    unsigned char tag = (unsigned char)kind;
+    struct iovec iov = {.iov_base = &tag, .iov_len = 1};
+    struct msghdr mh = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = cbuf, .msg_controllen = sizeof(cbuf)};
+    struct cmsghdr* cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cm), fds, sizeof(fds));
+    if (sendmsg(fd, &mh, MSG_NOSIGNAL) != 1) goto fail;
+
+    if (link_attach(fd, seg_fd, 0, efd[1], efd[0]) < 0) goto fail;
+    close(seg_fd);
+    return fd;
+
+fail: {
+        int err = errno;
+        if (seg_fd >= 0) close(seg_fd);
+        if (efd[0] >= 0) close(efd[0]);
+        if (efd[1] >= 0) close(efd[1]);
+        close(fd);
+        errno = err;
+        return -1;
+    }
+}
+
+int tpshm_accept_socket(int listen_fd) {
+    int fd;
+    do {
+        fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    } while (fd < 0 && errno == EINTR);
+    return fd;
+}
+
+/* Receive the connector's segment and doorbells, if they are here yet */
+int tpshm_attach(int fd) {
+    int fds[3];
+    char cbuf[CMSG_SPACE(sizeof(fds))];
+    unsigned char tag = 0;
+    struct iovec iov = {.iov_base = &tag, .iov_len = 1};
+    struct msghdr mh = {.msg_iov = &iov, .msg_iovlen = 1, .msg_control = cbuf, .msg_controllen = sizeof(cbuf)};
+    ssize_t n;
+    do {
+        n = recvmsg(fd, &mh, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return -1;
+    struct cmsghdr* cm = n == 1 ? CMSG_FIRSTHDR(&mh) : NULL;
+    if (!cm || cm->cmsg_level != SOL_SOCKET || cm->cmsg_type != SCM_RIGHTS) {
+        errno = EPROTO;
+        return -1;
+    }
+    size_t got = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    memcpy(fds, CMSG_DATA(cm), got < 3 ? got * sizeof(int) : sizeof(fds));
+    if (got != 3) {
+        for (size_t i = 0; i < got && i < 3; i++) close(fds[i]);
+        errno = EPROTO;
+        return -1;
+    }
+
+    struct stat st;
+    int ok = fstat(fds[0], &st) == 0 && (size_t)st.st_size >= sizeof(TpShmSegment) &&
+             link_attach(fd, fds[0], 1, fds[1], fds[2]) == 0;
+    close(fds[0]);
+    if (ok) {
+        TpShmLink* l = link_of(fd);
+        if (l->seg->magic == TPSHM_MAGIC && l->seg->version == TPSHM_VERSION &&
+            (l->kind == TPSHM_STREAM || l->kind == TPSHM_DGRAM)) {
+            return 0;
+        }
+        link_release(fd);
+        errno = EPROTO;
+        return -1;
+    }
+    close(fds[1]);
+    close(fds[2]);
+    return -1;
+}
+
+int tpshm_accept(int listen_fd) {
+    for (;;) {
+        int fd = tpshm_accept_socket(listen_fd);
+        if (fd < 0) return -1;
+
+        /* Wait up to TPSHM_HANDSHAKE_MS for the connector's segment */
+        struct pollfd pfd = {.fd = fd, .events = POLLIN};
+        int rc;
+        while ((rc = poll(&pfd, 1, TPSHM_HANDSHAKE_MS)) < 0 && errno == EINTR) {
+        }
+        if (rc <= 0) errno = ETIMEDOUT;
+        if (rc > 0 && tpshm_attach(fd) == 0) return fd;
+        perror("tpshm handshake");
+        close(fd);
+    }
+}
+
+int tpshm_is_link(int fd) {
+    return link_of(fd) != NULL;
+}
+
+int tpshm_rx_fd(int fd) {
+    TpShmLink* l = link_of(fd);
+    return l ? l->rx_efd : -1;
+}
+
+/* Producer: room for need bytes at tail, asking for a wakeup if there is none */
+static int ring_room(TpShmRing* r, uint64_t tail, size_t need) {
+    if (TPSHM_RING_BYTES - (tail - r->head_cache) >= need) return 1;
+    r->head_cache = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    if (TPSHM_RING_BYTES - (tail - r->head_cache) >= need) return 1;
+
+    __atomic_store_n(&r->producer_waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    r->head_cache = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    return TPSHM_RING_BYTES - (tail - r->head_cache) >= need;
+}
+
+ssize_t tpshm_sendv(int fd, const struct iovec* iov, int iovcnt) {
+    TpShmLink* l = link_of(fd);
+    if (!l) {
+        errno = EBADF;
+        return -1;
+    }
+    if (l->hangup || __atomic_load_n(&l->rx->closed, __ATOMIC_ACQUIRE)) {
+        errno = EPIPE;
+        return -1;
+    }
+    size_t len = 0;
+    for (int i = 0; i < iovcnt; i++) len += iov[i].iov_len;
+    if (len > TPSHM_MAX_RECORD) {
+        if (l->kind == TPSHM_DGRAM) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+        len = TPSHM_MAX_RECORD; /* short write, as a full socket buffer would give */
+    }
+
+    TpShmRing* r = l->tx;
+    uint64_t tail = r->tail;
+    size_t need = record_size(len);
+    size_t pos = tail & TPSHM_MASK;
+    size_t to_end = TPSHM_RING_BYTES - pos;
+    if (!ring_room(r, tail, need > to_end ? to_end + need : need)) {
+        errno = EAGAIN;
+        return -1;
+    }
+    if (need > to_end) {
+        memcpy(r->data + pos, &(uint32_t){TPSHM_WRAP}, 4);
+        tail += to_end;
+        pos = 0;
+    }
+    uint32_t hdr = (uint32_t)len;
+    memcpy(r->data + pos, &hdr, 4);
+    size_t off = 0;
+    for (int i = 0; i < iovcnt && off < len; i++) {
+        size_t take = iov[i].iov_len < len - off ? iov[i].iov_len : len - off;
+        memcpy(r->data + pos + 4 + off, iov[i].iov_base, take);
+        off += take;
+    }
+    __atomic_store_n(&r->tail, tail + need, __ATOMIC_RELEASE);
+
+    /* Publish before checking for a parked consumer (pairs with the fence in rx_park) */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->consumer_idle, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&r->consumer_idle, 0, __ATOMIC_ACQ_REL)) {
+        ring_doorbell(l->tx_efd);
+    }
+    return (ssize_t)len;
+}
+
+ssize_t tpshm_send(int fd, const void* buf, size_t len) {
+    struct iovec iov = {.iov_base = (void*)buf, .iov_len = len};
+    return tpshm_sendv(fd, &iov, 1);
+}
+
+/* Consumer: copy what is queued on rx into buf; publishes the new head */
+static size_t rx_drain(TpShmLink* l, unsigned char* buf, size_t cap) {
+    TpShmRing* r = l->rx;
+    uint64_t head = r->head;
+    size_t n = 0;
+    while (n < cap) {
+        if (head == r->tail_cache) {
+            r->tail_cache = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+            if (head == r->tail_cache) break;
+        }
+        size_t pos = head & TPSHM_MASK;
+        uint32_t len;
+        memcpy(&len, r->data + pos, 4);
+        if (len == TPSHM_WRAP) {
+            head += TPSHM_RING_BYTES - pos;
+            continue;
+        }
+        if (l->kind == TPSHM_DGRAM) {
+            /* One datagram per receive; whatever does not fit is lost, as with recv() */
+            n = len < cap ? len : cap;
+            memcpy(buf, r->data + pos + 4, n);
+            head += record_size(len);
+            break;
+        }
+        size_t left = len - l->rx_off;
+        size_t take = left < cap - n ? left : cap - n;
+        memcpy(buf + n, r->data + pos + 4 + l->rx_off, take);
+        n += take;
+        if (take < left) {
+            l->rx_off += (uint32_t)take;
+            break;
+        }
+        l->rx_off = 0;
+        head += record_size(len);
+    }
+    if (head == r->head) return n;
+    __atomic_store_n(&r->head, head, __ATOMIC_RELEASE);
+
+    /* A producer waiting for room gets its doorbell rung (pairs with the fence in ring_room) */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->producer_waiting, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&r->producer_waiting, 0, __ATOMIC_ACQ_REL)) {
+        ring_doorbell(l->tx_efd);
+    }
+    return n;
+}
+
+/* Announce ourselves idle, then re-check so a concurrent send is not lost */
+static size_t rx_park(TpShmLink* l, unsigned char* buf, size_t cap) {
+    l->parked = 1;
+    __atomic_store_n(&l->rx->consumer_idle, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return rx_drain(l, buf, cap);
+}
+
+static int rx_ended(TpShmLink* l) {
+    return l->hangup || __atomic_load_n(&l->rx->closed, __ATOMIC_ACQUIRE);
+}
+
+ssize_t tpshm_recv(int fd, void* buf, size_t cap) {
+    TpShmLink* l = link_of(fd);
+    if (!l) {
+        errno = EBADF;
+        return -1;
+    }
+    if (l->parked) {
+        /* Busy again: sends stop ringing the doorbell */
+        l->parked = 0;
+        __atomic_store_n(&l->rx->consumer_idle, 0, __ATOMIC_RELAXED);
+    }
+    size_t n = rx_drain(l, buf, cap);
+    if (n == 0 && cap > 0) n = rx_park(l, buf, cap);
+    if (n > 0) return (ssize_t)n;
+    if (rx_ended(l)) return 0;
+    errno = EAGAIN;
+    return -1;
+}
+
+void tpshm_hangup(int fd) {
+    TpShmLink* l = link_of(fd);
+    if (l) l->hangup = 1;
+}
+
+int tpshm_wait(int fd, int timeout_ms) {
+    TpShmLink* l = link_of(fd);
+    if (!l) {
+        errno = EBADF;
+        return -1;
+    }
+    l->parked = 1;
+    __atomic_store_n(&l->rx->consumer_idle, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&l->rx->tail, __ATOMIC_ACQUIRE) != l->rx->head || rx_ended(l)) return 1;
+
+    struct pollfd pfd[2] = {{.fd = l->rx_efd, .events = POLLIN}, {.fd = fd, .events = POLLRDHUP}};
+    int rc;
+    while ((rc = poll(pfd, 2, timeout_ms)) < 0 && errno == EINTR) {
+    }
+    if (rc <= 0) return rc;
+    if (pfd[0].revents & POLLIN) {
+        uint64_t count;
+        ssize_t r = read(l->rx_efd, &count, sizeof(count));
+        (void)r;
+    }
+    if (pfd[1].revents & (POLLRDHUP | POLLHUP | POLLERR)) l->hangup = 1;
+    return 1;
+}
+
+int tpshm_close(int fd) {
+    link_release(fd);
+    return close(fd);
+}
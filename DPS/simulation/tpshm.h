@@ -0,0 +1,95 @@
+#ifndef TPSHM_H
+#define TPSHM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+/* Shared-memory links between processes on one host (leader and followers of
+ * a simulation or hardware-in-the-loop rig). TP_NET=shm in the environment
+ * switches connect2Leader/createUDPServer and the leader's listener over to
+ * them; everything above keeps using the same fds and message API.
+ *
+ * A link is a memfd segment holding one single-producer/single-consumer ring
+ * per direction. Records are a 4-byte length plus payload, 8-byte aligned;
+ * a record that would straddle the end of the ring is preceded by a wrap
+ * marker. Producer, consumer and wakeup state sit on separate cache lines.
+ *
+ * Wakeups: each side owns a doorbell eventfd. A consumer that finds its ring
+ * empty announces itself idle, and only then does a send write the doorbell;
+ * a producer that finds the ring full asks for one when space is freed. So a
+ * busy link makes no syscalls at all.
+ *
+ * Setup: the listener is an abstract AF_UNIX stream socket. The connecting
+ * side creates the segment and both doorbells and passes them over the socket
+ * (SCM_RIGHTS). The socket stays open as the link's fd: it is what callers
+ * hold, it names the link in tpio and the registry, and the kernel hangs it
+ * up if the peer dies, so a crash reads as end of stream.
+ *
+ * TPSHM_STREAM links behave like TCP (receives pack records, records may be
+ * split across receives, long sends are short writes); TPSHM_DGRAM links like
+ * UDP (one record per receive, truncated to the buffer; sends are whole or
+ * EAGAIN). Sends never block.
+ *
+ * Threads: one thread sends and one receives on a link at a time; closing it
+ * must be serialized with both, as for a socket.
+ */
+#define TPSHM_CACHELINE 64
+#define TPSHM_RING_BYTES 32768          // per direction, power of two
+#define TPSHM_MAX_RECORD 8192           // longest record; stream sends are cut to it
+#define TPSHM_MAX_FD 16384              // link fds must be below this
+#define TPSHM_HANDSHAKE_MS 100          // acceptor wait for the connector's segment
+
+typedef enum {
+    TPSHM_STREAM = 1,
+    TPSHM_DGRAM
+} TpShmKind;
+
+/* 1 when TP_NET=shm */
+int tpshm_enabled(void);
+
+/* Abstract socket name for role ("leader", "truck") and port */
+void tpshm_name(char* out, size_t cap, const char* role, uint16_t port);
+
+/* Non-blocking listener; fd, or -1 */
+int tpshm_listen(const char* name);
+
+/* Next connection on a listener as a link fd; -1 with errno EAGAIN when none is
+ * queued. Waits up to TPSHM_HANDSHAKE_MS per connection for its segment. */
+int tpshm_accept(int listen_fd);
+
+/* tpshm_accept() in two halves, for callers that must not wait (the leader's
+ * reactor). tpshm_accept_socket() takes the next connection as a non-blocking
+ * socket, -1 with errno EAGAIN when none is queued; once it is readable,
+ * tpshm_attach() makes it a link: 0, -1 with errno EAGAIN while the segment has
+ * not arrived, or -1 on a bad handshake (the caller closes fd). */
+int tpshm_accept_socket(int listen_fd);
+int tpshm_attach(int fd);
+
+/* New link to a listener; fd, or -1 */
+int tpshm_connect(const char* name, TpShmKind kind);
+
+int tpshm_is_link(int fd);
+
+/* The link's doorbell: readable after a wakeup from the peer. -1 if fd is no link. */
+int tpshm_rx_fd(int fd);
+
+/* Non-blocking send: bytes written, or -1 with errno EAGAIN (ring full),
+ * EPIPE (peer gone) or EMSGSIZE (datagram too long) */
+ssize_t tpshm_sendv(int fd, const struct iovec* iov, int iovcnt);
+ssize_t tpshm_send(int fd, const void* buf, size_t len);
+
+/* Non-blocking receive: bytes, 0 at end of stream, or -1 with errno EAGAIN */
+ssize_t tpshm_recv(int fd, void* buf, size_t cap);
+
+/* The link's socket reported a hang-up: once drained, receives return 0 */
+void tpshm_hangup(int fd);
+
+/* Block until fd may have data or the timeout (ms, -1 = none) passes: 1, 0 on timeout, -1 */
+int tpshm_wait(int fd, int timeout_ms);
+
+/* Close fd, releasing its link if it is one */
+int tpshm_close(int fd);
+
+#endif
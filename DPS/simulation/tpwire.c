@@ -0,0 +1,446 @@
+//File: tpwire.c
+
+#include <string.h>
+
+#include "tpwire.h"
+
+/* Bounded writer/reader: an overrun sets err and every later call is a no-op */
+typedef struct {
+    unsigned char* buf;
+    size_t cap;
+    size_t len;
+    int err;
+} WireOut;
+
+typedef struct {
+    const unsigned char* buf;
+    size_t len;
+    size_t pos;
+    int err;
+} WireIn;
+
+static void put_u8(WireOut* w, uint8_t v) {
+    if (w->err || w->len + 1 > w->cap) { w->err = 1; return; }
+    w->buf[w->len++] = v;
+}
+
+static void put_u16(WireOut* w, uint16_t v) {
+    put_u8(w, (uint8_t)(v >> 8));
+    put_u8(w, (uint8_t)v);
+}
+
+static void put_varint(WireOut* w, uint64_t v) {
+    while (v >= 0x80) {
+        put_u8(w, (uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    put_u8(w, (uint8_t)v);
+}
+
+static void put_svarint(WireOut* w, int64_t v) {
+    put_varint(w, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void put_f32(WireOut* w, float f) {
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    put_u16(w, (uint16_t)(v >> 16));
+    put_u16(w, (uint16_t)v);
+}
+
+static void put_ip(WireOut* w, const char ip[16]) {
+    size_t n = strnlen(ip, 15);
+    put_u8(w, (uint8_t)n);
+    for (size_t i = 0; i < n; i++) put_u8(w, (uint8_t)ip[i]);
+}
+
+static uint8_t get_u8(WireIn* r) {
+    if (r->err || r->pos >= r->len) { r->err = 1; return 0; }
+    return r->buf[r->pos++];
+}
+
+static uint16_t get_u16(WireIn* r) {
+    uint16_t hi = get_u8(r);
+    return (uint16_t)((hi << 8) | get_u8(r));
+}
+
+static uint64_t get_varint(WireIn* r) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t b = get_u8(r);
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    r->err = 1;
+    return 0;
+}
+
+static int64_t get_svarint(WireIn* r) {
+    uint64_t v = get_varint(r);
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static float get_f32(WireIn* r) {
+    uint32_t v = (uint32_t)get_u16(r) << 16;
+    v |= get_u16(r);
+    float f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+static void get_ip(WireIn* r, char ip[16]) {
+    uint8_t n = get_u8(r);
+    if (n > 15) { r->err = 1; n = 0; }
+    for (uint8_t i = 0; i < n; i++) ip[i] = (char)get_u8(r);
+    ip[n] = '\0';
+}
+
+static int clock_is_zero(const MatrixClock* c) {
+    for (int i = 0; i < NUM_TRUCKS; i++)
+        for (int j = 0; j < NUM_TRUCKS; j++)
+            if (c->mc[i][j]) return 0;
+    return 1;
+}
+
+/* Clock section for one message: the full clock (once it has ticked) when there
+ * is no per-peer base, otherwise only the entries that differ from the base */
+static uint8_t clock_flags(const MatrixClock* c, const MatrixClock* base, int commit) {
+    if (!base) return clock_is_zero(c) ? 0 : TPWIRE_F_CLOCK;
+    if (memcmp(c, base, sizeof(*c)) == 0) return 0;
+    return TPWIRE_F_CLOCK_DELTA | (commit ? TPWIRE_F_CLOCK_COMMIT : 0);
+}
+
+static void put_header(WireOut* w, TpWireKind kind, int type, uint8_t flags) {
+    put_u8(w, TPWIRE_VERSION);
+    put_u8(w, (uint8_t)((kind << 4) | (type & 0x0F)));
+    put_u8(w, flags);
+}
+
+static void put_clock(WireOut* w, uint8_t flags, const MatrixClock* c, const MatrixClock* base) {
+    if (flags & TPWIRE_F_CLOCK) {
+        for (int i = 0; i < NUM_TRUCKS; i++)
+            for (int j = 0; j < NUM_TRUCKS; j++)
+                put_svarint(w, c->mc[i][j]);
+    } else if (flags & TPWIRE_F_CLOCK_DELTA) {
+        /* count, then (flat index, value - base) per changed entry */
+        int changed = 0;
+        for (int k = 0; k < NUM_TRUCKS * NUM_TRUCKS; k++)
+            if (c->mc[k / NUM_TRUCKS][k % NUM_TRUCKS] != base->mc[k / NUM_TRUCKS][k % NUM_TRUCKS]) changed++;
+        put_varint(w, (uint64_t)changed);
+        for (int k = 0; k < NUM_TRUCKS * NUM_TRUCKS; k++) {
+            int v = c->mc[k / NUM_TRUCKS][k % NUM_TRUCKS];
+            int b = base->mc[k / NUM_TRUCKS][k % NUM_TRUCKS];
+            if (v == b) continue;
+            put_varint(w, (uint64_t)k);
+            put_svarint(w, (int64_t)v - b);
+        }
+    }
+}
+
+/* Rebuild the full clock. With a base, a message without a clock section means
+ * "unchanged since the last commit". */
+static void get_clock(WireIn* r, uint8_t flags, MatrixClock* c, const MatrixClock* base) {
+    if (base) *c = *base;
+    if (flags & TPWIRE_F_CLOCK) {
+        for (int i = 0; i < NUM_TRUCKS; i++)
+            for (int j = 0; j < NUM_TRUCKS; j++)
+                c->mc[i][j] = (int)get_svarint(r);
+    } else if (flags & TPWIRE_F_CLOCK_DELTA) {
+        uint64_t changed = get_varint(r);
+        if (!base || changed > NUM_TRUCKS * NUM_TRUCKS) { r->err = 1; return; }
+        for (uint64_t n = 0; n < changed && !r->err; n++) {
+            uint64_t k = get_varint(r);
+            int64_t diff = get_svarint(r);
+            if (k >= NUM_TRUCKS * NUM_TRUCKS) { r->err = 1; return; }
+            c->mc[k / NUM_TRUCKS][k % NUM_TRUCKS] = (int)(base->mc[k / NUM_TRUCKS][k % NUM_TRUCKS] + diff);
+        }
+    }
+}
+
+/* Returns the message type and sets *flags, or -1 on a version/kind mismatch */
+static int get_header(WireIn* r, TpWireKind kind, uint8_t* flags) {
+    uint8_t version = get_u8(r);
+    uint8_t kt = get_u8(r);
+    *flags = get_u8(r);
+    if (r->err || version != TPWIRE_VERSION || (kt >> 4) != kind) return -1;
+    return kt & 0x0F;
+}
+
+static size_t finish_out(const WireOut* w) {
+    return w->err ? 0 : w->len;
+}
+
+/* Clock section and end-of-message check; a committed delta becomes the new base */
+static int finish_in(WireIn* r, uint8_t flags, MatrixClock* c, MatrixClock* base) {
+    get_clock(r, flags, c, base);
+    if (r->err || r->pos != r->len) return -1;
+    if (base && (flags & TPWIRE_F_CLOCK_COMMIT)) *base = *c;
+    return 0;
+}
+
+static size_t encode_ld(const LD_MESSAGE* m, const MatrixClock* base, int commit,
+                        const uint32_t* seq, unsigned char* out, size_t cap) {
+    WireOut w = {.buf = out, .cap = cap};
+    uint8_t flags = clock_flags(&m->matrix_clock, base, commit) | (seq ? TPWIRE_F_SEQ : 0);
+    put_header(&w, TPWIRE_KIND_LD, m->type, flags);
+    if (seq) put_varint(&w, *seq);
+
+    switch (m->type) {
+        case MSG_LDR_CMD: {
+            const LeaderCommand* c = &m->payload.cmd;
+            put_varint(&w, c->command_id);
+            put_f32(&w, c->leader.x);
+            put_f32(&w, c->leader.y);
+            put_f32(&w, c->leader.speed);
+            put_u8(&w, (uint8_t)c->leader.dir);
+            put_u8(&w, (uint8_t)c->leader.state);
+            put_u8(&w, c->is_turning_event ? 1 : 0);
+            if (c->is_turning_event) {
+                put_f32(&w, c->turn_point_x);
+                put_f32(&w, c->turn_point_y);
+                put_u8(&w, (uint8_t)c->turn_dir);
+            }
+            break;
+        }
+        case MSG_LDR_UPDATE_REAR:
+            put_u8(&w, m->payload.rearInfo.has_rearTruck ? 1 : 0);
+            if (m->payload.rearInfo.has_rearTruck) {
+                put_ip(&w, m->payload.rearInfo.rearTruck_Address.ip);
+                put_u16(&w, m->payload.rearInfo.rearTruck_Address.udp_port);
+            }
+            put_varint(&w, m->topo_epoch);
+            break;
+        case MSG_LDR_EMERGENCY_BRAKE:
+            break;
+        case MSG_LDR_ASSIGN_ID:
+            put_svarint(&w, m->payload.assigned_id);
+            put_varint(&w, m->topo_epoch);
+            put_varint(&w, m->session_token);
+            break;
+        case MSG_LDR_SPAWN:
+            put_svarint(&w, m->payload.spawn.assigned_id);
+            put_f32(&w, m->payload.spawn.spawn_x);
+            put_f32(&w, m->payload.spawn.spawn_y);
+            put_u8(&w, (uint8_t)m->payload.spawn.spawn_dir);
+            put_varint(&w, m->topo_epoch);
+            break;
+        case MSG_LDR_MCAST_JOIN:
+            put_ip(&w, m->payload.mcast.group.ip);
+            put_u16(&w, m->payload.mcast.group.udp_port);
+            put_varint(&w, m->payload.mcast.next_seq);
+            break;
+        case MSG_LDR_HEARTBEAT:
+            put_varint(&w, m->payload.cmd.command_id);
+            break;
+        default:
+            return 0;
+    }
+    put_clock(&w, flags, &m->matrix_clock, base);
+    return finish_out(&w);
+}
+
+static int decode_ld(const unsigned char* in, size_t len, MatrixClock* base,
+                     uint32_t* seq, LD_MESSAGE* m) {
+    WireIn r = {.buf = in, .len = len};
+    uint8_t flags;
+    memset(m, 0, sizeof(*m));
+    int type = get_header(&r, TPWIRE_KIND_LD, &flags);
+    if (type < 0) return -1;
+    /* Sequenced datagrams and stream messages are not interchangeable */
+    if (!(flags & TPWIRE_F_SEQ) != !seq) return -1;
+    if (seq) *seq = (uint32_t)get_varint(&r);
+    m->type = (Leader_Truck_MSG_Type)type;
+
+    switch (m->type) {
+        case MSG_LDR_CMD: {
+            LeaderCommand* c = &m->payload.cmd;
+            c->command_id = get_varint(&r);
+            c->leader.x = get_f32(&r);
+            c->leader.y = get_f32(&r);
+            c->leader.speed = get_f32(&r);
+            c->leader.dir = (DIRECTION)get_u8(&r);
+            c->leader.state = (TRUCK_CONTROL_STATE)get_u8(&r);
+            c->is_turning_event = get_u8(&r);
+            if (c->is_turning_event) {
+                c->turn_point_x = get_f32(&r);
+                c->turn_point_y = get_f32(&r);
+                c->turn_dir = (DIRECTION)get_u8(&r);
+            }
+            break;
+        }
+        case MSG_LDR_UPDATE_REAR:
+            m->payload.rearInfo.has_rearTruck = get_u8(&r);
+            if (m->payload.rearInfo.has_rearTruck) {
+                get_ip(&r, m->payload.rearInfo.rearTruck_Address.ip);
+                m->payload.rearInfo.rearTruck_Address.udp_port = get_u16(&r);
+            }
+            m->topo_epoch = (uint32_t)get_varint(&r);
+            break;
+        case MSG_LDR_EMERGENCY_BRAKE:
+            break;
+        case MSG_LDR_ASSIGN_ID:
+            m->payload.assigned_id = (int32_t)get_svarint(&r);
+            m->topo_epoch = (uint32_t)get_varint(&r);
+            m->session_token = get_varint(&r);
+            break;
+        case MSG_LDR_SPAWN:
+            m->payload.spawn.assigned_id = (int32_t)get_svarint(&r);
+            m->payload.spawn.spawn_x = get_f32(&r);
+            m->payload.spawn.spawn_y = get_f32(&r);
+            m->payload.spawn.spawn_dir = (DIRECTION)get_u8(&r);
+            m->topo_epoch = (uint32_t)get_varint(&r);
+            break;
+        case MSG_LDR_MCAST_JOIN:
+            get_ip(&r, m->payload.mcast.group.ip);
+            m->payload.mcast.group.udp_port = get_u16(&r);
+            m->payload.mcast.next_seq = (uint32_t)get_varint(&r);
+            break;
+        case MSG_LDR_HEARTBEAT:
+            m->payload.cmd.command_id = get_varint(&r);
+            break;
+        default:
+            return -1;
+    }
+    return finish_in(&r, flags, &m->matrix_clock, base);
+}
+
+static size_t encode_ft(const FT_MESSAGE* m, const MatrixClock* base, int commit, unsigned char* out, size_t cap) {
+    WireOut w = {.buf = out, .cap = cap};
+    uint8_t flags = clock_flags(&m->matrix_clock, base, commit);
+    put_header(&w, TPWIRE_KIND_FT, m->type, flags);
+
+    switch (m->type) {
+        case MSG_FT_POSITION:
+            put_f32(&w, m->payload.position.x);
+            put_f32(&w, m->payload.position.y);
+            put_f32(&w, m->payload.position.speed);
+            break;
+        case MSG_FT_EMERGENCY_BRAKE:
+            put_u8(&w, m->payload.warning.emergency_Flag);
+            put_u8(&w, m->payload.warning.resendFlag);
+            break;
+        case MSG_FT_INTRUDER_REPORT:
+            put_svarint(&w, m->payload.intruder.speed);
+            put_svarint(&w, m->payload.intruder.length);
+            put_varint(&w, m->payload.intruder.duration_ms);
+            break;
+        default:
+            return 0;
+    }
+    put_clock(&w, flags, &m->matrix_clock, base);
+    return finish_out(&w);
+}
+
+static int decode_ft(const unsigned char* in, size_t len, MatrixClock* base, FT_MESSAGE* m) {
+    WireIn r = {.buf = in, .len = len};
+    uint8_t flags;
+    memset(m, 0, sizeof(*m));
+    int type = get_header(&r, TPWIRE_KIND_FT, &flags);
+    if (type < 0) return -1;
+    m->type = (Follower_Truck_MSG_Type)type;
+
+    switch (m->type) {
+        case MSG_FT_POSITION:
+            m->payload.position.x = get_f32(&r);
+            m->payload.position.y = get_f32(&r);
+            m->payload.position.speed = get_f32(&r);
+            break;
+        case MSG_FT_EMERGENCY_BRAKE:
+            m->payload.warning.emergency_Flag = get_u8(&r);
+            m->payload.warning.resendFlag = get_u8(&r);
+            break;
+        case MSG_FT_INTRUDER_REPORT:
+            m->payload.intruder.speed = (int32_t)get_svarint(&r);
+            m->payload.intruder.length = (int32_t)get_svarint(&r);
+            m->payload.intruder.duration_ms = (uint32_t)get_varint(&r);
+            break;
+        default:
+            return -1;
+    }
+    return finish_in(&r, flags, &m->matrix_clock, base);
+}
+
+size_t tpwire_encode_reg(const FollowerRegisterMsg* m, unsigned char* out, size_t cap) {
+    WireOut w = {.buf = out, .cap = cap};
+    uint8_t flags = clock_flags(&m->matrix_clock, NULL, 0);
+    put_header(&w, TPWIRE_KIND_REG, 0, flags);
+    put_ip(&w, m->selfAddress.ip);
+    put_u16(&w, m->selfAddress.udp_port);
+    put_varint(&w, (uint32_t)m->platoon_id);
+    put_varint(&w, m->resume_token);
+    if (m->resume_token) {
+        put_varint(&w, m->topo_epoch);
+        put_varint(&w, m->last_cmd_id);
+    }
+    put_clock(&w, flags, &m->matrix_clock, NULL);
+    return finish_out(&w);
+}
+
+int tpwire_decode_reg(const unsigned char* in, size_t len, FollowerRegisterMsg* m) {
+    WireIn r = {.buf = in, .len = len};
+    uint8_t flags;
+    memset(m, 0, sizeof(*m));
+    if (get_header(&r, TPWIRE_KIND_REG, &flags) != 0) return -1;
+    get_ip(&r, m->selfAddress.ip);
+    m->selfAddress.udp_port = get_u16(&r);
+    m->platoon_id = (int32_t)(uint32_t)get_varint(&r);
+    m->resume_token = get_varint(&r);
+    if (m->resume_token) {
+        m->topo_epoch = (uint32_t)get_varint(&r);
+        m->last_cmd_id = get_varint(&r);
+    }
+    return finish_in(&r, flags, &m->matrix_clock, NULL);
+}
+
+size_t tpwire_encode_ld(const LD_MESSAGE* m, unsigned char* out, size_t cap) {
+    return encode_ld(m, NULL, 0, NULL, out, cap);
+}
+
+int tpwire_decode_ld(const unsigned char* in, size_t len, LD_MESSAGE* m) {
+    return decode_ld(in, len, NULL, NULL, m);
+}
+
+size_t tpwire_encode_ft(const FT_MESSAGE* m, unsigned char* out, size_t cap) {
+    return encode_ft(m, NULL, 0, out, cap);
+}
+
+int tpwire_decode_ft(const unsigned char* in, size_t len, FT_MESSAGE* m) {
+    return decode_ft(in, len, NULL, m);
+}
+
+size_t tpwire_encode_ld_delta(const LD_MESSAGE* m, MatrixClock* sent, int commit,
+                              unsigned char* out, size_t cap) {
+    size_t n = encode_ld(m, sent, commit, NULL, out, cap);
+    if (n && commit) *sent = m->matrix_clock;
+    return n;
+}
+
+int tpwire_decode_ld_delta(const unsigned char* in, size_t len, MatrixClock* received, LD_MESSAGE* m) {
+    return decode_ld(in, len, received, NULL, m);
+}
+
+size_t tpwire_encode_ft_delta(const FT_MESSAGE* m, MatrixClock* sent, int commit,
+                              unsigned char* out, size_t cap) {
+    size_t n = encode_ft(m, sent, commit, out, cap);
+    if (n && commit) *sent = m->matrix_clock;
+    return n;
+}
+
+int tpwire_decode_ft_delta(const unsigned char* in, size_t len, MatrixClock* received, FT_MESSAGE* m) {
+    return decode_ft(in, len, received, m);
+}
+
+size_t tpwire_encode_ld_seq(const LD_MESSAGE* m, uint32_t seq, unsigned char* out, size_t cap) {
+    return encode_ld(m, NULL, 0, &seq, out, cap);
+}
+
+int tpwire_decode_ld_seq(const unsigned char* in, size_t len, uint32_t* seq, LD_MESSAGE* m) {
+    return decode_ld(in, len, NULL, seq, m);
+}
+
+int tpwire_seq_check(uint32_t* next, uint32_t seq) {
+    int32_t ahead = (int32_t)(seq - *next);
+    if (ahead < 0) return -1;
+    *next = seq + 1;
+    return (int)ahead;
+}
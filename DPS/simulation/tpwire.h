@@ -0,0 +1,71 @@
+#ifndef TPWIRE_H
+#define TPWIRE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "truckplatoon.h"
+
+/* Compact wire encoding for LD_MESSAGE, FT_MESSAGE and FollowerRegisterMsg.
+ * Only the fields a message type uses are written, instead of the whole union
+ * and a fixed 64-byte matrix clock.
+ *
+ * Layout: version (u8), kind << 4 | type (u8), flags (u8), then the body.
+ *   - integers: unsigned LEB128 varints (signed values zigzag-encoded)
+ *   - floats: IEEE-754 binary32, big-endian
+ *   - enums and booleans: u8; ports: u16 big-endian; IPs: u8 length + bytes
+ *   - TPWIRE_F_CLOCK: body is followed by NUM_TRUCKS^2 clock varints
+ *   - TPWIRE_F_SEQ: a varint sequence number follows the header (datagrams)
+ *   - TPWIRE_F_CLOCK_DELTA: body is followed by a count and (index, value - base)
+ *     pairs for the clock entries that changed since the per-peer base
+ * Decoders reject other versions, kinds, types and truncated or trailing bytes.
+ *
+ * Delta clocks (the *_delta calls) need an ordered, reliable stream and one base
+ * per direction per peer, both starting zeroed. The base only moves on messages
+ * sent with commit set (TPWIRE_F_CLOCK_COMMIT), so messages that may still be
+ * shed before reaching the socket must be encoded with commit = 0.
+ */
+#define TPWIRE_VERSION 5         // 2: join requests carry a platoon ID; 3: topology epochs; 4: heartbeats; 5: session resume
+#define TPWIRE_MAX 160           // largest encoded message
+
+#define TPWIRE_F_CLOCK 0x01
+#define TPWIRE_F_CLOCK_DELTA 0x02
+#define TPWIRE_F_CLOCK_COMMIT 0x04
+#define TPWIRE_F_SEQ 0x08
+
+typedef enum {
+    TPWIRE_KIND_LD = 1,          // leader -> follower (TCP)
+    TPWIRE_KIND_FT,              // follower -> leader (TCP) and follower -> follower (UDP)
+    TPWIRE_KIND_REG              // join request
+} TpWireKind;
+
+/* Encoders return the encoded length, or 0 if cap is too small */
+size_t tpwire_encode_ld(const LD_MESSAGE* m, unsigned char* out, size_t cap);
+size_t tpwire_encode_ft(const FT_MESSAGE* m, unsigned char* out, size_t cap);
+size_t tpwire_encode_reg(const FollowerRegisterMsg* m, unsigned char* out, size_t cap);
+
+/* Decoders fill *m (fields not on the wire are zero). 0 on success, -1 if malformed. */
+int tpwire_decode_ld(const unsigned char* in, size_t len, LD_MESSAGE* m);
+int tpwire_decode_ft(const unsigned char* in, size_t len, FT_MESSAGE* m);
+int tpwire_decode_reg(const unsigned char* in, size_t len, FollowerRegisterMsg* m);
+
+/* Delta-clock variants. *sent is the clock last committed to this peer and is
+ * updated when commit is set; *received is rebuilt from on decode. */
+size_t tpwire_encode_ld_delta(const LD_MESSAGE* m, MatrixClock* sent, int commit,
+                              unsigned char* out, size_t cap);
+int tpwire_decode_ld_delta(const unsigned char* in, size_t len, MatrixClock* received, LD_MESSAGE* m);
+size_t tpwire_encode_ft_delta(const FT_MESSAGE* m, MatrixClock* sent, int commit,
+                              unsigned char* out, size_t cap);
+int tpwire_decode_ft_delta(const unsigned char* in, size_t len, MatrixClock* received, FT_MESSAGE* m);
+
+/* Sequenced leader messages for unreliable transports (multicast cruise
+ * commands). They carry a stateless clock. */
+size_t tpwire_encode_ld_seq(const LD_MESSAGE* m, uint32_t seq, unsigned char* out, size_t cap);
+int tpwire_decode_ld_seq(const unsigned char* in, size_t len, uint32_t* seq, LD_MESSAGE* m);
+
+/* Gap detector for a sequenced stream. *next is the sequence number expected
+ * next. Returns how many messages were skipped (0 = in order) and moves *next
+ * past seq, or -1 for a duplicate/reordered message, leaving *next alone. */
+int tpwire_seq_check(uint32_t* next, uint32_t seq);
+
+#endif
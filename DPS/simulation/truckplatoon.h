@@ -13,8 +13,14 @@
 #define LEADER_IP   "127.0.0.1"
 #define LEADER_PORT 5000 
 
+/* Optional multicast data plane for periodic cruise commands (leader --mcast).
+ * TTL 1 with loopback enabled, so a platoon on one host works too. Platoon p
+ * uses port LEADER_MCAST_PORT + p. */
+#define LEADER_MCAST_GROUP "239.255.77.1"
+#define LEADER_MCAST_PORT 5100
+
 #define LEADER_SLEEP 1
-#define MAX_FOLLOWERS 5
+#define MAX_FOLLOWERS 1024   // admission limit; the leader's session table grows on demand
 #define CMD_QUEUE_SIZE 10
 #define SAFE_DISTANCE 15 
 #define SIM_DT 0.1f // Legacy default; prefer *_DT constants below
@@ -44,6 +50,28 @@
  */
 #define LEADER_RX_TIMEOUT_MS 2000
 #define LEADER_WATCHDOG_PERIOD_MS 100
+
+/* Session resume: when a follower's link to the leader drops, the leader holds
+ * its slot for LEADER_RESUME_MS (leader --resume-ms) while the follower
+ * reconnects with backoff and presents the session token it got with
+ * MSG_LDR_ASSIGN_ID. It is then told only the topology and cruise commands it
+ * missed; the rest of the platoon does not reform.
+ */
+#define LEADER_RESUME_MS 3000
+#define FOLLOWER_RECONNECT_MIN_MS 50
+#define FOLLOWER_RECONNECT_MAX_MS 800
+
+/* Send-on-change cruise commands (leader --on-change)
+ * The leader sends a full command only when speed, direction, state or a turn
+ * changes, when dead reckoning from the last full command would be off by more
+ * than LEADER_DR_THRESHOLD metres, or every LEADER_CMD_REFRESH_MS. Followers
+ * extrapolate the leader from that command meanwhile. A heartbeat naming the
+ * command goes out whenever the leader has been quiet for LEADER_HEARTBEAT_MS,
+ * which keeps the follower watchdog satisfied.
+ */
+#define LEADER_HEARTBEAT_MS (LEADER_RX_TIMEOUT_MS / 2)
+#define LEADER_CMD_REFRESH_MS 10000
+#define LEADER_DR_THRESHOLD 0.5f
 /* Directions & States */
 typedef enum {
     NORTH,
@@ -58,7 +86,9 @@ typedef enum {
     MSG_LDR_UPDATE_REAR, 
     MSG_LDR_EMERGENCY_BRAKE, 
     MSG_LDR_ASSIGN_ID,
-    MSG_LDR_SPAWN
+    MSG_LDR_SPAWN,
+    MSG_LDR_MCAST_JOIN,
+    MSG_LDR_HEARTBEAT
 } Leader_Truck_MSG_Type;
 
 typedef enum {
@@ -103,12 +133,20 @@ typedef struct {
     float turn_point_x; 
     float turn_point_y; 
     DIRECTION turn_dir; 
+    int32_t platoon_id;   /* leader-internal routing, not on the wire */
+    int32_t is_heartbeat; /* leader-internal: send as MSG_LDR_HEARTBEAT for command_id */
 } LeaderCommand;
 
 /* Registration message*/
 typedef struct {
     NetInfo selfAddress;
     MatrixClock matrix_clock;
+    int32_t platoon_id;   /* platoon to join; 0 = the default platoon */
+    /* Resume after a dropped link: the token from MSG_LDR_ASSIGN_ID (0 = new
+     * join), the newest topology epoch and full cruise command applied */
+    uint64_t resume_token;
+    uint32_t topo_epoch;
+    uint64_t last_cmd_id;
 } FollowerRegisterMsg;
 
 /* Topology message */
@@ -127,6 +165,12 @@ typedef struct {
     DIRECTION spawn_dir;
 } SpawnInfoMsg;
 
+/* Multicast join message (TCP): cruise commands now arrive on this group.
+ * next_seq is the sequence number of the next datagram, for gap detection. */
+typedef struct {
+    NetInfo group;
+    uint32_t next_seq;
+} McastInfoMsg;
 
 typedef struct {
     int32_t speed;          // intruder speed
@@ -134,14 +178,6 @@ typedef struct {
     uint32_t duration_ms;   // expected intrusion duration
 } IntruderInfo;
 
-typedef struct {
-    LeaderCommand queue[CMD_QUEUE_SIZE];
-    int32_t head;
-    int32_t tail;
-    pthread_mutex_t mutex;
-    pthread_cond_t not_empty;
-} CommandQueue;
-
 typedef struct {
     Leader_Truck_MSG_Type type; 
     union {
@@ -149,7 +185,10 @@ typedef struct {
         RearInfoMsg rearInfo; 
         int32_t assigned_id;
         SpawnInfoMsg spawn;
+        McastInfoMsg mcast;
     } payload; 
+    uint32_t topo_epoch;    /* ASSIGN_ID, UPDATE_REAR, SPAWN: topology epoch they belong to */
+    uint64_t session_token; /* ASSIGN_ID: what a reconnect presents to resume this slot */
     MatrixClock matrix_clock;      
 }LD_MESSAGE;
 